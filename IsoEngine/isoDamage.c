@@ -0,0 +1,269 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "isoEngine.h"
+#include "isoDamage.h"
+#include "../renderer.h"
+#include "../texture.h"
+#include "../logger.h"
+
+static void isoDamageCheckChunks(isoDamageT *damage,isoEngineT *isoEngine);
+static void isoDamageGetChunkQuad(isoEngineT *isoEngine,int chunkX,int chunkY,SDL_Rect *chunkQuad);
+static void isoDamageSaveChunks(isoDamageT *damage,isoEngineT *isoEngine);
+
+isoDamageT *isoDamageNew()
+{
+    isoDamageT *damage = malloc(sizeof(struct isoDamageT));
+
+    if(damage == NULL){
+        writeToLog("Error in isoDamageNew(...): Could not allocate memory for the damage tracking!","error.txt");
+        return NULL;
+    }
+    damage->full = 1;
+    setupRect(&damage->rect,0,0,0,0);
+    damage->frameSkipped = 0;
+    damage->numFramesDrawn = 0;
+    damage->numFramesSkipped = 0;
+    damage->frame = NULL;
+    damage->width = 0;
+    damage->height = 0;
+    damage->presented = 0;
+    damage->isoMap = NULL;
+    setupRect(&damage->mouseQuad,0,0,0,0);
+    damage->chunkStartX = 0;
+    damage->chunkStartY = 0;
+    damage->chunkEndX = -1;
+    damage->chunkEndY = -1;
+    damage->maxChunkRevisions = 0;
+    damage->chunkRevisions = NULL;
+
+    return damage;
+}
+
+void isoDamageFree(isoDamageT *damage)
+{
+    if(damage != NULL)
+    {
+        if(damage->frame != NULL){
+            SDL_DestroyTexture(damage->frame);
+        }
+        if(damage->chunkRevisions != NULL){
+            free(damage->chunkRevisions);
+        }
+        free(damage);
+    }
+}
+
+//Something the engine does not know about has changed inside rect (in screen pixels),
+//for example an entity that moved: add the rectangle it was drawn in and the one it will be drawn in.
+void isoDamageAddRect(isoDamageT *damage,SDL_Rect *rect)
+{
+    if(damage == NULL || rect == NULL || SDL_RectEmpty(rect)){
+        return;
+    }
+    if(SDL_RectEmpty(&damage->rect)){
+        damage->rect = *rect;
+    }
+    else{
+        SDL_UnionRect(&damage->rect,rect,&damage->rect);
+    }
+}
+
+//Repaint everything with the next frame, for example when the window has been uncovered or the
+//renderer has lost its render targets. The last frame may be gone with them, so it is created again.
+void isoDamageAddFull(isoDamageT *damage)
+{
+    if(damage == NULL){
+        return;
+    }
+    damage->full = 1;
+    if(damage->frame != NULL){
+        SDL_DestroyTexture(damage->frame);
+        damage->frame = NULL;
+    }
+}
+
+//Call before drawing a frame. Returns 0 if nothing on the screen has changed since the last presented frame,
+//then the frame is not drawn or presented at all. Otherwise the renderer draws into the last frame,
+//clipped to the damaged rectangle, until isoDamageEndFrame copies it to the screen.
+//Clearing has to be done with SDL_RenderFillRect, SDL_RenderClear ignores the clip rectangle.
+int isoDamageBeginFrame(isoDamageT *damage,isoEngineT *isoEngine)
+{
+    int width,height;
+    SDL_Rect mouseQuad;
+
+    if(damage == NULL || isoEngine == NULL){
+        return 1;
+    }
+    damage->frameSkipped = 0;
+
+    //a new window size needs a new frame
+    SDL_GetRendererOutputSize(getRenderer(),&width,&height);
+    if(width != damage->width || height != damage->height){
+        isoDamageAddFull(damage);
+        damage->width = width;
+        damage->height = height;
+    }
+    if(damage->frame == NULL && SDL_RenderTargetSupported(getRenderer()) == SDL_TRUE && width > 0 && height > 0){
+        damage->frame = SDL_CreateTexture(getRenderer(),SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_TARGET,width,height);
+        if(damage->frame == NULL){
+            writeToLog("Error in isoDamageBeginFrame(...): Could not create render target texture, every frame is drawn in full!","error.txt");
+        }
+        damage->full = 1;
+    }
+
+    //the camera moved, everything on the screen moved with it
+    if(damage->presented == 0 || isoEngine->scrollX != damage->scrollX || isoEngine->scrollY != damage->scrollY ||
+       isoEngine->zoomLevel != damage->zoomLevel || isoEngine->drawMode != damage->drawMode || isoEngine->isoMap != damage->isoMap){
+        damage->full = 1;
+    }
+
+    if(damage->full == 0 && isoEngine->isoMap != NULL && isoEngine->isoMap->tileSet->tileClipRects != NULL){
+        isoEngineGetIsoMouseQuad(isoEngine,&mouseQuad);
+        if(SDL_RectEquals(&mouseQuad,&damage->mouseQuad) == SDL_FALSE){
+            isoDamageAddRect(damage,&damage->mouseQuad);
+            isoDamageAddRect(damage,&mouseQuad);
+        }
+        isoDamageCheckChunks(damage,isoEngine);
+    }
+
+    if(damage->full == 0 && SDL_RectEmpty(&damage->rect)){
+        damage->frameSkipped = 1;
+        damage->numFramesSkipped++;
+        return 0;
+    }
+    damage->numFramesDrawn++;
+
+    if(damage->frame != NULL){
+        SDL_SetRenderTarget(getRenderer(),damage->frame);
+        if(damage->full == 0){
+            SDL_RenderSetClipRect(getRenderer(),&damage->rect);
+        }
+    }
+    return 1;
+}
+
+//Call after the frame has been drawn, right before SDL_RenderPresent. Puts the frame on the screen
+//and remembers what it shows, for the next isoDamageBeginFrame.
+void isoDamageEndFrame(isoDamageT *damage,isoEngineT *isoEngine)
+{
+    if(damage == NULL || isoEngine == NULL || damage->frameSkipped){
+        return;
+    }
+    if(damage->frame != NULL){
+        SDL_RenderSetClipRect(getRenderer(),NULL);
+        SDL_SetRenderTarget(getRenderer(),NULL);
+        //the back buffer is undefined after every present, so the whole frame is copied
+        SDL_RenderCopy(getRenderer(),damage->frame,NULL,NULL);
+        countDrawCall();
+    }
+    damage->presented = 1;
+    damage->full = 0;
+    setupRect(&damage->rect,0,0,0,0);
+    damage->scrollX = isoEngine->scrollX;
+    damage->scrollY = isoEngine->scrollY;
+    damage->zoomLevel = isoEngine->zoomLevel;
+    damage->drawMode = isoEngine->drawMode;
+    damage->isoMap = isoEngine->isoMap;
+
+    setupRect(&damage->mouseQuad,0,0,0,0);
+    if(isoEngine->isoMap != NULL && isoEngine->isoMap->tileSet->tileClipRects != NULL){
+        isoEngineGetIsoMouseQuad(isoEngine,&damage->mouseQuad);
+    }
+    isoDamageSaveChunks(damage,isoEngine);
+}
+
+//A chunk on the screen with a new revision has had tiles changed (isoMapSetTile), a new tile set, or has been paged in
+static void isoDamageCheckChunks(isoDamageT *damage,isoEngineT *isoEngine)
+{
+    int chunkX,chunkY;
+    int i = 0;
+    SDL_Rect chunkQuad;
+
+    for(chunkY=damage->chunkStartY;chunkY<=damage->chunkEndY;++chunkY){
+        for(chunkX=damage->chunkStartX;chunkX<=damage->chunkEndX;++chunkX){
+            if(isoMapGetChunkRevision(isoEngine->isoMap,chunkX,chunkY) != damage->chunkRevisions[i++]){
+                isoDamageGetChunkQuad(isoEngine,chunkX,chunkY,&chunkQuad);
+                isoDamageAddRect(damage,&chunkQuad);
+            }
+        }
+    }
+}
+
+//The revisions of the chunks under the visible tiles of the frame that was just drawn
+static void isoDamageSaveChunks(isoDamageT *damage,isoEngineT *isoEngine)
+{
+    int chunkX,chunkY;
+    int i = 0;
+    int numChunks;
+    Uint32 *chunkRevisions;
+    isoVisibleRangeT *range = &isoEngine->visibleTiles;
+
+    damage->chunkStartX = 0;
+    damage->chunkStartY = 0;
+    damage->chunkEndX = -1;
+    damage->chunkEndY = -1;
+    if(isoEngine->isoMap == NULL || range->startY > range->endY || range->minX > range->maxX){
+        return;
+    }
+    numChunks = ((range->maxX>>MAP_CHUNK_SHIFT)-(range->minX>>MAP_CHUNK_SHIFT)+1) * ((range->endY>>MAP_CHUNK_SHIFT)-(range->startY>>MAP_CHUNK_SHIFT)+1);
+    if(numChunks > damage->maxChunkRevisions){
+        chunkRevisions = realloc(damage->chunkRevisions,numChunks*sizeof(Uint32));
+        if(chunkRevisions == NULL){
+            //without the revisions a changed tile is not noticed, repaint everything next time
+            writeToLog("Error in isoDamageEndFrame(...): Could not allocate memory for the chunk revisions!","error.txt");
+            damage->presented = 0;
+            return;
+        }
+        damage->chunkRevisions = chunkRevisions;
+        damage->maxChunkRevisions = numChunks;
+    }
+    damage->chunkStartX = range->minX>>MAP_CHUNK_SHIFT;
+    damage->chunkStartY = range->startY>>MAP_CHUNK_SHIFT;
+    damage->chunkEndX = range->maxX>>MAP_CHUNK_SHIFT;
+    damage->chunkEndY = range->endY>>MAP_CHUNK_SHIFT;
+
+    for(chunkY=damage->chunkStartY;chunkY<=damage->chunkEndY;++chunkY){
+        for(chunkX=damage->chunkStartX;chunkX<=damage->chunkEndX;++chunkX){
+            damage->chunkRevisions[i++] = isoMapGetChunkRevision(isoEngine->isoMap,chunkX,chunkY);
+        }
+    }
+}
+
+//The screen rectangle a chunk is drawn in. A tile's screen position grows linearly with x and y,
+//so the quads of the four corner tiles, drawn as large as the largest tile, enclose the whole chunk.
+static void isoDamageGetChunkQuad(isoEngineT *isoEngine,int chunkX,int chunkY,SDL_Rect *chunkQuad)
+{
+    int i;
+    int x,y;
+    isoMapT *isoMap = isoEngine->isoMap;
+    SDL_Rect tileRect;
+    SDL_Rect quad;
+    point2DT point;
+
+    setupRect(&tileRect,0,0,0,0);
+    for(i=0;i<isoMap->tileSet->numTileClipRects;++i){
+        if(isoMap->tileSet->tileClipRects[i].w > tileRect.w) tileRect.w = isoMap->tileSet->tileClipRects[i].w;
+        if(isoMap->tileSet->tileClipRects[i].h > tileRect.h) tileRect.h = isoMap->tileSet->tileClipRects[i].h;
+    }
+    setupRect(chunkQuad,0,0,0,0);
+
+    for(i=0;i<4;++i){
+        x = (chunkX<<MAP_CHUNK_SHIFT) + ((i&1) ? MAP_CHUNK_MASK : 0);
+        y = (chunkY<<MAP_CHUNK_SHIFT) + ((i&2) ? MAP_CHUNK_MASK : 0);
+        point.x = ((x*isoEngine->zoomLevel *isoMap->tileSize) + isoEngine->scrollX);
+        point.y = ((y*isoEngine->zoomLevel *isoMap->tileSize) + isoEngine->scrollY);
+        isoEngineConvert2dToIso(&point);
+        textureGetQuadXYClipScale(isoMap->tileSet->tilesTex,point.x,point.y,&tileRect,isoEngine->zoomLevel,&quad);
+        //rounding of the scaled positions
+        quad.x -= 1;
+        quad.y -= 1;
+        quad.w += 2;
+        quad.h += 2;
+        if(i == 0){
+            *chunkQuad = quad;
+        }
+        else{
+            SDL_UnionRect(chunkQuad,&quad,chunkQuad);
+        }
+    }
+}
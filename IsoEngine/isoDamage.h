@@ -0,0 +1,49 @@
+#ifndef __ISO_DAMAGE_H_
+#define __ISO_DAMAGE_H_
+
+#include <SDL2/SDL.h>
+#include "isoMap.h"
+
+//Damage tracking: what has changed on the screen since the last presented frame.
+//The engine notices changes of the camera, the zoom level, the iso mouse and the map chunks on the screen,
+//the game adds the screen rectangles of everything else it draws (entities, the user interface) with isoDamageAddRect.
+//A frame without damage is not drawn at all, a frame with a little damage is only repainted inside the damaged rectangle.
+struct isoEngineT;
+
+typedef struct isoDamageT
+{
+    int full;           //the whole screen has to be repainted
+    SDL_Rect rect;      //otherwise only this rectangle (empty if nothing changed)
+    int frameSkipped;   //the last isoDamageBeginFrame found nothing to draw
+    int numFramesDrawn;
+    int numFramesSkipped;
+
+    //the last presented frame, partial repaints are drawn into it and it is copied to the screen
+    SDL_Texture *frame;
+    int width;
+    int height;
+
+    //what was on the screen when the last frame was presented
+    int presented;
+    int scrollX;
+    int scrollY;
+    float zoomLevel;
+    int drawMode;
+    isoMapT *isoMap;
+    SDL_Rect mouseQuad;
+    int chunkStartX;
+    int chunkStartY;
+    int chunkEndX;
+    int chunkEndY;
+    int maxChunkRevisions;
+    Uint32 *chunkRevisions;
+}isoDamageT;
+
+isoDamageT *isoDamageNew();
+void isoDamageFree(isoDamageT *damage);
+void isoDamageAddRect(isoDamageT *damage,SDL_Rect *rect);
+void isoDamageAddFull(isoDamageT *damage);
+int isoDamageBeginFrame(isoDamageT *damage,struct isoEngineT *isoEngine);
+void isoDamageEndFrame(isoDamageT *damage,struct isoEngineT *isoEngine);
+
+#endif // __ISO_DAMAGE_H_
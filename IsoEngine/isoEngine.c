@@ -2,9 +2,36 @@
 #include <stdlib.h>
 #include <math.h>
 #include "isoEngine.h"
+#include "isoMapPager.h"
+#include "isoTransform.h"
 #include "../logger.h"
 #include "../renderer.h"
 
+static int isoEngineIsTileOnScreen(isoEngineT *isoEngine,int x,int y,SDL_Rect *tileRect);
+static void isoEngineGetIsoMousePos(isoEngineT *isoEngine,int *x,int *y);
+static void isoEngineGetTileQuadPos(isoEngineT *isoEngine,int x,int y,int *quadX,int *quadY);
+static void isoEngineFreeTileBands(isoEngineT *isoEngine);
+
+//what every pick on the same camera needs, in 1/ISO_PICK_ONE pixels
+#define ISO_PICK_SHIFT  8
+#define ISO_PICK_ONE    (1<<ISO_PICK_SHIFT)
+#define ISO_PICK_MARGIN (6*ISO_PICK_ONE)
+
+typedef struct isoPickT
+{
+    Sint64 step;        //the distance between two tiles, half the width and the height of a tile's diamond
+    Sint64 scrollX;
+    Sint64 scrollY;
+}isoPickT;
+
+//what the thread pool needs to generate the quads of one band
+typedef struct isoEngineBandJobT
+{
+    isoEngineT *isoEngine;
+    isoVisibleRangeT *range;
+    SDL_Point *quadSizes;
+}isoEngineBandJobT;
+
 void setupRect(SDL_Rect *rect,int x,int y,int w,int h)
 {
     rect->x = x;
@@ -29,9 +56,28 @@ isoEngineT *isoEngineNewIsoEngine()
     isoEngine->mapScroll2Dpos.y = 0;
     isoEngine->zoomLevel = 1.0;
     isoEngine->lastTileClicked = -1;
+    isoEngine->drawMode = ISO_ENGINE_DRAW_CACHED;
+    textureBatchInit(&isoEngine->mapBatch);
+    isoEngine->visibleTiles.maxRows = 0;
+    isoEngine->visibleTiles.spanStartX = NULL;
+    isoEngine->visibleTiles.spanEndX = NULL;
+    //without a thread pool the tiles are generated on the calling thread
+    isoEngine->threadPool = threadPoolNew(-1);
+    isoEngine->tileBands = NULL;
+    isoEngine->maxTileBands = 0;
+    isoTransformSetImplementation(ISO_TRANSFORM_AUTO);
+    isoEngine->renderCache = isoRenderCacheNew(ISO_RENDER_CACHE_DEFAULT_BUDGET);
+    if(isoEngine->renderCache == NULL){
+        isoEngine->drawMode = ISO_ENGINE_DRAW_BATCHED;
+    }
+    //without damage tracking every frame is drawn
+    isoEngine->damage = isoDamageNew();
+    isoEngine->renderQueue = isoRenderQueueNew();
     isoEngine->isoMap = NULL;
 
     setupRect(&isoEngine->mouseRect,0,0,1,1);
+    isoEngine->mouseScreenPos.x = 0;
+    isoEngine->mouseScreenPos.y = 0;
     isoEngine->tilePos.x = 0;
     isoEngine->tilePos.y = 0;
 
@@ -46,6 +92,13 @@ void isoEngineFreeIsoEngine(isoEngineT *isoEngine)
         {
             isoMapFreeMap(isoEngine->isoMap);
         }
+        textureBatchFree(&isoEngine->mapBatch);
+        isoRenderCacheFree(isoEngine->renderCache);
+        isoDamageFree(isoEngine->damage);
+        isoRenderQueueFree(isoEngine->renderQueue);
+        isoEngineFreeVisibleTiles(&isoEngine->visibleTiles);
+        isoEngineFreeTileBands(isoEngine);
+        threadPoolFree(isoEngine->threadPool);
         free(isoEngine);
     }
 }
@@ -69,11 +122,11 @@ void isoEngineConvertIsoTo2D(point2DT *point)
 void isoEngineGetTileCoordinates(isoEngineT *isoEngine,point2DT *point,point2DT *point2DCoord)
 {
     if(isoEngine == NULL){
-        writeToLog("Error in isoEngineGetTileCoordinates(...): - isoEngine is NULL!","error.txt");
+        logError("error.txt","isoEngineGetTileCoordinates(...) - isoEngine is NULL!");
         return;
     }
     if(isoEngine->isoMap == NULL){
-        writeToLog("Error in isoEngineGetTileCoordinates(...): - isoEngine->isoMap is NULL!","error.txt");
+        logError("error.txt","isoEngineGetTileCoordinates(...) - isoEngine->isoMap is NULL!");
         return;
     }
     float tempX = (float)point->x / (float)isoEngine->isoMap->tileSize;
@@ -138,9 +191,9 @@ void isoEngineConvertCartesianCameraToIsometric(isoEngineT *isoEngine,point2DT *
 
 void isoEngineUpdateMousePos(isoEngineT *isoEngine)
 {
-    SDL_GetMouseState(&isoEngine->mouseRect.x,&isoEngine->mouseRect.y);
-    isoEngine->mouseRect.x = isoEngine->mouseRect.x/isoEngine->zoomLevel;
-    isoEngine->mouseRect.y = isoEngine->mouseRect.y/isoEngine->zoomLevel;
+    SDL_GetMouseState(&isoEngine->mouseScreenPos.x,&isoEngine->mouseScreenPos.y);
+    isoEngine->mouseRect.x = isoEngine->mouseScreenPos.x/isoEngine->zoomLevel;
+    isoEngine->mouseRect.y = isoEngine->mouseScreenPos.y/isoEngine->zoomLevel;
 }
 
 void isoEngineScrollMapWithMouse(isoEngineT *isoEngine)
@@ -179,31 +232,329 @@ void isoEngineDrawIsoMouse(isoEngineT *isoEngine)
         writeToLog("Error in function isoEngineDrawIsoMouse(...) - isoEngine->isoMap is NULL!","error.txt");
         return;
     }
-    int modulusX = isoEngine->isoMap->tileSize*isoEngine->zoomLevel;
-    int modulusY = isoEngine->isoMap->tileSize*isoEngine->zoomLevel;
-    int correctX =(((int)isoEngine->mapScroll2Dpos.x)%modulusX)*2;
-    int correctY = ((int)isoEngine->mapScroll2Dpos.y)%modulusY;
+    int x,y;
+    SDL_Point *quadSizes = isoMapGetTileQuadSizes(isoEngine->isoMap,isoEngine->zoomLevel);
 
-    isoEngine->mousePoint.x = (isoEngine->mouseRect.x/isoEngine->isoMap->tileSize) * isoEngine->isoMap->tileSize;
-    isoEngine->mousePoint.y = (isoEngine->mouseRect.y/isoEngine->isoMap->tileSize) * isoEngine->isoMap->tileSize;
+    if(quadSizes == NULL){
+        return;
+    }
+    isoEngineGetIsoMousePos(isoEngine,&x,&y);
+    textureRenderXYClipSize(&isoEngine->isoMap->tileSet->tilesTex[0],x,y,&isoEngine->isoMap->tileSet->tileClipRects[0],&quadSizes[0]);
+}
 
-    //For every other x position on the map
-    if(((int)isoEngine->mousePoint.x/isoEngine->isoMap->tileSize)%2){
-        //Move the mouse down by half a tile so we can
-        //pick isometric tiles on that row as well.
-        isoEngine->mousePoint.y+=isoEngine->isoMap->tileSize*0.5;
+//Where isoEngineDrawIsoMouse draws the iso mouse on the screen
+void isoEngineGetIsoMouseQuad(isoEngineT *isoEngine,SDL_Rect *quad)
+{
+    int x,y;
+    SDL_Point *quadSizes = isoMapGetTileQuadSizes(isoEngine->isoMap,isoEngine->zoomLevel);
+
+    if(quadSizes == NULL){
+        setupRect(quad,0,0,0,0);
+        return;
     }
-    textureRenderXYClipScale(&isoEngine->isoMap->tileSet->tilesTex[0],(isoEngine->zoomLevel*isoEngine->mousePoint.x)-correctX,
-                             (isoEngine->zoomLevel*isoEngine->mousePoint.y)+correctY,&isoEngine->isoMap->tileSet->tileClipRects[0],isoEngine->zoomLevel);
+    isoEngineGetIsoMousePos(isoEngine,&x,&y);
+    textureGetQuadXYClipSize(x,y,&quadSizes[0],quad);
 }
 
+//The iso mouse is drawn over the tile under the mouse
+static void isoEngineGetIsoMousePos(isoEngineT *isoEngine,int *x,int *y)
+{
+    int tileX,tileY;
 
-void isoEngineDrawIsoMap(isoEngineT *isoEngine)
+    isoEnginePickTile(isoEngine,isoEngine->mouseScreenPos.x,isoEngine->mouseScreenPos.y,&tileX,&tileY);
+    isoEngineGetTileQuadPos(isoEngine,tileX,tileY,x,y);
+}
+
+//Is any pixel of a tile with the size of tileRect, drawn at map position x,y, on the screen?
+static int isoEngineIsTileOnScreen(isoEngineT *isoEngine,int x,int y,SDL_Rect *tileRect)
 {
-    int i,j;
-    int x,y;
-    int tile = 4;
     point2DT point;
+    SDL_Rect quad;
+
+    //the same position and size as when the tile is drawn
+    point.x = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
+    point.y = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
+    isoEngineConvert2dToIso(&point);
+    textureGetQuadXYClipScale(isoEngine->isoMap->tileSet->tilesTex,point.x,point.y,tileRect,isoEngine->zoomLevel,&quad);
+
+    return quad.x < WINDOW_WIDTH && quad.y < WINDOW_HEIGHT && quad.x+quad.w > 0 && quad.y+quad.h > 0;
+}
+
+//Works out exactly which tiles intersect the screen for the current scroll position and zoom level.
+//Every map row crosses the screen in one span of tiles, because the screen position of a tile
+//grows with x on a row. The span ends are estimated from the screen size and then moved tile by tile
+//until they match isoEngineIsTileOnScreen(), so a tile is never missed or drawn off the screen.
+//Returns 0 if nothing is visible.
+int isoEngineGetVisibleTiles(isoEngineT *isoEngine,isoVisibleRangeT *range)
+{
+    int i,y;
+    int rows;
+    int startX,endX;
+    int *spanStartX,*spanEndX;
+    float lowU,highU,v;
+    float step;
+    float tileW,tileH;
+    SDL_Rect tileRect;
+    isoMapT *isoMap;
+
+    range->startY = 0;
+    range->endY = -1;
+    range->minX = 0;
+    range->maxX = -1;
+
+    if(isoEngine == NULL || isoEngine->isoMap == NULL || isoEngine->isoMap->tileSet == NULL){
+        return 0;
+    }
+    isoMap = isoEngine->isoMap;
+    if(isoMap->tileSet->tileClipRects == NULL || isoMap->tileSet->numTileClipRects <= 0){
+        return 0;
+    }
+
+    //a tile is on the screen if the largest tile of the tile set would be
+    setupRect(&tileRect,0,0,0,0);
+    for(i=0;i<isoMap->tileSet->numTileClipRects;++i){
+        if(isoMap->tileSet->tileClipRects[i].w > tileRect.w) tileRect.w = isoMap->tileSet->tileClipRects[i].w;
+        if(isoMap->tileSet->tileClipRects[i].h > tileRect.h) tileRect.h = isoMap->tileSet->tileClipRects[i].h;
+    }
+    tileW = tileRect.w*isoEngine->zoomLevel+1;
+    tileH = tileRect.h*isoEngine->zoomLevel+1;
+    step = isoEngine->zoomLevel*isoMap->tileSize;
+
+    //with u = x*step+scrollX and v = y*step+scrollY a tile is drawn at (u-v, (u+v)/2).
+    //It is visible when -tileW < u-v < WINDOW_WIDTH and -tileH < (u+v)/2 < WINDOW_HEIGHT
+    range->startY = (int)floor((-tileH - WINDOW_WIDTH/2.0f - isoEngine->scrollY)/step) - 1;
+    range->endY = (int)ceil((WINDOW_HEIGHT + tileW/2.0f - isoEngine->scrollY)/step) + 1;
+    if(range->startY < 0) range->startY = 0;
+    if(range->endY > isoMap->mapHeight-1) range->endY = isoMap->mapHeight-1;
+    if(range->startY > range->endY){
+        return 0;
+    }
+
+    rows = range->endY-range->startY+1;
+    if(rows > range->maxRows){
+        spanStartX = realloc(range->spanStartX,rows*sizeof(int));
+        if(spanStartX == NULL){
+            writeToLog("Error in function isoEngineGetVisibleTiles(...) - Could not allocate memory for the visible tile spans!","error.txt");
+            range->endY = range->startY-1;
+            return 0;
+        }
+        range->spanStartX = spanStartX;
+        spanEndX = realloc(range->spanEndX,rows*sizeof(int));
+        if(spanEndX == NULL){
+            writeToLog("Error in function isoEngineGetVisibleTiles(...) - Could not allocate memory for the visible tile spans!","error.txt");
+            range->endY = range->startY-1;
+            return 0;
+        }
+        range->spanEndX = spanEndX;
+        range->maxRows = rows;
+    }
+    range->minX = isoMap->mapWidth;
+
+    for(y=range->startY;y<=range->endY;++y){
+        v = y*step + isoEngine->scrollY;
+        lowU = SDL_max(v - tileW,-2*tileH - v);
+        highU = SDL_min(v + WINDOW_WIDTH,2*WINDOW_HEIGHT - v);
+
+        //estimate, then move the span ends onto the first and last visible tile
+        startX = SDL_max((int)floor((lowU - isoEngine->scrollX)/step) - 1,0);
+        endX = SDL_min((int)ceil((highU - isoEngine->scrollX)/step) + 1,isoMap->mapWidth-1);
+
+        while(startX > 0 && isoEngineIsTileOnScreen(isoEngine,startX-1,y,&tileRect)){
+            startX--;
+        }
+        while(startX <= endX && !isoEngineIsTileOnScreen(isoEngine,startX,y,&tileRect)){
+            startX++;
+        }
+        while(endX < isoMap->mapWidth-1 && isoEngineIsTileOnScreen(isoEngine,endX+1,y,&tileRect)){
+            endX++;
+        }
+        while(endX >= startX && !isoEngineIsTileOnScreen(isoEngine,endX,y,&tileRect)){
+            endX--;
+        }
+        range->spanStartX[y-range->startY] = startX;
+        range->spanEndX[y-range->startY] = endX;
+
+        if(startX <= endX){
+            if(startX < range->minX) range->minX = startX;
+            if(endX > range->maxX) range->maxX = endX;
+        }
+    }
+    if(range->minX > range->maxX){
+        range->startY = 0;
+        range->endY = -1;
+        return 0;
+    }
+    return 1;
+}
+
+void isoEngineFreeVisibleTiles(isoVisibleRangeT *range)
+{
+    if(range->spanStartX != NULL){
+        free(range->spanStartX);
+    }
+    if(range->spanEndX != NULL){
+        free(range->spanEndX);
+    }
+    range->spanStartX = NULL;
+    range->spanEndX = NULL;
+    range->maxRows = 0;
+}
+
+//Adds the quads of the visible tiles on the map rows firstRow to lastRow to the batch.
+//Only reads the engine and the map, so several bands can be generated at the same time.
+//quadSizes is the tile set's quad size table for the current zoom level, see isoMapGetTileQuadSizes.
+static void isoEngineAddTileQuads(isoEngineT *isoEngine,isoVisibleRangeT *range,int firstRow,int lastRow,SDL_Point *quadSizes,textureBatchT *batch)
+{
+    int x,y;
+    int tile;
+    int chunkX,chunkY;
+    int chunkStartX,chunkEndX,chunkStartY,chunkEndY;
+    int startX,endX;
+    isoMapChunkT *chunkData;
+    int rowData[MAP_CHUNK_SIZE];
+    float pointX[MAP_CHUNK_SIZE];
+    float pointY[MAP_CHUNK_SIZE];
+
+    //walk the map chunk by chunk, so the tiles we read are next to each other in memory.
+    //Chunks and the tiles inside them are visited back to front, which keeps the painter's order.
+    for(chunkY=firstRow>>MAP_CHUNK_SHIFT;chunkY<=lastRow>>MAP_CHUNK_SHIFT;++chunkY){
+        for(chunkX=range->minX>>MAP_CHUNK_SHIFT;chunkX<=range->maxX>>MAP_CHUNK_SHIFT;++chunkX){
+
+            chunkData = isoMapGetChunk(isoEngine->isoMap,chunkX,chunkY,0);
+            if(chunkData == NULL){
+                continue;
+            }
+            chunkStartX = chunkX<<MAP_CHUNK_SHIFT;
+            chunkStartY = SDL_max(chunkY<<MAP_CHUNK_SHIFT,firstRow);
+            chunkEndX = chunkStartX+MAP_CHUNK_MASK;
+            chunkEndY = SDL_min((chunkY<<MAP_CHUNK_SHIFT)+MAP_CHUNK_MASK,lastRow);
+
+            for(y=chunkStartY;y<=chunkEndY;++y){
+                isoMapChunkGetRow(chunkData,y&MAP_CHUNK_MASK,rowData);
+
+                //the part of the row's visible span inside this chunk
+                startX = SDL_max(range->spanStartX[y-range->startY],chunkStartX);
+                endX = SDL_min(range->spanEndX[y-range->startY],chunkEndX);
+
+                //the screen positions of the whole segment are converted at once
+                for(x=startX;x<=endX;++x){
+                    pointX[x-startX] = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
+                    pointY[x-startX] = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
+                }
+                isoTransformConvert2dToIso(pointX,pointY,endX-startX+1);
+
+                for(x=startX;x<=endX;++x){
+                    tile = rowData[x&MAP_CHUNK_MASK];
+                    textureBatchAddXYClipSize(batch,pointX[x-startX],pointY[x-startX],
+                                              &isoEngine->isoMap->tileSet->tileClipRects[tile],&quadSizes[tile]);
+                }
+            }
+        }
+    }
+}
+
+static void isoEngineBandJob(void *data,int band)
+{
+    isoEngineBandJobT *bandJob = data;
+    isoTileBandT *tileBand = &bandJob->isoEngine->tileBands[band];
+
+    textureBatchBegin(&tileBand->quads,bandJob->isoEngine->isoMap->tileSet->tilesTex);
+    isoEngineAddTileQuads(bandJob->isoEngine,bandJob->range,tileBand->firstRow,tileBand->lastRow,bandJob->quadSizes,&tileBand->quads);
+}
+
+static void isoEngineFreeTileBands(isoEngineT *isoEngine)
+{
+    int i;
+
+    for(i=0;i<isoEngine->maxTileBands;++i){
+        textureBatchFree(&isoEngine->tileBands[i].quads);
+    }
+    free(isoEngine->tileBands);
+    isoEngine->tileBands = NULL;
+    isoEngine->maxTileBands = 0;
+}
+
+//Splits the visible rows into bands with about the same number of tiles, returns the number of bands
+static int isoEngineSplitTileBands(isoEngineT *isoEngine,isoVisibleRangeT *range)
+{
+    int i,y;
+    int numBands;
+    int numTiles = 0;
+    int bandTiles = 0;
+    isoTileBandT *tileBands;
+
+    for(y=range->startY;y<=range->endY;++y){
+        numTiles += SDL_max(range->spanEndX[y-range->startY]-range->spanStartX[y-range->startY]+1,0);
+    }
+    numBands = SDL_min(threadPoolGetNumThreads(isoEngine->threadPool)*ISO_ENGINE_BANDS_PER_THREAD,
+                       numTiles/ISO_ENGINE_MIN_TILES_PER_BAND);
+    numBands = SDL_min(numBands,range->endY-range->startY+1);
+    if(numBands <= 1){
+        return 1;
+    }
+    if(numBands > isoEngine->maxTileBands){
+        tileBands = realloc(isoEngine->tileBands,numBands*sizeof(isoTileBandT));
+        if(tileBands == NULL){
+            writeToLog("Error in function isoEngineSplitTileBands(...) - Could not allocate memory for the tile bands!","error.txt");
+            return 1;
+        }
+        isoEngine->tileBands = tileBands;
+        for(i=isoEngine->maxTileBands;i<numBands;++i){
+            textureBatchInit(&isoEngine->tileBands[i].quads);
+        }
+        isoEngine->maxTileBands = numBands;
+    }
+
+    //a band ends on the row that brings the tiles so far up to its share
+    i = 0;
+    isoEngine->tileBands[0].firstRow = range->startY;
+    for(y=range->startY;y<range->endY && i<numBands-1;++y){
+        bandTiles += SDL_max(range->spanEndX[y-range->startY]-range->spanStartX[y-range->startY]+1,0);
+        if(bandTiles >= (long long)numTiles*(i+1)/numBands){
+            isoEngine->tileBands[i].lastRow = y;
+            i++;
+            isoEngine->tileBands[i].firstRow = y+1;
+        }
+    }
+    isoEngine->tileBands[i].lastRow = range->endY;
+    return i+1;
+}
+
+//Fills isoEngine->mapBatch with the quads of the visible tiles (isoEngineGetVisibleTiles) in painter's order.
+//Large ranges are split into bands of rows that are generated on the thread pool and appended band by band.
+void isoEngineBuildMapBatch(isoEngineT *isoEngine,isoVisibleRangeT *range)
+{
+    int i;
+    int numBands;
+    isoEngineBandJobT bandJob;
+    SDL_Point *quadSizes;
+
+    textureBatchBegin(&isoEngine->mapBatch,isoEngine->isoMap->tileSet->tilesTex);
+
+    //only changes with the zoom level, the bands share it read only
+    quadSizes = isoMapGetTileQuadSizes(isoEngine->isoMap,isoEngine->zoomLevel);
+    if(quadSizes == NULL){
+        return;
+    }
+    numBands = isoEngineSplitTileBands(isoEngine,range);
+    if(numBands <= 1){
+        isoEngineAddTileQuads(isoEngine,range,range->startY,range->endY,quadSizes,&isoEngine->mapBatch);
+        return;
+    }
+    bandJob.isoEngine = isoEngine;
+    bandJob.range = range;
+    bandJob.quadSizes = quadSizes;
+    threadPoolRun(isoEngine->threadPool,isoEngineBandJob,&bandJob,numBands);
+
+    //the bands are in row order, and so are the quads inside each band
+    for(i=0;i<numBands;++i){
+        textureBatchAppend(&isoEngine->mapBatch,&isoEngine->tileBands[i].quads);
+    }
+}
+
+void isoEngineDrawIsoMap(isoEngineT *isoEngine)
+{
+    isoVisibleRangeT *range;
 
     if(isoEngine==NULL){
         return;
@@ -212,90 +563,258 @@ void isoEngineDrawIsoMap(isoEngineT *isoEngine)
         return;
     }
 
-    int startX = -3/isoEngine->zoomLevel +(isoEngine->mapScroll2Dpos.x/isoEngine->zoomLevel/isoEngine->isoMap->tileSize)*2;
-    int startY = -20/isoEngine->zoomLevel + abs((isoEngine->mapScroll2Dpos.y/isoEngine->zoomLevel/isoEngine->isoMap->tileSize))*2;
-    int numTilesInWidth = ((WINDOW_WIDTH/isoEngine->isoMap->tileSize)/isoEngine->zoomLevel);
-    int numTilesInHeight = ((WINDOW_HEIGHT/isoEngine->isoMap->tileSize)/isoEngine->zoomLevel)*2;
-
     if(isoEngine->isoMap->tileSet != NULL){
 
-        for(i=startY;i<startY+numTilesInHeight+26;++i){
-            for(j=startX;j<startX+numTilesInWidth+5;++j){
+        range = &isoEngine->visibleTiles;
+        if(isoEngineGetVisibleTiles(isoEngine,range)==0){
+            return;
+        }
 
-                //only draw when both x & y is equal, so we skip here
-                if((j&1) != (i&1)){
-                    continue;
-                }
-                x = (i+j)/2;
-                y = (i-j)/2;
-
-                if(x>=0 && y>=0 && x<isoEngine->isoMap->mapWidth && y<isoEngine->isoMap->mapHeight){
-                    tile = isoMapGetTile(isoEngine->isoMap,x,y,0);
-                    point.x = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
-                    point.y = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
-                    isoEngineConvert2dToIso(&point);
-                    textureRenderXYClipScale(isoEngine->isoMap->tileSet->tilesTex,point.x,point.y,
-                                             &isoEngine->isoMap->tileSet->tileClipRects[tile],isoEngine->zoomLevel);
-                }
-            }
+        //a paged map loads the chunks around the visible tiles and drops the ones far away
+        if(isoEngine->isoMap->pager != NULL){
+            isoMapPagerUpdate(isoEngine->isoMap->pager,range->minX,range->startY,range->maxX,range->endY);
+        }
+
+        //the render cache draws whole blocks of tiles, the rest of the screen is clipped away
+        if(isoEngine->drawMode == ISO_ENGINE_DRAW_CACHED && isoRenderCacheDrawMap(isoEngine->renderCache,isoEngine,range)){
+            return;
+        }
+
+        isoEngineBuildMapBatch(isoEngine,range);
+
+        //submit all visible tiles at once, or one by one
+        if(isoEngine->drawMode != ISO_ENGINE_DRAW_PER_TILE){
+            textureBatchDraw(&isoEngine->mapBatch);
+        }
+        else{
+            textureBatchDrawEach(&isoEngine->mapBatch);
         }
     }
 }
 
-void isoEngineGetMouseTilePos(isoEngineT *isoEngine, point2DT *mouseTilePos)
+//Adds the visible tiles of the layers firstLayer to lastLayer to the render queue, each with the depth x+y of its tile.
+//Empty tiles are left out above the ground layer. Nothing is drawn, see isoRenderQueueDraw.
+void isoEngineQueueIsoMap(isoEngineT *isoEngine,isoRenderQueueT *queue,int firstLayer,int lastLayer)
 {
-    if(isoEngine == NULL){
-        writeToLog("Error in function isoEngineDrawIsoMouse(...) - isoEngine is NULL!","error.txt");
+    int x,y;
+    int layer;
+    int tile;
+    int chunkX,chunkY;
+    int chunkStartX,chunkEndX,chunkStartY,chunkEndY;
+    int startX,endX;
+    Uint32 layerKey;
+    isoVisibleRangeT *range;
+    isoMapChunkT *chunkData;
+    SDL_Point *quadSizes;
+    int rowData[MAP_CHUNK_SIZE];
+    float pointX[MAP_CHUNK_SIZE];
+    float pointY[MAP_CHUNK_SIZE];
+
+    if(isoEngine == NULL || queue == NULL || isoEngine->isoMap == NULL || isoEngine->isoMap->tileSet == NULL){
         return;
     }
-    if(isoEngine->isoMap == NULL){
-        writeToLog("Error in function isoEngineDrawIsoMouse(...) - isoEngine->isoMap is NULL!","error.txt");
+    range = &isoEngine->visibleTiles;
+    if(isoEngineGetVisibleTiles(isoEngine,range) == 0){
+        return;
+    }
+    quadSizes = isoMapGetTileQuadSizes(isoEngine->isoMap,isoEngine->zoomLevel);
+    if(quadSizes == NULL){
         return;
     }
+    firstLayer = SDL_max(firstLayer,0);
+    lastLayer = SDL_min(SDL_min(lastLayer,isoEngine->isoMap->numLayers-1),ISO_RENDER_QUEUE_MAX_LAYER);
+
+    for(layer=firstLayer;layer<=lastLayer;++layer){
+        layerKey = ISO_RENDER_QUEUE_KEY(0,layer,0);
+        for(chunkY=range->startY>>MAP_CHUNK_SHIFT;chunkY<=range->endY>>MAP_CHUNK_SHIFT;++chunkY){
+            for(chunkX=range->minX>>MAP_CHUNK_SHIFT;chunkX<=range->maxX>>MAP_CHUNK_SHIFT;++chunkX){
+
+                //a chunk that is not stored is all empty tiles
+                chunkData = isoMapGetChunk(isoEngine->isoMap,chunkX,chunkY,layer);
+                if(chunkData == NULL){
+                    continue;
+                }
+                chunkStartX = chunkX<<MAP_CHUNK_SHIFT;
+                chunkStartY = SDL_max(chunkY<<MAP_CHUNK_SHIFT,range->startY);
+                chunkEndX = chunkStartX+MAP_CHUNK_MASK;
+                chunkEndY = SDL_min((chunkY<<MAP_CHUNK_SHIFT)+MAP_CHUNK_MASK,range->endY);
+
+                for(y=chunkStartY;y<=chunkEndY;++y){
+                    startX = SDL_max(range->spanStartX[y-range->startY],chunkStartX);
+                    endX = SDL_min(range->spanEndX[y-range->startY],chunkEndX);
+                    if(startX > endX){
+                        continue;
+                    }
+                    isoMapChunkGetRow(chunkData,y&MAP_CHUNK_MASK,rowData);
+
+                    for(x=startX;x<=endX;++x){
+                        pointX[x-startX] = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
+                        pointY[x-startX] = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
+                    }
+                    isoTransformConvert2dToIso(pointX,pointY,endX-startX+1);
+
+                    for(x=startX;x<=endX;++x){
+                        tile = rowData[x&MAP_CHUNK_MASK];
+                        if(tile == MAP_EMPTY_TILE && layer > 0){
+                            continue;
+                        }
+                        isoRenderQueueAdd(queue,layerKey | ISO_RENDER_QUEUE_KEY(SDL_min(x+y,ISO_RENDER_QUEUE_MAX_DEPTH),0,0),
+                                          isoEngine->isoMap->tileSet->tilesTex,&isoEngine->isoMap->tileSet->tileClipRects[tile],
+                                          pointX[x-startX],pointY[x-startX],&quadSizes[tile]);
+                    }
+                }
+            }
+        }
+    }
+}
 
+//The top left corner of the quad the tile x,y is drawn with, computed exactly as isoEngineAddTileQuads does
+static void isoEngineGetTileQuadPos(isoEngineT *isoEngine,int x,int y,int *quadX,int *quadY)
+{
     point2DT point;
-    point2DT tileShift, mouse2IsoPOint;
 
-    if(isoEngine == NULL || mouseTilePos == NULL){
+    point.x = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
+    point.y = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
+    isoEngineConvert2dToIso(&point);
+    //textureGetQuadXYClipSize puts the quad at the point
+    *quadX = (int)point.x;
+    *quadY = (int)point.y;
+}
+
+static void isoEnginePickSetup(isoEngineT *isoEngine,isoPickT *pick)
+{
+    pick->step = (Sint64)(isoEngine->zoomLevel*isoEngine->isoMap->tileSize*ISO_PICK_ONE + 0.5f);
+    pick->scrollX = (Sint64)isoEngine->scrollX*ISO_PICK_ONE;
+    pick->scrollY = (Sint64)isoEngine->scrollY*ISO_PICK_ONE;
+}
+
+//rounds towards minus infinity, unlike /
+static Sint64 isoEngineFloorDiv(Sint64 a,Sint64 b)
+{
+    return a >= 0 ? a/b : -((-a+b-1)/b);
+}
+
+//Is the center of the pixel x,y on the diamond (the top face) of the tile drawn at quadX,quadY?
+static int isoEngineIsOnDiamond(isoPickT *pick,int x,int y,int quadX,int quadY)
+{
+    //relative to the center of the diamond, which is 2*step wide and step high
+    Sint64 dx = (Sint64)(x-quadX)*ISO_PICK_ONE + ISO_PICK_ONE/2 - pick->step;
+    Sint64 dy = (Sint64)(y-quadY)*ISO_PICK_ONE + ISO_PICK_ONE/2 - pick->step/2;
+
+    return (dx < 0 ? -dx : dx) + 2*(dy < 0 ? -dy : dy) <= pick->step;
+}
+
+//The tile under the screen pixel x,y, on or off the map.
+//The exact inverse of the iso transform gives the tile. Near the edge of its diamond the rounding of the drawn
+//positions matters, there the tile and its neighbours are tested against the pixel. They are tested front to back:
+//on an edge two diamonds share, the tile that is drawn later and covers the other one wins.
+static void isoEnginePickPoint(isoEngineT *isoEngine,isoPickT *pick,int x,int y,int *tileX,int *tileY)
+{
+    static const int neighbours[9][2] = {{1,1},{0,1},{1,0},{-1,1},{0,0},{1,-1},{-1,0},{0,-1},{-1,-1}};
+    int i;
+    int quadX,quadY;
+    int estimateX,estimateY;
+    Sint64 pixelX = (Sint64)x*ISO_PICK_ONE + ISO_PICK_ONE/2;
+    Sint64 pixelY = (Sint64)y*ISO_PICK_ONE + ISO_PICK_ONE/2;
+    Sint64 u,v;
+
+    if(pick->step <= 0){
+        *tileX = *tileY = 0;
+        return;
+    }
+    //the screen point x,y is the 2d point u/2,v/2 = ((x+2y)/2,(2y-x)/2). A tile's diamond covers
+    //[tu+step/2,tu+3step/2) x [tv-step/2,tv+step/2) of it, with tu,tv the 2d position the tile is drawn at
+    u = pixelX + 2*pixelY - 2*pick->scrollX - pick->step;
+    v = 2*pixelY - pixelX - 2*pick->scrollY + pick->step;
+    estimateX = (int)isoEngineFloorDiv(u,2*pick->step);
+    estimateY = (int)isoEngineFloorDiv(v,2*pick->step);
+
+    //the drawn positions are less than 2 pixels off in x and y, which moves u and v by less than 6 pixels
+    u -= (Sint64)estimateX*2*pick->step;
+    v -= (Sint64)estimateY*2*pick->step;
+    if(SDL_min(u,v) > ISO_PICK_MARGIN && SDL_max(u,v) < 2*pick->step - ISO_PICK_MARGIN){
+        *tileX = estimateX;
+        *tileY = estimateY;
         return;
     }
 
-    int modulusX = isoEngine->isoMap->tileSize*isoEngine->zoomLevel;
-    int modulusY = isoEngine->isoMap->tileSize*isoEngine->zoomLevel;
-    int correctX =(((int)isoEngine->mapScroll2Dpos.x)%modulusX)*2;
-    int correctY = ((int)isoEngine->mapScroll2Dpos.y)%modulusY;
+    for(i=0;i<9;++i){
+        //only the neighbours on the sides the pixel is close to
+        if((neighbours[i][0] < 0 && u > ISO_PICK_MARGIN) || (neighbours[i][0] > 0 && u < 2*pick->step - ISO_PICK_MARGIN) ||
+           (neighbours[i][1] < 0 && v > ISO_PICK_MARGIN) || (neighbours[i][1] > 0 && v < 2*pick->step - ISO_PICK_MARGIN)){
+            continue;
+        }
+        isoEngineGetTileQuadPos(isoEngine,estimateX+neighbours[i][0],estimateY+neighbours[i][1],&quadX,&quadY);
+        if(isoEngineIsOnDiamond(pick,x,y,quadX,quadY)){
+            *tileX = estimateX+neighbours[i][0];
+            *tileY = estimateY+neighbours[i][1];
+            return;
+        }
+    }
+    //in the seam between rounded diamonds
+    *tileX = estimateX;
+    *tileY = estimateY;
+}
 
-    //copy mouse point
-    mouse2IsoPOint = isoEngine->mousePoint;
-    isoEngineConvertIsoTo2D(&mouse2IsoPOint);
+//The map tile drawn at the screen pixel x,y. Returns 0 if there is no tile there, tileX and tileY are set anyway.
+int isoEnginePickTile(isoEngineT *isoEngine,int x,int y,int *tileX,int *tileY)
+{
+    isoPickT pick;
 
-    //get tile coordinates
-    isoEngineGetTileCoordinates(isoEngine,&mouse2IsoPOint,&point);
+    if(isoEngine == NULL || isoEngine->isoMap == NULL || tileX == NULL || tileY == NULL){
+        logError("error.txt","isoEnginePickTile(...) - isoEngine, isoEngine->isoMap or the tile position is NULL!");
+        return 0;
+    }
+    isoEnginePickSetup(isoEngine,&pick);
+    isoEnginePickPoint(isoEngine,&pick,x,y,tileX,tileY);
+    return *tileX >= 0 && *tileY >= 0 && *tileX < isoEngine->isoMap->mapWidth && *tileY < isoEngine->isoMap->mapHeight;
+}
 
-    tileShift.x = correctX;
-    tileShift.y = correctY;
-    isoEngineConvert2dToIso(&tileShift);
+//Picks the tiles under many screen points at once (touch points, a selection box, queries).
+//Points without a tile get -1,-1, returns the number of points that have one.
+int isoEnginePickTiles(isoEngineT *isoEngine,const SDL_Point *points,SDL_Point *tiles,int numPoints)
+{
+    int i;
+    int numPicked = 0;
+    isoPickT pick;
 
-    //check for fixing tile position when the y position is larger than 0
-    if(isoEngine->mapScroll2Dpos.y>0){
-        point.y -= (((float)isoEngine->scrollY-tileShift.y)/(float)isoEngine->isoMap->tileSize)/isoEngine->zoomLevel;
-        point.y+=1;
+    if(isoEngine == NULL || isoEngine->isoMap == NULL || points == NULL || tiles == NULL){
+        logError("error.txt","isoEnginePickTiles(...) - isoEngine, isoEngine->isoMap, points or tiles is NULL!");
+        return 0;
     }
-    else{
-        point.y -= (((float)isoEngine->scrollY-tileShift.y)/(float)isoEngine->isoMap->tileSize)/isoEngine->zoomLevel;
+    isoEnginePickSetup(isoEngine,&pick);
+
+    for(i=0;i<numPoints;++i){
+        isoEnginePickPoint(isoEngine,&pick,points[i].x,points[i].y,&tiles[i].x,&tiles[i].y);
+        if(tiles[i].x >= 0 && tiles[i].y >= 0 && tiles[i].x < isoEngine->isoMap->mapWidth && tiles[i].y < isoEngine->isoMap->mapHeight){
+            numPicked++;
+        }
+        else{
+            tiles[i].x = tiles[i].y = -1;
+        }
     }
+    return numPicked;
+}
 
-    //check for fixing tile position when the x position is larger than 0
-    if(isoEngine->mapScroll2Dpos.x>0)
-    {
-        point.x -= (((float)isoEngine->scrollX+(float)tileShift.x)/(float)isoEngine->isoMap->tileSize)/isoEngine->zoomLevel;
-        point.x+=1;
+//The tile under the mouse, on or off the map
+void isoEngineGetMouseTilePos(isoEngineT *isoEngine, point2DT *mouseTilePos)
+{
+    int tileX,tileY;
+
+    if(isoEngine == NULL){
+        writeToLog("Error in function isoEngineGetMouseTilePos(...) - isoEngine is NULL!","error.txt");
+        return;
     }
-    else{
-        point.x -= (((float)isoEngine->scrollX+(float)tileShift.x)/(float)isoEngine->isoMap->tileSize)/isoEngine->zoomLevel;
+    if(isoEngine->isoMap == NULL){
+        writeToLog("Error in function isoEngineGetMouseTilePos(...) - isoEngine->isoMap is NULL!","error.txt");
+        return;
+    }
+    if(mouseTilePos == NULL){
+        return;
     }
-    mouseTilePos->x = (int)point.x;
-    mouseTilePos->y = (int)point.y;
+    isoEnginePickTile(isoEngine,isoEngine->mouseScreenPos.x,isoEngine->mouseScreenPos.y,&tileX,&tileY);
+    mouseTilePos->x = tileX;
+    mouseTilePos->y = tileY;
 }
 
 void isoEngineCenterMapToTileUnderMouse(isoEngineT *isoEngine)
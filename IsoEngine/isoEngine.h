@@ -2,6 +2,19 @@
 #define ISOENGINE_H_
 #include <SDL2/SDL.h>
 #include "isoMap.h"
+#include "isoRenderCache.h"
+#include "isoDamage.h"
+#include "isoRenderQueue.h"
+#include "../threadPool.h"
+
+//How isoEngineDrawIsoMap submits the map tiles to the renderer
+#define ISO_ENGINE_DRAW_PER_TILE    0   //one SDL_RenderCopy per tile
+#define ISO_ENGINE_DRAW_BATCHED     1   //one SDL_RenderGeometry call for all visible tiles
+#define ISO_ENGINE_DRAW_CACHED      2   //blit pre-rendered blocks of tiles from the render cache
+
+//The quads of the visible tiles are generated on the thread pool in bands of map rows
+#define ISO_ENGINE_BANDS_PER_THREAD     2       //more bands than threads, so a slow thread holds up less
+#define ISO_ENGINE_MIN_TILES_PER_BAND   1024    //below this waking the workers costs more than it saves
 
 typedef struct point2DT
 {
@@ -9,6 +22,27 @@ typedef struct point2DT
     float y;
 }point2DT;
 
+//The tiles that are on the screen: the map rows startY to endY,
+//and on every row y the tiles spanStartX[y-startY] to spanEndX[y-startY] (an empty row has start > end)
+typedef struct isoVisibleRangeT
+{
+    int startY;
+    int endY;
+    int minX;
+    int maxX;
+    int maxRows;
+    int *spanStartX;
+    int *spanEndX;
+}isoVisibleRangeT;
+
+//The map rows firstRow to lastRow of the visible range and the quads of their tiles
+typedef struct isoTileBandT
+{
+    int firstRow;
+    int lastRow;
+    textureBatchT quads;
+}isoTileBandT;
+
 typedef struct isoEngineT
 {
     int scrollX;
@@ -16,10 +50,19 @@ typedef struct isoEngineT
     int mapScrollSpeed;
     point2DT mapScroll2Dpos;
     float zoomLevel;
-    SDL_Rect mouseRect;
-    point2DT mousePoint;
+    SDL_Rect mouseRect;         //the mouse position divided by the zoom level
+    SDL_Point mouseScreenPos;   //the mouse position in screen pixels
     point2DT tilePos;
     int lastTileClicked;
+    int drawMode;
+    textureBatchT mapBatch;
+    isoRenderCacheT *renderCache;
+    isoDamageT *damage;
+    isoRenderQueueT *renderQueue;   //the layers above the ground and the sprites, sorted by depth
+    isoVisibleRangeT visibleTiles;
+    threadPoolT *threadPool;
+    isoTileBandT *tileBands;
+    int maxTileBands;
     isoMapT *isoMap;
 }isoEngineT;
 
@@ -38,8 +81,15 @@ void isoEngineConvertCartesianCameraToIsometric(isoEngineT *isoEngine,point2DT *
 void isoEngineUpdateMousePos(isoEngineT *isoEngine);
 void isoEngineScrollMapWithMouse(isoEngineT *isoEngine);
 void isoEngineDrawIsoMouse(isoEngineT *isoEngine);
+void isoEngineGetIsoMouseQuad(isoEngineT *isoEngine,SDL_Rect *quad);
 void isoEngineDrawIsoMap(isoEngineT *isoEngine);
+int isoEngineGetVisibleTiles(isoEngineT *isoEngine,isoVisibleRangeT *range);
+void isoEngineFreeVisibleTiles(isoVisibleRangeT *range);
+void isoEngineBuildMapBatch(isoEngineT *isoEngine,isoVisibleRangeT *range);
+void isoEngineQueueIsoMap(isoEngineT *isoEngine,isoRenderQueueT *queue,int firstLayer,int lastLayer);
 void isoEngineGetMouseTilePos(isoEngineT *isoEngine, point2DT *mouseTilePos);
+int isoEnginePickTile(isoEngineT *isoEngine,int x,int y,int *tileX,int *tileY);
+int isoEnginePickTiles(isoEngineT *isoEngine,const SDL_Point *points,SDL_Point *tiles,int numPoints);
 void isoEngineCenterMapToTileUnderMouse(isoEngineT *isoEngine);
 void isoEngineCenterMap(isoEngineT *isoEngine,point2DT *objectPoint);
 void isoEngineGetMouseTileClick(isoEngineT *isoEngine);
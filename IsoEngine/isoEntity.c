@@ -0,0 +1,494 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "isoEntity.h"
+#include "isoEngine.h"
+#include "isoTransform.h"
+#include "../renderer.h"
+#include "../logger.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+#define ISO_ENTITY_X86
+#include <immintrin.h>
+#endif
+
+#define ISO_ENTITY_GENERATIONS      (1<<(32-ISO_ENTITY_SLOT_BITS))
+#define ISO_ENTITY_SLOT_MASK        (ISO_ENTITY_MAX_ENTITIES-1)
+#define ISO_ENTITY_NUM_COMPONENTS   12
+#define ISO_ENTITY_COMPONENT_ALIGN  4096
+#define ISO_ENTITY_COMPONENT_SHIFT  256     //ISO_ENTITY_NUM_COMPONENTS of these fit in ISO_ENTITY_COMPONENT_ALIGN
+
+//The direction an entity faces when it moves with the signs of its velocity, [x+1][y+1]. -1 keeps the direction.
+static const int isoEntityDirections[3][3] =
+{
+    {ISO_ENTITY_DIR_UP,ISO_ENTITY_DIR_UP_LEFT,ISO_ENTITY_DIR_LEFT},
+    {ISO_ENTITY_DIR_UP_RIGHT,-1,ISO_ENTITY_DIR_DOWN_LEFT},
+    {ISO_ENTITY_DIR_RIGHT,ISO_ENTITY_DIR_DOWN_RIGHT,ISO_ENTITY_DIR_DOWN}
+};
+
+isoEntityStoreT *isoEntityStoreNew()
+{
+    isoEntityStoreT *store = calloc(1,sizeof(struct isoEntityStoreT));
+
+    if(store == NULL){
+        writeToLog("Error in isoEntityStoreNew(...): Could not allocate memory for the entity store!","error.txt");
+        return NULL;
+    }
+    //calloc has set all the arrays to NULL and all the counts to 0
+    store->freeSlot = 0;
+    return store;
+}
+
+void isoEntityStoreFree(isoEntityStoreT *store)
+{
+    int i;
+
+    if(store == NULL){
+        return;
+    }
+    free(store->components);
+    free(store->slotIndex);
+    free(store->slotGeneration);
+    for(i=0;i<store->numSprites;++i){
+        textureQuadTableFree(&store->sprites[i].quads);
+        textureBatchFree(&store->sprites[i].batch);
+    }
+    free(store);
+}
+
+//Registers a sprite sheet for isoEntityCreate. Returns the sprite, or -1 if there are ISO_ENTITY_MAX_SPRITES already.
+int isoEntityAddSprite(isoEntityStoreT *store,textureT *texture,SDL_Rect *clipRects,int numFrames,int ticksPerFrame)
+{
+    isoEntitySpriteT *sprite;
+
+    if(store == NULL || texture == NULL || clipRects == NULL || numFrames < 1){
+        writeToLog("Error in function: isoEntityAddSprite(...) - Parameter store, texture or clipRects is NULL or there are no frames!","error.txt");
+        return -1;
+    }
+    if(store->numSprites == ISO_ENTITY_MAX_SPRITES){
+        writeToLog("Error in function: isoEntityAddSprite(...) - The store has ISO_ENTITY_MAX_SPRITES sprites already!","error.txt");
+        return -1;
+    }
+    sprite = &store->sprites[store->numSprites];
+    sprite->texture = texture;
+    sprite->clipRects = clipRects;
+    sprite->numFrames = numFrames;
+    sprite->ticksPerFrame = SDL_max(ticksPerFrame,1);
+    textureQuadTableInit(&sprite->quads);
+    textureBatchInit(&sprite->batch);
+    return store->numSprites++;
+}
+
+//The component arrays and the size of their elements
+static void isoEntityGetComponents(isoEntityStoreT *store,void ***arrays,size_t *sizes)
+{
+    int i = 0;
+
+    arrays[i] = (void**)&store->x;          sizes[i++] = sizeof(float);
+    arrays[i] = (void**)&store->y;          sizes[i++] = sizeof(float);
+    arrays[i] = (void**)&store->prevX;      sizes[i++] = sizeof(float);
+    arrays[i] = (void**)&store->prevY;      sizes[i++] = sizeof(float);
+    arrays[i] = (void**)&store->velocityX;  sizes[i++] = sizeof(float);
+    arrays[i] = (void**)&store->velocityY;  sizes[i++] = sizeof(float);
+    arrays[i] = (void**)&store->direction;  sizes[i++] = sizeof(Uint8);
+    arrays[i] = (void**)&store->walkStart;  sizes[i++] = sizeof(Uint32);
+    arrays[i] = (void**)&store->sprite;     sizes[i++] = sizeof(Uint16);
+    arrays[i] = (void**)&store->slot;       sizes[i++] = sizeof(Uint32);
+    arrays[i] = (void**)&store->screenX;    sizes[i++] = sizeof(float);
+    arrays[i] = (void**)&store->screenY;    sizes[i++] = sizeof(float);
+}
+
+//Moves the components to a block with room for maxEntities. All arrays are in one block, each one starting
+//ISO_ENTITY_COMPONENT_SHIFT bytes further into a page than the one before. Arrays allocated one by one would all
+//start at the same place in a page, and x[i], prevX[i] and velocityX[i] would fight over the same cache sets.
+static int isoEntityGrowComponents(isoEntityStoreT *store,int maxEntities)
+{
+    int i;
+    size_t size = 0;
+    size_t offsets[ISO_ENTITY_NUM_COMPONENTS];
+    size_t sizes[ISO_ENTITY_NUM_COMPONENTS];
+    void **arrays[ISO_ENTITY_NUM_COMPONENTS];
+    Uint8 *components;
+
+    isoEntityGetComponents(store,arrays,sizes);
+    for(i=0;i<ISO_ENTITY_NUM_COMPONENTS;++i){
+        offsets[i] = (size + ISO_ENTITY_COMPONENT_ALIGN-1)/ISO_ENTITY_COMPONENT_ALIGN*ISO_ENTITY_COMPONENT_ALIGN + i*ISO_ENTITY_COMPONENT_SHIFT;
+        size = offsets[i] + sizes[i]*maxEntities;
+    }
+    components = malloc(size);
+    if(components == NULL){
+        return 0;
+    }
+    for(i=0;i<ISO_ENTITY_NUM_COMPONENTS;++i){
+        if(store->numEntities > 0){
+            memcpy(components + offsets[i],*arrays[i],sizes[i]*store->numEntities);
+        }
+        *arrays[i] = components + offsets[i];
+    }
+    free(store->components);
+    store->components = components;
+    store->maxEntities = maxEntities;
+    return 1;
+}
+
+static int isoEntityGrowArray(void **array,size_t size,int count)
+{
+    void *grown = realloc(*array,size*count);
+
+    if(grown == NULL){
+        return 0;
+    }
+    *array = grown;
+    return 1;
+}
+
+//Makes room for one more entity, the components and the slots grow separately
+static int isoEntityGrow(isoEntityStoreT *store)
+{
+    int maxEntities = store->maxEntities == 0 ? 1024 : store->maxEntities*2;
+    int maxSlots = store->maxSlots == 0 ? 1024 : store->maxSlots*2;
+
+    if(store->numEntities == store->maxEntities && isoEntityGrowComponents(store,maxEntities) == 0){
+        return 0;
+    }
+    if(store->freeSlot == (Uint32)store->numSlots && store->numSlots == store->maxSlots){
+        if(isoEntityGrowArray((void**)&store->slotIndex,sizeof(Uint32),maxSlots) == 0 ||
+           isoEntityGrowArray((void**)&store->slotGeneration,sizeof(Uint16),maxSlots) == 0){
+            return 0;
+        }
+        store->maxSlots = maxSlots;
+    }
+    return 1;
+}
+
+//Creates an entity at x,y standing still and facing down. Returns its handle, or ISO_ENTITY_NONE if it could not be created.
+isoEntityHandleT isoEntityCreate(isoEntityStoreT *store,float x,float y,int sprite)
+{
+    int index;
+    Uint32 slot;
+
+    if(store == NULL || sprite < 0 || sprite >= store->numSprites){
+        writeToLog("Error in function: isoEntityCreate(...) - Parameter store is NULL or the sprite does not exist!","error.txt");
+        return ISO_ENTITY_NONE;
+    }
+    if(store->numEntities == ISO_ENTITY_MAX_ENTITIES){
+        writeToLog("Error in function: isoEntityCreate(...) - The store has ISO_ENTITY_MAX_ENTITIES entities already!","error.txt");
+        return ISO_ENTITY_NONE;
+    }
+    if(isoEntityGrow(store) == 0){
+        writeToLog("Error in function: isoEntityCreate(...) - Could not allocate memory for the entity!","error.txt");
+        return ISO_ENTITY_NONE;
+    }
+    slot = store->freeSlot;
+    if(slot == (Uint32)store->numSlots){
+        store->slotGeneration[slot] = 1;
+        store->numSlots++;
+        store->freeSlot = store->numSlots;
+    }
+    else{
+        store->freeSlot = store->slotIndex[slot];
+    }
+
+    index = store->numEntities++;
+    store->slotIndex[slot] = index;
+    store->slot[index] = slot;
+    store->x[index] = x;
+    store->y[index] = y;
+    store->prevX[index] = x;
+    store->prevY[index] = y;
+    store->velocityX[index] = 0;
+    store->velocityY[index] = 0;
+    store->direction[index] = ISO_ENTITY_DIR_DOWN;
+    store->walkStart[index] = store->tick;
+    store->sprite[index] = sprite;
+    return ((isoEntityHandleT)store->slotGeneration[slot] << ISO_ENTITY_SLOT_BITS) | slot;
+}
+
+//Returns the index of the entity in the component arrays, or -1 if the handle is not an entity (any more).
+//The index is only good until the next isoEntityRemove.
+int isoEntityGetIndex(isoEntityStoreT *store,isoEntityHandleT handle)
+{
+    Uint32 slot = handle & ISO_ENTITY_SLOT_MASK;
+
+    if(store == NULL || slot >= (Uint32)store->numSlots || store->slotGeneration[slot] != handle >> ISO_ENTITY_SLOT_BITS){
+        return -1;
+    }
+    return store->slotIndex[slot];
+}
+
+//Removes the entity, the last entity takes its place in the arrays. Returns 0 if the handle is not an entity.
+int isoEntityRemove(isoEntityStoreT *store,isoEntityHandleT handle)
+{
+    int index = isoEntityGetIndex(store,handle);
+    int last;
+    Uint32 slot = handle & ISO_ENTITY_SLOT_MASK;
+
+    if(index < 0){
+        return 0;
+    }
+    last = --store->numEntities;
+    if(index != last){
+        store->x[index] = store->x[last];
+        store->y[index] = store->y[last];
+        store->prevX[index] = store->prevX[last];
+        store->prevY[index] = store->prevY[last];
+        store->velocityX[index] = store->velocityX[last];
+        store->velocityY[index] = store->velocityY[last];
+        store->direction[index] = store->direction[last];
+        store->walkStart[index] = store->walkStart[last];
+        store->sprite[index] = store->sprite[last];
+        store->slot[index] = store->slot[last];
+        store->slotIndex[store->slot[index]] = index;
+    }
+    //0 is skipped when the generation wraps around, so ISO_ENTITY_NONE stays invalid
+    store->slotGeneration[slot] = (store->slotGeneration[slot] + 1) % ISO_ENTITY_GENERATIONS;
+    if(store->slotGeneration[slot] == 0){
+        store->slotGeneration[slot] = 1;
+    }
+    store->slotIndex[slot] = store->freeSlot;
+    store->freeSlot = slot;
+    return 1;
+}
+
+int isoEntityGetPosition(isoEntityStoreT *store,isoEntityHandleT handle,float *x,float *y)
+{
+    int index = isoEntityGetIndex(store,handle);
+
+    if(index < 0){
+        return 0;
+    }
+    *x = store->x[index];
+    *y = store->y[index];
+    return 1;
+}
+
+//Sets how far the entity moves per tick. It turns the way it moves, and starts its walk if it was standing.
+//A standing entity keeps its direction.
+int isoEntitySetVelocity(isoEntityStoreT *store,isoEntityHandleT handle,float velocityX,float velocityY)
+{
+    int index = isoEntityGetIndex(store,handle);
+    int direction;
+
+    if(index < 0){
+        return 0;
+    }
+    direction = isoEntityDirections[(velocityX > 0) - (velocityX < 0) + 1][(velocityY > 0) - (velocityY < 0) + 1];
+    if(direction >= 0){
+        store->direction[index] = direction;
+        if(store->velocityX[index] == 0 && store->velocityY[index] == 0){
+            store->walkStart[index] = store->tick;
+        }
+    }
+    store->velocityX[index] = velocityX;
+    store->velocityY[index] = velocityY;
+    return 1;
+}
+
+#ifdef ISO_ENTITY_X86
+//Four entities at a time, returns how many were moved. The adds are the same as the scalar ones.
+__attribute__((target("sse2")))
+static int isoEntityMoveSSE2(float *position,float *prevPosition,float *velocity,int count)
+{
+    int i;
+    __m128 v;
+
+    for(i=0;i+4<=count;i+=4){
+        v = _mm_loadu_ps(&position[i]);
+        _mm_storeu_ps(&prevPosition[i],v);
+        _mm_storeu_ps(&position[i],_mm_add_ps(v,_mm_loadu_ps(&velocity[i])));
+    }
+    return i;
+}
+#endif
+
+//One coordinate of every entity. The compiler does not vectorize this at -O2, and one by one
+//the structure of arrays is no faster than one struct per entity.
+static void isoEntityMove(float *position,float *prevPosition,float *velocity,int count)
+{
+    int i = 0;
+
+#ifdef ISO_ENTITY_X86
+    //isoTransformSetImplementation has checked that the CPU has SSE2
+    if(isoTransformGetImplementation() >= ISO_TRANSFORM_SSE2){
+        i = isoEntityMoveSSE2(position,prevPosition,velocity,count);
+    }
+#endif
+    for(;i<count;++i){
+        prevPosition[i] = position[i];
+        position[i] += velocity[i];
+    }
+}
+
+//One tick: every entity moves by its velocity. The direction and the walk only change with the velocity,
+//so this is nothing but the positions.
+void isoEntityUpdate(isoEntityStoreT *store)
+{
+    if(store == NULL){
+        return;
+    }
+    isoEntityMove(store->x,store->prevX,store->velocityX,store->numEntities);
+    isoEntityMove(store->y,store->prevY,store->velocityY,store->numEntities);
+    store->tick++;
+}
+
+//The clip rect of the sprite that shows entity i: its direction, and the frame of its walk if it moves
+static int isoEntityGetClip(isoEntityStoreT *store,isoEntitySpriteT *sprite,int i)
+{
+    int frame = 0;
+
+    if(sprite->numFrames > 1 && (store->velocityX[i] != 0 || store->velocityY[i] != 0)){
+        frame = (store->tick - store->walkStart[i])/sprite->ticksPerFrame % sprite->numFrames;
+    }
+    return store->direction[i]*sprite->numFrames + frame;
+}
+
+//Jumps are not animated: the entities are drawn where they are, not between the last two ticks
+void isoEntitySnap(isoEntityStoreT *store)
+{
+    if(store == NULL){
+        return;
+    }
+    memcpy(store->prevX,store->x,store->numEntities*sizeof(float));
+    memcpy(store->prevY,store->y,store->numEntities*sizeof(float));
+}
+
+//The screen positions of all entities alpha of the way between the last two ticks, the same math as drawCharacter had
+static void isoEntityGetScreenPositions(isoEntityStoreT *store,isoEngineT *isoEngine,float alpha)
+{
+    int i;
+    int n = store->numEntities;
+    float zoomLevel = isoEngine->zoomLevel;
+
+    for(i=0;i<n;++i){
+        store->screenX[i] = (int)((store->prevX[i] + (store->x[i]-store->prevX[i])*alpha)*zoomLevel) + isoEngine->scrollX;
+        store->screenY[i] = (int)((store->prevY[i] + (store->y[i]-store->prevY[i])*alpha)*zoomLevel) + isoEngine->scrollY;
+    }
+    isoTransformConvert2dToIso(store->screenX,store->screenY,n);
+}
+
+//Updates the quad tables of the sprites to the zoom level and works out the screen positions. Returns 0 if it failed.
+static int isoEntityPrepareDraw(isoEntityStoreT *store,isoEngineT *isoEngine,float alpha)
+{
+    int i;
+    isoEntitySpriteT *sprite;
+
+    for(i=0;i<store->numSprites;++i){
+        sprite = &store->sprites[i];
+        if(textureQuadTableUpdate(&sprite->quads,sprite->clipRects,sprite->numFrames*ISO_ENTITY_NUM_DIRECTIONS,isoEngine->zoomLevel) == 0){
+            return 0;
+        }
+    }
+    isoEntityGetScreenPositions(store,isoEngine,alpha);
+    return 1;
+}
+
+//Draws the entities on the screen, one batch per sprite. The entities are not sorted by depth, see isoEntityQueue.
+void isoEntityDraw(isoEntityStoreT *store,isoEngineT *isoEngine,float alpha)
+{
+    int i;
+    int x,y;
+    isoEntitySpriteT *sprite;
+    SDL_Point *size;
+    int clip;
+
+    if(store == NULL || isoEngine == NULL){
+        return;
+    }
+    store->numDrawn = 0;
+    if(isoEntityPrepareDraw(store,isoEngine,alpha) == 0){
+        return;
+    }
+    for(i=0;i<store->numSprites;++i){
+        textureBatchBegin(&store->sprites[i].batch,store->sprites[i].texture);
+    }
+
+    for(i=0;i<store->numEntities;++i){
+        sprite = &store->sprites[store->sprite[i]];
+        clip = isoEntityGetClip(store,sprite,i);
+        size = &sprite->quads.sizes[clip];
+        x = store->screenX[i];
+        y = store->screenY[i];
+        if(x >= WINDOW_WIDTH || y >= WINDOW_HEIGHT || x + size->x <= 0 || y + size->y <= 0){
+            continue;
+        }
+        textureBatchAddXYClipSize(&sprite->batch,x,y,&sprite->clipRects[clip],size);
+        store->numDrawn++;
+    }
+    for(i=0;i<store->numSprites;++i){
+        textureBatchDraw(&store->sprites[i].batch);
+    }
+}
+
+//Adds the entities on the screen to the render queue on the layer. An entity has the depth of the map tile
+//it stands on, and within the tile it is ordered by how far down the tile it is, so it is drawn over
+//the tiles of the layer on its own tile and the tiles behind it, and under the ones in front of it.
+void isoEntityQueue(isoEntityStoreT *store,isoEngineT *isoEngine,float alpha,isoRenderQueueT *queue,int layer)
+{
+    int i;
+    int x,y;
+    int tileX,tileY;
+    int depth,subOrder;
+    float mapX,mapY;
+    float tileSize;
+    isoEntitySpriteT *sprite;
+    SDL_Point *size;
+    int clip;
+
+    if(store == NULL || isoEngine == NULL || isoEngine->isoMap == NULL || queue == NULL){
+        return;
+    }
+    store->numDrawn = 0;
+    if(isoEntityPrepareDraw(store,isoEngine,alpha) == 0){
+        return;
+    }
+    tileSize = isoEngine->isoMap->tileSize;
+    layer = SDL_min(SDL_max(layer,0),ISO_RENDER_QUEUE_MAX_LAYER);
+
+    for(i=0;i<store->numEntities;++i){
+        sprite = &store->sprites[store->sprite[i]];
+        clip = isoEntityGetClip(store,sprite,i);
+        size = &sprite->quads.sizes[clip];
+        x = store->screenX[i];
+        y = store->screenY[i];
+        if(x >= WINDOW_WIDTH || y >= WINDOW_HEIGHT || x + size->x <= 0 || y + size->y <= 0){
+            continue;
+        }
+        //the depth of the position it is drawn at, not where it is at the tick
+        mapX = store->prevX[i] + (store->x[i]-store->prevX[i])*alpha;
+        mapY = store->prevY[i] + (store->y[i]-store->prevY[i])*alpha;
+        tileX = floor(mapX/tileSize);
+        tileY = floor(mapY/tileSize);
+        depth = SDL_min(SDL_max(tileX+tileY,0),ISO_RENDER_QUEUE_MAX_DEPTH);
+        //1 to ISO_RENDER_QUEUE_MAX_SUB_ORDER-1, the tiles of the layer have 0
+        subOrder = 1 + (int)((mapX - tileX*tileSize + mapY - tileY*tileSize)*(ISO_RENDER_QUEUE_MAX_SUB_ORDER-2)/(2*tileSize));
+        subOrder = SDL_min(SDL_max(subOrder,1),ISO_RENDER_QUEUE_MAX_SUB_ORDER-1);
+
+        isoRenderQueueAdd(queue,ISO_RENDER_QUEUE_KEY(depth,layer,subOrder),sprite->texture,&sprite->clipRects[clip],x,y,size);
+        store->numDrawn++;
+    }
+}
+
+//The screen rectangle isoEntityDraw draws the entity in. Returns 0 if the handle is not an entity.
+int isoEntityGetQuad(isoEntityStoreT *store,isoEntityHandleT handle,isoEngineT *isoEngine,float alpha,SDL_Rect *quad)
+{
+    int index = isoEntityGetIndex(store,handle);
+    int clip;
+    point2DT point;
+    isoEntitySpriteT *sprite;
+
+    setupRect(quad,0,0,0,0);
+    if(index < 0 || isoEngine == NULL){
+        return 0;
+    }
+    sprite = &store->sprites[store->sprite[index]];
+    if(textureQuadTableUpdate(&sprite->quads,sprite->clipRects,sprite->numFrames*ISO_ENTITY_NUM_DIRECTIONS,isoEngine->zoomLevel) == 0){
+        return 0;
+    }
+    clip = isoEntityGetClip(store,sprite,index);
+    point.x = (int)((store->prevX[index] + (store->x[index]-store->prevX[index])*alpha)*isoEngine->zoomLevel) + isoEngine->scrollX;
+    point.y = (int)((store->prevY[index] + (store->y[index]-store->prevY[index])*alpha)*isoEngine->zoomLevel) + isoEngine->scrollY;
+    isoEngineConvert2dToIso(&point);
+    textureGetQuadXYClipSize(point.x,point.y,&sprite->quads.sizes[clip],quad);
+    return 1;
+}
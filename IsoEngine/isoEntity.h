@@ -0,0 +1,92 @@
+#ifndef __ISO_ENTITY_H_
+#define __ISO_ENTITY_H_
+
+#include <SDL2/SDL.h>
+#include "../texture.h"
+#include "isoRenderQueue.h"
+
+//The entities are stored as a structure of arrays: every component is a dense array and entity i is at index i
+//of all of them, so the update and draw passes run straight through memory. Removing an entity moves the last
+//one into its place. A handle stays the same as long as the entity lives: it holds a slot, which knows where the
+//entity is now, and the generation of the slot, so the handle of a removed entity never finds the next one.
+#define ISO_ENTITY_SLOT_BITS        20
+#define ISO_ENTITY_MAX_ENTITIES     (1<<ISO_ENTITY_SLOT_BITS)
+#define ISO_ENTITY_NONE             0       //never a handle, the generations start at 1
+#define ISO_ENTITY_MAX_SPRITES      32
+
+//The directions, in the order of the sprite sheets (the character's)
+#define ISO_ENTITY_DIR_UP_LEFT      0
+#define ISO_ENTITY_DIR_UP           1
+#define ISO_ENTITY_DIR_UP_RIGHT     2
+#define ISO_ENTITY_DIR_RIGHT        3
+#define ISO_ENTITY_DIR_DOWN_RIGHT   4
+#define ISO_ENTITY_DIR_DOWN         5
+#define ISO_ENTITY_DIR_DOWN_LEFT    6
+#define ISO_ENTITY_DIR_LEFT         7
+#define ISO_ENTITY_NUM_DIRECTIONS   8
+
+struct isoEngineT;
+
+typedef Uint32 isoEntityHandleT;
+
+//A sprite sheet with numFrames clip rects for every direction, direction after direction.
+//The clip rects and the texture belong to the caller.
+typedef struct isoEntitySpriteT
+{
+    textureT *texture;
+    SDL_Rect *clipRects;
+    int numFrames;
+    int ticksPerFrame;          //how long a frame of the walk is shown
+    textureQuadTableT quads;
+    textureBatchT batch;
+}isoEntitySpriteT;
+
+typedef struct isoEntityStoreT
+{
+    int numEntities;
+    int maxEntities;
+    Uint32 tick;                //counts the calls of isoEntityUpdate
+
+    //the components, in one block
+    void *components;
+    float *x;                   //the position in 2D map pixels, like the character's
+    float *y;
+    float *prevX;               //the position one tick ago, drawn in between
+    float *prevY;
+    float *velocityX;           //pixels per tick, set with isoEntitySetVelocity so the direction follows
+    float *velocityY;
+    Uint8 *direction;
+    Uint32 *walkStart;          //the tick the entity started to walk, the frame of its walk is worked out when it is drawn
+    Uint16 *sprite;
+    Uint32 *slot;               //the slot that points at the entity
+
+    //where isoEntityDraw puts the screen positions
+    float *screenX;
+    float *screenY;
+
+    int numSlots;
+    int maxSlots;
+    Uint32 *slotIndex;          //the entity of a used slot, the next free slot of a free one
+    Uint16 *slotGeneration;
+    Uint32 freeSlot;            //the first free slot, numSlots if there is none
+
+    int numSprites;
+    isoEntitySpriteT sprites[ISO_ENTITY_MAX_SPRITES];
+    int numDrawn;               //the entities the last isoEntityDraw or isoEntityQueue found on the screen
+}isoEntityStoreT;
+
+isoEntityStoreT *isoEntityStoreNew();
+void isoEntityStoreFree(isoEntityStoreT *store);
+int isoEntityAddSprite(isoEntityStoreT *store,textureT *texture,SDL_Rect *clipRects,int numFrames,int ticksPerFrame);
+isoEntityHandleT isoEntityCreate(isoEntityStoreT *store,float x,float y,int sprite);
+int isoEntityRemove(isoEntityStoreT *store,isoEntityHandleT handle);
+int isoEntityGetIndex(isoEntityStoreT *store,isoEntityHandleT handle);
+int isoEntityGetPosition(isoEntityStoreT *store,isoEntityHandleT handle,float *x,float *y);
+int isoEntitySetVelocity(isoEntityStoreT *store,isoEntityHandleT handle,float velocityX,float velocityY);
+void isoEntityUpdate(isoEntityStoreT *store);
+void isoEntitySnap(isoEntityStoreT *store);
+void isoEntityDraw(isoEntityStoreT *store,struct isoEngineT *isoEngine,float alpha);
+void isoEntityQueue(isoEntityStoreT *store,struct isoEngineT *isoEngine,float alpha,isoRenderQueueT *queue,int layer);
+int isoEntityGetQuad(isoEntityStoreT *store,isoEntityHandleT handle,struct isoEngineT *isoEngine,float alpha,SDL_Rect *quad);
+
+#endif // __ISO_ENTITY_H_
@@ -0,0 +1,506 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "isoFlow.h"
+#include "../logger.h"
+
+#define ISO_FLOW_SHIFT          MAP_CHUNK_SHIFT
+#define ISO_FLOW_MASK           MAP_CHUNK_MASK
+
+typedef struct isoFlowJobT
+{
+    isoFlowT *flow;
+    isoFlowFieldT *field;
+    SDL_atomic_t failed;
+}isoFlowJobT;
+
+isoFlowT *isoFlowNew(isoPathFinderT *finder,threadPoolT *threadPool)
+{
+    isoFlowT *flow;
+
+    if(finder == NULL){
+        writeToLog("Error in function: isoFlowNew(...) - Parameter finder is NULL!","error.txt");
+        return NULL;
+    }
+    flow = calloc(1,sizeof(struct isoFlowT));
+    if(flow == NULL){
+        writeToLog("Error in isoFlowNew(...): Could not allocate memory for the flow fields!","error.txt");
+        return NULL;
+    }
+    flow->finder = finder;
+    flow->threadPool = threadPool;
+    flow->integrateList = malloc(finder->numClustersX * finder->numClustersY * sizeof(int));
+    if(flow->integrateList == NULL){
+        writeToLog("Error in isoFlowNew(...): Could not allocate memory for the flow fields!","error.txt");
+        isoFlowFree(flow);
+        return NULL;
+    }
+    return flow;
+}
+
+static void isoFlowFieldFree(isoFlowFieldT *field)
+{
+    int i;
+
+    if(field == NULL){
+        return;
+    }
+    if(field->chunks != NULL){
+        for(i=0;i<field->finder->numClustersX * field->finder->numClustersY;++i){
+            free(field->chunks[i]);
+        }
+    }
+    free(field->chunks);
+    free(field->nodeCost);
+    free(field->nodeNext);
+    free(field->nodeSettled);
+    free(field->open);
+    free(field->required);
+    free(field->requiredList);
+    free(field);
+}
+
+void isoFlowFree(isoFlowT *flow)
+{
+    int i;
+
+    if(flow == NULL){
+        return;
+    }
+    for(i=0;i<ISO_FLOW_MAX_FIELDS;++i){
+        isoFlowFieldFree(flow->fields[i]);
+    }
+    free(flow->integrateList);
+    free(flow);
+}
+
+static isoFlowFieldT *isoFlowFieldNew(isoPathFinderT *finder,int goalX,int goalY)
+{
+    int numClusters = finder->numClustersX * finder->numClustersY;
+    size_t numNodes = (size_t)numClusters*ISO_PATH_MAX_CLUSTER_NODES;
+    isoFlowFieldT *field = calloc(1,sizeof(struct isoFlowFieldT));
+
+    if(field == NULL){
+        return NULL;
+    }
+    field->finder = finder;
+    field->goalX = goalX;
+    field->goalY = goalY;
+    field->goalCluster = (goalY >> ISO_FLOW_SHIFT)*finder->numClustersX + (goalX >> ISO_FLOW_SHIFT);
+    field->nodeCost = malloc(numNodes*sizeof(Uint32));
+    field->nodeNext = malloc(numNodes*sizeof(Uint32));
+    field->nodeSettled = malloc(numNodes*sizeof(Uint8));
+    field->chunks = calloc(numClusters,sizeof(isoFlowChunkT*));
+    field->required = calloc(numClusters,sizeof(Uint8));
+    field->requiredList = malloc(numClusters*sizeof(int));
+    if(field->nodeCost == NULL || field->nodeNext == NULL || field->nodeSettled == NULL || field->chunks == NULL ||
+       field->required == NULL || field->requiredList == NULL){
+        isoFlowFieldFree(field);
+        return NULL;
+    }
+    return field;
+}
+
+//The field to the goal tile, taken from the fields that are kept if it is there. Otherwise it takes the place of the
+//field that was asked for longest ago. The field stays valid until ISO_FLOW_MAX_FIELDS other goals were asked for.
+isoFlowFieldT *isoFlowGetField(isoFlowT *flow,int goalX,int goalY)
+{
+    int i;
+    int slot = 0;
+
+    if(flow == NULL || goalX < 0 || goalY < 0 || goalX >= flow->finder->isoMap->mapWidth || goalY >= flow->finder->isoMap->mapHeight){
+        writeToLog("Error in function: isoFlowGetField(...) - Parameter flow is NULL or the goal is outside the map!","error.txt");
+        return NULL;
+    }
+    for(i=0;i<ISO_FLOW_MAX_FIELDS;++i){
+        if(flow->fields[i] != NULL && flow->fields[i]->goalX == goalX && flow->fields[i]->goalY == goalY){
+            flow->fields[i]->lastUsed = ++flow->useCount;
+            return flow->fields[i];
+        }
+    }
+    for(i=0;i<ISO_FLOW_MAX_FIELDS;++i){
+        if(flow->fields[i] == NULL){
+            slot = i;
+            break;
+        }
+        if(flow->fields[i]->lastUsed < flow->fields[slot]->lastUsed){
+            slot = i;
+        }
+    }
+    isoFlowFieldFree(flow->fields[slot]);
+    flow->fields[slot] = isoFlowFieldNew(flow->finder,goalX,goalY);
+    if(flow->fields[slot] == NULL){
+        writeToLog("Error in isoFlowGetField(...): Could not allocate memory for the flow field!","error.txt");
+        return NULL;
+    }
+    flow->fields[slot]->lastUsed = ++flow->useCount;
+    return flow->fields[slot];
+}
+
+//Asks for the directions of the chunk of the tile x,y, e.g. the one a unit stands on, in the next isoFlowUpdate
+void isoFlowRequire(isoFlowFieldT *field,int x,int y)
+{
+    int cluster;
+
+    if(field == NULL || x < 0 || y < 0 || x >= field->finder->isoMap->mapWidth || y >= field->finder->isoMap->mapHeight){
+        return;
+    }
+    cluster = (y >> ISO_FLOW_SHIFT)*field->finder->numClustersX + (x >> ISO_FLOW_SHIFT);
+    if(!field->required[cluster]){
+        field->required[cluster] = 1;
+        field->requiredList[field->numRequired++] = cluster;
+    }
+}
+
+//Returns 0 if the open list could not grow, the search can not go on without the node
+static int isoFlowOpenPush(isoFlowFieldT *field,Uint32 cost,Uint32 node)
+{
+    int i;
+    Uint64 entry = ((Uint64)cost << 32) | node;
+    Uint64 *open;
+
+    if(field->numOpen == field->maxOpen){
+        open = realloc(field->open,(field->maxOpen == 0 ? 1024 : field->maxOpen*2)*sizeof(Uint64));
+        if(open == NULL){
+            writeToLog("Error in function: isoFlowOpenPush(...) - Could not allocate memory for the open list!","error.txt");
+            return 0;
+        }
+        field->open = open;
+        field->maxOpen = field->maxOpen == 0 ? 1024 : field->maxOpen*2;
+    }
+    i = field->numOpen++;
+    while(i > 0 && field->open[(i-1)/2] > entry){
+        field->open[i] = field->open[(i-1)/2];
+        i = (i-1)/2;
+    }
+    field->open[i] = entry;
+    return 1;
+}
+
+static Uint32 isoFlowOpenPop(isoFlowFieldT *field)
+{
+    int i = 0;
+    int child;
+    Uint64 top = field->open[0];
+    Uint64 last = field->open[--field->numOpen];
+
+    for(;;){
+        child = 2*i+1;
+        if(child >= field->numOpen){
+            break;
+        }
+        if(child+1 < field->numOpen && field->open[child+1] < field->open[child]){
+            child++;
+        }
+        if(field->open[child] >= last){
+            break;
+        }
+        field->open[i] = field->open[child];
+        i = child;
+    }
+    field->open[i] = last;
+    return (Uint32)top;
+}
+
+//Returns 0 if the node could not be put on the open list
+static int isoFlowRelax(isoFlowFieldT *field,Uint32 node,Uint32 next,Uint32 cost)
+{
+    if(field->nodeSettled[node] || cost >= field->nodeCost[node]){
+        return 1;
+    }
+    field->nodeCost[node] = cost;
+    field->nodeNext[node] = next;
+    return isoFlowOpenPush(field,cost,node);
+}
+
+//The side of the cluster a node is on, which is where its entrance leads
+static int isoFlowGetSide(isoPathClusterT *cluster,int index)
+{
+    int side;
+
+    for(side=0;side<4 && index >= cluster->sideStart[side] + cluster->sideCount[side];++side);
+    return side;
+}
+
+//Starts the search over the nodes again, from the costs of the nodes of the goal's cluster to the goal.
+//Returns 0 if there was no memory for it.
+static int isoFlowBeginSearch(isoFlowFieldT *field)
+{
+    int k;
+    isoPathFinderT *finder = field->finder;
+    isoPathClusterT *cluster = &finder->clusters[field->goalCluster];
+    Uint16 goalTile = ((field->goalY & ISO_FLOW_MASK) << ISO_FLOW_SHIFT) + (field->goalX & ISO_FLOW_MASK);
+    Uint32 goalCost = 0;
+    Uint32 integration[ISO_PATH_CLUSTER_TILES];
+    Uint8 steps[ISO_PATH_CLUSTER_TILES];
+
+    memset(field->nodeCost,0xff,(size_t)finder->numClustersX*finder->numClustersY*ISO_PATH_MAX_CLUSTER_NODES*sizeof(Uint32));
+    memset(field->nodeSettled,0,(size_t)finder->numClustersX*finder->numClustersY*ISO_PATH_MAX_CLUSTER_NODES);
+    field->numOpen = 0;
+    field->graphRevision = finder->graphRevision;
+    field->searched = 1;
+    if(isoPathIntegrate(finder,field->goalCluster,&goalTile,&goalCost,1,integration,steps) == 0){
+        return 0;
+    }
+    for(k=0;k<cluster->numNodes;++k){
+        if(isoFlowRelax(field,field->goalCluster*ISO_PATH_MAX_CLUSTER_NODES + k,ISO_FLOW_GOAL_NODE,integration[cluster->nodeTiles[k]]) == 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//Goes on with the search over the nodes until numWaiting nodes of the clusters that were asked for are settled, or
+//there are no nodes left. A node is reached from the other nodes of its cluster, and from the node of the same
+//entrance on the other side of the border. Returns the number of nodes settled, or -1 if a node could not be put on
+//the open list.
+static int isoFlowSearch(isoFlowFieldT *field,int numWaiting)
+{
+    int k,side;
+    int ok = 1;
+    int cluster,neighbour;
+    int numSettled = 0;
+    Uint32 node,index,cost;
+    isoPathFinderT *finder = field->finder;
+    isoPathClusterT *clusterData;
+
+    while(numWaiting > 0 && field->numOpen > 0){
+        node = isoFlowOpenPop(field);
+        if(field->nodeSettled[node]){
+            continue;
+        }
+        field->nodeSettled[node] = 1;
+        numSettled++;
+        cluster = node / ISO_PATH_MAX_CLUSTER_NODES;
+        index = node % ISO_PATH_MAX_CLUSTER_NODES;
+        clusterData = &finder->clusters[cluster];
+        if(field->required[cluster]){
+            numWaiting--;
+        }
+
+        for(k=0;k<clusterData->numNodes && ok;++k){
+            if(k != (int)index && clusterData->distances[k*clusterData->numNodes + index] != ISO_PATH_NO_PATH){
+                ok = isoFlowRelax(field,cluster*ISO_PATH_MAX_CLUSTER_NODES + k,node,
+                                  field->nodeCost[node] + clusterData->distances[k*clusterData->numNodes + index]);
+            }
+        }
+        side = isoFlowGetSide(clusterData,index);
+        neighbour = cluster + (side == ISO_PATH_UP ? -finder->numClustersX : side == ISO_PATH_DOWN ? finder->numClustersX : side == ISO_PATH_LEFT ? -1 : 1);
+        k = index - clusterData->sideStart[side];
+        if(ok && side < 4 && k < finder->clusters[neighbour].sideCount[(side+2)%4]){
+            cost = ISO_PATH_STRAIGHT*finder->costs[(size_t)cluster*ISO_PATH_CLUSTER_TILES + clusterData->nodeTiles[index]];
+            ok = isoFlowRelax(field,neighbour*ISO_PATH_MAX_CLUSTER_NODES + finder->clusters[neighbour].sideStart[(side+2)%4] + k,node,
+                              field->nodeCost[node] + cost);
+        }
+        if(!ok){
+            return -1;
+        }
+    }
+    return numSettled;
+}
+
+//The tiles the integration of a cluster starts from: the goal, and the nodes whose way leaves the cluster, which
+//cost what the way from them costs and step across the border. A tile that is a node on two sides keeps the cheaper.
+static int isoFlowGetSeeds(isoFlowFieldT *field,int cluster,Uint64 *seeds)
+{
+    int i,j,k;
+    int numSeeds = 0;
+    Uint32 node;
+    Uint64 seed;
+    isoPathClusterT *clusterData = &field->finder->clusters[cluster];
+
+    if(cluster == field->goalCluster){
+        seeds[numSeeds++] = ((Uint64)(((field->goalY & ISO_FLOW_MASK) << ISO_FLOW_SHIFT) + (field->goalX & ISO_FLOW_MASK)) << 8) | ISO_PATH_SEED_STEP;
+    }
+    for(k=0;k<clusterData->numNodes;++k){
+        node = cluster*ISO_PATH_MAX_CLUSTER_NODES + k;
+        if(!field->nodeSettled[node] || field->nodeNext[node] == ISO_FLOW_GOAL_NODE ||
+           field->nodeNext[node] / ISO_PATH_MAX_CLUSTER_NODES == (Uint32)cluster){
+            continue;
+        }
+        seed = ((Uint64)field->nodeCost[node] << 32) | ((Uint64)clusterData->nodeTiles[k] << 8) | isoFlowGetSide(clusterData,k);
+        for(i=0;i<numSeeds && ((seeds[i] >> 8) & 0xffff) != clusterData->nodeTiles[k];++i);
+        if(i == numSeeds){
+            seeds[numSeeds++] = seed;
+        }
+        else if(seed < seeds[i]){
+            seeds[i] = seed;
+        }
+    }
+    //sorted by the cost, which the integration needs, and so that the same seeds always look the same
+    for(i=1;i<numSeeds;++i){
+        seed = seeds[i];
+        for(j=i;j > 0 && seeds[j-1] > seed;--j){
+            seeds[j] = seeds[j-1];
+        }
+        seeds[j] = seed;
+    }
+    return numSeeds;
+}
+
+static void isoFlowIntegrateJob(void *data,int job)
+{
+    int i;
+    int tile;
+    isoFlowJobT *flowJob = data;
+    int cluster = flowJob->flow->integrateList[job];
+    isoFlowChunkT *chunk = flowJob->field->chunks[cluster];
+    Uint16 seedTiles[ISO_FLOW_MAX_SEEDS];
+    Uint32 seedCosts[ISO_FLOW_MAX_SEEDS];
+
+    for(i=0;i<chunk->numSeeds;++i){
+        seedTiles[i] = (chunk->seeds[i] >> 8) & 0xffff;
+        seedCosts[i] = chunk->seeds[i] >> 32;
+    }
+    if(isoPathIntegrate(flowJob->flow->finder,cluster,seedTiles,seedCosts,chunk->numSeeds,chunk->integration,chunk->steps) == 0){
+        //integrated again the next time it is asked for
+        chunk->numSeeds = -1;
+        memset(chunk->steps,ISO_PATH_NO_STEP,sizeof(chunk->steps));
+        SDL_AtomicSet(&flowJob->failed,1);
+        return;
+    }
+    //a seed that is not cheaper to get to through another one steps across the border
+    for(i=0;i<chunk->numSeeds;++i){
+        tile = seedTiles[i];
+        if(chunk->steps[tile] == ISO_PATH_SEED_STEP){
+            chunk->steps[tile] = chunk->seeds[i] & 0xff;
+        }
+    }
+}
+
+//Settles the nodes and integrates the chunks the field was asked for since the last update. Returns the number of
+//chunks integrated.
+static int isoFlowUpdateField(isoFlowT *flow,isoFlowFieldT *field)
+{
+    int i,k;
+    int cluster;
+    int numSeeds;
+    int numSettled = 0;
+    int numWaiting = 0;
+    int ok = 1;
+    int numIntegrate = 0;
+    isoPathFinderT *finder = flow->finder;
+    isoFlowChunkT *chunk;
+    isoFlowJobT job;
+    Uint64 seeds[ISO_FLOW_MAX_SEEDS];
+
+    //every node may cost something else once the graph has changed
+    if(!field->searched || field->graphRevision != finder->graphRevision){
+        ok = isoFlowBeginSearch(field);
+    }
+    if(ok){
+        for(i=0;i<field->numRequired;++i){
+            cluster = field->requiredList[i];
+            for(k=0;k<finder->clusters[cluster].numNodes;++k){
+                numWaiting += !field->nodeSettled[cluster*ISO_PATH_MAX_CLUSTER_NODES + k];
+            }
+        }
+        numSettled = isoFlowSearch(field,numWaiting);
+        ok = numSettled >= 0;
+    }
+    //the nodes that were left out may have been on the way, the chunks keep their directions and the search starts
+    //again in the next update
+    if(!ok){
+        writeToLog("Error in function: isoFlowUpdate(...) - The search over the nodes failed, the flow field was not updated!","error.txt");
+        field->searched = 0;
+        for(i=0;i<field->numRequired;++i){
+            field->required[field->requiredList[i]] = 0;
+        }
+        field->numRequired = 0;
+        return 0;
+    }
+    flow->numSettled += numSettled;
+
+    for(i=0;i<field->numRequired;++i){
+        cluster = field->requiredList[i];
+        field->required[cluster] = 0;
+        chunk = field->chunks[cluster];
+        if(chunk == NULL){
+            chunk = malloc(sizeof(isoFlowChunkT));
+            if(chunk == NULL){
+                writeToLog("Error in function: isoFlowUpdate(...) - Could not allocate memory for the chunk!","error.txt");
+                continue;
+            }
+            chunk->numSeeds = -1;
+            memset(chunk->integration,0xff,sizeof(chunk->integration));
+            memset(chunk->steps,ISO_PATH_NO_STEP,sizeof(chunk->steps));
+            field->chunks[cluster] = chunk;
+        }
+        //the tiles stay the same as long as their costs and the seeds do
+        numSeeds = isoFlowGetSeeds(field,cluster,seeds);
+        if(chunk->numSeeds == numSeeds && chunk->costsRevision == finder->clusters[cluster].costsRevision &&
+           memcmp(chunk->seeds,seeds,numSeeds*sizeof(Uint64)) == 0){
+            flow->numKept++;
+            continue;
+        }
+        chunk->numSeeds = numSeeds;
+        chunk->costsRevision = finder->clusters[cluster].costsRevision;
+        memcpy(chunk->seeds,seeds,numSeeds*sizeof(Uint64));
+        flow->integrateList[numIntegrate++] = cluster;
+    }
+    field->numRequired = 0;
+
+    job.flow = flow;
+    job.field = field;
+    SDL_AtomicSet(&job.failed,0);
+    threadPoolRun(flow->threadPool,isoFlowIntegrateJob,&job,numIntegrate);
+    if(SDL_AtomicGet(&job.failed)){
+        writeToLog("Error in function: isoFlowUpdate(...) - Could not allocate memory for the integration!","error.txt");
+    }
+    return numIntegrate;
+}
+
+//Once per frame, after the units asked for their chunks: builds the path finder clusters that changed, then brings
+//the chunks that were asked for up to date. Returns the number of chunks integrated.
+int isoFlowUpdate(isoFlowT *flow)
+{
+    int i;
+
+    if(flow == NULL){
+        return 0;
+    }
+    isoPathRebuild(flow->finder);
+    flow->numIntegrated = 0;
+    flow->numKept = 0;
+    flow->numSettled = 0;
+    for(i=0;i<ISO_FLOW_MAX_FIELDS;++i){
+        if(flow->fields[i] != NULL && flow->fields[i]->numRequired > 0){
+            flow->numIntegrated += isoFlowUpdateField(flow,flow->fields[i]);
+        }
+    }
+    return flow->numIntegrated;
+}
+
+static isoFlowChunkT *isoFlowGetChunk(isoFlowFieldT *field,int x,int y,int *tile)
+{
+    if(field == NULL || x < 0 || y < 0 || x >= field->finder->isoMap->mapWidth || y >= field->finder->isoMap->mapHeight){
+        return NULL;
+    }
+    *tile = ((y & ISO_FLOW_MASK) << ISO_FLOW_SHIFT) + (x & ISO_FLOW_MASK);
+    return field->chunks[(y >> ISO_FLOW_SHIFT)*field->finder->numClustersX + (x >> ISO_FLOW_SHIFT)];
+}
+
+//The step to take from the tile x,y towards the goal, 0,0 on the goal. Returns 0 if there is no way to the goal from
+//the tile or its chunk was never asked for.
+int isoFlowGetDirection(isoFlowFieldT *field,int x,int y,int *dx,int *dy)
+{
+    int tile;
+    isoFlowChunkT *chunk = isoFlowGetChunk(field,x,y,&tile);
+
+    *dx = 0;
+    *dy = 0;
+    if(chunk == NULL || chunk->steps[tile] == ISO_PATH_NO_STEP){
+        return 0;
+    }
+    isoPathGetStep(chunk->steps[tile],dx,dy);
+    return 1;
+}
+
+//The cost of the way from the tile x,y to the goal, ISO_PATH_NO_PATH if there is none
+Uint32 isoFlowGetCost(isoFlowFieldT *field,int x,int y)
+{
+    int tile;
+    isoFlowChunkT *chunk = isoFlowGetChunk(field,x,y,&tile);
+
+    return chunk != NULL ? chunk->integration[tile] : ISO_PATH_NO_PATH;
+}
@@ -0,0 +1,72 @@
+#ifndef __ISO_FLOW_H_
+#define __ISO_FLOW_H_
+
+#include <SDL2/SDL.h>
+#include "isoPath.h"
+
+//Flow fields for many units going to the same tile: instead of a path per unit, every tile gets the step to take
+//towards the goal. The cost from every node of the path finder to the goal is worked out with a Dijkstra backwards
+//from the goal over the nodes, and the tiles of a chunk are then integrated from the nodes of the chunk whose way
+//leaves it (and the goal): the cost to the goal of every tile and the step it takes.
+//Only the chunks units ask for (isoFlowRequire) get their tiles, and the node search stops once it has settled their
+//nodes. A chunk keeps its tiles until the costs of its tiles or of its nodes on the way out change, so painting a tile
+//only integrates again the chunks whose way to the goal it changes. The chunks are integrated on the thread pool.
+#define ISO_FLOW_MAX_FIELDS     8       //the fields of the goals that were asked for last are kept
+#define ISO_FLOW_MAX_SEEDS      (ISO_PATH_MAX_CLUSTER_NODES+1)
+#define ISO_FLOW_GOAL_NODE      0xffffffff
+
+typedef struct isoFlowChunkT
+{
+    Uint32 costsRevision;                       //the costs of the path finder cluster the tiles were integrated with
+    int numSeeds;
+    Uint64 seeds[ISO_FLOW_MAX_SEEDS];           //cost << 32 | tile << 8 | step, sorted
+    Uint32 integration[ISO_PATH_CLUSTER_TILES]; //the cost to the goal
+    Uint8 steps[ISO_PATH_CLUSTER_TILES];        //the step to the next tile, ISO_PATH_SEED_STEP at the goal
+}isoFlowChunkT;
+
+typedef struct isoFlowFieldT
+{
+    isoPathFinderT *finder;
+    int goalX;
+    int goalY;
+    int goalCluster;
+    Uint32 graphRevision;       //the path finder graph the node costs are for
+    int searched;               //the node search has been started for graphRevision
+    Uint64 lastUsed;
+
+    //the search backwards over the nodes, indexed by cluster*ISO_PATH_MAX_CLUSTER_NODES + node
+    Uint32 *nodeCost;           //the cost from the node to the goal
+    Uint32 *nodeNext;           //the next node on the way, ISO_FLOW_GOAL_NODE if the way goes straight to the goal
+    Uint8 *nodeSettled;
+    Uint64 *open;               //a binary heap of cost << 32 | node
+    int numOpen;
+    int maxOpen;
+
+    isoFlowChunkT **chunks;     //per cluster, NULL until a unit asks for it
+    Uint8 *required;
+    int *requiredList;          //the clusters asked for since the last isoFlowUpdate
+    int numRequired;
+}isoFlowFieldT;
+
+typedef struct isoFlowT
+{
+    isoPathFinderT *finder;
+    threadPoolT *threadPool;
+    isoFlowFieldT *fields[ISO_FLOW_MAX_FIELDS];
+    Uint64 useCount;
+    int *integrateList;
+
+    int numIntegrated;          //the chunks the last isoFlowUpdate integrated
+    int numKept;                //the chunks it asked for that were still up to date
+    int numSettled;             //the nodes it settled
+}isoFlowT;
+
+isoFlowT *isoFlowNew(isoPathFinderT *finder,threadPoolT *threadPool);
+void isoFlowFree(isoFlowT *flow);
+isoFlowFieldT *isoFlowGetField(isoFlowT *flow,int goalX,int goalY);
+void isoFlowRequire(isoFlowFieldT *field,int x,int y);
+int isoFlowUpdate(isoFlowT *flow);
+int isoFlowGetDirection(isoFlowFieldT *field,int x,int y,int *dx,int *dy);
+Uint32 isoFlowGetCost(isoFlowFieldT *field,int x,int y);
+
+#endif // __ISO_FLOW_H_
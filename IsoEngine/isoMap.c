@@ -5,12 +5,43 @@
 #include "isoEngine.h"
 #include "isoMap.h"
 #include "../texture.h"
+#include "../renderer.h"
 #include "../logger.h"
+#include "../mappedFile.h"
+#include "isoMapPager.h"
+#include "isoMapJournal.h"
+#include "isoMapGen.h"
 
-static void isoGenerateMap(isoMapT *isoMap);
+//the chunks of a map file are used as the map's tiles in place
+SDL_COMPILE_TIME_ASSERT(isoMapTileIs32Bit,sizeof(int) == 4);
+SDL_COMPILE_TIME_ASSERT(isoMapFileChunkSize,sizeof(isoMapFileChunkT) == 4);
+
+Uint32 isoMapGetChunkRevision(isoMapT *isoMap,int chunkX,int chunkY)
+{
+    if(isoMap == NULL)
+    {
+        return 0;
+    }
+
+    if(chunkX < 0 || chunkX > isoMap->numChunksX-1 || chunkY < 0 || chunkY > isoMap->numChunksY-1){
+        return 0;
+    }
+    return isoMap->chunkRevisions[chunkY * isoMap->numChunksX + chunkX];
+}
+
+static isoMapT *isoMapAllocateMap(char *mapName,int width,int height,int numLayers,int tileSize,int allocateTiles);
+static int isoMapInitLayer(isoMapT *isoMap,isoMapLayerT *mapLayer,int sparse);
+static void isoMapFreeLayer(isoMapT *isoMap,isoMapLayerT *mapLayer);
+static isoMapChunkT *isoMapAllocateChunk(isoMapLayerT *mapLayer,int chunk);
+static isoMapChunkT *isoMapUseChunk(isoMapT *isoMap,int layer,int chunk);
+static int isoMapChunkSetTile(isoMapChunkT *chunk,int tile,int value);
+static int isoMapStoreChunk(isoMapT *isoMap,int layer,int chunk,const int *tiles);
 
 isoMapT* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,int tileSize)
 {
+    isoMapT *isoMap;
+    isoMapGenT gen;
+
     //Set failsafe values
     if(height<=0){
         height = 10;
@@ -24,18 +55,57 @@ isoMapT* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,i
         numLayers = 1;
     }
 
+    isoMap = isoMapAllocateMap(mapName,width,height,numLayers,tileSize,1);
+    if(isoMap == NULL){
+        return NULL;
+    }
+    isoMapGenInitDefault(&gen,ISO_MAP_GEN_DEFAULT_SEED);
+    if(isoMapGenRun(&gen,isoMap,NULL)==0){
+        isoMapFreeMap(isoMap);
+        return NULL;
+    }
+    return isoMap;
+}
+
+//Allocates a map and its tile set. With allocateTiles set the ground layer is allocated dense and the layers above
+//it sparse, without it every layer starts out with no chunks at all, ready to be pointed at the chunks of a map file.
+static isoMapT *isoMapAllocateMap(char *mapName,int width,int height,int numLayers,int tileSize,int allocateTiles)
+{
+    int i;
+
     //allocate memory for the map
     isoMapT *isoMap = malloc(sizeof(struct isoMapT));
     if(isoMap == NULL){
         writeToLog("Error in function: isoMapCreateEmptyMap(...) - Could not allocate memory for isometric map!","error.txt");
         return NULL;
     }
-    //allocate memory for map data (the actual tiles)
-    isoMap->mapData = malloc(width * height * numLayers * sizeof(int));
-    if(isoMap->mapData == NULL){
+    isoMap->mappedFile = NULL;
+    isoMap->pager = NULL;
+    isoMap->journal = NULL;
+
+    //round the map size up to whole chunks
+    isoMap->numChunksX = (width + MAP_CHUNK_MASK) >> MAP_CHUNK_SHIFT;
+    isoMap->numChunksY = (height + MAP_CHUNK_MASK) >> MAP_CHUNK_SHIFT;
+
+    //allocate memory for map data (the actual tiles), one plane per layer.
+    //The ground layer is dense, the layers above it are mostly empty and stored sparse.
+    isoMap->layers = calloc(numLayers,sizeof(struct isoMapLayerT));
+    if(isoMap->layers == NULL){
+        writeToLog("Error in function: isoMapCreateEmptyMap(...) - Could not allocate memory for isometric map data!","error.txt");
+        return NULL;
+    }
+    //every chunk counts its changes, so cached drawings of it can tell when they are out of date
+    isoMap->chunkRevisions = calloc(isoMap->numChunksX * isoMap->numChunksY,sizeof(Uint32));
+    if(isoMap->chunkRevisions == NULL){
         writeToLog("Error in function: isoMapCreateEmptyMap(...) - Could not allocate memory for isometric map data!","error.txt");
         return NULL;
     }
+    for(i=0;i<numLayers;++i){
+        if(isoMapInitLayer(isoMap,&isoMap->layers[i],i>0 || allocateTiles==0)==0){
+            writeToLog("Error in function: isoMapCreateEmptyMap(...) - Could not allocate memory for isometric map data!","error.txt");
+            return NULL;
+        }
+    }
 
     //allocate memory for the tile set
     isoMap->tileSet = malloc(sizeof(struct isoTileSetT));
@@ -46,6 +116,9 @@ isoMapT* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,i
     }
 
     isoMap->tileSet->numTileClipRects = 0;
+    isoMap->tileSet->tileWidth = 0;
+    isoMap->tileSet->tileHeight = 0;
+    isoMap->tileSet->filename[0] = 0;
     isoMap->tileSet->tilesTex = malloc(sizeof(struct textureT));
 
     if(isoMap->tileSet->tilesTex == NULL){
@@ -55,6 +128,7 @@ isoMapT* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,i
     textureInit(isoMap->tileSet->tilesTex,0,0,0,NULL,NULL,SDL_FLIP_NONE);
     isoMap->tileSet->tilesTex->texture = NULL;
     isoMap->tileSet->tileClipRects = NULL;
+    textureQuadTableInit(&isoMap->tileSet->quadTable);
     isoMap->tileSet->tileSetLoaded = 0;
 
     isoMap->mapHeight = height;
@@ -70,23 +144,40 @@ isoMapT* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,i
     }
     //Divide the tile size by two
     isoMap->tileSize = tileSize/2;
-    isoGenerateMap(isoMap);
     return isoMap;
 }
 
 void isoMapFreeMap(isoMapT *isoMap)
 {
+    int i;
+
     if(isoMap != NULL)
     {
-        if(isoMap->mapData!=NULL)
+        //the loader thread must be gone before the chunks it hands over are freed
+        isoMapPagerFree(isoMap->pager);
+        isoMapJournalFree(isoMap->journal);
+        if(isoMap->layers!=NULL)
+        {
+            for(i=0;i<isoMap->numLayers;++i){
+                isoMapFreeLayer(isoMap,&isoMap->layers[i]);
+            }
+            free(isoMap->layers);
+        }
+        if(isoMap->chunkRevisions!=NULL)
+        {
+            free(isoMap->chunkRevisions);
+        }
+        //the chunks of a loaded map live in the mapped file, unmap it after the layers are gone
+        if(isoMap->mappedFile!=NULL)
         {
-            free(isoMap->mapData);
+            mappedFileClose(isoMap->mappedFile);
         }
         if(isoMap->tileSet!=NULL)
         {
             if(isoMap->tileSet->tileClipRects!=NULL){
                 free(isoMap->tileSet->tileClipRects);
             }
+            textureQuadTableFree(&isoMap->tileSet->quadTable);
             if(isoMap->tileSet->tilesTex!=NULL){
                 textureDelete(isoMap->tileSet->tilesTex);
                 free(isoMap->tileSet->tilesTex);
@@ -96,13 +187,44 @@ void isoMapFreeMap(isoMapT *isoMap)
     }
 }
 
+//Returns the quad size of every tile clip rect at the zoom level, or NULL if no tile set is loaded.
+//The sizes are only computed again when the zoom level changes. Not thread safe, call it before handing
+//the sizes to other threads.
+SDL_Point *isoMapGetTileQuadSizes(isoMapT *isoMap,float zoomLevel)
+{
+    isoTileSetT *tileSet = isoMap->tileSet;
+
+    if(tileSet == NULL || tileSet->tileClipRects == NULL || tileSet->numTileClipRects <= 0){
+        return NULL;
+    }
+    if(textureQuadTableUpdate(&tileSet->quadTable,tileSet->tileClipRects,tileSet->numTileClipRects,zoomLevel) == 0){
+        return NULL;
+    }
+    return tileSet->quadTable.sizes;
+}
+
+static int isoMapLoadTileSetTexture(isoMapT *isoMap,char *filename,int tileWidth,int tileHeight,int async);
+
 int isoMapLoadTileSet(isoMapT *isoMap,char *filename,int tileWidth,int tileHeight)
+{
+    return isoMapLoadTileSetTexture(isoMap,filename,tileWidth,tileHeight,0);
+}
+
+//Like isoMapLoadTileSet, but the image is decoded in the background. The tiles can be used at once,
+//they are drawn as placeholders until textureCacheUpdate has uploaded the texture.
+int isoMapLoadTileSetAsync(isoMapT *isoMap,char *filename,int tileWidth,int tileHeight)
+{
+    return isoMapLoadTileSetTexture(isoMap,filename,tileWidth,tileHeight,1);
+}
+
+static int isoMapLoadTileSetTexture(isoMapT *isoMap,char *filename,int tileWidth,int tileHeight,int async)
 {
     int x=0,y=0;
     int w,h;
     int numTilesX;
     int numTilesY;
     int i = 0;
+    int chunk;
     SDL_Rect tmpRect;
 
     if(isoMap == NULL)
@@ -113,18 +235,30 @@ int isoMapLoadTileSet(isoMapT *isoMap,char *filename,int tileWidth,int tileHeigh
     //if a tile set already has been loaded
     if(isoMap->tileSet->tileClipRects!=NULL){
         free(isoMap->tileSet->tileClipRects);
+        isoMap->tileSet->tileClipRects = NULL;
     }
+    //the quad sizes belong to the old clip rects
+    textureQuadTableFree(&isoMap->tileSet->quadTable);
 
-    //free the tiles texture
-    if(isoMap->tileSet->tilesTex->texture!=NULL){
-        textureDelete(isoMap->tileSet->tilesTex);
-        isoMap->tileSet->tilesTex->texture = NULL;
-    }
+    //give the tiles texture back, the texture cache keeps it so loading the same tile set again is free
+    textureDelete(isoMap->tileSet->tilesTex);
 
-    if(loadTexture(isoMap->tileSet->tilesTex,filename)==0){
+    if((async ? loadTextureAsync(isoMap->tileSet->tilesTex,filename) : loadTexture(isoMap->tileSet->tilesTex,filename))==0){
         return -1;
     }
 
+    //remember the tile set, so it can be saved with the map
+    if(filename != isoMap->tileSet->filename){
+        snprintf(isoMap->tileSet->filename,MAP_TILESET_FILENAME_LENGTH,"%s",filename);
+    }
+    isoMap->tileSet->tileWidth = tileWidth;
+    isoMap->tileSet->tileHeight = tileHeight;
+
+    //everything drawn with the old tile set is out of date
+    for(chunk=0;chunk<isoMap->numChunksX * isoMap->numChunksY;++chunk){
+        isoMap->chunkRevisions[chunk]++;
+    }
+
     //get width and height
     w = isoMap->tileSet->tilesTex->width;
     h = isoMap->tileSet->tilesTex->height;
@@ -177,62 +311,1167 @@ int isoMapLoadTileSet(isoMapT *isoMap,char *filename,int tileWidth,int tileHeigh
 
 int isoMapGetTile(isoMapT *isoMap,int x,int y,int layer)
 {
+    isoMapChunkT *chunk;
+
     if(isoMap == NULL)
     {
         return -1;
     }
 
-    if(x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer > isoMap->numLayers){
+    if(x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer > isoMap->numLayers-1){
         return -1;
     }
-    return isoMap->mapData[(y * isoMap->mapWidth + x) * isoMap->numLayers + layer];
+    chunk = isoMapUseChunk(isoMap,layer,(y >> MAP_CHUNK_SHIFT) * isoMap->numChunksX + (x >> MAP_CHUNK_SHIFT));
+
+    //nothing has been painted in this part of a sparse layer
+    if(chunk->indices == NULL){
+        if(isoMap->pager != NULL && isoMapPagerIsResident(isoMap->pager,(y >> MAP_CHUNK_SHIFT) * isoMap->numChunksX + (x >> MAP_CHUNK_SHIFT))==0){
+            return MAP_TILE_NOT_RESIDENT;
+        }
+        return MAP_EMPTY_TILE;
+    }
+    return isoMapChunkGetTile(chunk,((y & MAP_CHUNK_MASK) << MAP_CHUNK_SHIFT) + (x & MAP_CHUNK_MASK));
 }
 
 void isoMapSetTile(isoMapT *isoMap,int x,int y,int layer,int value)
 {
+    int chunk;
+    int tile;
+    int changed;
+    int oldValue = MAP_EMPTY_TILE;
+    isoMapChunkT *chunkData;
+
     if(isoMap == NULL)
     {
         return;
     }
 
-    if(x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer > isoMap->numLayers){
+    if(x < 0 || x > isoMap->mapWidth-1 || y < 0 || y > isoMap->mapHeight-1 || layer < 0 || layer > isoMap->numLayers-1){
         return;
     }
-    isoMap->mapData[(y * isoMap->mapWidth + x) * isoMap->numLayers + layer] = value;
+    chunk = (y >> MAP_CHUNK_SHIFT) * isoMap->numChunksX + (x >> MAP_CHUNK_SHIFT);
+    tile = ((y & MAP_CHUNK_MASK) << MAP_CHUNK_SHIFT) + (x & MAP_CHUNK_MASK);
+    chunkData = isoMapUseChunk(isoMap,layer,chunk);
+
+    //the tiles around it are not known, there is nothing to change yet
+    if(isoMap->pager != NULL && isoMapPagerIsResident(isoMap->pager,chunk)==0){
+        if(isoMapPagerLoseChange(isoMap->pager,chunk)){
+            logWarning("error.txt","isoMapSetTile(...) - tile %d,%d is in a chunk that is not loaded, the change is lost!",x,y);
+        }
+        return;
+    }
+    if(isoMap->journal != NULL && chunkData->indices != NULL){
+        oldValue = isoMapChunkGetTile(chunkData,tile);
+    }
+    if(chunkData->indices == NULL){
+        //clearing a tile in an empty region does not need any memory
+        if(value == MAP_EMPTY_TILE){
+            return;
+        }
+        if(isoMapAllocateChunk(&isoMap->layers[layer],chunk) == NULL){
+            writeToLog("Error in function: isoMapSetTile(...) - Could not allocate memory for map chunk!","error.txt");
+            return;
+        }
+    }
+    changed = isoMapChunkSetTile(chunkData,tile,value);
+    if(changed < 0){
+        writeToLog("Error in function: isoMapSetTile(...) - Could not allocate memory to widen the map chunk!","error.txt");
+    }
+    if(changed > 0){
+        isoMap->chunkRevisions[chunk]++;
+        if(isoMap->pager != NULL){
+            isoMapPagerMarkDirty(isoMap->pager,chunk);
+        }
+        if(isoMap->journal != NULL){
+            isoMapJournalRecord(isoMap->journal,x,y,layer,oldValue,value);
+        }
+    }
 }
 
-static void isoGenerateMap(isoMapT *isoMap)
+//Returns a layer of a chunk, or NULL for chunks of a sparse layer that have never been painted on.
+//Its tiles are read with isoMapChunkGetRow or isoMapChunkGetTile.
+isoMapChunkT *isoMapGetChunk(isoMapT *isoMap,int chunkX,int chunkY,int layer)
 {
-    int x,y;
-    int paintTile=0;
-    //only loop y and x, we will only draw on the ground layer
+    isoMapChunkT *chunk;
 
-    for(y=0;y<isoMap->mapHeight;y+=2)
+    if(isoMap == NULL)
     {
-        for(x=0;x<isoMap->mapWidth;x+=2)
-        {
-            isoMapSetTile(isoMap,x,y,0,1);
-            isoMapSetTile(isoMap,x,y+1,0,1);
-            isoMapSetTile(isoMap,x+1,y,0,1);
-            isoMapSetTile(isoMap,x+1,y+1,0,1);
-            paintTile = rand()%10;
-            if(paintTile>8)
-            {
-                if(y<isoMap->mapHeight-4 && x<isoMap->mapWidth-4){
-                    isoMapSetTile(isoMap,x,y,0,4);
-                    isoMapSetTile(isoMap,x,y+1,0,4);
-                    isoMapSetTile(isoMap,x+1,y,0,4);
-                    isoMapSetTile(isoMap,x+1,y+1,0,4);
+        return NULL;
+    }
+
+    if(chunkX < 0 || chunkX > isoMap->numChunksX-1 || chunkY < 0 || chunkY > isoMap->numChunksY-1 || layer < 0 || layer > isoMap->numLayers-1){
+        return NULL;
+    }
+    chunk = isoMapUseChunk(isoMap,layer,chunkY * isoMap->numChunksX + chunkX);
+    return chunk->indices != NULL ? chunk : NULL;
+}
+
+//Replaces all MAP_CHUNK_NUM_TILES tiles of a chunk, given row by row, and packs them with the narrowest indices
+//that fit. Returns 1 on success and 0 on failure.
+int isoMapSetChunkTiles(isoMapT *isoMap,int chunkX,int chunkY,int layer,const int *tiles)
+{
+    int chunk;
+
+    if(isoMap == NULL || tiles == NULL)
+    {
+        return 0;
+    }
+
+    if(chunkX < 0 || chunkX > isoMap->numChunksX-1 || chunkY < 0 || chunkY > isoMap->numChunksY-1 || layer < 0 || layer > isoMap->numLayers-1){
+        return 0;
+    }
+    chunk = chunkY * isoMap->numChunksX + chunkX;
+
+    if(isoMap->pager != NULL && isoMapPagerIsResident(isoMap->pager,chunk)==0){
+        if(isoMapPagerLoseChange(isoMap->pager,chunk)){
+            logWarning("error.txt","isoMapSetChunkTiles(...) - chunk %d,%d is not loaded, the change is lost!",chunkX,chunkY);
+        }
+        return 0;
+    }
+    if(isoMapStoreChunk(isoMap,layer,chunk,tiles) == 0){
+        writeToLog("Error in function: isoMapSetChunkTiles(...) - Could not allocate memory for map chunk!","error.txt");
+        return 0;
+    }
+    return 1;
+}
+
+//Packs the tiles into a chunk, allocating it in a sparse layer, and tells the pager and the renderer it changed
+static int isoMapStoreChunk(isoMapT *isoMap,int layer,int chunk,const int *tiles)
+{
+    isoMapLayerT *mapLayer = &isoMap->layers[layer];
+
+    if(isoMapChunkPack(&mapLayer->chunks[chunk],tiles) == 0){
+        return 0;
+    }
+    if(((mapLayer->chunkPresence[chunk >> 5] >> (chunk & 31)) & 1) == 0){
+        mapLayer->chunkPresence[chunk >> 5] |= 1u << (chunk & 31);
+        mapLayer->numChunksAllocated++;
+    }
+    isoMap->chunkRevisions[chunk]++;
+    if(isoMap->pager != NULL){
+        isoMapPagerMarkDirty(isoMap->pager,chunk);
+    }
+    return 1;
+}
+
+//Cuts rect down to the part of it that is on the map, returns 0 if nothing is left
+static int isoMapClipRect(isoMapT *isoMap,const SDL_Rect *rect,SDL_Rect *clipped)
+{
+    int x0 = SDL_max(rect->x,0);
+    int y0 = SDL_max(rect->y,0);
+    int x1 = SDL_min(rect->x + rect->w,isoMap->mapWidth);
+    int y1 = SDL_min(rect->y + rect->h,isoMap->mapHeight);
+
+    if(rect->w <= 0 || rect->h <= 0 || x1 <= x0 || y1 <= y0){
+        return 0;
+    }
+    clipped->x = x0;
+    clipped->y = y0;
+    clipped->w = x1 - x0;
+    clipped->h = y1 - y0;
+    return 1;
+}
+
+//Changes the tiles of a row in place, row->x,row->y is the map tile of the first one and row->w the number of them
+typedef void (*isoMapRowFuncT)(void *data,int *tiles,const SDL_Rect *row);
+
+//The core of the bulk operations: every chunk the clipped rect overlaps is decoded once, func changes its rows and
+//the chunk is stored again. A chunk where at least MAP_BULK_MIN_TILES tiles changed is packed as a whole, in the
+//others only the changed tiles are set. Chunks that are not loaded are left out. Only tiles that were stored are
+//told to the journal and counted. Returns the number of changed tiles.
+static int isoMapWriteRect(isoMapT *isoMap,const SDL_Rect *clipped,int layer,isoMapRowFuncT func,void *data)
+{
+    int chunkX,chunkY,chunk;
+    int x0,y0,x1,y1;
+    int x,y,tile,i;
+    int numChunkChanged;
+    int numChanged = 0;
+    int changed;
+    isoMapChunkT *chunkData;
+    SDL_Rect row;
+    int oldTiles[MAP_CHUNK_NUM_TILES];
+    int tiles[MAP_CHUNK_NUM_TILES];
+
+    //one transaction, undone at once
+    if(isoMap->journal != NULL){
+        isoMapJournalBegin(isoMap->journal);
+    }
+    for(chunkY = clipped->y >> MAP_CHUNK_SHIFT;chunkY <= (clipped->y + clipped->h - 1) >> MAP_CHUNK_SHIFT;++chunkY){
+        y0 = SDL_max(clipped->y - (chunkY << MAP_CHUNK_SHIFT),0);
+        y1 = SDL_min(clipped->y + clipped->h - (chunkY << MAP_CHUNK_SHIFT),MAP_CHUNK_SIZE);
+        for(chunkX = clipped->x >> MAP_CHUNK_SHIFT;chunkX <= (clipped->x + clipped->w - 1) >> MAP_CHUNK_SHIFT;++chunkX){
+            x0 = SDL_max(clipped->x - (chunkX << MAP_CHUNK_SHIFT),0);
+            x1 = SDL_min(clipped->x + clipped->w - (chunkX << MAP_CHUNK_SHIFT),MAP_CHUNK_SIZE);
+            chunk = chunkY * isoMap->numChunksX + chunkX;
+            chunkData = isoMapUseChunk(isoMap,layer,chunk);
+
+            if(isoMap->pager != NULL && isoMapPagerIsResident(isoMap->pager,chunk)==0){
+                if(isoMapPagerLoseChange(isoMap->pager,chunk)){
+                    logWarning("error.txt","isoMapWriteRect(...) - chunk %d,%d is not loaded, the change is lost!",chunkX,chunkY);
+                }
+                continue;
+            }
+            if(chunkData->indices != NULL){
+                isoMapChunkGetTiles(chunkData,oldTiles);
+            }
+            else{
+                for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+                    oldTiles[i] = MAP_EMPTY_TILE;
+                }
+            }
+            memcpy(tiles,oldTiles,sizeof(tiles));
+            row.x = (chunkX << MAP_CHUNK_SHIFT) + x0;
+            row.w = x1 - x0;
+            row.h = 1;
+            for(y=y0;y<y1;++y){
+                row.y = (chunkY << MAP_CHUNK_SHIFT) + y;
+                func(data,&tiles[(y << MAP_CHUNK_SHIFT) + x0],&row);
+            }
+
+            numChunkChanged = 0;
+            for(y=y0;y<y1;++y){
+                tile = y << MAP_CHUNK_SHIFT;
+                if(memcmp(&tiles[tile + x0],&oldTiles[tile + x0],(x1 - x0)*sizeof(int)) == 0){
+                    continue;
+                }
+                for(x=x0;x<x1;++x){
+                    numChunkChanged += tiles[tile + x] != oldTiles[tile + x];
+                }
+            }
+            if(numChunkChanged == 0){
+                continue;
+            }
+
+            if(chunkData->indices == NULL || numChunkChanged >= MAP_BULK_MIN_TILES){
+                if(isoMapStoreChunk(isoMap,layer,chunk,tiles) == 0){
+                    writeToLog("Error in function: isoMapWriteRect(...) - Could not allocate memory for map chunk!","error.txt");
+                    continue;
                 }
+                if(isoMap->journal != NULL){
+                    for(y=y0;y<y1;++y){
+                        for(x=x0;x<x1;++x){
+                            tile = (y << MAP_CHUNK_SHIFT) + x;
+                            if(tiles[tile] != oldTiles[tile]){
+                                isoMapJournalRecord(isoMap->journal,(chunkX << MAP_CHUNK_SHIFT) + x,(chunkY << MAP_CHUNK_SHIFT) + y,layer,oldTiles[tile],tiles[tile]);
+                            }
+                        }
+                    }
+                }
+            }
+            else{
+                numChunkChanged = 0;
+                for(y=y0;y<y1;++y){
+                    for(x=x0;x<x1;++x){
+                        tile = (y << MAP_CHUNK_SHIFT) + x;
+                        if(tiles[tile] == oldTiles[tile]){
+                            continue;
+                        }
+                        changed = isoMapChunkSetTile(chunkData,tile,tiles[tile]);
+                        if(changed < 0){
+                            writeToLog("Error in function: isoMapWriteRect(...) - Could not allocate memory to widen the map chunk!","error.txt");
+                            continue;
+                        }
+                        if(changed > 0){
+                            numChunkChanged++;
+                            if(isoMap->journal != NULL){
+                                isoMapJournalRecord(isoMap->journal,(chunkX << MAP_CHUNK_SHIFT) + x,(chunkY << MAP_CHUNK_SHIFT) + y,layer,oldTiles[tile],tiles[tile]);
+                            }
+                        }
+                    }
+                }
+                if(numChunkChanged == 0){
+                    continue;
+                }
+                isoMap->chunkRevisions[chunk]++;
+                if(isoMap->pager != NULL){
+                    isoMapPagerMarkDirty(isoMap->pager,chunk);
+                }
+            }
+            numChanged += numChunkChanged;
+        }
+    }
+    if(isoMap->journal != NULL){
+        isoMapJournalEnd(isoMap->journal);
+    }
+    return numChanged;
+}
+
+static void isoMapFillRow(void *data,int *tiles,const SDL_Rect *row)
+{
+    int value = *(int*)data;
+    int i;
+
+    for(i=0;i<row->w;++i){
+        tiles[i] = value;
+    }
+}
+
+//Sets every tile of rect that is on the map to value. Returns the number of tiles that changed.
+int isoMapFillRect(isoMapT *isoMap,const SDL_Rect *rect,int layer,int value)
+{
+    SDL_Rect clipped;
+
+    if(isoMap == NULL || rect == NULL)
+    {
+        return 0;
+    }
+
+    if(layer < 0 || layer > isoMap->numLayers-1 || isoMapClipRect(isoMap,rect,&clipped) == 0){
+        return 0;
+    }
+    return isoMapWriteRect(isoMap,&clipped,layer,isoMapFillRow,&value);
+}
+
+typedef struct isoMapPatternT
+{
+    const int *tiles;
+    int x;
+    int y;
+    int width;
+    int transparent;
+}isoMapPatternT;
+
+static void isoMapStampRow(void *data,int *tiles,const SDL_Rect *row)
+{
+    isoMapPatternT *pattern = (isoMapPatternT*)data;
+    const int *values = &pattern->tiles[(row->y - pattern->y) * pattern->width + (row->x - pattern->x)];
+    int i;
+
+    //without a branch, the transparent tiles are not predictable
+    for(i=0;i<row->w;++i){
+        tiles[i] = values[i] != pattern->transparent ? values[i] : tiles[i];
+    }
+}
+
+static void isoMapCopyRow(void *data,int *tiles,const SDL_Rect *row)
+{
+    isoMapPatternT *pattern = (isoMapPatternT*)data;
+
+    memcpy(tiles,&pattern->tiles[(row->y - pattern->y) * pattern->width + (row->x - pattern->x)],row->w*sizeof(int));
+}
+
+//Puts the width x height tiles of the pattern, row by row, on the map with its top left tile at x,y. Tiles of the
+//pattern with the value transparent leave the map as it is. Returns the number of tiles that changed.
+int isoMapStampRect(isoMapT *isoMap,int x,int y,int layer,const int *pattern,int width,int height,int transparent)
+{
+    SDL_Rect rect = {x,y,width,height};
+    SDL_Rect clipped;
+    isoMapPatternT stamp = {pattern,x,y,width,transparent};
+
+    if(isoMap == NULL || pattern == NULL)
+    {
+        return 0;
+    }
+
+    if(layer < 0 || layer > isoMap->numLayers-1 || isoMapClipRect(isoMap,&rect,&clipped) == 0){
+        return 0;
+    }
+    return isoMapWriteRect(isoMap,&clipped,layer,isoMapStampRow,&stamp);
+}
+
+//Copies the tiles of srcRect in a layer of src to dst, with the top left tile at dstX,dstY. Both can be the same map
+//and layer, also when the rects overlap. Tiles outside of either map are left out, tiles of chunks of src that are not
+//loaded are copied as MAP_EMPTY_TILE. Returns the number of tiles that changed.
+int isoMapCopyRect(isoMapT *dst,int dstX,int dstY,int dstLayer,isoMapT *src,const SDL_Rect *srcRect,int srcLayer)
+{
+    SDL_Rect srcClipped;
+    SDL_Rect rect;
+    SDL_Rect clipped;
+    SDL_Rect band;
+    SDL_Rect srcBand;
+    int offsetX,offsetY;
+    int chunkY,firstChunkY,lastChunkY,step;
+    int i;
+    int numChanged = 0;
+    int *tiles;
+    isoMapPatternT copy;
+
+    if(dst == NULL || src == NULL || srcRect == NULL)
+    {
+        return 0;
+    }
+
+    if(dstLayer < 0 || dstLayer > dst->numLayers-1 || srcLayer < 0 || srcLayer > src->numLayers-1){
+        return 0;
+    }
+    if(isoMapClipRect(src,srcRect,&srcClipped) == 0){
+        return 0;
+    }
+    offsetX = srcRect->x - dstX;
+    offsetY = srcRect->y - dstY;
+    rect.x = srcClipped.x - offsetX;
+    rect.y = srcClipped.y - offsetY;
+    rect.w = srcClipped.w;
+    rect.h = srcClipped.h;
+    if(isoMapClipRect(dst,&rect,&clipped) == 0){
+        return 0;
+    }
+
+    tiles = malloc(sizeof(int) * clipped.w * MAP_CHUNK_SIZE);
+    if(tiles == NULL){
+        writeToLog("Error in function: isoMapCopyRect(...) - Could not allocate memory for the copied tiles!","error.txt");
+        return 0;
+    }
+
+    //a row of destination chunks at a time: its source rows are read, then written. When the destination is below
+    //the source in the same layer the rows are copied from the bottom up, so no row is overwritten before it is read.
+    firstChunkY = clipped.y >> MAP_CHUNK_SHIFT;
+    lastChunkY = (clipped.y + clipped.h - 1) >> MAP_CHUNK_SHIFT;
+    step = 1;
+    if(src == dst && srcLayer == dstLayer && offsetY < 0){
+        i = firstChunkY;
+        firstChunkY = lastChunkY;
+        lastChunkY = i;
+        step = -1;
+    }
+    if(dst->journal != NULL){
+        isoMapJournalBegin(dst->journal);
+    }
+    for(chunkY = firstChunkY;chunkY != lastChunkY + step;chunkY += step){
+        band.x = clipped.x;
+        band.y = SDL_max(clipped.y,chunkY << MAP_CHUNK_SHIFT);
+        band.w = clipped.w;
+        band.h = SDL_min(clipped.y + clipped.h,(chunkY + 1) << MAP_CHUNK_SHIFT) - band.y;
+        srcBand.x = band.x + offsetX;
+        srcBand.y = band.y + offsetY;
+        srcBand.w = band.w;
+        srcBand.h = band.h;
+        isoMapReadRect(src,&srcBand,srcLayer,tiles);
+        for(i=0;i<band.w * band.h;++i){
+            if(tiles[i] == MAP_TILE_NOT_RESIDENT){
+                tiles[i] = MAP_EMPTY_TILE;
+            }
+        }
+        copy.tiles = tiles;
+        copy.x = band.x;
+        copy.y = band.y;
+        copy.width = band.w;
+        copy.transparent = 0;
+        numChanged += isoMapWriteRect(dst,&band,dstLayer,isoMapCopyRow,&copy);
+    }
+    if(dst->journal != NULL){
+        isoMapJournalEnd(dst->journal);
+    }
+    free(tiles);
+    return numChanged;
+}
+
+//Reads the rect->w x rect->h tiles of rect into tiles, row by row. Tiles outside of the map are -1, tiles of chunks
+//that are not loaded MAP_TILE_NOT_RESIDENT. Returns the number of tiles read from the map.
+int isoMapReadRect(isoMapT *isoMap,const SDL_Rect *rect,int layer,int *tiles)
+{
+    SDL_Rect clipped;
+    int x,y,i;
+    int chunkX,chunk;
+    int x0,x1,value;
+    int *row;
+    isoMapChunkT *chunkData;
+    int chunkRow[MAP_CHUNK_SIZE];
+
+    if(isoMap == NULL || rect == NULL || tiles == NULL)
+    {
+        return 0;
+    }
+
+    if(rect->w <= 0 || rect->h <= 0){
+        return 0;
+    }
+    if(layer < 0 || layer > isoMap->numLayers-1 || isoMapClipRect(isoMap,rect,&clipped) == 0){
+        for(i=0;i<rect->w * rect->h;++i){
+            tiles[i] = -1;
+        }
+        return 0;
+    }
+
+    for(y=rect->y;y<rect->y + rect->h;++y){
+        row = &tiles[(y - rect->y) * rect->w];
+        if(y < clipped.y || y >= clipped.y + clipped.h){
+            for(i=0;i<rect->w;++i){
+                row[i] = -1;
+            }
+            continue;
+        }
+        for(x=rect->x;x<clipped.x;++x){
+            row[x - rect->x] = -1;
+        }
+        for(x=clipped.x + clipped.w;x<rect->x + rect->w;++x){
+            row[x - rect->x] = -1;
+        }
+        for(chunkX = clipped.x >> MAP_CHUNK_SHIFT;chunkX <= (clipped.x + clipped.w - 1) >> MAP_CHUNK_SHIFT;++chunkX){
+            x0 = SDL_max(clipped.x,chunkX << MAP_CHUNK_SHIFT);
+            x1 = SDL_min(clipped.x + clipped.w,(chunkX + 1) << MAP_CHUNK_SHIFT);
+            chunk = (y >> MAP_CHUNK_SHIFT) * isoMap->numChunksX + chunkX;
+            chunkData = isoMapUseChunk(isoMap,layer,chunk);
+
+            if(chunkData->indices != NULL){
+                isoMapChunkGetRow(chunkData,y & MAP_CHUNK_MASK,chunkRow);
+                memcpy(&row[x0 - rect->x],&chunkRow[x0 & MAP_CHUNK_MASK],(x1 - x0)*sizeof(int));
+                continue;
+            }
+            value = MAP_EMPTY_TILE;
+            if(isoMap->pager != NULL && isoMapPagerIsResident(isoMap->pager,chunk)==0){
+                value = MAP_TILE_NOT_RESIDENT;
+            }
+            for(x=x0;x<x1;++x){
+                row[x - rect->x] = value;
+            }
+        }
+    }
+    return clipped.w * clipped.h;
+}
+
+//The memory the chunks of all layers take, the chunks that are still in the mapped map file included
+size_t isoMapGetTileMemory(isoMapT *isoMap)
+{
+    int layer,chunk;
+    size_t memory = 0;
+    isoMapChunkT *chunks;
+
+    if(isoMap == NULL)
+    {
+        return 0;
+    }
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        chunks = isoMap->layers[layer].chunks;
+        for(chunk=0;chunk<isoMap->numChunksX * isoMap->numChunksY;++chunk){
+            if(chunks[chunk].indices != NULL){
+                memory += MAP_CHUNK_BYTES(chunks[chunk].bitsPerTile);
+            }
+        }
+    }
+    return memory;
+}
+
+int isoMapIsChunkPresent(isoMapT *isoMap,int chunkX,int chunkY,int layer)
+{
+    int chunk;
+
+    if(isoMap == NULL)
+    {
+        return 0;
+    }
+
+    if(chunkX < 0 || chunkX > isoMap->numChunksX-1 || chunkY < 0 || chunkY > isoMap->numChunksY-1 || layer < 0 || layer > isoMap->numLayers-1){
+        return 0;
+    }
+    chunk = chunkY * isoMap->numChunksX + chunkX;
+    return (isoMap->layers[layer].chunkPresence[chunk >> 5] >> (chunk & 31)) & 1;
+}
+
+static Uint64 isoMapAlignOffset(Uint64 offset,Uint64 alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static int isoMapWritePadding(FILE *out,Uint64 from,Uint64 to)
+{
+    static const char zeros[MAP_FILE_ALIGNMENT];
+    size_t size;
+
+    while(from < to){
+        size = to-from < MAP_FILE_ALIGNMENT ? (size_t)(to-from) : MAP_FILE_ALIGNMENT;
+        if(fwrite(zeros,1,size,out) != size){
+            return 0;
+        }
+        from += size;
+    }
+    return 1;
+}
+
+static int isoMapIsChunkEmpty(isoMapChunkT *chunk)
+{
+    int i;
+    int tiles[MAP_CHUNK_NUM_TILES];
+
+    if(chunk->paletteSize == 1 && chunk->palette[0] == MAP_EMPTY_TILE){
+        return 1;
+    }
+    isoMapChunkGetTiles(chunk,tiles);
+    for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+        if(tiles[i] != MAP_EMPTY_TILE){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//Writes the map to filename.tmp and moves it over filename when everything has been written,
+//so a crash or a full disk never leaves a broken map behind. Returns 1 on success and 0 on failure.
+//On Windows a map can not be saved over the file it was loaded from while it is still loaded.
+int isoMapSaveMap(isoMapT *isoMap,char *filename)
+{
+    int layer,chunk;
+    int numChunks;
+    int ok = 1;
+    isoMapChunkT *chunkData;
+    isoMapFileChunkT fileChunk;
+    Uint32 *layerFlags;
+    Uint64 *chunkOffsets;
+    Uint64 offset;
+    isoMapFileHeaderT header;
+    char tmpFilename[512];
+    char msg[600];
+    FILE *out;
+
+    if(isoMap == NULL || filename == NULL)
+    {
+        writeToLog("Error in function: isoMapSaveMap(...) - Parameter isoMapT *isoMap or char *filename is NULL!","error.txt");
+        return 0;
+    }
+    //most of a paged map is only in the file it is being paged from
+    if(isoMap->pager != NULL){
+        writeToLog("Error in function: isoMapSaveMap(...) - A map loaded with isoMapLoadMapPaged can not be saved!","error.txt");
+        return 0;
+    }
+    if(snprintf(tmpFilename,sizeof(tmpFilename),"%s.tmp",filename) >= (int)sizeof(tmpFilename)){
+        writeToLog("Error in function: isoMapSaveMap(...) - The filename is too long!","error.txt");
+        return 0;
+    }
+    numChunks = isoMap->numChunksX * isoMap->numChunksY;
+    layerFlags = calloc(isoMap->numLayers,sizeof(Uint32));
+    chunkOffsets = calloc((size_t)isoMap->numLayers * numChunks,sizeof(Uint64));
+    if(layerFlags == NULL || chunkOffsets == NULL){
+        writeToLog("Error in function: isoMapSaveMap(...) - Could not allocate memory for the chunk table!","error.txt");
+        free(layerFlags);
+        free(chunkOffsets);
+        return 0;
+    }
+
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,MAP_FILE_MAGIC,sizeof(header.magic));
+    header.version = MAP_FILE_VERSION;
+    header.byteOrder = MAP_FILE_BYTE_ORDER;
+    header.headerSize = sizeof(isoMapFileHeaderT);
+    header.mapWidth = isoMap->mapWidth;
+    header.mapHeight = isoMap->mapHeight;
+    header.numLayers = isoMap->numLayers;
+    header.tileSize = isoMap->tileSize*2;
+    header.chunkSize = MAP_CHUNK_SIZE;
+    header.numChunksX = isoMap->numChunksX;
+    header.numChunksY = isoMap->numChunksY;
+    header.tileSetTileWidth = isoMap->tileSet->tileWidth;
+    header.tileSetTileHeight = isoMap->tileSet->tileHeight;
+    snprintf(header.name,sizeof(header.name),"%s",isoMap->name);
+    snprintf(header.tileSetFilename,sizeof(header.tileSetFilename),"%s",isoMap->tileSet->filename);
+    header.layerTableOffset = isoMapAlignOffset(sizeof(isoMapFileHeaderT),8);
+    header.chunkTableOffset = isoMapAlignOffset(header.layerTableOffset + (Uint64)isoMap->numLayers*sizeof(Uint32),8);
+    header.dataOffset = isoMapAlignOffset(header.chunkTableOffset + (Uint64)isoMap->numLayers*numChunks*sizeof(Uint64),MAP_FILE_ALIGNMENT);
+
+    //dense layers store every chunk, sparse layers only the chunks that have something on them
+    offset = header.dataOffset;
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        layerFlags[layer] = isoMap->layers[layer].sparse ? MAP_FILE_LAYER_SPARSE : 0;
+        for(chunk=0;chunk<numChunks;++chunk){
+            chunkData = &isoMap->layers[layer].chunks[chunk];
+            if(chunkData->indices == NULL || (isoMap->layers[layer].sparse && isoMapIsChunkEmpty(chunkData))){
+                continue;
             }
-            if(paintTile==7){
-                if(y<isoMap->mapHeight-4 && x<isoMap->mapWidth-4){
-                    isoMapSetTile(isoMap,x,y,0,3);
-                    isoMapSetTile(isoMap,x,y+1,0,3);
-                    isoMapSetTile(isoMap,x+1,y,0,3);
-                    isoMapSetTile(isoMap,x+1,y+1,0,3);
+            chunkOffsets[(size_t)layer*numChunks + chunk] = offset;
+            offset += sizeof(isoMapFileChunkT) + MAP_CHUNK_BYTES(chunkData->bitsPerTile);
+        }
+    }
+    header.fileSize = offset;
+
+    out = fopen(tmpFilename,"wb");
+    if(out == NULL){
+        sprintf(msg,"Error in function: isoMapSaveMap(...) - Could not open %.500s for writing!",tmpFilename);
+        writeToLog(msg,"error.txt");
+        free(layerFlags);
+        free(chunkOffsets);
+        return 0;
+    }
+    ok = fwrite(&header,sizeof(header),1,out) == 1 &&
+         isoMapWritePadding(out,sizeof(header),header.layerTableOffset) &&
+         fwrite(layerFlags,sizeof(Uint32),isoMap->numLayers,out) == (size_t)isoMap->numLayers &&
+         isoMapWritePadding(out,header.layerTableOffset + (Uint64)isoMap->numLayers*sizeof(Uint32),header.chunkTableOffset) &&
+         fwrite(chunkOffsets,sizeof(Uint64),(size_t)isoMap->numLayers*numChunks,out) == (size_t)isoMap->numLayers*numChunks &&
+         isoMapWritePadding(out,header.chunkTableOffset + (Uint64)isoMap->numLayers*numChunks*sizeof(Uint64),header.dataOffset);
+
+    for(layer=0;layer<isoMap->numLayers && ok;++layer){
+        for(chunk=0;chunk<numChunks && ok;++chunk){
+            if(chunkOffsets[(size_t)layer*numChunks + chunk] != 0){
+                //the palette is followed by the indices, in the file just like in memory
+                chunkData = &isoMap->layers[layer].chunks[chunk];
+                fileChunk.bitsPerTile = chunkData->bitsPerTile;
+                fileChunk.paletteSize = chunkData->paletteSize;
+                ok = fwrite(&fileChunk,sizeof(fileChunk),1,out) == 1 &&
+                     fwrite(chunkData->palette,MAP_CHUNK_PALETTE_CAPACITY(chunkData->bitsPerTile)*sizeof(int),1,out) == 1 &&
+                     fwrite(chunkData->indices,MAP_CHUNK_NUM_TILES*chunkData->bitsPerTile/8,1,out) == 1;
+            }
+        }
+    }
+    free(layerFlags);
+    free(chunkOffsets);
+
+    if(!ok){
+        fclose(out);
+        remove(tmpFilename);
+    }
+    if(!ok || mappedFileReplace(out,tmpFilename,filename)==0){
+        sprintf(msg,"Error in function: isoMapSaveMap(...) - Could not write %.500s!",filename);
+        writeToLog(msg,"error.txt");
+        return 0;
+    }
+    return 1;
+}
+
+static int isoMapCheckFileHeader(isoMapFileHeaderT *header,Uint64 fileSize)
+{
+    Uint64 numChunks;
+
+    if(memcmp(header->magic,MAP_FILE_MAGIC,sizeof(header->magic))!=0 || header->version != MAP_FILE_VERSION ||
+       header->byteOrder != MAP_FILE_BYTE_ORDER || header->headerSize != sizeof(isoMapFileHeaderT)){
+        return 0;
+    }
+    if(header->chunkSize != MAP_CHUNK_SIZE || header->fileSize != fileSize ||
+       header->tileSize < 2 || header->tileSize > MAP_FILE_MAX_TILE_SIZE){
+        return 0;
+    }
+    if(header->mapWidth == 0 || header->mapHeight == 0 || header->numLayers == 0 ||
+       header->mapWidth > 0x7fffffff - MAP_CHUNK_MASK || header->mapHeight > 0x7fffffff - MAP_CHUNK_MASK ||
+       header->numChunksX != (header->mapWidth + MAP_CHUNK_MASK) >> MAP_CHUNK_SHIFT ||
+       header->numChunksY != (header->mapHeight + MAP_CHUNK_MASK) >> MAP_CHUNK_SHIFT){
+        return 0;
+    }
+    //the chunk table is indexed with an int
+    numChunks = (Uint64)header->numChunksX * header->numChunksY * header->numLayers;
+    if(numChunks > 0x7fffffff){
+        return 0;
+    }
+    //compared by subtracting, an offset near the end of the Uint64 range must not wrap around
+    if(header->layerTableOffset % sizeof(Uint32) != 0 || header->chunkTableOffset % sizeof(Uint64) != 0 ||
+       header->layerTableOffset > fileSize || (Uint64)header->numLayers*sizeof(Uint32) > fileSize - header->layerTableOffset ||
+       header->chunkTableOffset > fileSize || numChunks*sizeof(Uint64) > fileSize - header->chunkTableOffset ||
+       header->dataOffset > fileSize){
+        return 0;
+    }
+    return 1;
+}
+
+//Maps a map file saved by isoMapSaveMap into memory. Only the header and the chunk tables are read up front, the map's
+//chunks point straight into the file and the operating system pages them in when they are first used. A chunk's tiles
+//are checked on its first use, a broken chunk is logged and left empty. Tiles that are changed afterwards stay in
+//memory until the map is saved. Returns NULL if the file can not be mapped or is not a map file.
+isoMapT *isoMapLoadMap(char *filename)
+{
+    int layer,chunk;
+    int numChunks;
+    Uint64 offset;
+    Uint32 *layerFlags;
+    Uint64 *chunkOffsets;
+    isoMapFileChunkT *fileChunk;
+    isoMapFileHeaderT *header;
+    isoMapLayerT *mapLayer;
+    mappedFileT *mappedFile;
+    isoMapT *isoMap;
+    char name[MAP_NAME_LENGTH];
+    char tileSetFilename[MAP_TILESET_FILENAME_LENGTH];
+    char msg[300];
+
+    mappedFile = mappedFileOpen(filename);
+    if(mappedFile == NULL){
+        return NULL;
+    }
+    if(mappedFile->size < sizeof(isoMapFileHeaderT) || isoMapCheckFileHeader(mappedFile->data,mappedFile->size)==0){
+        sprintf(msg,"Error in function: isoMapLoadMap(...) - %.200s is not a map file of this version!",filename);
+        writeToLog(msg,"error.txt");
+        mappedFileClose(mappedFile);
+        return NULL;
+    }
+    header = mappedFile->data;
+    layerFlags = (Uint32*)((char*)mappedFile->data + header->layerTableOffset);
+    chunkOffsets = (Uint64*)((char*)mappedFile->data + header->chunkTableOffset);
+
+    //the file may come from anywhere, do not trust the strings to be terminated
+    memcpy(name,header->name,MAP_NAME_LENGTH-1);
+    name[MAP_NAME_LENGTH-1] = 0;
+    isoMap = isoMapAllocateMap(name,header->mapWidth,header->mapHeight,header->numLayers,header->tileSize,0);
+    if(isoMap == NULL){
+        mappedFileClose(mappedFile);
+        return NULL;
+    }
+    isoMap->mappedFile = mappedFile;
+    numChunks = isoMap->numChunksX * isoMap->numChunksY;
+
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        mapLayer = &isoMap->layers[layer];
+        mapLayer->sparse = (layerFlags[layer] & MAP_FILE_LAYER_SPARSE) != 0;
+
+        for(chunk=0;chunk<numChunks;++chunk){
+            offset = chunkOffsets[(size_t)layer*numChunks + chunk];
+            if(offset == 0){
+                //a dense layer has every chunk, a missing one is just empty
+                if(mapLayer->sparse == 0 && isoMapAllocateChunk(mapLayer,chunk) == NULL){
+                    writeToLog("Error in function: isoMapLoadMap(...) - Could not allocate memory for map chunk!","error.txt");
+                    isoMapFreeMap(isoMap);
+                    return NULL;
                 }
+                continue;
+            }
+            //the offset is checked before fileChunk is read, and by subtracting, so a huge offset can not wrap around
+            fileChunk = (isoMapFileChunkT*)((char*)mappedFile->data + offset);
+            if(offset < header->dataOffset || offset % sizeof(int) != 0 || offset > mappedFile->size - sizeof(isoMapFileChunkT) ||
+               (fileChunk->bitsPerTile != 4 && fileChunk->bitsPerTile != 8 && fileChunk->bitsPerTile != 16) ||
+               MAP_CHUNK_BYTES(fileChunk->bitsPerTile) > mappedFile->size - offset - sizeof(isoMapFileChunkT) ||
+               isoMapChunkInit(&mapLayer->chunks[chunk],fileChunk->bitsPerTile,fileChunk->paletteSize,fileChunk+1,0) == 0){
+                sprintf(msg,"Error in function: isoMapLoadMap(...) - %.200s has a broken chunk table!",filename);
+                writeToLog(msg,"error.txt");
+                isoMapFreeMap(isoMap);
+                return NULL;
             }
+            //the tiles are only read when the chunk is first used, isoMapUseChunk checks them then
+            mapLayer->chunks[chunk].unchecked = 1;
+            mapLayer->chunkPresence[chunk >> 5] |= 1u << (chunk & 31);
+            mapLayer->numChunksAllocated++;
         }
     }
+
+    //the tile set needs a renderer, a tool without one still keeps the reference for the next save
+    memcpy(tileSetFilename,header->tileSetFilename,MAP_TILESET_FILENAME_LENGTH-1);
+    tileSetFilename[MAP_TILESET_FILENAME_LENGTH-1] = 0;
+    snprintf(isoMap->tileSet->filename,MAP_TILESET_FILENAME_LENGTH,"%s",tileSetFilename);
+    isoMap->tileSet->tileWidth = header->tileSetTileWidth;
+    isoMap->tileSet->tileHeight = header->tileSetTileHeight;
+    if(tileSetFilename[0] != 0 && getRenderer() != NULL){
+        isoMapLoadTileSet(isoMap,tileSetFilename,header->tileSetTileWidth,header->tileSetTileHeight);
+    }
+    return isoMap;
+}
+
+//Opens a map file saved by isoMapSaveMap without reading any chunks. isoEngineDrawIsoMap pages in the chunks
+//around the camera on a background thread and drops the oldest ones when more than memoryBudget bytes are in use,
+//so the map can be larger than the memory of the machine. Chunks that are not loaded yet are drawn empty and
+//isoMapGetTile returns MAP_TILE_NOT_RESIDENT for them. Changed chunks stay in memory, a paged map can not be saved.
+isoMapT *isoMapLoadMapPaged(char *filename,size_t memoryBudget)
+{
+    int layer;
+    isoMapPagerT *pager;
+    isoMapT *isoMap;
+    char name[MAP_NAME_LENGTH];
+    char tileSetFilename[MAP_TILESET_FILENAME_LENGTH];
+    char msg[300];
+
+    if(filename == NULL){
+        writeToLog("Error in function: isoMapLoadMapPaged(...) - Parameter char *filename is NULL!","error.txt");
+        return NULL;
+    }
+    pager = isoMapPagerNew(filename,memoryBudget);
+    if(pager == NULL){
+        return NULL;
+    }
+    if(isoMapCheckFileHeader(&pager->header,pager->fileSize)==0 || pager->layerFlags == NULL){
+        sprintf(msg,"Error in function: isoMapLoadMapPaged(...) - %.200s is not a map file of this version!",filename);
+        writeToLog(msg,"error.txt");
+        isoMapPagerFree(pager);
+        return NULL;
+    }
+
+    memcpy(name,pager->header.name,MAP_NAME_LENGTH-1);
+    name[MAP_NAME_LENGTH-1] = 0;
+    isoMap = isoMapAllocateMap(name,pager->header.mapWidth,pager->header.mapHeight,pager->header.numLayers,pager->header.tileSize,0);
+    if(isoMap == NULL){
+        isoMapPagerFree(pager);
+        return NULL;
+    }
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        isoMap->layers[layer].sparse = (pager->layerFlags[layer] & MAP_FILE_LAYER_SPARSE) != 0;
+    }
+    isoMap->pager = pager;
+    if(isoMapPagerStart(pager,isoMap)==0){
+        isoMapFreeMap(isoMap);
+        return NULL;
+    }
+
+    memcpy(tileSetFilename,pager->header.tileSetFilename,MAP_TILESET_FILENAME_LENGTH-1);
+    tileSetFilename[MAP_TILESET_FILENAME_LENGTH-1] = 0;
+    snprintf(isoMap->tileSet->filename,MAP_TILESET_FILENAME_LENGTH,"%s",tileSetFilename);
+    isoMap->tileSet->tileWidth = pager->header.tileSetTileWidth;
+    isoMap->tileSet->tileHeight = pager->header.tileSetTileHeight;
+    if(tileSetFilename[0] != 0 && getRenderer() != NULL){
+        isoMapLoadTileSet(isoMap,tileSetFilename,pager->header.tileSetTileWidth,pager->header.tileSetTileHeight);
+    }
+    return isoMap;
+}
+
+static int isoMapInitLayer(isoMapT *isoMap,isoMapLayerT *mapLayer,int sparse)
+{
+    int i;
+    int numChunks = isoMap->numChunksX * isoMap->numChunksY;
+
+    mapLayer->sparse = sparse;
+    mapLayer->numChunksAllocated = 0;
+    mapLayer->chunks = calloc(numChunks,sizeof(isoMapChunkT));
+    mapLayer->chunkPresence = calloc((numChunks + 31) / 32,sizeof(Uint32));
+
+    if(mapLayer->chunks == NULL || mapLayer->chunkPresence == NULL){
+        return 0;
+    }
+
+    if(sparse == 0)
+    {
+        for(i=0;i<numChunks;++i){
+            if(isoMapAllocateChunk(mapLayer,i) == NULL){
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void isoMapFreeLayer(isoMapT *isoMap,isoMapLayerT *mapLayer)
+{
+    int i;
+
+    if(mapLayer->chunks!=NULL)
+    {
+        //the chunks of a loaded map stay in the mapped file until they are widened
+        for(i=0;i<isoMap->numChunksX * isoMap->numChunksY;++i){
+            isoMapChunkFree(&mapLayer->chunks[i]);
+        }
+        free(mapLayer->chunks);
+    }
+    if(mapLayer->chunkPresence!=NULL){
+        free(mapLayer->chunkPresence);
+    }
+}
+
+static isoMapChunkT *isoMapAllocateChunk(isoMapLayerT *mapLayer,int chunk)
+{
+    if(isoMapChunkAllocate(&mapLayer->chunks[chunk],4) == 0){
+        return NULL;
+    }
+    mapLayer->chunkPresence[chunk >> 5] |= 1u << (chunk & 31);
+    mapLayer->numChunksAllocated++;
+    return &mapLayer->chunks[chunk];
+}
+
+//Returns a chunk of the layer for reading or changing its tiles. The chunks of a mapped map file are checked here,
+//when they are first used, so isoMapLoadMap does not have to read the whole file. A broken chunk is logged once and
+//left empty, it must never make the draw loop read past its palette or the tile set.
+static isoMapChunkT *isoMapUseChunk(isoMapT *isoMap,int layer,int chunk)
+{
+    isoMapLayerT *mapLayer = &isoMap->layers[layer];
+    isoMapChunkT *chunkData = &mapLayer->chunks[chunk];
+
+    if(chunkData->unchecked == 0){
+        return chunkData;
+    }
+    if(isoMapChunkCheck(chunkData,isoMap->tileSet->numTileClipRects)){
+        chunkData->unchecked = 0;
+        return chunkData;
+    }
+    logError("error.txt","isoMapUseChunk(...) - chunk %d of layer %d is broken or has tiles that are not in the tile set!",chunk,layer);
+
+    //the chunk points into the mapped file, there is nothing to free
+    memset(chunkData,0,sizeof(isoMapChunkT));
+    if(mapLayer->sparse == 0 && isoMapChunkAllocate(chunkData,4)){
+        return chunkData;
+    }
+    mapLayer->chunkPresence[chunk >> 5] &= ~(1u << (chunk & 31));
+    mapLayer->numChunksAllocated--;
+    return chunkData;
+}
+
+//Allocates an empty chunk with bitsPerTile (4, 8 or 16) bit indices. Returns 0 if there is no memory.
+int isoMapChunkAllocate(isoMapChunkT *chunk,int bitsPerTile)
+{
+    //MAP_EMPTY_TILE is 0, so a cleared block is an empty chunk: every index is 0 and palette[0] is MAP_EMPTY_TILE
+    void *memory = calloc(1,MAP_CHUNK_BYTES(bitsPerTile));
+
+    if(memory == NULL){
+        return 0;
+    }
+    return isoMapChunkInit(chunk,bitsPerTile,1,memory,1);
+}
+
+//Points the chunk at a block laid out like a map file stores it, MAP_CHUNK_PALETTE_CAPACITY(bitsPerTile) palette
+//entries followed by the indices. With owned set the chunk frees the block. Returns 0 if the width or the palette
+//size is broken, the indices and the palette values of a chunk from a file are checked by isoMapChunkCheck.
+int isoMapChunkInit(isoMapChunkT *chunk,int bitsPerTile,int paletteSize,void *memory,int owned)
+{
+    if((bitsPerTile != 4 && bitsPerTile != 8 && bitsPerTile != 16) || paletteSize < 1 || paletteSize > MAP_CHUNK_PALETTE_CAPACITY(bitsPerTile)){
+        return 0;
+    }
+    chunk->palette = memory;
+    chunk->indices = (Uint32*)((int*)memory + MAP_CHUNK_PALETTE_CAPACITY(bitsPerTile));
+    chunk->memory = owned ? memory : NULL;
+    chunk->bitsPerTile = bitsPerTile;
+    chunk->paletteSize = paletteSize;
+    chunk->unchecked = 0;
+    return 1;
+}
+
+//Returns 0 if the chunk can not be drawn: an index past the palette would read a palette entry that was never set,
+//and every value of the palette has to be MAP_EMPTY_TILE or a tile of a tile set with numTiles tiles. With numTiles 0
+//the tile set is not known yet and only negative values are rejected.
+int isoMapChunkCheck(isoMapChunkT *chunk,int numTiles)
+{
+    int i;
+    int bits;
+    Uint32 mask;
+
+    if(chunk == NULL || chunk->palette == NULL)
+    {
+        return 0;
+    }
+
+    //only a full palette needs no check of the indices
+    bits = chunk->bitsPerTile;
+    mask = (1u << bits)-1;
+    if(chunk->paletteSize < MAP_CHUNK_PALETTE_CAPACITY(bits)){
+        for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+            if(((chunk->indices[(i*bits) >> 5] >> ((i*bits) & 31)) & mask) >= (Uint32)chunk->paletteSize){
+                return 0;
+            }
+        }
+    }
+    for(i=0;i<chunk->paletteSize;++i){
+        if(chunk->palette[i] != MAP_EMPTY_TILE && (chunk->palette[i] < 0 || (numTiles > 0 && chunk->palette[i] >= numTiles))){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void isoMapChunkFree(isoMapChunkT *chunk)
+{
+    free(chunk->memory);
+    memset(chunk,0,sizeof(isoMapChunkT));
+}
+
+//Returns tile localY*MAP_CHUNK_SIZE + localX of the chunk
+int isoMapChunkGetTile(isoMapChunkT *chunk,int tile)
+{
+    int bits = chunk->bitsPerTile;
+    Uint32 word = chunk->indices[(tile*bits) >> 5];
+
+    return chunk->palette[(word >> ((tile*bits) & 31)) & ((1u << bits)-1)];
+}
+
+//Decodes the MAP_CHUNK_SIZE tiles of row localY, the draw loop reads the map this way
+void isoMapChunkGetRow(isoMapChunkT *chunk,int localY,int *tiles)
+{
+    int i;
+    Uint32 word;
+    int *palette = chunk->palette;
+    Uint32 *words = chunk->indices + ((localY*MAP_CHUNK_SIZE*chunk->bitsPerTile) >> 5);
+
+    //one loop per width, so the shifts and masks are constants, and every word is loaded once
+    switch(chunk->bitsPerTile){
+    case 4:
+        for(i=0;i<MAP_CHUNK_SIZE;i+=8){
+            word = *words++;
+            tiles[i] = palette[word & 0xf];
+            tiles[i+1] = palette[(word >> 4) & 0xf];
+            tiles[i+2] = palette[(word >> 8) & 0xf];
+            tiles[i+3] = palette[(word >> 12) & 0xf];
+            tiles[i+4] = palette[(word >> 16) & 0xf];
+            tiles[i+5] = palette[(word >> 20) & 0xf];
+            tiles[i+6] = palette[(word >> 24) & 0xf];
+            tiles[i+7] = palette[word >> 28];
+        }
+        break;
+    case 8:
+        for(i=0;i<MAP_CHUNK_SIZE;i+=4){
+            word = *words++;
+            tiles[i] = palette[word & 0xff];
+            tiles[i+1] = palette[(word >> 8) & 0xff];
+            tiles[i+2] = palette[(word >> 16) & 0xff];
+            tiles[i+3] = palette[word >> 24];
+        }
+        break;
+    default:
+        for(i=0;i<MAP_CHUNK_SIZE;i+=2){
+            word = *words++;
+            tiles[i] = palette[word & 0xffff];
+            tiles[i+1] = palette[word >> 16];
+        }
+        break;
+    }
+}
+
+//Decodes all MAP_CHUNK_NUM_TILES tiles, row by row
+void isoMapChunkGetTiles(isoMapChunkT *chunk,int *tiles)
+{
+    int y;
+    for(y=0;y<MAP_CHUNK_SIZE;++y){
+        isoMapChunkGetRow(chunk,y,tiles + (y << MAP_CHUNK_SHIFT));
+    }
+}
+
+static int isoMapChunkFindValue(isoMapChunkT *chunk,int value)
+{
+    int i;
+    for(i=0;i<chunk->paletteSize;++i){
+        if(chunk->palette[i] == value){
+            return i;
+        }
+    }
+    return -1;
+}
+
+//Returns 1 if the tile changed, 0 if it already had the value and -1 if the chunk could not be widened
+static int isoMapChunkSetTile(isoMapChunkT *chunk,int tile,int value)
+{
+    int index;
+    int bits = chunk->bitsPerTile;
+    int shift = (tile*bits) & 31;
+    Uint32 mask = (1u << bits)-1;
+    Uint32 *word = &chunk->indices[(tile*bits) >> 5];
+    int tiles[MAP_CHUNK_NUM_TILES];
+
+    index = isoMapChunkFindValue(chunk,value);
+    if(index < 0){
+        if(chunk->paletteSize == MAP_CHUNK_PALETTE_CAPACITY(bits)){
+            //packing the chunk again drops the values that are not used any more, and widens it if that is not enough
+            isoMapChunkGetTiles(chunk,tiles);
+            tiles[tile] = value;
+            return isoMapChunkPack(chunk,tiles) ? 1 : -1;
+        }
+        index = chunk->paletteSize++;
+        chunk->palette[index] = value;
+    }
+    if(((*word >> shift) & mask) == (Uint32)index){
+        return 0;
+    }
+    *word = (*word & ~(mask << shift)) | ((Uint32)index << shift);
+    return 1;
+}
+
+//Replaces the chunk with the MAP_CHUNK_NUM_TILES tiles, using the narrowest indices their values fit in.
+//Returns 0 if there is no memory, the chunk is left as it was then.
+int isoMapChunkPack(isoMapChunkT *chunk,const int *tiles)
+{
+    int i;
+    int bits;
+    int index = 0;
+    int paletteSize = 0;
+    int palette[MAP_CHUNK_NUM_TILES];
+    Uint16 indices[MAP_CHUNK_NUM_TILES];
+    Uint32 *words;
+    void *memory;
+
+    for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+        //neighbouring tiles mostly have the same value
+        if(paletteSize == 0 || palette[index] != tiles[i]){
+            for(index=0;index<paletteSize && palette[index] != tiles[i];++index);
+            if(index == paletteSize){
+                palette[paletteSize++] = tiles[i];
+            }
+        }
+        indices[i] = index;
+    }
+    bits = paletteSize <= MAP_CHUNK_PALETTE_CAPACITY(4) ? 4 : paletteSize <= MAP_CHUNK_PALETTE_CAPACITY(8) ? 8 : 16;
+
+    memory = calloc(1,MAP_CHUNK_BYTES(bits));
+    if(memory == NULL){
+        return 0;
+    }
+    memcpy(memory,palette,paletteSize*sizeof(int));
+    words = (Uint32*)((int*)memory + MAP_CHUNK_PALETTE_CAPACITY(bits));
+    for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+        words[(i*bits) >> 5] |= (Uint32)indices[i] << ((i*bits) & 31);
+    }
+    isoMapChunkFree(chunk);
+    return isoMapChunkInit(chunk,bits,paletteSize,memory,1);
 }
@@ -3,17 +3,114 @@
 
 #include <SDL2/SDL.h>
 #include "../texture.h"
+#include "../mappedFile.h"
 
 #define MAP_NAME_LENGTH 50
+#define MAP_TILESET_FILENAME_LENGTH 256
+
+//The map is stored in square chunks of MAP_CHUNK_SIZE x MAP_CHUNK_SIZE tiles.
+//Every layer of a chunk is one contiguous block, so nearby tiles share cache lines.
+#define MAP_CHUNK_SHIFT     5
+#define MAP_CHUNK_SIZE      (1<<MAP_CHUNK_SHIFT)
+#define MAP_CHUNK_MASK      (MAP_CHUNK_SIZE-1)
+#define MAP_CHUNK_NUM_TILES (MAP_CHUNK_SIZE*MAP_CHUNK_SIZE)
+
+//A chunk only uses a few different tile values, so it stores them once in a palette and every tile as an index into it.
+//The indices are 4 bits wide as long as the palette has room for 16 values, then 8 bits for 256 values and 16 bits
+//for any number of values. A chunk is widened the first time a value does not fit.
+//The palette always has room for every index of its width (MAP_CHUNK_NUM_TILES values at 16 bits).
+#define MAP_CHUNK_PALETTE_CAPACITY(bits)    ((bits) < 16 ? 1<<(bits) : MAP_CHUNK_NUM_TILES)
+#define MAP_CHUNK_BYTES(bits)               (MAP_CHUNK_PALETTE_CAPACITY(bits)*sizeof(int) + MAP_CHUNK_NUM_TILES*(bits)/8)
+
+//The tile value of a tile that has never been painted on
+#define MAP_EMPTY_TILE      0
+//isoMapGetTile of a paged map (isoMapLoadMapPaged) for a tile whose chunk has not been read from the file yet
+#define MAP_TILE_NOT_RESIDENT -2
+
+//The bulk operations (isoMapFillRect, isoMapCopyRect, isoMapStampRect) decode every chunk they touch once. A chunk
+//where they change at least this many tiles is packed again as a whole, in the others the tiles are set one by one.
+#define MAP_BULK_MIN_TILES  (MAP_CHUNK_NUM_TILES/16)
+
+//Map file format, see isoMapSaveMap.
+//The file is a header, a table with the flags of every layer, a table with the file offset of every chunk of every layer
+//(0 for a chunk that is not stored, it is all MAP_EMPTY_TILE) and the chunk data. Every chunk is an isoMapFileChunkT
+//followed by the chunk exactly the way isoMapT keeps it in memory, the palette and then the packed indices row by row,
+//and the chunk data starts on a MAP_FILE_ALIGNMENT boundary. isoMapLoadMap maps the file into memory and uses the
+//chunks in place. Version 1 stored every tile as a 32 bit int.
+#define MAP_FILE_MAGIC          "ISOMAP\0"
+#define MAP_FILE_VERSION        2
+#define MAP_FILE_BYTE_ORDER     0x01020304
+#define MAP_FILE_ALIGNMENT      4096
+#define MAP_FILE_LAYER_SPARSE   1
+#define MAP_FILE_MAX_TILE_SIZE  4096   //the tile size is halved and divided by, it has to be at least 2
+
+typedef struct isoMapFileHeaderT
+{
+    char magic[8];
+    Uint32 version;
+    Uint32 byteOrder;
+    Uint32 headerSize;
+    Uint32 mapWidth;
+    Uint32 mapHeight;
+    Uint32 numLayers;
+    Uint32 tileSize;
+    Uint32 chunkSize;
+    Uint32 numChunksX;
+    Uint32 numChunksY;
+    Uint32 tileSetTileWidth;
+    Uint32 tileSetTileHeight;
+    Uint64 layerTableOffset;
+    Uint64 chunkTableOffset;
+    Uint64 dataOffset;
+    Uint64 fileSize;
+    char name[64];
+    char tileSetFilename[MAP_TILESET_FILENAME_LENGTH];
+}isoMapFileHeaderT;
+
+typedef struct isoMapFileChunkT
+{
+    Uint16 bitsPerTile;
+    Uint16 paletteSize;
+}isoMapFileChunkT;
+
+//One layer of a chunk. Tile i (localY*MAP_CHUNK_SIZE + localX) is palette[index i of indices].
+typedef struct isoMapChunkT
+{
+    Uint32 *indices;    //NULL for a chunk that is not there
+    int *palette;
+    void *memory;       //the block with the palette and the indices, NULL if they are in the mapped map file
+    Uint16 bitsPerTile;
+    Uint16 paletteSize;
+    Uint16 unchecked;   //set for a chunk of a mapped map file until it is first used and isoMapChunkCheck has run
+}isoMapChunkT;
 
 typedef struct isoTileSetT
 {
     int tileSetLoaded;
     int numTileClipRects;
+    int tileWidth;
+    int tileHeight;
+    char filename[MAP_TILESET_FILENAME_LENGTH];
     textureT *tilesTex;
     SDL_Rect *tileClipRects;
+    textureQuadTableT quadTable;    //the quad size of every clip rect at the current zoom level, see isoMapGetTileQuadSizes
 }isoTileSetT;
 
+struct isoMapPagerT;
+struct isoMapJournalT;
+
+//Every layer is stored in its own plane.
+//A dense layer has every chunk, a sparse layer only allocates the chunks that have been painted on.
+//The chunks of a map loaded with isoMapLoadMap point into the mapped map file instead,
+//the chunks of a map loaded with isoMapLoadMapPaged come and go while the camera moves.
+typedef struct isoMapLayerT
+{
+    int sparse;
+    int numChunksAllocated;
+    Uint32 *chunkPresence;
+    isoMapChunkT *chunks;
+}isoMapLayerT;
+
 typedef struct isoMapT
 {
     int mapHeight;
@@ -22,16 +119,48 @@ typedef struct isoMapT
     int tileSize;
     int tileSizeX;
     int tileSizeY;
-    int *mapData;
+    int numChunksX;
+    int numChunksY;
+    Uint32 *chunkRevisions;
+    isoMapLayerT *layers;
     char name[MAP_NAME_LENGTH];
     isoTileSetT *tileSet;
+    mappedFileT *mappedFile;
+    struct isoMapPagerT *pager;
+    struct isoMapJournalT *journal;     //told every tile isoMapSetTile and the bulk operations change, see isoMapJournalNew
 }isoMapT;
 
 isoMapT* isoMapCreateEmptyMap(char *mapName,int width,int height,int numLayers,int tileSize);
 void isoMapFreeMap(isoMapT *isoMap);
 int isoMapLoadTileSet(isoMapT *isoMap,char *filename,int tileWidth,int tileHeight);
+int isoMapLoadTileSetAsync(isoMapT *isoMap,char *filename,int tileWidth,int tileHeight);
+SDL_Point *isoMapGetTileQuadSizes(isoMapT *isoMap,float zoomLevel);
 int isoMapGetTile(isoMapT *isoMap,int x,int y,int layer);
+//On a paged map (isoMapLoadMapPaged) a change to a chunk that is not loaded is lost: isoMapSetTile and the bulk
+//operations leave those tiles out and isoMapSetChunkTiles returns 0. The first lost change to a chunk in a frame
+//is logged as a warning, pager->lostChanges counts all of them.
 void isoMapSetTile(isoMapT *isoMap,int x,int y,int layer,int value);
+int isoMapSetChunkTiles(isoMapT *isoMap,int chunkX,int chunkY,int layer,const int *tiles);
+int isoMapFillRect(isoMapT *isoMap,const SDL_Rect *rect,int layer,int value);
+int isoMapStampRect(isoMapT *isoMap,int x,int y,int layer,const int *pattern,int width,int height,int transparent);
+int isoMapCopyRect(isoMapT *dst,int dstX,int dstY,int dstLayer,isoMapT *src,const SDL_Rect *srcRect,int srcLayer);
+isoMapChunkT *isoMapGetChunk(isoMapT *isoMap,int chunkX,int chunkY,int layer);
+int isoMapReadRect(isoMapT *isoMap,const SDL_Rect *rect,int layer,int *tiles);
+size_t isoMapGetTileMemory(isoMapT *isoMap);
+int isoMapIsChunkPresent(isoMapT *isoMap,int chunkX,int chunkY,int layer);
+Uint32 isoMapGetChunkRevision(isoMapT *isoMap,int chunkX,int chunkY);
+int isoMapSaveMap(isoMapT *isoMap,char *filename);
+isoMapT *isoMapLoadMap(char *filename);
+isoMapT *isoMapLoadMapPaged(char *filename,size_t memoryBudget);
+
+int isoMapChunkAllocate(isoMapChunkT *chunk,int bitsPerTile);
+int isoMapChunkInit(isoMapChunkT *chunk,int bitsPerTile,int paletteSize,void *memory,int owned);
+int isoMapChunkCheck(isoMapChunkT *chunk,int numTiles);
+void isoMapChunkFree(isoMapChunkT *chunk);
+int isoMapChunkGetTile(isoMapChunkT *chunk,int tile);
+void isoMapChunkGetRow(isoMapChunkT *chunk,int localY,int *tiles);
+void isoMapChunkGetTiles(isoMapChunkT *chunk,int *tiles);
+int isoMapChunkPack(isoMapChunkT *chunk,const int *tiles);
 
 #endif // __ISO_MAP_H_
 
@@ -0,0 +1,402 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "isoMapGen.h"
+#include "../logger.h"
+
+//the corners of a grid cell of the noise
+typedef struct isoMapGenCellT
+{
+    int valid;
+    int cellX;
+    int cellY;
+    Sint64 corners[4];
+}isoMapGenCellT;
+
+typedef struct isoMapGenJobT
+{
+    isoMapGenT *gen;
+    isoMapT *isoMap;
+    Uint8 *painted;         //the layers the passes paint
+    SDL_atomic_t failed;
+}isoMapGenJobT;
+
+//the patches isoMapCreateEmptyMap has always painted: 2x2 tiles of grass, one in ten of tile 3 and one in ten of tile 4
+static const isoMapGenStampsT isoMapGenPatches = {2,4,3,{1,3,4},{8,1,1}};
+
+//splitmix64's finalizer, every bit of the result depends on every bit of x
+static Uint64 isoMapGenMix(Uint64 x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void isoMapGenRandomInit(isoMapGenRandomT *random,Uint64 seed,Uint64 stream)
+{
+    random->key = isoMapGenMix(seed ^ isoMapGenMix(stream));
+    random->counter = 0;
+}
+
+//The n-th number of a stream is a hash of its key and n, there is no state to carry from chunk to chunk
+Uint32 isoMapGenRandomNext(isoMapGenRandomT *random)
+{
+    return (Uint32)(isoMapGenMix(random->key + random->counter++ * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+//Returns 0 to range-1
+int isoMapGenRandomRange(isoMapGenRandomT *random,int range)
+{
+    if(range <= 0){
+        return 0;
+    }
+    return (int)(((Uint64)isoMapGenRandomNext(random) * (Uint32)range) >> 32);
+}
+
+static int isoMapGenLattice(Uint64 seed,int x,int y)
+{
+    return (int)(isoMapGenMix(seed ^ isoMapGenMix(((Uint64)(Uint32)y << 32) | (Uint32)x)) >> 48);
+}
+
+static int isoMapGenFloorDiv(int a,int b)
+{
+    return a >= 0 ? a/b : -((b-1-a)/b);
+}
+
+//Computes the noise of a tile for isoMapGenNoise. The corners of the last grid cell of every octave are kept
+//in cells, neighbouring tiles are mostly in the same cells.
+static int isoMapGenNoiseCells(Uint64 seed,int x,int y,int scale,int octaves,isoMapGenCellT *cells)
+{
+    int octave;
+    int cellX,cellY;
+    Sint64 fx,fy,sx,sy;
+    Sint64 top,bottom;
+    Sint64 amplitude = ISO_MAP_GEN_NOISE_MAX;
+    Sint64 total = 0;
+    Sint64 weight = 0;
+    isoMapGenCellT *cell;
+
+    for(octave=0;octave<SDL_max(SDL_min(octaves,ISO_MAP_GEN_MAX_OCTAVES),1) && scale>0;++octave){
+        cell = &cells[octave];
+        cellX = isoMapGenFloorDiv(x,scale);
+        cellY = isoMapGenFloorDiv(y,scale);
+        if(cell->valid == 0 || cell->cellX != cellX || cell->cellY != cellY){
+            cell->valid = 1;
+            cell->cellX = cellX;
+            cell->cellY = cellY;
+            cell->corners[0] = isoMapGenLattice(seed,cellX,cellY);
+            cell->corners[1] = isoMapGenLattice(seed,cellX+1,cellY);
+            cell->corners[2] = isoMapGenLattice(seed,cellX,cellY+1);
+            cell->corners[3] = isoMapGenLattice(seed,cellX+1,cellY+1);
+        }
+        fx = (Sint64)(x - cellX*scale)*ISO_MAP_GEN_NOISE_MAX/scale;
+        fy = (Sint64)(y - cellY*scale)*ISO_MAP_GEN_NOISE_MAX/scale;
+        //smoothstep, 3t^2 - 2t^3
+        sx = fx*fx/ISO_MAP_GEN_NOISE_MAX*(3*ISO_MAP_GEN_NOISE_MAX - 2*fx)/ISO_MAP_GEN_NOISE_MAX;
+        sy = fy*fy/ISO_MAP_GEN_NOISE_MAX*(3*ISO_MAP_GEN_NOISE_MAX - 2*fy)/ISO_MAP_GEN_NOISE_MAX;
+
+        top = cell->corners[0] + (cell->corners[1]-cell->corners[0])*sx/ISO_MAP_GEN_NOISE_MAX;
+        bottom = cell->corners[2] + (cell->corners[3]-cell->corners[2])*sx/ISO_MAP_GEN_NOISE_MAX;
+        total += (top + (bottom-top)*sy/ISO_MAP_GEN_NOISE_MAX)*amplitude;
+        weight += amplitude;
+
+        amplitude /= 2;
+        scale /= 2;
+        seed = isoMapGenMix(seed + 1);
+    }
+    return weight > 0 ? (int)(total/weight) : 0;
+}
+
+//Value noise at tile x,y from 0 to ISO_MAP_GEN_NOISE_MAX-1. Random values on a grid of scale tiles are blended
+//smoothly, every further octave (up to ISO_MAP_GEN_MAX_OCTAVES) adds a grid of half the size with half the weight.
+//Integer math only, so every platform gets the same noise.
+int isoMapGenNoise(Uint64 seed,int x,int y,int scale,int octaves)
+{
+    isoMapGenCellT cells[ISO_MAP_GEN_MAX_OCTAVES];
+
+    memset(cells,0,sizeof(cells));
+    return isoMapGenNoiseCells(seed,x,y,scale,octaves,cells);
+}
+
+void isoMapGenInit(isoMapGenT *gen,Uint64 seed)
+{
+    gen->seed = seed;
+    gen->numPasses = 0;
+}
+
+//A generator with the patches the maps have always had on the ground layer
+void isoMapGenInitDefault(isoMapGenT *gen,Uint64 seed)
+{
+    isoMapGenInit(gen,seed);
+    isoMapGenAddPass(gen,isoMapGenStamps,&isoMapGenPatches,0);
+}
+
+//The passes run in the order they are added. data is handed to func and must stay valid while the generator is used.
+int isoMapGenAddPass(isoMapGenT *gen,isoMapGenPassFuncT func,const void *data,int layer)
+{
+    if(gen == NULL || func == NULL || layer < 0){
+        writeToLog("Error in function: isoMapGenAddPass(...) - Parameter gen or func is NULL or the layer is negative!","error.txt");
+        return 0;
+    }
+    if(gen->numPasses == ISO_MAP_GEN_MAX_PASSES){
+        writeToLog("Error in function: isoMapGenAddPass(...) - The generator has ISO_MAP_GEN_MAX_PASSES passes already!","error.txt");
+        return 0;
+    }
+    gen->passes[gen->numPasses].func = func;
+    gen->passes[gen->numPasses].data = data;
+    gen->passes[gen->numPasses].layer = layer;
+    gen->numPasses++;
+    return 1;
+}
+
+//Returns which layers the passes paint, or NULL if a pass paints a layer the map does not have
+static Uint8 *isoMapGenGetPaintedLayers(isoMapGenT *gen,isoMapT *isoMap,const char *function)
+{
+    int pass;
+    Uint8 *painted;
+
+    if(isoMap->pager != NULL){
+        logError("error.txt","%s - A map loaded with isoMapLoadMapPaged can not be generated!",function);
+        return NULL;
+    }
+    painted = calloc(isoMap->numLayers,sizeof(Uint8));
+    if(painted == NULL){
+        logError("error.txt","%s - Could not allocate memory!",function);
+        return NULL;
+    }
+    for(pass=0;pass<gen->numPasses;++pass){
+        if(gen->passes[pass].layer >= isoMap->numLayers){
+            logError("error.txt","%s - Pass %d paints layer %d, the map only has %d!",function,pass,gen->passes[pass].layer,isoMap->numLayers);
+            free(painted);
+            return NULL;
+        }
+        painted[gen->passes[pass].layer] = 1;
+    }
+    return painted;
+}
+
+static int isoMapGenIsEmpty(const int *tiles)
+{
+    int i;
+    for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+        if(tiles[i] != MAP_EMPTY_TILE){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//Runs the passes on a chunk and packs the painted layers into it. Only touches this chunk's isoMapChunkT,
+//so chunks can be painted on several threads. tiles has room for MAP_CHUNK_NUM_TILES tiles of every layer.
+static int isoMapGenPaintChunk(isoMapGenT *gen,isoMapT *isoMap,int chunkX,int chunkY,const Uint8 *painted,int *tiles)
+{
+    int i,pass,layer;
+    int chunk = chunkY * isoMap->numChunksX + chunkX;
+    Uint64 stream = isoMapGenMix(((Uint64)(Uint32)chunkY << 32) | (Uint32)chunkX);
+    isoMapGenContextT context;
+    isoMapChunkT *chunkData;
+
+    context.isoMap = isoMap;
+    context.chunkX = chunkX;
+    context.chunkY = chunkY;
+    context.width = SDL_min(MAP_CHUNK_SIZE,isoMap->mapWidth - (chunkX << MAP_CHUNK_SHIFT));
+    context.height = SDL_min(MAP_CHUNK_SIZE,isoMap->mapHeight - (chunkY << MAP_CHUNK_SHIFT));
+
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        if(painted[layer]){
+            for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+                tiles[layer*MAP_CHUNK_NUM_TILES + i] = MAP_EMPTY_TILE;
+            }
+        }
+    }
+    for(pass=0;pass<gen->numPasses;++pass){
+        //a pass gets the same seed on every chunk, and a stream of its own on every chunk
+        context.seed = isoMapGenMix(gen->seed + pass);
+        context.tiles = &tiles[gen->passes[pass].layer * MAP_CHUNK_NUM_TILES];
+        isoMapGenRandomInit(&context.random,gen->seed,stream + pass);
+        gen->passes[pass].func(&context,gen->passes[pass].data);
+    }
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        if(painted[layer] == 0){
+            continue;
+        }
+        chunkData = &isoMap->layers[layer].chunks[chunk];
+        //a sparse layer keeps no memory for nothing
+        if(isoMap->layers[layer].sparse && isoMapGenIsEmpty(&tiles[layer*MAP_CHUNK_NUM_TILES])){
+            isoMapChunkFree(chunkData);
+            continue;
+        }
+        if(isoMapChunkPack(chunkData,&tiles[layer*MAP_CHUNK_NUM_TILES]) == 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+//Brings the chunk's presence bits in line with the chunks isoMapGenPaintChunk has packed or freed
+static void isoMapGenFinishChunk(isoMapT *isoMap,const Uint8 *painted,int chunk)
+{
+    int layer;
+    int present;
+    isoMapLayerT *mapLayer;
+
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        if(painted[layer] == 0){
+            continue;
+        }
+        mapLayer = &isoMap->layers[layer];
+        present = mapLayer->chunks[chunk].indices != NULL;
+        if(present != (int)((mapLayer->chunkPresence[chunk >> 5] >> (chunk & 31)) & 1)){
+            mapLayer->chunkPresence[chunk >> 5] ^= 1u << (chunk & 31);
+            mapLayer->numChunksAllocated += present ? 1 : -1;
+        }
+    }
+    isoMap->chunkRevisions[chunk]++;
+}
+
+//Generates one chunk, the map's other chunks are left alone. Returns 1 on success and 0 on failure.
+int isoMapGenChunk(isoMapGenT *gen,isoMapT *isoMap,int chunkX,int chunkY)
+{
+    int ok;
+    int *tiles;
+    Uint8 *painted;
+
+    if(gen == NULL || isoMap == NULL){
+        writeToLog("Error in function: isoMapGenChunk(...) - Parameter gen or isoMap is NULL!","error.txt");
+        return 0;
+    }
+    if(chunkX < 0 || chunkX > isoMap->numChunksX-1 || chunkY < 0 || chunkY > isoMap->numChunksY-1){
+        return 0;
+    }
+    painted = isoMapGenGetPaintedLayers(gen,isoMap,"isoMapGenChunk(...)");
+    if(painted == NULL){
+        return 0;
+    }
+    tiles = malloc((size_t)isoMap->numLayers*MAP_CHUNK_NUM_TILES*sizeof(int));
+    ok = tiles != NULL && isoMapGenPaintChunk(gen,isoMap,chunkX,chunkY,painted,tiles);
+    isoMapGenFinishChunk(isoMap,painted,chunkY * isoMap->numChunksX + chunkX);
+    if(!ok){
+        writeToLog("Error in function: isoMapGenChunk(...) - Could not allocate memory for the chunk!","error.txt");
+    }
+    free(tiles);
+    free(painted);
+    return ok;
+}
+
+//one row of chunks
+static void isoMapGenRowJob(void *data,int chunkY)
+{
+    int chunkX;
+    isoMapGenJobT *job = data;
+    int *tiles = malloc((size_t)job->isoMap->numLayers*MAP_CHUNK_NUM_TILES*sizeof(int));
+
+    if(tiles == NULL){
+        SDL_AtomicSet(&job->failed,1);
+        return;
+    }
+    for(chunkX=0;chunkX<job->isoMap->numChunksX;++chunkX){
+        if(isoMapGenPaintChunk(job->gen,job->isoMap,chunkX,chunkY,job->painted,tiles) == 0){
+            SDL_AtomicSet(&job->failed,1);
+        }
+    }
+    free(tiles);
+}
+
+//Generates every chunk of the map, a row of chunks per job of the thread pool (NULL runs them all on this thread).
+//The map is the same with any number of threads. Returns 1 on success and 0 on failure.
+int isoMapGenRun(isoMapGenT *gen,isoMapT *isoMap,threadPoolT *pool)
+{
+    int chunk;
+    isoMapGenJobT job;
+
+    if(gen == NULL || isoMap == NULL){
+        writeToLog("Error in function: isoMapGenRun(...) - Parameter gen or isoMap is NULL!","error.txt");
+        return 0;
+    }
+    job.gen = gen;
+    job.isoMap = isoMap;
+    job.painted = isoMapGenGetPaintedLayers(gen,isoMap,"isoMapGenRun(...)");
+    if(job.painted == NULL){
+        return 0;
+    }
+    SDL_AtomicSet(&job.failed,0);
+    threadPoolRun(pool,isoMapGenRowJob,&job,isoMap->numChunksY);
+
+    //the presence bits of neighbouring chunks share words, they are set after the threads are done
+    for(chunk=0;chunk<isoMap->numChunksX * isoMap->numChunksY;++chunk){
+        isoMapGenFinishChunk(isoMap,job.painted,chunk);
+    }
+    free(job.painted);
+    if(SDL_AtomicGet(&job.failed)){
+        writeToLog("Error in function: isoMapGenRun(...) - Could not allocate memory for the chunks!","error.txt");
+        return 0;
+    }
+    return 1;
+}
+
+void isoMapGenStamps(isoMapGenContextT *context,const void *data)
+{
+    int i,x,y;
+    int stampX,stampY;
+    int mapX,mapY;
+    int tile;
+    int pick;
+    int totalWeight = 0;
+    const isoMapGenStampsT *stamps = data;
+    int size = stamps->size;
+
+    //a stamp must not cross into another chunk
+    if(size < 1 || size > MAP_CHUNK_SIZE || (size & (size-1)) != 0 || stamps->numTiles < 1 || stamps->numTiles > ISO_MAP_GEN_MAX_TILES){
+        return;
+    }
+    for(i=0;i<stamps->numTiles;++i){
+        totalWeight += SDL_max(stamps->weights[i],0);
+    }
+    for(stampY=0;stampY<context->height;stampY+=size){
+        for(stampX=0;stampX<context->width;stampX+=size){
+            pick = isoMapGenRandomRange(&context->random,totalWeight);
+            for(i=0;i<stamps->numTiles-1 && pick >= SDL_max(stamps->weights[i],0);++i){
+                pick -= SDL_max(stamps->weights[i],0);
+            }
+            mapX = (context->chunkX << MAP_CHUNK_SHIFT) + stampX;
+            mapY = (context->chunkY << MAP_CHUNK_SHIFT) + stampY;
+            tile = stamps->tiles[i];
+            if(mapX >= context->isoMap->mapWidth - stamps->border || mapY >= context->isoMap->mapHeight - stamps->border){
+                tile = stamps->tiles[0];
+            }
+            for(y=stampY;y<SDL_min(stampY+size,context->height);++y){
+                for(x=stampX;x<SDL_min(stampX+size,context->width);++x){
+                    context->tiles[(y << MAP_CHUNK_SHIFT) + x] = tile;
+                }
+            }
+        }
+    }
+}
+
+void isoMapGenNoisePass(isoMapGenContextT *context,const void *data)
+{
+    int i,x,y;
+    int noise;
+    const isoMapGenNoiseT *noisePass = data;
+    isoMapGenCellT cells[ISO_MAP_GEN_MAX_OCTAVES];
+
+    if(noisePass->scale < 1){
+        return;
+    }
+    memset(cells,0,sizeof(cells));
+    for(y=0;y<context->height;++y){
+        for(x=0;x<context->width;++x){
+            noise = isoMapGenNoiseCells(context->seed,(context->chunkX << MAP_CHUNK_SHIFT) + x,(context->chunkY << MAP_CHUNK_SHIFT) + y,
+                                        noisePass->scale,noisePass->octaves,cells);
+            for(i=0;i<SDL_min(noisePass->numLevels,ISO_MAP_GEN_MAX_TILES);++i){
+                if(noise < noisePass->levels[i]){
+                    context->tiles[(y << MAP_CHUNK_SHIFT) + x] = noisePass->tiles[i];
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef __ISO_MAP_GEN_H_
+#define __ISO_MAP_GEN_H_
+
+#include <SDL2/SDL.h>
+#include "isoMap.h"
+#include "../threadPool.h"
+
+//Generates the tiles of a map chunk by chunk from a seed. A generator is a list of passes, every pass paints one layer
+//of a chunk. The random numbers of a pass on a chunk come from a stream of its own, computed from the seed, the pass
+//and the chunk position, so the chunks can be generated on any number of threads and in any order and the map is
+//always the same, on every platform. No pass reads another chunk, and every layer a pass paints starts out empty.
+#define ISO_MAP_GEN_MAX_PASSES      16
+#define ISO_MAP_GEN_MAX_TILES       8
+#define ISO_MAP_GEN_DEFAULT_SEED    0x150e7a9e
+#define ISO_MAP_GEN_NOISE_MAX       65536   //isoMapGenNoise returns 0 to ISO_MAP_GEN_NOISE_MAX-1
+#define ISO_MAP_GEN_MAX_OCTAVES     16
+
+typedef struct isoMapGenRandomT
+{
+    Uint64 key;
+    Uint64 counter;
+}isoMapGenRandomT;
+
+//what a pass gets for a chunk
+typedef struct isoMapGenContextT
+{
+    isoMapT *isoMap;
+    Uint64 seed;                //the seed of the pass, the same on every chunk, for patterns that go across chunks
+    int chunkX;
+    int chunkY;
+    int width;                  //the tiles of the chunk that are on the map, the rest are never drawn
+    int height;
+    int *tiles;                 //the layer of the pass, MAP_CHUNK_NUM_TILES tiles row by row
+    isoMapGenRandomT random;    //the stream of this pass on this chunk
+}isoMapGenContextT;
+
+typedef void (*isoMapGenPassFuncT)(isoMapGenContextT *context,const void *data);
+
+typedef struct isoMapGenPassT
+{
+    isoMapGenPassFuncT func;
+    const void *data;
+    int layer;
+}isoMapGenPassT;
+
+typedef struct isoMapGenT
+{
+    Uint64 seed;
+    int numPasses;
+    isoMapGenPassT passes[ISO_MAP_GEN_MAX_PASSES];
+}isoMapGenT;
+
+//isoMapGenStamps: square stamps of size x size tiles (a power of two up to MAP_CHUNK_SIZE, so they never cross
+//a chunk), each one tiles[i] with a chance of weights[i] in the sum of the weights. Within border tiles of the right
+//and the bottom edge of the map every stamp is tiles[0].
+typedef struct isoMapGenStampsT
+{
+    int size;
+    int border;
+    int numTiles;
+    int tiles[ISO_MAP_GEN_MAX_TILES];
+    int weights[ISO_MAP_GEN_MAX_TILES];
+}isoMapGenStampsT;
+
+//isoMapGenNoisePass: value noise over the whole map, cells of scale tiles and octaves finer ones on top.
+//A tile becomes tiles[i] for the first level the noise is below, and keeps its tile if it is above all of them.
+typedef struct isoMapGenNoiseT
+{
+    int scale;
+    int octaves;
+    int numLevels;
+    int levels[ISO_MAP_GEN_MAX_TILES];
+    int tiles[ISO_MAP_GEN_MAX_TILES];
+}isoMapGenNoiseT;
+
+void isoMapGenInit(isoMapGenT *gen,Uint64 seed);
+void isoMapGenInitDefault(isoMapGenT *gen,Uint64 seed);
+int isoMapGenAddPass(isoMapGenT *gen,isoMapGenPassFuncT func,const void *data,int layer);
+int isoMapGenChunk(isoMapGenT *gen,isoMapT *isoMap,int chunkX,int chunkY);
+int isoMapGenRun(isoMapGenT *gen,isoMapT *isoMap,threadPoolT *pool);
+
+void isoMapGenRandomInit(isoMapGenRandomT *random,Uint64 seed,Uint64 stream);
+Uint32 isoMapGenRandomNext(isoMapGenRandomT *random);
+int isoMapGenRandomRange(isoMapGenRandomT *random,int range);
+int isoMapGenNoise(Uint64 seed,int x,int y,int scale,int octaves);
+
+void isoMapGenStamps(isoMapGenContextT *context,const void *data);
+void isoMapGenNoisePass(isoMapGenContextT *context,const void *data);
+
+#endif // __ISO_MAP_GEN_H_
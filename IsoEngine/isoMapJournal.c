@@ -0,0 +1,335 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "isoMapJournal.h"
+#include "../logger.h"
+
+//Attaches a journal to the map, from now on it is told every tile isoMapSetTile changes.
+//A memoryBudget of 0 is ISO_MAP_JOURNAL_DEFAULT_BUDGET. The journal is freed with the map.
+isoMapJournalT *isoMapJournalNew(isoMapT *isoMap,size_t memoryBudget)
+{
+    isoMapJournalT *journal;
+
+    if(isoMap == NULL || isoMap->journal != NULL){
+        writeToLog("Error in function: isoMapJournalNew(...) - Parameter isoMap is NULL or the map has a journal already!","error.txt");
+        return NULL;
+    }
+    journal = calloc(1,sizeof(struct isoMapJournalT));
+    if(journal == NULL){
+        writeToLog("Error in function: isoMapJournalNew(...) - Could not allocate memory for the journal!","error.txt");
+        return NULL;
+    }
+    journal->isoMap = isoMap;
+    journal->memoryBudget = memoryBudget > 0 ? memoryBudget : ISO_MAP_JOURNAL_DEFAULT_BUDGET;
+    isoMap->journal = journal;
+    return journal;
+}
+
+//Frees the journal and takes it off its map
+void isoMapJournalFree(isoMapJournalT *journal)
+{
+    int i;
+
+    if(journal == NULL){
+        return;
+    }
+    if(journal->isoMap->journal == journal){
+        journal->isoMap->journal = NULL;
+    }
+    for(i=0;i<journal->numTransactions;++i){
+        free(journal->transactions[i].data);
+    }
+    free(journal->transactions);
+    free(journal->edits);
+    free(journal->buffer);
+    free(journal);
+}
+
+//Drops count transactions from first on
+static void isoMapJournalDrop(isoMapJournalT *journal,int first,int count)
+{
+    int i;
+
+    if(count == 0){
+        return;
+    }
+    for(i=first;i<first+count;++i){
+        free(journal->transactions[i].data);
+        journal->memoryUsed -= journal->transactions[i].size + sizeof(isoMapJournalTransactionT);
+    }
+    memmove(&journal->transactions[first],&journal->transactions[first+count],
+            (journal->numTransactions-first-count)*sizeof(isoMapJournalTransactionT));
+    journal->numTransactions -= count;
+    if(journal->numDone > first){
+        journal->numDone = SDL_max(journal->numDone-count,first);
+    }
+}
+
+//Drops the oldest transactions until the rest fit into the budget
+static void isoMapJournalTrim(isoMapJournalT *journal)
+{
+    int count = 0;
+    size_t memoryUsed = journal->memoryUsed;
+
+    while(count < journal->numTransactions && memoryUsed > journal->memoryBudget){
+        memoryUsed -= journal->transactions[count].size + sizeof(isoMapJournalTransactionT);
+        count++;
+    }
+    if(count > 0){
+        isoMapJournalDrop(journal,0,count);
+        journal->numDropped += count;
+    }
+}
+
+void isoMapJournalSetBudget(isoMapJournalT *journal,size_t memoryBudget)
+{
+    if(journal == NULL){
+        return;
+    }
+    journal->memoryBudget = memoryBudget > 0 ? memoryBudget : ISO_MAP_JOURNAL_DEFAULT_BUDGET;
+    isoMapJournalTrim(journal);
+}
+
+static int isoMapJournalWrite(isoMapJournalT *journal,const void *data,size_t size)
+{
+    size_t maxBufferSize;
+    Uint8 *buffer;
+
+    if(journal->bufferSize + size > journal->maxBufferSize){
+        maxBufferSize = SDL_max(journal->maxBufferSize*2,journal->bufferSize + size + 1024);
+        buffer = realloc(journal->buffer,maxBufferSize);
+        if(buffer == NULL){
+            return 0;
+        }
+        journal->buffer = buffer;
+        journal->maxBufferSize = maxBufferSize;
+    }
+    memcpy(&journal->buffer[journal->bufferSize],data,size);
+    journal->bufferSize += size;
+    return 1;
+}
+
+//The old or the new values of a run, as pairs of a count and a value
+static int isoMapJournalWriteValues(isoMapJournalT *journal,const isoMapJournalEditT *edits,int length,int newValues)
+{
+    int i;
+    int value;
+    Uint16 count;
+
+    for(i=0;i<length;i+=count){
+        value = newValues ? edits[i].newValue : edits[i].oldValue;
+        for(count=1;i+count < length && (newValues ? edits[i+count].newValue : edits[i+count].oldValue) == value;++count);
+        if(isoMapJournalWrite(journal,&count,sizeof(count)) == 0 || isoMapJournalWrite(journal,&value,sizeof(value)) == 0){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int isoMapJournalCompareEdits(const void *a,const void *b)
+{
+    const isoMapJournalEditT *editA = a;
+    const isoMapJournalEditT *editB = b;
+
+    if(editA->layer != editB->layer) return editA->layer < editB->layer ? -1 : 1;
+    if(editA->y != editB->y) return editA->y < editB->y ? -1 : 1;
+    if(editA->x != editB->x) return editA->x < editB->x ? -1 : 1;
+    if(editA->order != editB->order) return editA->order < editB->order ? -1 : 1;
+    return 0;
+}
+
+//Turns the changes of the open transaction into runs. The transactions that could be redone are dropped.
+static void isoMapJournalCommit(isoMapJournalT *journal)
+{
+    int i,j;
+    int numTiles = 0;
+    int length;
+    Uint16 header[2];
+    isoMapJournalEditT *edits = journal->edits;
+    isoMapJournalTransactionT *transactions;
+    isoMapJournalTransactionT *transaction;
+
+    if(journal->numEdits == 0){
+        return;
+    }
+    //a tile changed more than once keeps its first old and its last new value, a tile changed back is left out
+    qsort(edits,journal->numEdits,sizeof(isoMapJournalEditT),isoMapJournalCompareEdits);
+    for(i=0;i<journal->numEdits;i=j){
+        for(j=i+1;j<journal->numEdits && edits[j].layer == edits[i].layer && edits[j].y == edits[i].y && edits[j].x == edits[i].x;++j);
+        if(edits[i].oldValue != edits[j-1].newValue){
+            edits[numTiles] = edits[i];
+            edits[numTiles++].newValue = edits[j-1].newValue;
+        }
+    }
+    journal->numEdits = 0;
+    if(numTiles == 0){
+        return;
+    }
+
+    journal->bufferSize = 0;
+    for(i=0;i<numTiles;i+=length){
+        for(length=1;i+length < numTiles && length < ISO_MAP_JOURNAL_MAX_RUN && edits[i+length].layer == edits[i].layer &&
+                     edits[i+length].y == edits[i].y && edits[i+length].x == edits[i].x+length;++length);
+        header[0] = edits[i].layer;
+        header[1] = length;
+        if(isoMapJournalWrite(journal,&edits[i].x,sizeof(int)) == 0 || isoMapJournalWrite(journal,&edits[i].y,sizeof(int)) == 0 ||
+           isoMapJournalWrite(journal,header,sizeof(header)) == 0 ||
+           isoMapJournalWriteValues(journal,&edits[i],length,0) == 0 || isoMapJournalWriteValues(journal,&edits[i],length,1) == 0){
+            writeToLog("Error in function: isoMapJournalEnd(...) - Could not allocate memory for the transaction, it can not be undone!","error.txt");
+            return;
+        }
+    }
+
+    //a new change ends what could be redone
+    isoMapJournalDrop(journal,journal->numDone,journal->numTransactions-journal->numDone);
+    if(journal->numTransactions == journal->maxTransactions){
+        transactions = realloc(journal->transactions,(journal->maxTransactions == 0 ? 64 : journal->maxTransactions*2)*sizeof(isoMapJournalTransactionT));
+        if(transactions == NULL){
+            writeToLog("Error in function: isoMapJournalEnd(...) - Could not allocate memory for the transaction, it can not be undone!","error.txt");
+            return;
+        }
+        journal->transactions = transactions;
+        journal->maxTransactions = journal->maxTransactions == 0 ? 64 : journal->maxTransactions*2;
+    }
+    transaction = &journal->transactions[journal->numTransactions];
+    transaction->data = malloc(journal->bufferSize);
+    if(transaction->data == NULL){
+        writeToLog("Error in function: isoMapJournalEnd(...) - Could not allocate memory for the transaction, it can not be undone!","error.txt");
+        return;
+    }
+    memcpy(transaction->data,journal->buffer,journal->bufferSize);
+    transaction->size = journal->bufferSize;
+    transaction->numTiles = numTiles;
+    journal->numTransactions++;
+    journal->numDone = journal->numTransactions;
+    journal->memoryUsed += transaction->size + sizeof(isoMapJournalTransactionT);
+    isoMapJournalTrim(journal);
+}
+
+//The changes from here to the matching isoMapJournalEnd are undone together. The calls can be nested.
+void isoMapJournalBegin(isoMapJournalT *journal)
+{
+    if(journal == NULL){
+        return;
+    }
+    journal->depth++;
+}
+
+void isoMapJournalEnd(isoMapJournalT *journal)
+{
+    if(journal == NULL || journal->depth == 0){
+        return;
+    }
+    if(--journal->depth == 0){
+        isoMapJournalCommit(journal);
+    }
+}
+
+//Called by isoMapSetTile for every tile it changes
+void isoMapJournalRecord(isoMapJournalT *journal,int x,int y,int layer,int oldValue,int newValue)
+{
+    int maxEdits;
+    isoMapJournalEditT *edits;
+    isoMapJournalEditT *edit;
+
+    if(journal == NULL){
+        return;
+    }
+    if(journal->numEdits == journal->maxEdits){
+        maxEdits = journal->maxEdits == 0 ? 1024 : journal->maxEdits*2;
+        edits = realloc(journal->edits,maxEdits*sizeof(isoMapJournalEditT));
+        if(edits == NULL){
+            writeToLog("Error in function: isoMapJournalRecord(...) - Could not allocate memory for the change, it can not be undone!","error.txt");
+            return;
+        }
+        journal->edits = edits;
+        journal->maxEdits = maxEdits;
+    }
+    edit = &journal->edits[journal->numEdits];
+    edit->x = x;
+    edit->y = y;
+    edit->layer = layer;
+    edit->oldValue = oldValue;
+    edit->newValue = newValue;
+    edit->order = journal->numEdits++;
+    if(journal->depth == 0){
+        isoMapJournalCommit(journal);
+    }
+}
+
+//Sets the old or the new values of the tiles of a transaction, without telling the journal
+static void isoMapJournalApply(isoMapJournalT *journal,isoMapJournalTransactionT *transaction,int newValues)
+{
+    int i,k;
+    int x,y;
+    int values;
+    int value;
+    size_t position = 0;
+    Uint16 header[2];
+    Uint16 count;
+    isoMapT *isoMap = journal->isoMap;
+
+    isoMap->journal = NULL;
+    while(position < transaction->size){
+        memcpy(&x,&transaction->data[position],sizeof(int));
+        memcpy(&y,&transaction->data[position+sizeof(int)],sizeof(int));
+        memcpy(header,&transaction->data[position+2*sizeof(int)],sizeof(header));
+        position += 2*sizeof(int) + sizeof(header);
+        for(values=0;values<2;++values){
+            for(i=0;i<header[1];i+=count){
+                memcpy(&count,&transaction->data[position],sizeof(count));
+                memcpy(&value,&transaction->data[position+sizeof(count)],sizeof(value));
+                position += sizeof(count) + sizeof(value);
+                for(k=0;k<count && values == newValues;++k){
+                    isoMapSetTile(isoMap,x+i+k,y,header[0],value);
+                }
+            }
+        }
+    }
+    isoMap->journal = journal;
+}
+
+//Undoes the last transaction, an open one is ended first. Returns the number of tiles set back, 0 if there is
+//nothing to undo.
+int isoMapJournalUndo(isoMapJournalT *journal)
+{
+    isoMapJournalTransactionT *transaction;
+
+    if(journal == NULL){
+        return 0;
+    }
+    if(journal->depth > 0){
+        journal->depth = 0;
+        isoMapJournalCommit(journal);
+    }
+    if(journal->numDone == 0){
+        return 0;
+    }
+    transaction = &journal->transactions[--journal->numDone];
+    isoMapJournalApply(journal,transaction,0);
+    return transaction->numTiles;
+}
+
+//Does the last undone transaction again. Returns the number of tiles set, 0 if there is nothing to redo.
+int isoMapJournalRedo(isoMapJournalT *journal)
+{
+    isoMapJournalTransactionT *transaction;
+
+    if(journal == NULL || journal->depth > 0 || journal->numDone == journal->numTransactions){
+        return 0;
+    }
+    transaction = &journal->transactions[journal->numDone++];
+    isoMapJournalApply(journal,transaction,1);
+    return transaction->numTiles;
+}
+
+//Forgets every transaction and the changes of the open one, e.g. after a new map was loaded
+void isoMapJournalClear(isoMapJournalT *journal)
+{
+    if(journal == NULL){
+        return;
+    }
+    isoMapJournalDrop(journal,0,journal->numTransactions);
+    journal->numEdits = 0;
+    journal->depth = 0;
+}
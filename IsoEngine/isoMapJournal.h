@@ -0,0 +1,69 @@
+#ifndef __ISO_MAP_JOURNAL_H_
+#define __ISO_MAP_JOURNAL_H_
+
+#include <SDL2/SDL.h>
+#include "isoMap.h"
+
+//Undo and redo for the tiles of a map. A journal attached to the map (isoMapJournalNew) is told every tile
+//isoMapSetTile changes. The changes between isoMapJournalBegin and isoMapJournalEnd, e.g. a brush stroke, are one
+//transaction, a change outside of them is a transaction of its own. A bulk operation (isoMapFillRect...) is one
+//transaction, or part of the open one. A transaction only keeps the first old and the
+//last new value of every tile it changed, as runs of tiles next to each other in a row, and the values of a run as
+//runs of the same value. Undo and redo set the tiles of one transaction, so they take as long as the edit was big.
+//When the transactions take more than the memory budget the oldest ones are dropped, they can not be undone anymore.
+//Whole chunks set with isoMapSetChunkTiles (the map generator) are not recorded.
+#define ISO_MAP_JOURNAL_DEFAULT_BUDGET  (16*1024*1024)
+#define ISO_MAP_JOURNAL_MAX_RUN         0xffff
+
+//A tile change of the open transaction
+typedef struct isoMapJournalEditT
+{
+    int x;
+    int y;
+    int layer;
+    int oldValue;
+    int newValue;
+    Uint32 order;               //which change to the tile came first
+}isoMapJournalEditT;
+
+//The runs of a transaction: a header (x, y, layer and length of the run), then the old and the new values as
+//pairs of a count and a value
+typedef struct isoMapJournalTransactionT
+{
+    Uint8 *data;
+    size_t size;
+    int numTiles;
+}isoMapJournalTransactionT;
+
+typedef struct isoMapJournalT
+{
+    isoMapT *isoMap;
+    isoMapJournalTransactionT *transactions;
+    int numTransactions;
+    int numDone;                //the transactions before this can be undone, the ones from it on redone
+    int maxTransactions;
+    int depth;                  //isoMapJournalBegin calls without an isoMapJournalEnd yet
+
+    isoMapJournalEditT *edits;  //the changes of the open transaction
+    int numEdits;
+    int maxEdits;
+    Uint8 *buffer;              //where a transaction is put together
+    size_t bufferSize;
+    size_t maxBufferSize;
+
+    size_t memoryUsed;
+    size_t memoryBudget;
+    int numDropped;             //transactions dropped to stay in the budget
+}isoMapJournalT;
+
+isoMapJournalT *isoMapJournalNew(isoMapT *isoMap,size_t memoryBudget);
+void isoMapJournalFree(isoMapJournalT *journal);
+void isoMapJournalSetBudget(isoMapJournalT *journal,size_t memoryBudget);
+void isoMapJournalBegin(isoMapJournalT *journal);
+void isoMapJournalEnd(isoMapJournalT *journal);
+void isoMapJournalRecord(isoMapJournalT *journal,int x,int y,int layer,int oldValue,int newValue);
+int isoMapJournalUndo(isoMapJournalT *journal);
+int isoMapJournalRedo(isoMapJournalT *journal);
+void isoMapJournalClear(isoMapJournalT *journal);
+
+#endif // __ISO_MAP_JOURNAL_H_
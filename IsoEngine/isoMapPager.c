@@ -0,0 +1,469 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "isoMapPager.h"
+#include "../logger.h"
+
+static int isoMapPagerThread(void *data);
+static int isoMapPagerReadAt(FILE *file,Uint64 offset,void *buffer,size_t size);
+static isoMapPagerLoadT *isoMapPagerReadChunk(isoMapPagerT *pager,int chunk);
+static void isoMapPagerInstall(isoMapPagerT *pager,isoMapPagerLoadT *load);
+static void isoMapPagerEvict(isoMapPagerT *pager,int index);
+static void isoMapPagerRequest(isoMapPagerT *pager,int startX,int startY,int endX,int endY,int visible);
+static void isoMapPagerFreeLoad(isoMapPagerT *pager,isoMapPagerLoadT *load);
+
+//Opens the map file and reads its header and layer table. The header is checked by the caller.
+isoMapPagerT *isoMapPagerNew(char *filename,size_t memoryBudget)
+{
+    isoMapPagerT *pager;
+    char msg[300];
+
+    pager = calloc(1,sizeof(struct isoMapPagerT));
+    if(pager == NULL){
+        writeToLog("Error in function: isoMapPagerNew(...) - Could not allocate memory for the map pager!","error.txt");
+        return NULL;
+    }
+    pager->memoryBudget = memoryBudget;
+    pager->file = fopen(filename,"rb");
+    if(pager->file == NULL){
+        sprintf(msg,"Error in function: isoMapPagerNew(...) - Could not open %.200s!",filename);
+        writeToLog(msg,"error.txt");
+        free(pager);
+        return NULL;
+    }
+#ifdef _WIN32
+    _fseeki64(pager->file,0,SEEK_END);
+    pager->fileSize = (Uint64)_ftelli64(pager->file);
+#else
+    fseeko(pager->file,0,SEEK_END);
+    pager->fileSize = (Uint64)ftello(pager->file);
+#endif
+    if(isoMapPagerReadAt(pager->file,0,&pager->header,sizeof(isoMapFileHeaderT))==0){
+        memset(&pager->header,0,sizeof(isoMapFileHeaderT));
+        return pager;
+    }
+    //the header check covers the layer table
+    pager->numLayers = pager->header.numLayers;
+    if(pager->numLayers > 0 && pager->header.layerTableOffset <= pager->fileSize &&
+       (Uint64)pager->numLayers*sizeof(Uint32) <= pager->fileSize - pager->header.layerTableOffset){
+        pager->layerFlags = calloc(pager->numLayers,sizeof(Uint32));
+        if(pager->layerFlags == NULL ||
+           isoMapPagerReadAt(pager->file,pager->header.layerTableOffset,pager->layerFlags,pager->numLayers*sizeof(Uint32))==0){
+            writeToLog("Error in function: isoMapPagerNew(...) - Could not read the layer table!","error.txt");
+            isoMapPagerFree(pager);
+            return NULL;
+        }
+    }
+    return pager;
+}
+
+//Starts paging the chunks of isoMap in, the map must have been allocated without any chunks
+int isoMapPagerStart(isoMapPagerT *pager,isoMapT *isoMap)
+{
+    pager->isoMap = isoMap;
+    pager->numChunks = isoMap->numChunksX * isoMap->numChunksY;
+    pager->chunkState = calloc(pager->numChunks,sizeof(Uint8));
+    pager->lastUsed = calloc(pager->numChunks,sizeof(Uint32));
+    pager->lastLost = calloc(pager->numChunks,sizeof(Uint32));
+    pager->lock = SDL_CreateMutex();
+    pager->wake = SDL_CreateCond();
+
+    if(pager->chunkState == NULL || pager->lastUsed == NULL || pager->lastLost == NULL || pager->lock == NULL || pager->wake == NULL){
+        writeToLog("Error in function: isoMapPagerStart(...) - Could not allocate memory for the map pager!","error.txt");
+        return 0;
+    }
+    pager->thread = SDL_CreateThread(isoMapPagerThread,"isoMapPager",pager);
+    if(pager->thread == NULL){
+        writeToLog("Error in function: isoMapPagerStart(...) - Could not create the loader thread!","error.txt");
+        return 0;
+    }
+    return 1;
+}
+
+//Stops the loader thread. The resident chunks belong to the map's layers and are freed with them.
+void isoMapPagerFree(isoMapPagerT *pager)
+{
+    isoMapPagerLoadT *load;
+
+    if(pager == NULL){
+        return;
+    }
+    if(pager->thread != NULL){
+        SDL_LockMutex(pager->lock);
+        SDL_AtomicSet(&pager->quit,1);
+        SDL_CondSignal(pager->wake);
+        SDL_UnlockMutex(pager->lock);
+        SDL_WaitThread(pager->thread,NULL);
+    }
+    while(pager->loaded != NULL){
+        load = pager->loaded;
+        pager->loaded = load->next;
+        isoMapPagerFreeLoad(pager,load);
+    }
+    if(pager->lock != NULL){
+        SDL_DestroyMutex(pager->lock);
+    }
+    if(pager->wake != NULL){
+        SDL_DestroyCond(pager->wake);
+    }
+    if(pager->file != NULL){
+        fclose(pager->file);
+    }
+    free(pager->layerFlags);
+    free(pager->chunkState);
+    free(pager->lastUsed);
+    free(pager->lastLost);
+    free(pager->residentChunks);
+    free(pager->requests);
+    free(pager);
+}
+
+void isoMapPagerSetBudget(isoMapPagerT *pager,size_t memoryBudget)
+{
+    if(pager != NULL){
+        pager->memoryBudget = memoryBudget;
+    }
+}
+
+int isoMapPagerIsResident(isoMapPagerT *pager,int chunk)
+{
+    return (pager->chunkState[chunk] & ISO_MAP_PAGER_STATE_MASK) == ISO_MAP_PAGER_RESIDENT;
+}
+
+void isoMapPagerMarkDirty(isoMapPagerT *pager,int chunk)
+{
+    pager->chunkState[chunk] |= ISO_MAP_PAGER_DIRTY;
+}
+
+//Counts a change to a chunk that is not loaded, the change is lost. Returns 1 for the first lost change to the chunk
+//this frame and 0 for the others, so a brush sweeping over a chunk that is not loaded is logged once and not per tile.
+int isoMapPagerLoseChange(isoMapPagerT *pager,int chunk)
+{
+    pager->lostChanges++;
+    if(pager->lastLost[chunk] == pager->frame+1){
+        return 0;
+    }
+    pager->lastLost[chunk] = pager->frame+1;
+    return 1;
+}
+
+//Called once per frame with the visible tiles (minX,minY)-(maxX,maxY). Takes over the chunks the loader has read,
+//asks for the visible chunks and the chunks the camera is heading for, and drops old chunks over the budget.
+//Never waits for the disk, a chunk that is not loaded yet is simply not there this frame.
+void isoMapPagerUpdate(isoMapPagerT *pager,int minX,int minY,int maxX,int maxY)
+{
+    int i,chunk;
+    int startX,startY,endX,endY;
+    int aheadX,aheadY;
+    int step,numSteps;
+    int shiftX,shiftY;
+    float centerX,centerY;
+    isoMapPagerLoadT *loaded;
+    isoMapPagerLoadT *load;
+    isoMapT *isoMap;
+
+    if(pager == NULL || pager->thread == NULL){
+        return;
+    }
+    isoMap = pager->isoMap;
+    pager->frame++;
+
+    //the scroll direction, smoothed over a few frames. A jump (isoEngineCenterMap) is not a direction.
+    centerX = (minX+maxX)*0.5f;
+    centerY = (minY+maxY)*0.5f;
+    if(pager->frame > 1 && fabsf(centerX-pager->lastCenterX) < MAP_CHUNK_SIZE && fabsf(centerY-pager->lastCenterY) < MAP_CHUNK_SIZE){
+        pager->velocityX = pager->velocityX*0.7f + (centerX-pager->lastCenterX)*0.3f;
+        pager->velocityY = pager->velocityY*0.7f + (centerY-pager->lastCenterY)*0.3f;
+    }
+    else{
+        pager->velocityX = 0;
+        pager->velocityY = 0;
+    }
+    pager->lastCenterX = centerX;
+    pager->lastCenterY = centerY;
+
+    //take what the loader has finished and forget the requests it has not started on
+    SDL_LockMutex(pager->lock);
+    loaded = pager->loaded;
+    pager->loaded = NULL;
+    for(i=pager->nextRequest;i<pager->numRequests;++i){
+        pager->chunkState[pager->requests[i]] &= ~ISO_MAP_PAGER_STATE_MASK;
+    }
+    pager->numRequests = 0;
+    pager->nextRequest = 0;
+
+    //visible chunks first, then the margin around them, then where the camera is going
+    startX = SDL_max(minX>>MAP_CHUNK_SHIFT,0);
+    startY = SDL_max(minY>>MAP_CHUNK_SHIFT,0);
+    endX = SDL_min(maxX>>MAP_CHUNK_SHIFT,isoMap->numChunksX-1);
+    endY = SDL_min(maxY>>MAP_CHUNK_SHIFT,isoMap->numChunksY-1);
+    pager->missingChunks = 0;
+    isoMapPagerRequest(pager,startX,startY,endX,endY,1);
+    isoMapPagerRequest(pager,startX-ISO_MAP_PAGER_MARGIN,startY-ISO_MAP_PAGER_MARGIN,
+                       endX+ISO_MAP_PAGER_MARGIN,endY+ISO_MAP_PAGER_MARGIN,0);
+
+    //the visible chunks moved along the path, one chunk step at a time
+    aheadX = (int)floorf(pager->velocityX*ISO_MAP_PAGER_LOOKAHEAD_FRAMES) >> MAP_CHUNK_SHIFT;
+    aheadY = (int)floorf(pager->velocityY*ISO_MAP_PAGER_LOOKAHEAD_FRAMES) >> MAP_CHUNK_SHIFT;
+    numSteps = SDL_max(abs(aheadX),abs(aheadY));
+    for(step=1;step<=numSteps;++step){
+        shiftX = aheadX*step/numSteps;
+        shiftY = aheadY*step/numSteps;
+        isoMapPagerRequest(pager,startX+shiftX,startY+shiftY,endX+shiftX,endY+shiftY,0);
+    }
+    if(pager->numRequests > 0){
+        SDL_CondSignal(pager->wake);
+    }
+    SDL_UnlockMutex(pager->lock);
+
+    while(loaded != NULL){
+        load = loaded;
+        loaded = load->next;
+        isoMapPagerInstall(pager,load);
+    }
+
+    //least recently used first, never a chunk that is wanted this frame or has been changed
+    while(pager->memoryUsed > pager->memoryBudget){
+        int oldest = -1;
+        for(i=0;i<pager->numResident;++i){
+            chunk = pager->residentChunks[i];
+            if(pager->lastUsed[chunk] == pager->frame || (pager->chunkState[chunk] & ISO_MAP_PAGER_DIRTY)){
+                continue;
+            }
+            if(oldest < 0 || pager->lastUsed[chunk] < pager->lastUsed[pager->residentChunks[oldest]]){
+                oldest = i;
+            }
+        }
+        if(oldest < 0){
+            break;
+        }
+        isoMapPagerEvict(pager,oldest);
+    }
+}
+
+//Adds the chunks of a rectangle that are not loaded or on their way yet to the requests. Called with the lock held.
+static void isoMapPagerRequest(isoMapPagerT *pager,int startX,int startY,int endX,int endY,int visible)
+{
+    int x,y;
+    int chunk;
+    int *requests;
+    isoMapT *isoMap = pager->isoMap;
+
+    startX = SDL_max(startX,0);
+    startY = SDL_max(startY,0);
+    endX = SDL_min(endX,isoMap->numChunksX-1);
+    endY = SDL_min(endY,isoMap->numChunksY-1);
+
+    for(y=startY;y<=endY;++y){
+        for(x=startX;x<=endX;++x){
+            chunk = y*isoMap->numChunksX + x;
+            pager->lastUsed[chunk] = pager->frame;
+
+            if((pager->chunkState[chunk] & ISO_MAP_PAGER_STATE_MASK) != ISO_MAP_PAGER_RESIDENT){
+                pager->missingChunks += visible;
+            }
+            if((pager->chunkState[chunk] & ISO_MAP_PAGER_STATE_MASK) != ISO_MAP_PAGER_NOT_RESIDENT){
+                continue;
+            }
+            if(pager->numRequests == pager->maxRequests){
+                requests = realloc(pager->requests,(pager->maxRequests+256)*sizeof(int));
+                if(requests == NULL){
+                    return;
+                }
+                pager->requests = requests;
+                pager->maxRequests += 256;
+            }
+            pager->requests[pager->numRequests++] = chunk;
+            pager->chunkState[chunk] = (pager->chunkState[chunk] & ~ISO_MAP_PAGER_STATE_MASK) | ISO_MAP_PAGER_QUEUED;
+        }
+    }
+}
+
+//Puts a chunk the loader has read into the map's layers
+static void isoMapPagerInstall(isoMapPagerT *pager,isoMapPagerLoadT *load)
+{
+    int layer;
+    int chunk = load->chunk;
+    int *resident;
+    isoMapLayerT *mapLayer;
+    isoMapT *isoMap = pager->isoMap;
+
+    if(pager->numResident == pager->maxResident){
+        resident = realloc(pager->residentChunks,(pager->maxResident+1024)*sizeof(int));
+        if(resident == NULL){
+            //try again another frame
+            pager->chunkState[chunk] &= ~ISO_MAP_PAGER_STATE_MASK;
+            isoMapPagerFreeLoad(pager,load);
+            return;
+        }
+        pager->residentChunks = resident;
+        pager->maxResident += 1024;
+    }
+    pager->residentChunks[pager->numResident++] = chunk;
+
+    for(layer=0;layer<pager->numLayers;++layer){
+        if(load->layerChunks[layer].indices == NULL){
+            continue;
+        }
+        //the tiles are drawn with the clip rect of their value, a chunk with values outside the tile set is dropped
+        if(isoMapChunkCheck(&load->layerChunks[layer],isoMap->tileSet->numTileClipRects) == 0){
+            logError("error.txt","isoMapPagerInstall(...) - chunk %d of layer %d is broken or has tiles that are not in the tile set!",chunk,layer);
+            isoMapChunkFree(&load->layerChunks[layer]);
+            if((pager->layerFlags[layer] & MAP_FILE_LAYER_SPARSE) || isoMapChunkAllocate(&load->layerChunks[layer],4) == 0){
+                continue;
+            }
+        }
+        mapLayer = &isoMap->layers[layer];
+        mapLayer->chunks[chunk] = load->layerChunks[layer];
+        mapLayer->chunkPresence[chunk >> 5] |= 1u << (chunk & 31);
+        mapLayer->numChunksAllocated++;
+        pager->memoryUsed += MAP_CHUNK_BYTES(load->layerChunks[layer].bitsPerTile);
+    }
+    pager->chunkState[chunk] = ISO_MAP_PAGER_RESIDENT;
+    pager->chunksLoaded++;
+
+    //what was drawn of the chunk so far was drawn without its tiles
+    isoMap->chunkRevisions[chunk]++;
+    free(load);
+}
+
+static void isoMapPagerEvict(isoMapPagerT *pager,int index)
+{
+    int layer;
+    int chunk = pager->residentChunks[index];
+    isoMapLayerT *mapLayer;
+    isoMapT *isoMap = pager->isoMap;
+
+    for(layer=0;layer<pager->numLayers;++layer){
+        mapLayer = &isoMap->layers[layer];
+        if(mapLayer->chunks[chunk].indices == NULL){
+            continue;
+        }
+        //a chunk is only widened by a change, and changed chunks are never evicted
+        pager->memoryUsed -= MAP_CHUNK_BYTES(mapLayer->chunks[chunk].bitsPerTile);
+        isoMapChunkFree(&mapLayer->chunks[chunk]);
+        mapLayer->chunkPresence[chunk >> 5] &= ~(1u << (chunk & 31));
+        mapLayer->numChunksAllocated--;
+    }
+    pager->chunkState[chunk] = ISO_MAP_PAGER_NOT_RESIDENT;
+    pager->residentChunks[index] = pager->residentChunks[--pager->numResident];
+    pager->chunksEvicted++;
+    isoMap->chunkRevisions[chunk]++;
+}
+
+static void isoMapPagerFreeLoad(isoMapPagerT *pager,isoMapPagerLoadT *load)
+{
+    int layer;
+    for(layer=0;layer<pager->numLayers;++layer){
+        isoMapChunkFree(&load->layerChunks[layer]);
+    }
+    free(load);
+}
+
+static int isoMapPagerThread(void *data)
+{
+    int chunk;
+    isoMapPagerT *pager = data;
+    isoMapPagerLoadT *load;
+
+    SDL_LockMutex(pager->lock);
+    while(!SDL_AtomicGet(&pager->quit)){
+        if(pager->nextRequest == pager->numRequests){
+            SDL_CondWait(pager->wake,pager->lock);
+            continue;
+        }
+        chunk = pager->requests[pager->nextRequest++];
+
+        //the disk is read without the lock, the main thread never waits for it
+        SDL_UnlockMutex(pager->lock);
+        load = isoMapPagerReadChunk(pager,chunk);
+        while(load == NULL && !SDL_AtomicGet(&pager->quit)){
+            //out of memory, the main thread evicts chunks meanwhile
+            SDL_Delay(10);
+            load = isoMapPagerReadChunk(pager,chunk);
+        }
+        SDL_LockMutex(pager->lock);
+
+        if(load != NULL){
+            load->next = pager->loaded;
+            pager->loaded = load;
+        }
+    }
+    SDL_UnlockMutex(pager->lock);
+    return 0;
+}
+
+//Reads every layer of a chunk. A chunk a sparse layer did not store stays NULL, a dense layer gets an empty chunk.
+static isoMapPagerLoadT *isoMapPagerReadChunk(isoMapPagerT *pager,int chunk)
+{
+    int layer;
+    Uint64 offset;
+    isoMapFileChunkT fileChunk;
+    void *memory;
+    isoMapPagerLoadT *load;
+
+    load = calloc(1,sizeof(isoMapPagerLoadT) + pager->numLayers*sizeof(isoMapChunkT));
+    if(load == NULL){
+        return NULL;
+    }
+    load->chunk = chunk;
+
+    for(layer=0;layer<pager->numLayers;++layer){
+        if(isoMapPagerReadAt(pager->file,pager->header.chunkTableOffset + ((Uint64)layer*pager->numChunks + chunk)*sizeof(Uint64),
+                             &offset,sizeof(Uint64))==0){
+            offset = 0;
+        }
+        //compared by subtracting, a huge offset must not wrap around
+        if(offset != 0 && (offset < pager->header.dataOffset || offset % sizeof(int) != 0 || offset > pager->fileSize - sizeof(isoMapFileChunkT))){
+            logError("error.txt","isoMapPagerReadChunk(...) - chunk %d of layer %d has a broken file offset!",chunk,layer);
+            offset = 0;
+        }
+        //the size of a chunk depends on the width of its indices
+        if(offset != 0 && (isoMapPagerReadAt(pager->file,offset,&fileChunk,sizeof(fileChunk))==0 ||
+                           (fileChunk.bitsPerTile != 4 && fileChunk.bitsPerTile != 8 && fileChunk.bitsPerTile != 16) ||
+                           MAP_CHUNK_BYTES(fileChunk.bitsPerTile) > pager->fileSize - offset - sizeof(fileChunk))){
+            logError("error.txt","isoMapPagerReadChunk(...) - could not read chunk %d of layer %d!",chunk,layer);
+            offset = 0;
+        }
+        if(offset == 0 && (pager->layerFlags[layer] & MAP_FILE_LAYER_SPARSE)){
+            continue;
+        }
+        if(offset == 0){
+            if(isoMapChunkAllocate(&load->layerChunks[layer],4)==0){
+                isoMapPagerFreeLoad(pager,load);
+                return NULL;
+            }
+            continue;
+        }
+        memory = malloc(MAP_CHUNK_BYTES(fileChunk.bitsPerTile));
+        if(memory == NULL){
+            isoMapPagerFreeLoad(pager,load);
+            return NULL;
+        }
+        if(isoMapPagerReadAt(pager->file,offset+sizeof(fileChunk),memory,MAP_CHUNK_BYTES(fileChunk.bitsPerTile))==0 ||
+           isoMapChunkInit(&load->layerChunks[layer],fileChunk.bitsPerTile,fileChunk.paletteSize,memory,1)==0){
+            logError("error.txt","isoMapPagerReadChunk(...) - could not read chunk %d of layer %d!",chunk,layer);
+            free(memory);
+            if(isoMapChunkAllocate(&load->layerChunks[layer],4)==0){
+                isoMapPagerFreeLoad(pager,load);
+                return NULL;
+            }
+        }
+    }
+    return load;
+}
+
+static int isoMapPagerReadAt(FILE *file,Uint64 offset,void *buffer,size_t size)
+{
+#ifdef _WIN32
+    if(_fseeki64(file,(__int64)offset,SEEK_SET) != 0){
+        return 0;
+    }
+#else
+    if(fseeko(file,(off_t)offset,SEEK_SET) != 0){
+        return 0;
+    }
+#endif
+    return fread(buffer,1,size,file) == size;
+}
@@ -0,0 +1,80 @@
+#ifndef __ISO_MAP_PAGER_H_
+#define __ISO_MAP_PAGER_H_
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include "isoMap.h"
+
+//A paged map (isoMapLoadMapPaged) only keeps the chunks around the camera in memory.
+//A background thread reads them from the map file, the chunks that have not been used the longest
+//are dropped again when the memory budget is used up.
+#define ISO_MAP_PAGER_DEFAULT_BUDGET    (256*1024*1024)
+#define ISO_MAP_PAGER_MARGIN            1   //chunks loaded around the visible ones
+#define ISO_MAP_PAGER_LOOKAHEAD_FRAMES  30  //how many frames ahead the scroll direction is followed
+
+//chunk states
+#define ISO_MAP_PAGER_NOT_RESIDENT      0
+#define ISO_MAP_PAGER_QUEUED            1
+#define ISO_MAP_PAGER_RESIDENT          2
+#define ISO_MAP_PAGER_STATE_MASK        3
+#define ISO_MAP_PAGER_DIRTY             4   //changed since it was loaded, it is kept until the map is freed
+
+//the layers of one chunk, read by the loader thread and handed to the main thread
+typedef struct isoMapPagerLoadT
+{
+    int chunk;
+    struct isoMapPagerLoadT *next;
+    isoMapChunkT layerChunks[];
+}isoMapPagerLoadT;
+
+typedef struct isoMapPagerT
+{
+    FILE *file;
+    Uint64 fileSize;
+    isoMapFileHeaderT header;
+    Uint32 *layerFlags;
+    int numLayers;
+    int numChunks;
+
+    //only used by the main thread
+    isoMapT *isoMap;
+    Uint8 *chunkState;
+    Uint32 *lastUsed;
+    Uint32 *lastLost;           //the frame+1 a lost change to the chunk was last logged
+    int *residentChunks;
+    int numResident;
+    int maxResident;
+    size_t memoryUsed;
+    size_t memoryBudget;
+    Uint32 frame;
+    float velocityX;
+    float velocityY;
+    float lastCenterX;
+    float lastCenterY;
+    int chunksLoaded;
+    int chunksEvicted;
+    int missingChunks;
+    int lostChanges;            //changes to chunks that were not loaded
+
+    //shared with the loader thread, guarded by lock
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    SDL_Thread *thread;
+    SDL_atomic_t quit;
+    int *requests;
+    int numRequests;
+    int nextRequest;
+    int maxRequests;
+    isoMapPagerLoadT *loaded;
+}isoMapPagerT;
+
+isoMapPagerT *isoMapPagerNew(char *filename,size_t memoryBudget);
+int isoMapPagerStart(isoMapPagerT *pager,isoMapT *isoMap);
+void isoMapPagerFree(isoMapPagerT *pager);
+void isoMapPagerSetBudget(isoMapPagerT *pager,size_t memoryBudget);
+void isoMapPagerUpdate(isoMapPagerT *pager,int minX,int minY,int maxX,int maxY);
+int isoMapPagerIsResident(isoMapPagerT *pager,int chunk);
+void isoMapPagerMarkDirty(isoMapPagerT *pager,int chunk);
+int isoMapPagerLoseChange(isoMapPagerT *pager,int chunk);
+
+#endif // __ISO_MAP_PAGER_H_
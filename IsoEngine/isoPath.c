@@ -0,0 +1,1028 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "isoPath.h"
+#include "isoMapPager.h"
+#include "../logger.h"
+
+#define ISO_PATH_SHIFT          MAP_CHUNK_SHIFT
+#define ISO_PATH_MASK           MAP_CHUNK_MASK
+
+//what isoPathRebuild does with a cluster
+#define ISO_PATH_REBUILD_NODES  1       //find the entrances and the costs between them
+#define ISO_PATH_REBUILD_COSTS  2       //read the tile costs from the map first
+
+//how far a search on the nodes got
+#define ISO_PATH_NOT_FOUND      0
+#define ISO_PATH_FOUND          1
+#define ISO_PATH_SEARCHING      2
+#define ISO_PATH_CHECK_TIME     64      //nodes expanded between looks at the clock
+
+//The 8 steps, the straight ones first
+static const int isoPathStepX[8] = {0,1,0,-1,1,1,-1,-1};
+static const int isoPathStepY[8] = {-1,0,1,0,-1,1,1,-1};
+
+//The open tiles of a search inside a cluster are kept in buckets by their estimate (Dial's algorithm): a step
+//never costs more than ISO_PATH_DIAGONAL*255, so the open estimates always fit into ISO_PATH_BUCKETS in a row
+#define ISO_PATH_BUCKETS        4096
+#define ISO_PATH_BUCKET_MASK    (ISO_PATH_BUCKETS-1)
+#define ISO_PATH_NO_TILE        0xffff
+
+//What a search inside one cluster needs
+typedef struct isoPathLocalT
+{
+    const Uint8 *costs;
+    const Uint8 *moves;
+    Uint32 cost[ISO_PATH_CLUSTER_TILES];
+    Uint32 estimate[ISO_PATH_CLUSTER_TILES];
+    Uint16 parent[ISO_PATH_CLUSTER_TILES];
+    Uint16 next[ISO_PATH_CLUSTER_TILES];        //the open tiles in the same bucket
+    Uint16 previous[ISO_PATH_CLUSTER_TILES];
+    Uint8 open[ISO_PATH_CLUSTER_TILES];
+    Uint16 buckets[ISO_PATH_BUCKETS];
+    int numOpen;
+}isoPathLocalT;
+
+typedef struct isoPathRebuildJobT
+{
+    isoPathFinderT *finder;
+    int *clusters;
+    SDL_atomic_t failed;
+}isoPathRebuildJobT;
+
+isoPathFinderT *isoPathNew(isoMapT *isoMap,threadPoolT *threadPool)
+{
+    int numClusters;
+    size_t numNodes;
+    isoPathFinderT *finder;
+
+    if(isoMap == NULL){
+        writeToLog("Error in function: isoPathNew(...) - Parameter isoMap is NULL!","error.txt");
+        return NULL;
+    }
+    finder = calloc(1,sizeof(struct isoPathFinderT));
+    if(finder == NULL){
+        writeToLog("Error in isoPathNew(...): Could not allocate memory for the path finder!","error.txt");
+        return NULL;
+    }
+    finder->isoMap = isoMap;
+    finder->threadPool = threadPool;
+    memset(finder->tileCosts,ISO_PATH_DEFAULT_COST,sizeof(finder->tileCosts));
+    finder->costsChanged = 1;
+    finder->numClustersX = isoMap->numChunksX;
+    finder->numClustersY = isoMap->numChunksY;
+    numClusters = finder->numClustersX * finder->numClustersY;
+    numNodes = (size_t)numClusters*ISO_PATH_MAX_CLUSTER_NODES + 2;
+
+    finder->clusters = calloc(numClusters,sizeof(isoPathClusterT));
+    finder->costs = calloc((size_t)numClusters,ISO_PATH_CLUSTER_TILES);
+    finder->moves = calloc((size_t)numClusters,ISO_PATH_CLUSTER_TILES);
+    finder->rebuild = calloc(numClusters,sizeof(Uint8));
+    finder->rebuildList = malloc(numClusters*sizeof(int));
+    finder->nodeCost = malloc(numNodes*sizeof(Uint32));
+    finder->nodeParent = malloc(numNodes*sizeof(Uint32));
+    finder->nodeVisited = calloc(numNodes,sizeof(Uint32));
+    finder->nodeClosed = calloc(numNodes,sizeof(Uint32));
+    if(finder->clusters == NULL || finder->costs == NULL || finder->moves == NULL || finder->rebuild == NULL || finder->rebuildList == NULL ||
+       finder->nodeCost == NULL || finder->nodeParent == NULL || finder->nodeVisited == NULL || finder->nodeClosed == NULL){
+        writeToLog("Error in isoPathNew(...): Could not allocate memory for the clusters!","error.txt");
+        isoPathFree(finder);
+        return NULL;
+    }
+    return finder;
+}
+
+void isoPathFree(isoPathFinderT *finder)
+{
+    int i;
+
+    if(finder == NULL){
+        return;
+    }
+    if(finder->clusters != NULL){
+        for(i=0;i<finder->numClustersX * finder->numClustersY;++i){
+            free(finder->clusters[i].distances);
+        }
+    }
+    free(finder->clusters);
+    free(finder->costs);
+    free(finder->moves);
+    free(finder->rebuild);
+    free(finder->rebuildList);
+    free(finder->nodeCost);
+    free(finder->nodeParent);
+    free(finder->nodeVisited);
+    free(finder->nodeClosed);
+    free(finder->open);
+    free(finder->tiles);
+    free(finder->requests);
+    free(finder);
+}
+
+//Sets what it costs to step onto tiles with the value tile, ISO_PATH_BLOCKED if they can not be walked on.
+//Every cluster is built again by the next isoPathRebuild.
+void isoPathSetTileCost(isoPathFinderT *finder,int tile,int cost)
+{
+    if(finder == NULL || tile < 0 || tile >= ISO_PATH_MAX_TILE_VALUES){
+        writeToLog("Error in function: isoPathSetTileCost(...) - Parameter finder is NULL or the tile value has no cost!","error.txt");
+        return;
+    }
+    finder->tileCosts[tile] = SDL_min(SDL_max(cost,0),255);
+    finder->costsChanged = 1;
+}
+
+static Uint8 *isoPathGetClusterCosts(isoPathFinderT *finder,int clusterX,int clusterY)
+{
+    return &finder->costs[(size_t)(clusterY*finder->numClustersX + clusterX)*ISO_PATH_CLUSTER_TILES];
+}
+
+//The cost of stepping onto the map tile x,y as of the last isoPathRebuild, ISO_PATH_BLOCKED outside the map
+int isoPathGetCost(isoPathFinderT *finder,int x,int y)
+{
+    if(finder == NULL || x < 0 || y < 0 || x >= finder->isoMap->mapWidth || y >= finder->isoMap->mapHeight){
+        return ISO_PATH_BLOCKED;
+    }
+    return isoPathGetClusterCosts(finder,x >> ISO_PATH_SHIFT,y >> ISO_PATH_SHIFT)[((y & ISO_PATH_MASK) << ISO_PATH_SHIFT) + (x & ISO_PATH_MASK)];
+}
+
+//The steps that can be taken from every tile of a cluster, without leaving it
+static void isoPathGetMoves(const Uint8 *costs,Uint8 *moves)
+{
+    int step;
+    int tile;
+    int x,y,nextX,nextY;
+
+    for(tile=0;tile<ISO_PATH_CLUSTER_TILES;++tile){
+        moves[tile] = 0;
+        x = tile & ISO_PATH_MASK;
+        y = tile >> ISO_PATH_SHIFT;
+        for(step=0;step<8 && costs[tile] != ISO_PATH_BLOCKED;++step){
+            nextX = x + isoPathStepX[step];
+            nextY = y + isoPathStepY[step];
+            if(nextX < 0 || nextY < 0 || nextX >= ISO_PATH_CLUSTER_SIZE || nextY >= ISO_PATH_CLUSTER_SIZE ||
+               costs[(nextY << ISO_PATH_SHIFT) + nextX] == ISO_PATH_BLOCKED){
+                continue;
+            }
+            //no cutting corners
+            if(step >= 4 && (costs[(y << ISO_PATH_SHIFT) + nextX] == ISO_PATH_BLOCKED || costs[(nextY << ISO_PATH_SHIFT) + x] == ISO_PATH_BLOCKED)){
+                continue;
+            }
+            moves[tile] |= 1 << step;
+        }
+    }
+}
+
+//Reads the tiles of all layers of a cluster and works out their costs
+static void isoPathReadCosts(isoPathFinderT *finder,int cluster)
+{
+    int i,layer;
+    int x,y;
+    int tile;
+    int cost;
+    int clusterX = cluster % finder->numClustersX;
+    int clusterY = cluster / finder->numClustersX;
+    int width = SDL_min(finder->isoMap->mapWidth - (clusterX << ISO_PATH_SHIFT),ISO_PATH_CLUSTER_SIZE);
+    int height = SDL_min(finder->isoMap->mapHeight - (clusterY << ISO_PATH_SHIFT),ISO_PATH_CLUSTER_SIZE);
+    int resident = finder->isoMap->pager == NULL || isoMapPagerIsResident(finder->isoMap->pager,cluster);
+    Uint8 *costs = isoPathGetClusterCosts(finder,clusterX,clusterY);
+    Uint8 *moves = &finder->moves[(size_t)cluster*ISO_PATH_CLUSTER_TILES];
+    isoMapChunkT *chunk;
+    int tiles[ISO_PATH_CLUSTER_TILES];
+
+    //a chunk that is not loaded can not be walked on until it is, paging it in changes its revision
+    finder->clusters[cluster].revision = isoMapGetChunkRevision(finder->isoMap,clusterX,clusterY);
+    finder->clusters[cluster].costsRevision = finder->graphRevision;
+    if(!resident){
+        memset(costs,ISO_PATH_BLOCKED,ISO_PATH_CLUSTER_TILES);
+        memset(moves,0,ISO_PATH_CLUSTER_TILES);
+        return;
+    }
+    for(layer=0;layer<finder->isoMap->numLayers;++layer){
+        chunk = isoMapGetChunk(finder->isoMap,clusterX,clusterY,layer);
+        if(chunk == NULL){
+            if(layer == 0){
+                memset(costs,finder->tileCosts[MAP_EMPTY_TILE],ISO_PATH_CLUSTER_TILES);
+            }
+            continue;
+        }
+        isoMapChunkGetTiles(chunk,tiles);
+        for(i=0;i<ISO_PATH_CLUSTER_TILES;++i){
+            tile = tiles[i];
+            cost = tile >= 0 && tile < ISO_PATH_MAX_TILE_VALUES ? finder->tileCosts[tile] : ISO_PATH_DEFAULT_COST;
+            if(layer == 0){
+                costs[i] = cost;
+            }
+            else if(tile != MAP_EMPTY_TILE && costs[i] != ISO_PATH_BLOCKED){
+                costs[i] = cost == ISO_PATH_BLOCKED ? ISO_PATH_BLOCKED : SDL_max(costs[i],cost);
+            }
+        }
+    }
+    //the part of a cluster on the edge of the map that is outside it
+    for(y=0;y<ISO_PATH_CLUSTER_SIZE;++y){
+        for(x=(y < height ? width : 0);x<ISO_PATH_CLUSTER_SIZE;++x){
+            costs[(y << ISO_PATH_SHIFT) + x] = ISO_PATH_BLOCKED;
+        }
+    }
+    isoPathGetMoves(costs,moves);
+}
+
+//The entrances on the border to the right of (ISO_PATH_RIGHT) or below (ISO_PATH_DOWN) the cluster, as positions
+//along the border. Both clusters of a border get the same entrances in the same order. Returns how many there are.
+static int isoPathGetEntrances(isoPathFinderT *finder,int clusterX,int clusterY,int side,Uint8 *positions)
+{
+    int i;
+    int start = -1;
+    int open;
+    int numPositions = 0;
+    const Uint8 *costs;
+    const Uint8 *neighbourCosts;
+
+    if(side == ISO_PATH_RIGHT ? clusterX+1 >= finder->numClustersX : clusterY+1 >= finder->numClustersY){
+        return 0;
+    }
+    costs = isoPathGetClusterCosts(finder,clusterX,clusterY);
+    neighbourCosts = side == ISO_PATH_RIGHT ? isoPathGetClusterCosts(finder,clusterX+1,clusterY) : isoPathGetClusterCosts(finder,clusterX,clusterY+1);
+
+    for(i=0;i<=ISO_PATH_CLUSTER_SIZE;++i){
+        if(i == ISO_PATH_CLUSTER_SIZE){
+            open = 0;
+        }
+        else if(side == ISO_PATH_RIGHT){
+            open = costs[(i << ISO_PATH_SHIFT) + ISO_PATH_MASK] != ISO_PATH_BLOCKED && neighbourCosts[i << ISO_PATH_SHIFT] != ISO_PATH_BLOCKED;
+        }
+        else{
+            open = costs[(ISO_PATH_MASK << ISO_PATH_SHIFT) + i] != ISO_PATH_BLOCKED && neighbourCosts[i] != ISO_PATH_BLOCKED;
+        }
+        if(open && start < 0){
+            start = i;
+        }
+        else if(!open && start >= 0){
+            if(i - start >= ISO_PATH_LONG_ENTRANCE && numPositions+2 <= ISO_PATH_MAX_SIDE_NODES){
+                positions[numPositions++] = start;
+                positions[numPositions++] = i-1;
+            }
+            else if(numPositions < ISO_PATH_MAX_SIDE_NODES){
+                positions[numPositions++] = (start + i-1)/2;
+            }
+            start = -1;
+        }
+    }
+    return numPositions;
+}
+
+//Searches inside the cluster from now on
+static void isoPathUseCluster(isoPathLocalT *local,isoPathFinderT *finder,int cluster)
+{
+    local->costs = &finder->costs[(size_t)cluster*ISO_PATH_CLUSTER_TILES];
+    local->moves = &finder->moves[(size_t)cluster*ISO_PATH_CLUSTER_TILES];
+}
+
+static void isoPathOpenTile(isoPathLocalT *local,int tile)
+{
+    Uint16 *bucket = &local->buckets[local->estimate[tile] & ISO_PATH_BUCKET_MASK];
+
+    local->next[tile] = *bucket;
+    local->previous[tile] = ISO_PATH_NO_TILE;
+    if(*bucket != ISO_PATH_NO_TILE){
+        local->previous[*bucket] = tile;
+    }
+    *bucket = tile;
+    local->open[tile] = 1;
+    local->numOpen++;
+}
+
+static void isoPathCloseTile(isoPathLocalT *local,int tile)
+{
+    if(local->previous[tile] != ISO_PATH_NO_TILE){
+        local->next[local->previous[tile]] = local->next[tile];
+    }
+    else{
+        local->buckets[local->estimate[tile] & ISO_PATH_BUCKET_MASK] = local->next[tile];
+    }
+    if(local->next[tile] != ISO_PATH_NO_TILE){
+        local->previous[local->next[tile]] = local->previous[tile];
+    }
+    local->open[tile] = 0;
+    local->numOpen--;
+}
+
+//The octile distance at the lowest cost, never more than the cost of the path
+static Uint32 isoPathHeuristic(int x,int y,int goalX,int goalY)
+{
+    int dx = abs(x-goalX);
+    int dy = abs(y-goalY);
+
+    return ISO_PATH_STRAIGHT*SDL_max(dx,dy) + (ISO_PATH_DIAGONAL-ISO_PATH_STRAIGHT)*SDL_min(dx,dy);
+}
+
+//Searches inside one cluster from the start tiles until every target is reached. With one target it is an A* to it,
+//otherwise a Dijkstra. A start costs startCosts to begin with (0 without startCosts), the starts have to be sorted by
+//it. Reverse searches the paths from every tile to the starts instead: local->cost is then the cost to get from a tile
+//to a start and local->parent the next tile on the way. Returns the number of targets reached.
+//isoPathUseCluster has to be called for the cluster first.
+static int isoPathSearchLocal(isoPathLocalT *local,const Uint16 *starts,const Uint32 *startCosts,int numStarts,
+                              const Uint16 *targets,int numTargets,int reverse)
+{
+    int i,step;
+    int tile,next;
+    int numReached = 0;
+    int nextStart = 0;
+    int goalX = 0,goalY = 0;
+    Uint32 cost;
+    Uint32 estimate;
+    Uint32 current = 0;
+    Uint8 moves;
+    const Uint8 *costs = local->costs;
+    Uint8 isTarget[ISO_PATH_CLUSTER_TILES];
+    static const int stepOffset[8] = {-ISO_PATH_CLUSTER_SIZE,1,ISO_PATH_CLUSTER_SIZE,-1,
+                                      1-ISO_PATH_CLUSTER_SIZE,1+ISO_PATH_CLUSTER_SIZE,ISO_PATH_CLUSTER_SIZE-1,-1-ISO_PATH_CLUSTER_SIZE};
+
+    memset(isTarget,0,sizeof(isTarget));
+    for(i=0;i<numTargets;++i){
+        isTarget[targets[i]] = 1;
+    }
+    if(numTargets == 1){
+        goalX = targets[0] & ISO_PATH_MASK;
+        goalY = targets[0] >> ISO_PATH_SHIFT;
+    }
+    memset(local->cost,0xff,sizeof(local->cost));
+    memset(local->open,0,sizeof(local->open));
+    memset(local->buckets,0xff,sizeof(local->buckets));
+    local->numOpen = 0;
+
+    while(local->numOpen > 0 || nextStart < numStarts){
+        //a start joins the search when it gets to its cost, so the open estimates always fit into the buckets
+        while(nextStart < numStarts){
+            tile = starts[nextStart];
+            cost = startCosts != NULL ? startCosts[nextStart] : 0;
+            estimate = cost + (numTargets == 1 ? isoPathHeuristic(tile & ISO_PATH_MASK,tile >> ISO_PATH_SHIFT,goalX,goalY) : 0);
+            if(local->numOpen == 0){
+                current = SDL_max(current,estimate);
+            }
+            if(estimate > current){
+                break;
+            }
+            if(cost < local->cost[tile]){
+                if(local->open[tile]){
+                    isoPathCloseTile(local,tile);
+                }
+                local->cost[tile] = cost;
+                local->parent[tile] = tile;
+                local->estimate[tile] = estimate;
+                isoPathOpenTile(local,tile);
+            }
+            nextStart++;
+        }
+        //the estimates never go down, the next tile is in the next bucket that is not empty
+        tile = local->buckets[current & ISO_PATH_BUCKET_MASK];
+        if(tile == ISO_PATH_NO_TILE){
+            current++;
+            continue;
+        }
+        isoPathCloseTile(local,tile);
+        if(isTarget[tile]){
+            isTarget[tile] = 0;
+            if(++numReached == numTargets){
+                break;
+            }
+        }
+        moves = local->moves[tile];
+        for(step=0;moves != 0;++step,moves >>= 1){
+            if(!(moves & 1)){
+                continue;
+            }
+            next = tile + stepOffset[step];
+            cost = local->cost[tile] + (step < 4 ? ISO_PATH_STRAIGHT : ISO_PATH_DIAGONAL)*costs[reverse ? tile : next];
+            if(cost >= local->cost[next]){
+                continue;
+            }
+            if(local->open[next]){
+                isoPathCloseTile(local,next);
+            }
+            local->cost[next] = cost;
+            local->parent[next] = tile;
+            local->estimate[next] = cost + (numTargets == 1 ? isoPathHeuristic(next & ISO_PATH_MASK,next >> ISO_PATH_SHIFT,goalX,goalY) : 0);
+            isoPathOpenTile(local,next);
+        }
+    }
+    return numReached;
+}
+
+//Finds the nodes of a cluster from the entrances on its four sides and the costs between them
+static int isoPathBuildNodes(isoPathFinderT *finder,int index,isoPathLocalT *local)
+{
+    int i,j,side,count;
+    int clusterX = index % finder->numClustersX;
+    int clusterY = index / finder->numClustersX;
+    isoPathClusterT *cluster = &finder->clusters[index];
+    Uint8 positions[ISO_PATH_MAX_SIDE_NODES];
+    Uint32 *distances;
+
+    cluster->numNodes = 0;
+    for(side=0;side<4;++side){
+        switch(side){
+            case ISO_PATH_UP:   count = clusterY > 0 ? isoPathGetEntrances(finder,clusterX,clusterY-1,ISO_PATH_DOWN,positions) : 0; break;
+            case ISO_PATH_RIGHT:count = isoPathGetEntrances(finder,clusterX,clusterY,ISO_PATH_RIGHT,positions); break;
+            case ISO_PATH_DOWN: count = isoPathGetEntrances(finder,clusterX,clusterY,ISO_PATH_DOWN,positions); break;
+            default:            count = clusterX > 0 ? isoPathGetEntrances(finder,clusterX-1,clusterY,ISO_PATH_RIGHT,positions) : 0; break;
+        }
+        cluster->sideStart[side] = cluster->numNodes;
+        cluster->sideCount[side] = count;
+        for(i=0;i<count;++i){
+            switch(side){
+                case ISO_PATH_UP:   cluster->nodeTiles[cluster->numNodes++] = positions[i]; break;
+                case ISO_PATH_RIGHT:cluster->nodeTiles[cluster->numNodes++] = (positions[i] << ISO_PATH_SHIFT) + ISO_PATH_MASK; break;
+                case ISO_PATH_DOWN: cluster->nodeTiles[cluster->numNodes++] = (ISO_PATH_MASK << ISO_PATH_SHIFT) + positions[i]; break;
+                default:            cluster->nodeTiles[cluster->numNodes++] = positions[i] << ISO_PATH_SHIFT; break;
+            }
+        }
+    }
+
+    free(cluster->distances);
+    cluster->distances = NULL;
+    if(cluster->numNodes == 0){
+        return 1;
+    }
+    distances = malloc(cluster->numNodes*cluster->numNodes*sizeof(Uint32));
+    if(distances == NULL){
+        cluster->numNodes = 0;
+        memset(cluster->sideCount,0,sizeof(cluster->sideCount));
+        return 0;
+    }
+    isoPathUseCluster(local,finder,index);
+    for(i=0;i<cluster->numNodes;++i){
+        isoPathSearchLocal(local,&cluster->nodeTiles[i],NULL,1,cluster->nodeTiles,cluster->numNodes,0);
+        for(j=0;j<cluster->numNodes;++j){
+            distances[i*cluster->numNodes + j] = local->cost[cluster->nodeTiles[j]];
+        }
+    }
+    cluster->distances = distances;
+    return 1;
+}
+
+static void isoPathReadCostsJob(void *data,int job)
+{
+    isoPathRebuildJobT *rebuildJob = data;
+
+    isoPathReadCosts(rebuildJob->finder,rebuildJob->clusters[job]);
+}
+
+static void isoPathBuildNodesJob(void *data,int job)
+{
+    isoPathRebuildJobT *rebuildJob = data;
+    isoPathLocalT *local = malloc(sizeof(isoPathLocalT));
+
+    if(local == NULL || isoPathBuildNodes(rebuildJob->finder,rebuildJob->clusters[job],local) == 0){
+        SDL_AtomicSet(&rebuildJob->failed,1);
+    }
+    free(local);
+}
+
+//Builds the clusters whose chunk has changed since they were built, and their neighbours, on the thread pool.
+//Everything is built the first time and after the cost table changed. A search isoPathUpdate had to leave unfinished
+//starts again, as the nodes it had got to may have changed. Returns the number of clusters built.
+int isoPathRebuild(isoPathFinderT *finder)
+{
+    int i,side;
+    int x,y;
+    int numClusters;
+    int numChanged = 0;
+    int numRebuilt = 0;
+    isoPathRebuildJobT job;
+
+    if(finder == NULL){
+        return 0;
+    }
+    numClusters = finder->numClustersX * finder->numClustersY;
+    for(i=0;i<numClusters;++i){
+        if(finder->costsChanged || finder->clusters[i].revision != finder->isoMap->chunkRevisions[i]){
+            finder->rebuild[i] = ISO_PATH_REBUILD_COSTS | ISO_PATH_REBUILD_NODES;
+            finder->rebuildList[numChanged++] = i;
+        }
+    }
+    finder->costsChanged = 0;
+    finder->numRebuilt = 0;
+    if(numChanged == 0){
+        return 0;
+    }
+    finder->graphRevision++;
+    finder->search.active = 0;
+    job.finder = finder;
+    job.clusters = finder->rebuildList;
+    SDL_AtomicSet(&job.failed,0);
+    threadPoolRun(finder->threadPool,isoPathReadCostsJob,&job,numChanged);
+
+    //the entrances of a changed cluster are also the ones of its neighbours
+    for(i=0;i<numChanged;++i){
+        x = finder->rebuildList[i] % finder->numClustersX;
+        y = finder->rebuildList[i] / finder->numClustersX;
+        for(side=0;side<4;++side){
+            if(x + isoPathStepX[side] >= 0 && x + isoPathStepX[side] < finder->numClustersX &&
+               y + isoPathStepY[side] >= 0 && y + isoPathStepY[side] < finder->numClustersY){
+                finder->rebuild[(y + isoPathStepY[side])*finder->numClustersX + x + isoPathStepX[side]] |= ISO_PATH_REBUILD_NODES;
+            }
+        }
+    }
+    for(i=0;i<numClusters;++i){
+        if(finder->rebuild[i]){
+            finder->rebuildList[numRebuilt++] = i;
+            finder->rebuild[i] = 0;
+        }
+    }
+    threadPoolRun(finder->threadPool,isoPathBuildNodesJob,&job,numRebuilt);
+    if(SDL_AtomicGet(&job.failed)){
+        writeToLog("Error in function: isoPathRebuild(...) - Could not allocate memory for the cluster nodes!","error.txt");
+    }
+    finder->numRebuilt = numRebuilt;
+    return numRebuilt;
+}
+
+//Returns 0 if the open list could not grow, the search can not go on without the node
+static int isoPathOpenPush(isoPathFinderT *finder,Uint32 estimate,Uint32 node)
+{
+    int i;
+    Uint64 entry = ((Uint64)estimate << 32) | node;
+    Uint64 *open;
+
+    if(finder->numOpen == finder->maxOpen){
+        open = realloc(finder->open,(finder->maxOpen == 0 ? 1024 : finder->maxOpen*2)*sizeof(Uint64));
+        if(open == NULL){
+            writeToLog("Error in function: isoPathOpenPush(...) - Could not allocate memory for the open list!","error.txt");
+            return 0;
+        }
+        finder->open = open;
+        finder->maxOpen = finder->maxOpen == 0 ? 1024 : finder->maxOpen*2;
+    }
+    i = finder->numOpen++;
+    while(i > 0 && finder->open[(i-1)/2] > entry){
+        finder->open[i] = finder->open[(i-1)/2];
+        i = (i-1)/2;
+    }
+    finder->open[i] = entry;
+    return 1;
+}
+
+static Uint32 isoPathOpenPop(isoPathFinderT *finder)
+{
+    int i = 0;
+    int child;
+    Uint64 top = finder->open[0];
+    Uint64 last = finder->open[--finder->numOpen];
+
+    for(;;){
+        child = 2*i+1;
+        if(child >= finder->numOpen){
+            break;
+        }
+        if(child+1 < finder->numOpen && finder->open[child+1] < finder->open[child]){
+            child++;
+        }
+        if(finder->open[child] >= last){
+            break;
+        }
+        finder->open[i] = finder->open[child];
+        i = child;
+    }
+    finder->open[i] = last;
+    return (Uint32)top;
+}
+
+//The map tile of a node
+static void isoPathGetNodeTile(isoPathFinderT *finder,Uint32 node,int *x,int *y)
+{
+    int cluster = node / ISO_PATH_MAX_CLUSTER_NODES;
+    int tile = finder->clusters[cluster].nodeTiles[node % ISO_PATH_MAX_CLUSTER_NODES];
+
+    *x = ((cluster % finder->numClustersX) << ISO_PATH_SHIFT) + (tile & ISO_PATH_MASK);
+    *y = ((cluster / finder->numClustersX) << ISO_PATH_SHIFT) + (tile >> ISO_PATH_SHIFT);
+}
+
+//Returns 0 if the node could not be put on the open list
+static int isoPathRelax(isoPathFinderT *finder,Uint32 node,Uint32 parent,Uint32 cost)
+{
+    int x,y;
+    isoPathSearchT *search = &finder->search;
+
+    if(cost == ISO_PATH_NO_PATH || finder->nodeClosed[node] == finder->searchNumber){
+        return 1;
+    }
+    if(finder->nodeVisited[node] == finder->searchNumber && finder->nodeCost[node] <= cost){
+        return 1;
+    }
+    finder->nodeVisited[node] = finder->searchNumber;
+    finder->nodeCost[node] = cost;
+    finder->nodeParent[node] = parent;
+    if(node == search->goalNode){
+        return isoPathOpenPush(finder,cost,node);
+    }
+    isoPathGetNodeTile(finder,node,&x,&y);
+    return isoPathOpenPush(finder,cost + isoPathHeuristic(x,y,search->goalX,search->goalY),node);
+}
+
+static int isoPathAddTile(isoPathFinderT *finder,int x,int y)
+{
+    SDL_Point *tiles;
+
+    if(finder->numTiles == finder->maxTiles){
+        tiles = realloc(finder->tiles,(finder->maxTiles == 0 ? 256 : finder->maxTiles*2)*sizeof(SDL_Point));
+        if(tiles == NULL){
+            return 0;
+        }
+        finder->tiles = tiles;
+        finder->maxTiles = finder->maxTiles == 0 ? 256 : finder->maxTiles*2;
+    }
+    finder->tiles[finder->numTiles].x = x;
+    finder->tiles[finder->numTiles].y = y;
+    finder->numTiles++;
+    return 1;
+}
+
+//Adds the tiles from fromX,fromY (left out, it is the last tile of the path so far) to toX,toY inside the cluster
+static int isoPathAddLocalPath(isoPathFinderT *finder,isoPathLocalT *local,int fromX,int fromY,int toX,int toY)
+{
+    int clusterX = fromX >> ISO_PATH_SHIFT;
+    int clusterY = fromY >> ISO_PATH_SHIFT;
+    int first = finder->numTiles;
+    int last;
+    Uint16 to = ((toY & ISO_PATH_MASK) << ISO_PATH_SHIFT) + (toX & ISO_PATH_MASK);
+    Uint16 from = ((fromY & ISO_PATH_MASK) << ISO_PATH_SHIFT) + (fromX & ISO_PATH_MASK);
+    int tile;
+    SDL_Point swap;
+
+    isoPathUseCluster(local,finder,clusterY*finder->numClustersX + clusterX);
+    if(isoPathSearchLocal(local,&from,NULL,1,&to,1,0) == 0){
+        return 0;
+    }
+    //the parents lead back from the end, the tiles are turned around afterwards
+    for(tile=to;local->parent[tile] != tile;tile=local->parent[tile]){
+        if(isoPathAddTile(finder,(clusterX << ISO_PATH_SHIFT) + (tile & ISO_PATH_MASK),(clusterY << ISO_PATH_SHIFT) + (tile >> ISO_PATH_SHIFT)) == 0){
+            return 0;
+        }
+    }
+    for(last=finder->numTiles-1;first<last;++first,--last){
+        swap = finder->tiles[first];
+        finder->tiles[first] = finder->tiles[last];
+        finder->tiles[last] = swap;
+    }
+    return 1;
+}
+
+//Fills in the tiles of the path found on the nodes: inside a cluster from node to node, across a border one step
+static int isoPathFillPath(isoPathFinderT *finder,isoPathLocalT *local)
+{
+    int x,y;
+    int tileX,tileY;
+    Uint32 node,next,previous;
+    isoPathSearchT *search = &finder->search;
+
+    //turn the parents around so they lead from the start to the goal
+    previous = search->goalNode;
+    node = search->goalNode;
+    for(;;){
+        next = finder->nodeParent[node];
+        finder->nodeParent[node] = previous;
+        if(node == search->startNode){
+            break;
+        }
+        previous = node;
+        node = next;
+    }
+    x = search->startX;
+    y = search->startY;
+    if(isoPathAddTile(finder,x,y) == 0){
+        return 0;
+    }
+    for(node=finder->nodeParent[search->startNode];node!=search->goalNode;node=finder->nodeParent[node]){
+        isoPathGetNodeTile(finder,node,&tileX,&tileY);
+        if((x >> ISO_PATH_SHIFT) == (tileX >> ISO_PATH_SHIFT) && (y >> ISO_PATH_SHIFT) == (tileY >> ISO_PATH_SHIFT)){
+            if((x != tileX || y != tileY) && isoPathAddLocalPath(finder,local,x,y,tileX,tileY) == 0){
+                return 0;
+            }
+        }
+        else if(isoPathAddTile(finder,tileX,tileY) == 0){
+            return 0;
+        }
+        x = tileX;
+        y = tileY;
+    }
+    if((x != search->goalX || y != search->goalY) && isoPathAddLocalPath(finder,local,x,y,search->goalX,search->goalY) == 0){
+        return 0;
+    }
+    return 1;
+}
+
+//Starts a search on the nodes, with the costs from the start to the nodes of its cluster and from the nodes of the
+//goal's cluster to the goal. Returns ISO_PATH_SEARCHING, or ISO_PATH_FOUND or ISO_PATH_NOT_FOUND if that is clear already.
+static int isoPathBeginSearch(isoPathFinderT *finder,int startX,int startY,int goalX,int goalY,isoPathLocalT *local)
+{
+    int k;
+    int ok = 1;
+    int startCluster;
+    int startReached,goalReached;
+    Uint32 direct = ISO_PATH_NO_PATH;
+    Uint16 startTile,goalTile;
+    isoPathClusterT *cluster;
+    isoPathSearchT *search = &finder->search;
+
+    search->active = 0;
+    finder->numTiles = 0;
+    finder->numExpanded = 0;
+    if(isoPathGetCost(finder,startX,startY) == ISO_PATH_BLOCKED || isoPathGetCost(finder,goalX,goalY) == ISO_PATH_BLOCKED){
+        return ISO_PATH_NOT_FOUND;
+    }
+    if(startX == goalX && startY == goalY){
+        return isoPathAddTile(finder,startX,startY) ? ISO_PATH_FOUND : ISO_PATH_NOT_FOUND;
+    }
+    search->startX = startX;
+    search->startY = startY;
+    search->goalX = goalX;
+    search->goalY = goalY;
+    search->startNode = (Uint32)(finder->numClustersX * finder->numClustersY)*ISO_PATH_MAX_CLUSTER_NODES;
+    search->goalNode = search->startNode+1;
+    startCluster = (startY >> ISO_PATH_SHIFT)*finder->numClustersX + (startX >> ISO_PATH_SHIFT);
+    search->goalCluster = (goalY >> ISO_PATH_SHIFT)*finder->numClustersX + (goalX >> ISO_PATH_SHIFT);
+    startTile = ((startY & ISO_PATH_MASK) << ISO_PATH_SHIFT) + (startX & ISO_PATH_MASK);
+    goalTile = ((goalY & ISO_PATH_MASK) << ISO_PATH_SHIFT) + (goalX & ISO_PATH_MASK);
+
+    finder->searchNumber++;
+    finder->numOpen = 0;
+    finder->nodeVisited[search->startNode] = finder->searchNumber;
+    finder->nodeCost[search->startNode] = 0;
+    finder->nodeParent[search->startNode] = search->startNode;
+
+    //from the start to the nodes of its cluster, and to the goal if it is in the same cluster
+    cluster = &finder->clusters[startCluster];
+    isoPathUseCluster(local,finder,startCluster);
+    if(startCluster == search->goalCluster){
+        isoPathSearchLocal(local,&startTile,NULL,1,&goalTile,1,0);
+        direct = local->cost[goalTile];
+        ok = isoPathRelax(finder,search->goalNode,search->startNode,direct);
+    }
+    startReached = isoPathSearchLocal(local,&startTile,NULL,1,cluster->nodeTiles,cluster->numNodes,0);
+    for(k=0;k<cluster->numNodes && ok;++k){
+        ok = isoPathRelax(finder,startCluster*ISO_PATH_MAX_CLUSTER_NODES + k,search->startNode,local->cost[cluster->nodeTiles[k]]);
+    }
+    if(!ok){
+        return ISO_PATH_NOT_FOUND;
+    }
+    //and from the nodes of the goal's cluster to the goal
+    cluster = &finder->clusters[search->goalCluster];
+    isoPathUseCluster(local,finder,search->goalCluster);
+    goalReached = isoPathSearchLocal(local,&goalTile,NULL,1,cluster->nodeTiles,cluster->numNodes,1);
+    for(k=0;k<cluster->numNodes;++k){
+        search->goalCosts[k] = local->cost[cluster->nodeTiles[k]];
+    }
+    //the start or the goal is shut in inside its cluster
+    if(direct == ISO_PATH_NO_PATH && (startReached == 0 || goalReached == 0)){
+        return ISO_PATH_NOT_FOUND;
+    }
+    search->active = 1;
+    return ISO_PATH_SEARCHING;
+}
+
+//Goes on with the search on the nodes until the goal is reached, there are no nodes left or the performance counter
+//passes deadline (0 for no deadline). The tiles of the path are filled in when it is found.
+static int isoPathContinueSearch(isoPathFinderT *finder,isoPathLocalT *local,Uint64 deadline)
+{
+    int k,side;
+    int x,y;
+    int ok = 1;
+    int cluster,neighbour;
+    Uint32 node,next,index;
+    isoPathClusterT *clusterData;
+    isoPathSearchT *search = &finder->search;
+
+    while(finder->numOpen > 0 && ok){
+        if(deadline != 0 && finder->numExpanded % ISO_PATH_CHECK_TIME == 0 && SDL_GetPerformanceCounter() > deadline){
+            return ISO_PATH_SEARCHING;
+        }
+        node = isoPathOpenPop(finder);
+        if(finder->nodeClosed[node] == finder->searchNumber){
+            continue;
+        }
+        finder->nodeClosed[node] = finder->searchNumber;
+        if(node == search->goalNode){
+            break;
+        }
+        finder->numExpanded++;
+        cluster = node / ISO_PATH_MAX_CLUSTER_NODES;
+        index = node % ISO_PATH_MAX_CLUSTER_NODES;
+        clusterData = &finder->clusters[cluster];
+
+        //to the other nodes of the cluster that can be reached inside it
+        for(k=0;k<clusterData->numNodes && ok;++k){
+            if(k != (int)index && clusterData->distances[index*clusterData->numNodes + k] != ISO_PATH_NO_PATH){
+                ok = isoPathRelax(finder,cluster*ISO_PATH_MAX_CLUSTER_NODES + k,node,
+                                  finder->nodeCost[node] + clusterData->distances[index*clusterData->numNodes + k]);
+            }
+        }
+        //across the border, to the node of the same entrance on the other side
+        for(side=0;side<4 && (int)index >= clusterData->sideStart[side] + clusterData->sideCount[side];++side);
+        neighbour = cluster + (side == ISO_PATH_UP ? -finder->numClustersX : side == ISO_PATH_DOWN ? finder->numClustersX : side == ISO_PATH_LEFT ? -1 : 1);
+        k = index - clusterData->sideStart[side];
+        if(ok && side < 4 && k < finder->clusters[neighbour].sideCount[(side+2)%4]){
+            next = neighbour*ISO_PATH_MAX_CLUSTER_NODES + finder->clusters[neighbour].sideStart[(side+2)%4] + k;
+            isoPathGetNodeTile(finder,next,&x,&y);
+            ok = isoPathRelax(finder,next,node,finder->nodeCost[node] + ISO_PATH_STRAIGHT*isoPathGetCost(finder,x,y));
+        }
+
+        if(ok && cluster == search->goalCluster && search->goalCosts[index] != ISO_PATH_NO_PATH){
+            ok = isoPathRelax(finder,search->goalNode,node,finder->nodeCost[node] + search->goalCosts[index]);
+        }
+    }
+    //a node that did not fit on the open list may have been on the only path, the search is given up
+    search->active = 0;
+    if(!ok || finder->nodeClosed[search->goalNode] != finder->searchNumber || isoPathFillPath(finder,local) == 0){
+        finder->numTiles = 0;
+        return ISO_PATH_NOT_FOUND;
+    }
+    return ISO_PATH_FOUND;
+}
+
+//Finds a path right away. The tiles of the path, from the start to the goal, stay valid until the next search.
+//Returns 1 if there is a path and 0 if there is none. isoPathRebuild has to have been called after the map changed.
+//A search isoPathUpdate had to leave unfinished starts again in the next isoPathUpdate.
+int isoPathFind(isoPathFinderT *finder,int startX,int startY,int goalX,int goalY,const SDL_Point **tiles,int *numTiles)
+{
+    int found;
+    isoPathLocalT *local;
+
+    if(tiles != NULL) *tiles = NULL;
+    if(numTiles != NULL) *numTiles = 0;
+    if(finder == NULL){
+        return 0;
+    }
+    local = malloc(sizeof(isoPathLocalT));
+    if(local == NULL){
+        writeToLog("Error in function: isoPathFind(...) - Could not allocate memory for the search!","error.txt");
+        return 0;
+    }
+    found = isoPathBeginSearch(finder,startX,startY,goalX,goalY,local);
+    if(found == ISO_PATH_SEARCHING){
+        found = isoPathContinueSearch(finder,local,0);
+    }
+    free(local);
+    if(found != ISO_PATH_FOUND){
+        finder->numTiles = 0;
+        return 0;
+    }
+    if(tiles != NULL) *tiles = finder->tiles;
+    if(numTiles != NULL) *numTiles = finder->numTiles;
+    return 1;
+}
+
+//Queues a path search for isoPathUpdate, which calls callback with the path. Returns 0 if it could not be queued.
+int isoPathRequest(isoPathFinderT *finder,int startX,int startY,int goalX,int goalY,isoPathCallbackT callback,void *data)
+{
+    int maxRequests;
+    isoPathRequestT *requests;
+    isoPathRequestT *request;
+
+    if(finder == NULL || callback == NULL){
+        writeToLog("Error in function: isoPathRequest(...) - Parameter finder or callback is NULL!","error.txt");
+        return 0;
+    }
+    //the handled requests at the front make room first
+    if(finder->firstRequest + finder->numRequests == finder->maxRequests && finder->firstRequest > 0){
+        memmove(finder->requests,&finder->requests[finder->firstRequest],finder->numRequests*sizeof(isoPathRequestT));
+        finder->firstRequest = 0;
+    }
+    if(finder->firstRequest + finder->numRequests == finder->maxRequests){
+        maxRequests = finder->maxRequests == 0 ? 64 : finder->maxRequests*2;
+        requests = realloc(finder->requests,maxRequests*sizeof(isoPathRequestT));
+        if(requests == NULL){
+            writeToLog("Error in function: isoPathRequest(...) - Could not allocate memory for the request!","error.txt");
+            return 0;
+        }
+        finder->requests = requests;
+        finder->maxRequests = maxRequests;
+    }
+    request = &finder->requests[finder->firstRequest + finder->numRequests++];
+    request->startX = startX;
+    request->startY = startY;
+    request->goalX = goalX;
+    request->goalY = goalY;
+    request->callback = callback;
+    request->data = data;
+    return 1;
+}
+
+//Drops the requests that have not been handled yet with this data, e.g. of a unit that is removed
+void isoPathCancelRequests(isoPathFinderT *finder,void *data)
+{
+    int i;
+    int numKept = 0;
+
+    if(finder == NULL){
+        return;
+    }
+    if(finder->numRequests > 0 && finder->requests[finder->firstRequest].data == data){
+        finder->search.active = 0;
+    }
+    for(i=0;i<finder->numRequests;++i){
+        if(finder->requests[finder->firstRequest + i].data != data){
+            finder->requests[finder->firstRequest + numKept++] = finder->requests[finder->firstRequest + i];
+        }
+    }
+    finder->numRequests = numKept;
+}
+
+//Once per frame: builds the clusters that changed, then searches the queued requests in order until budgetMs have
+//passed. A long search is left where it is when the time is up and goes on in the next call, so a frame never
+//waits much longer than budgetMs for the paths. Returns the number of requests handled.
+int isoPathUpdate(isoPathFinderT *finder,float budgetMs)
+{
+    int found;
+    int numHandled = 0;
+    Uint64 deadline = SDL_GetPerformanceCounter() + (Uint64)(budgetMs*SDL_GetPerformanceFrequency()/1000.0);
+    isoPathRequestT request;
+    isoPathLocalT *local;
+
+    if(finder == NULL){
+        return 0;
+    }
+    isoPathRebuild(finder);
+    if(finder->numRequests == 0){
+        return 0;
+    }
+    local = malloc(sizeof(isoPathLocalT));
+    if(local == NULL){
+        writeToLog("Error in function: isoPathUpdate(...) - Could not allocate memory for the search!","error.txt");
+        return 0;
+    }
+    while(finder->numRequests > 0 && SDL_GetPerformanceCounter() < deadline){
+        request = finder->requests[finder->firstRequest];
+        if(finder->search.active){
+            found = isoPathContinueSearch(finder,local,deadline);
+        }
+        else{
+            found = isoPathBeginSearch(finder,request.startX,request.startY,request.goalX,request.goalY,local);
+            if(found == ISO_PATH_SEARCHING){
+                found = isoPathContinueSearch(finder,local,deadline);
+            }
+        }
+        if(found == ISO_PATH_SEARCHING){
+            break;
+        }
+        //the callback may queue a new request
+        finder->firstRequest++;
+        finder->numRequests--;
+        if(finder->numRequests == 0){
+            finder->firstRequest = 0;
+        }
+        request.callback(request.data,found == ISO_PATH_FOUND,found == ISO_PATH_FOUND ? finder->tiles : NULL,
+                         found == ISO_PATH_FOUND ? finder->numTiles : 0);
+        numHandled++;
+    }
+    free(local);
+    return numHandled;
+}
+
+//The way from a tile to its neighbour in one of the 8 directions, ISO_PATH_UP to ISO_PATH_LEFT and then the diagonals
+void isoPathGetStep(int step,int *dx,int *dy)
+{
+    *dx = step >= 0 && step < 8 ? isoPathStepX[step] : 0;
+    *dy = step >= 0 && step < 8 ? isoPathStepY[step] : 0;
+}
+
+//Works out for every tile of a cluster the cheapest way to one of the seed tiles, where getting to a seed costs
+//seedCosts more, as of the last isoPathRebuild. The seeds have to be sorted by their cost. integration gets the cost of
+//every tile, ISO_PATH_NO_PATH if no seed can be reached from it, and steps the step it takes on the way: the seeds that
+//are not cheaper to get to through another seed get ISO_PATH_SEED_STEP and the tiles without a way ISO_PATH_NO_STEP.
+//Both take ISO_PATH_CLUSTER_TILES, by localY*ISO_PATH_CLUSTER_SIZE + localX. Returns 0 if there was no memory.
+int isoPathIntegrate(isoPathFinderT *finder,int cluster,const Uint16 *seeds,const Uint32 *seedCosts,int numSeeds,Uint32 *integration,Uint8 *steps)
+{
+    int tile;
+    int step;
+    int dx,dy;
+    isoPathLocalT *local;
+
+    if(finder == NULL || cluster < 0 || cluster >= finder->numClustersX * finder->numClustersY){
+        writeToLog("Error in function: isoPathIntegrate(...) - Parameter finder is NULL or there is no such cluster!","error.txt");
+        return 0;
+    }
+    local = malloc(sizeof(isoPathLocalT));
+    if(local == NULL){
+        writeToLog("Error in function: isoPathIntegrate(...) - Could not allocate memory for the search!","error.txt");
+        return 0;
+    }
+    isoPathUseCluster(local,finder,cluster);
+    isoPathSearchLocal(local,seeds,seedCosts,numSeeds,NULL,0,1);
+    for(tile=0;tile<ISO_PATH_CLUSTER_TILES;++tile){
+        integration[tile] = local->cost[tile];
+        if(local->cost[tile] == ISO_PATH_NO_PATH){
+            steps[tile] = ISO_PATH_NO_STEP;
+            continue;
+        }
+        if(local->parent[tile] == tile){
+            steps[tile] = ISO_PATH_SEED_STEP;
+            continue;
+        }
+        dx = (local->parent[tile] & ISO_PATH_MASK) - (tile & ISO_PATH_MASK);
+        dy = (local->parent[tile] >> ISO_PATH_SHIFT) - (tile >> ISO_PATH_SHIFT);
+        for(step=0;step<8 && (isoPathStepX[step] != dx || isoPathStepY[step] != dy);++step);
+        steps[tile] = step;
+    }
+    free(local);
+    return 1;
+}
@@ -0,0 +1,128 @@
+#ifndef __ISO_PATH_H_
+#define __ISO_PATH_H_
+
+#include <SDL2/SDL.h>
+#include "isoMap.h"
+#include "../threadPool.h"
+
+//Hierarchical pathfinding (HPA*) over the tiles of a map. The clusters are the map chunks: the tiles on both sides of
+//a cluster border where both are walkable form an entrance, and every entrance gets a node in both clusters. The
+//cheapest paths between the nodes of a cluster are worked out when the cluster is built, so a path is first searched
+//on the nodes and then filled in tile by tile inside one cluster at a time. A cluster is built again when the
+//revision of its chunk changes (isoMapSetTile), together with its neighbours, which share its entrances.
+//Units move to the 8 neighbouring tiles, diagonally only if both tiles beside the corner are walkable.
+#define ISO_PATH_CLUSTER_SIZE       MAP_CHUNK_SIZE
+#define ISO_PATH_CLUSTER_TILES      MAP_CHUNK_NUM_TILES
+#define ISO_PATH_MAX_SIDE_NODES     16      //an entrance beyond this on one side of a cluster is left out
+#define ISO_PATH_MAX_CLUSTER_NODES  (4*ISO_PATH_MAX_SIDE_NODES)
+#define ISO_PATH_LONG_ENTRANCE      6       //an entrance this wide gets a node at both ends instead of one in the middle
+
+//The cost table: what it costs to step onto a tile, by tile value. 0 can not be walked on.
+//Tiles of the layers above the ground that are MAP_EMPTY_TILE do not count, otherwise the highest cost counts.
+#define ISO_PATH_BLOCKED            0
+#define ISO_PATH_DEFAULT_COST       1
+#define ISO_PATH_MAX_TILE_VALUES    1024    //tile values with a cost of their own, all others cost ISO_PATH_DEFAULT_COST
+#define ISO_PATH_STRAIGHT           10      //a step times the cost of the tile it goes to
+#define ISO_PATH_DIAGONAL           14
+#define ISO_PATH_NO_PATH            0xffffffff
+
+#define ISO_PATH_UP     0
+#define ISO_PATH_RIGHT  1
+#define ISO_PATH_DOWN   2
+#define ISO_PATH_LEFT   3
+
+//The steps isoPathIntegrate finds besides the 8 directions
+#define ISO_PATH_SEED_STEP  8
+#define ISO_PATH_NO_STEP    0xff
+
+//Called by isoPathUpdate with the tiles of the path from the start to the goal, both included.
+//found is 0 and there are no tiles if there is no path. The tiles are only valid during the call.
+typedef void (*isoPathCallbackT)(void *data,int found,const SDL_Point *tiles,int numTiles);
+
+typedef struct isoPathClusterT
+{
+    Uint32 revision;            //the chunk revision the costs were read at
+    Uint32 costsRevision;       //the graphRevision the costs were read at
+    int numNodes;
+    Uint8 sideStart[4];         //the nodes of each side, ISO_PATH_UP to ISO_PATH_LEFT, in the order of their entrances
+    Uint8 sideCount[4];
+    Uint16 nodeTiles[ISO_PATH_MAX_CLUSTER_NODES];   //localY*ISO_PATH_CLUSTER_SIZE + localX
+    Uint32 *distances;          //numNodes x numNodes, the cost from node i to node j inside the cluster
+}isoPathClusterT;
+
+//The path isoPathUpdate is searching on the nodes. When its time is up the search goes on in the next isoPathUpdate.
+typedef struct isoPathSearchT
+{
+    int active;
+    int startX;
+    int startY;
+    int goalX;
+    int goalY;
+    int goalCluster;
+    Uint32 startNode;
+    Uint32 goalNode;
+    Uint32 goalCosts[ISO_PATH_MAX_CLUSTER_NODES];   //from the nodes of the goal's cluster to the goal
+}isoPathSearchT;
+
+typedef struct isoPathRequestT
+{
+    int startX;
+    int startY;
+    int goalX;
+    int goalY;
+    isoPathCallbackT callback;
+    void *data;
+}isoPathRequestT;
+
+typedef struct isoPathFinderT
+{
+    isoMapT *isoMap;
+    threadPoolT *threadPool;
+    Uint8 tileCosts[ISO_PATH_MAX_TILE_VALUES];
+    int costsChanged;           //the cost table has changed, every cluster has to be built again
+    int numClustersX;
+    int numClustersY;
+    isoPathClusterT *clusters;
+    Uint8 *costs;               //the cost of every tile, ISO_PATH_CLUSTER_TILES per cluster, 0 outside the map
+    Uint8 *moves;               //a bit for every step that can be taken from the tile without leaving its cluster
+    Uint8 *rebuild;             //per cluster, what the next isoPathRebuild does with it
+    int *rebuildList;
+    Uint32 graphRevision;       //goes up whenever isoPathRebuild builds clusters
+
+    //the search on the nodes, indexed by cluster*ISO_PATH_MAX_CLUSTER_NODES + node, then the start and the goal
+    Uint32 *nodeCost;
+    Uint32 *nodeParent;
+    Uint32 *nodeVisited;        //nodeCost and nodeParent are only set for nodes with the current search number
+    Uint32 *nodeClosed;
+    Uint32 searchNumber;
+    isoPathSearchT search;
+    Uint64 *open;               //a binary heap of estimate << 32 | node
+    int numOpen;
+    int maxOpen;
+
+    SDL_Point *tiles;           //the last path that was found
+    int numTiles;
+    int maxTiles;
+
+    isoPathRequestT *requests;
+    int firstRequest;
+    int numRequests;
+    int maxRequests;
+
+    int numRebuilt;             //the clusters the last isoPathRebuild built
+    int numExpanded;            //the nodes the last path search expanded
+}isoPathFinderT;
+
+isoPathFinderT *isoPathNew(isoMapT *isoMap,threadPoolT *threadPool);
+void isoPathFree(isoPathFinderT *finder);
+void isoPathSetTileCost(isoPathFinderT *finder,int tile,int cost);
+int isoPathGetCost(isoPathFinderT *finder,int x,int y);
+int isoPathRebuild(isoPathFinderT *finder);
+int isoPathFind(isoPathFinderT *finder,int startX,int startY,int goalX,int goalY,const SDL_Point **tiles,int *numTiles);
+int isoPathRequest(isoPathFinderT *finder,int startX,int startY,int goalX,int goalY,isoPathCallbackT callback,void *data);
+void isoPathCancelRequests(isoPathFinderT *finder,void *data);
+int isoPathUpdate(isoPathFinderT *finder,float budgetMs);
+void isoPathGetStep(int step,int *dx,int *dy);
+int isoPathIntegrate(isoPathFinderT *finder,int cluster,const Uint16 *seeds,const Uint32 *seedCosts,int numSeeds,Uint32 *integration,Uint8 *steps);
+
+#endif // __ISO_PATH_H_
@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "isoEngine.h"
+#include "isoRenderCache.h"
+#include "../renderer.h"
+#include "../texture.h"
+#include "../logger.h"
+
+static isoRenderCacheEntryT *isoRenderCacheGetEntry(isoRenderCacheT *cache,int blockX,int blockY,float zoomLevel,int width,int height);
+static void isoRenderCacheRemoveEntry(isoRenderCacheT *cache,int index);
+static void isoRenderCacheBatchBlock(isoRenderCacheT *cache,isoEngineT *isoEngine,int blockX,int blockY,int baseX,int baseY,int shiftX,int shiftY,int offsetX);
+static int isoRenderCacheIsBlockVisible(isoVisibleRangeT *range,int blockX,int blockY);
+
+isoRenderCacheT *isoRenderCacheNew(size_t memoryBudget)
+{
+    isoRenderCacheT *cache = malloc(sizeof(struct isoRenderCacheT));
+
+    if(cache == NULL){
+        writeToLog("Error in isoRenderCacheNew(...): Could not allocate memory for the render cache!","error.txt");
+        return NULL;
+    }
+    cache->numEntries = 0;
+    cache->maxEntries = 0;
+    cache->memoryUsed = 0;
+    cache->memoryBudget = memoryBudget > 0 ? memoryBudget : ISO_RENDER_CACHE_DEFAULT_BUDGET;
+    cache->frame = 0;
+    cache->isoMap = NULL;
+    cache->entries = NULL;
+    textureBatchInit(&cache->batch);
+
+    return cache;
+}
+
+void isoRenderCacheFree(isoRenderCacheT *cache)
+{
+    if(cache != NULL)
+    {
+        isoRenderCacheClear(cache);
+        if(cache->entries != NULL){
+            free(cache->entries);
+        }
+        textureBatchFree(&cache->batch);
+        free(cache);
+    }
+}
+
+//Throw away all cached blocks, for example when the renderer has lost its render targets
+void isoRenderCacheClear(isoRenderCacheT *cache)
+{
+    if(cache == NULL){
+        return;
+    }
+    while(cache->numEntries>0){
+        isoRenderCacheRemoveEntry(cache,cache->numEntries-1);
+    }
+}
+
+void isoRenderCacheSetBudget(isoRenderCacheT *cache,size_t memoryBudget)
+{
+    int i,lru;
+
+    if(cache == NULL){
+        return;
+    }
+    cache->memoryBudget = memoryBudget > 0 ? memoryBudget : ISO_RENDER_CACHE_DEFAULT_BUDGET;
+
+    //evict the least recently used blocks until we are inside the new budget
+    while(cache->memoryUsed > cache->memoryBudget && cache->numEntries>0){
+        lru = 0;
+        for(i=1;i<cache->numEntries;++i){
+            if(cache->entries[i].lastUsed < cache->entries[lru].lastUsed){
+                lru = i;
+            }
+        }
+        isoRenderCacheRemoveEntry(cache,lru);
+    }
+}
+
+//Draws the blocks covering the visible tiles of the ground layer.
+//Returns 0 if the renderer can not render to textures, the caller has to draw the tiles itself.
+int isoRenderCacheDrawMap(isoRenderCacheT *cache,isoEngineT *isoEngine,isoVisibleRangeT *range)
+{
+    int i;
+    int blockX,blockY;
+    int width,height,offsetX;
+    int clipW = 0,clipH = 0;
+    float zoomLevel = isoEngine->zoomLevel;
+    float tileSize = isoEngine->isoMap->tileSize;
+    isoMapT *isoMap = isoEngine->isoMap;
+    isoRenderCacheEntryT *entry;
+    SDL_Texture *target;
+    SDL_Rect quad;
+    SDL_Rect clip;
+    point2DT point;
+    Uint32 revision;
+
+    if(cache == NULL || isoMap->tileSet == NULL || isoMap->tileSet->tileClipRects == NULL){
+        return 0;
+    }
+    //the placeholder of a tile set that is still loading is not worth caching
+    if(textureIsLoaded(isoMap->tileSet->tilesTex) == 0){
+        return 0;
+    }
+    if(range->startY > range->endY){
+        return 1;
+    }
+    if(SDL_RenderTargetSupported(getRenderer()) == SDL_FALSE){
+        return 0;
+    }
+    //blocks of another map are of no use
+    if(cache->isoMap != isoMap){
+        isoRenderCacheClear(cache);
+        cache->isoMap = isoMap;
+    }
+    cache->frame++;
+
+    //all blocks at this zoom level have the same size
+    for(i=0;i<isoMap->tileSet->numTileClipRects;++i){
+        if(isoMap->tileSet->tileClipRects[i].w > clipW) clipW = isoMap->tileSet->tileClipRects[i].w;
+        if(isoMap->tileSet->tileClipRects[i].h > clipH) clipH = isoMap->tileSet->tileClipRects[i].h;
+    }
+    offsetX = (int)ceil((ISO_RENDER_CACHE_BLOCK_SIZE-1)*tileSize*zoomLevel);
+    width = offsetX + (int)((ISO_RENDER_CACHE_BLOCK_SIZE-1)*tileSize*zoomLevel) + (int)(clipW*zoomLevel) + 2;
+    height = (int)((ISO_RENDER_CACHE_BLOCK_SIZE-1)*tileSize*zoomLevel) + (int)(clipH*zoomLevel) + 2;
+
+    //blocks are drawn back to front, like the tiles
+    for(blockY=range->startY>>ISO_RENDER_CACHE_BLOCK_SHIFT;blockY<=range->endY>>ISO_RENDER_CACHE_BLOCK_SHIFT;++blockY){
+        for(blockX=range->minX>>ISO_RENDER_CACHE_BLOCK_SHIFT;blockX<=range->maxX>>ISO_RENDER_CACHE_BLOCK_SHIFT;++blockX){
+
+            if(isoRenderCacheIsBlockVisible(range,blockX,blockY)==0){
+                continue;
+            }
+            entry = isoRenderCacheGetEntry(cache,blockX,blockY,zoomLevel,width,height);
+
+            //the budget is used up by blocks already on the screen, draw this block tile by tile
+            if(entry == NULL){
+                textureBatchBegin(&cache->batch,isoMap->tileSet->tilesTex);
+                isoRenderCacheBatchBlock(cache,isoEngine,blockX,blockY,0,0,isoEngine->scrollX,isoEngine->scrollY,0);
+                textureBatchDraw(&cache->batch);
+                continue;
+            }
+
+            revision = isoMapGetChunkRevision(isoMap,blockX>>(MAP_CHUNK_SHIFT-ISO_RENDER_CACHE_BLOCK_SHIFT),
+                                              blockY>>(MAP_CHUNK_SHIFT-ISO_RENDER_CACHE_BLOCK_SHIFT));
+
+            //(re)draw the block into its texture when it is new or the chunk has changed since
+            if(entry->revision != revision){
+                target = SDL_GetRenderTarget(getRenderer());
+                SDL_RenderGetClipRect(getRenderer(),&clip);
+                SDL_SetRenderTarget(getRenderer(),entry->texture);
+                SDL_SetRenderDrawColor(getRenderer(),0x00,0x00,0x00,0x00);
+                SDL_RenderClear(getRenderer());
+
+                textureBatchBegin(&cache->batch,isoMap->tileSet->tilesTex);
+                isoRenderCacheBatchBlock(cache,isoEngine,blockX,blockY,blockX<<ISO_RENDER_CACHE_BLOCK_SHIFT,
+                                         blockY<<ISO_RENDER_CACHE_BLOCK_SHIFT,0,0,offsetX);
+                textureBatchDraw(&cache->batch);
+
+                SDL_SetRenderTarget(getRenderer(),target);
+                //switching back to a texture target forgets the clip rectangle (see isoDamageBeginFrame)
+                if(SDL_RectEmpty(&clip) == SDL_FALSE){
+                    SDL_RenderSetClipRect(getRenderer(),&clip);
+                }
+                entry->revision = revision;
+            }
+
+            //the top corner of the block is where its first tile would be drawn
+            point.x = (((blockX<<ISO_RENDER_CACHE_BLOCK_SHIFT)*zoomLevel*tileSize) + isoEngine->scrollX);
+            point.y = (((blockY<<ISO_RENDER_CACHE_BLOCK_SHIFT)*zoomLevel*tileSize) + isoEngine->scrollY);
+            isoEngineConvert2dToIso(&point);
+            setupRect(&quad,(int)point.x-offsetX,(int)point.y,entry->width,entry->height);
+
+            SDL_RenderCopy(getRenderer(),entry->texture,NULL,&quad);
+            countDrawCall();
+        }
+    }
+    return 1;
+}
+
+static isoRenderCacheEntryT *isoRenderCacheGetEntry(isoRenderCacheT *cache,int blockX,int blockY,float zoomLevel,int width,int height)
+{
+    int i,lru;
+    size_t size = (size_t)width*height*4;
+    isoRenderCacheEntryT *entry = NULL;
+    isoRenderCacheEntryT *entries;
+
+    for(i=0;i<cache->numEntries;++i){
+        if(cache->entries[i].blockX == blockX && cache->entries[i].blockY == blockY && cache->entries[i].zoomLevel == zoomLevel){
+            //the tile set has changed size, draw the block again
+            if(cache->entries[i].width != width || cache->entries[i].height != height){
+                isoRenderCacheRemoveEntry(cache,i);
+                break;
+            }
+            cache->entries[i].lastUsed = cache->frame;
+            return &cache->entries[i];
+        }
+    }
+
+    //make room by evicting the least recently used blocks, but never one that is on the screen this frame
+    while(cache->memoryUsed + size > cache->memoryBudget){
+        lru = -1;
+        for(i=0;i<cache->numEntries;++i){
+            if(cache->entries[i].lastUsed != cache->frame && (lru == -1 || cache->entries[i].lastUsed < cache->entries[lru].lastUsed)){
+                lru = i;
+            }
+        }
+        if(lru == -1){
+            return NULL;
+        }
+        //a block of the same size can take over the texture
+        if(cache->entries[lru].width == width && cache->entries[lru].height == height){
+            entry = &cache->entries[lru];
+            break;
+        }
+        isoRenderCacheRemoveEntry(cache,lru);
+    }
+
+    if(entry == NULL){
+        if(cache->numEntries == cache->maxEntries){
+            entries = realloc(cache->entries,(cache->maxEntries+32)*sizeof(isoRenderCacheEntryT));
+            if(entries == NULL){
+                writeToLog("Error in isoRenderCacheGetEntry(...): Could not allocate memory for render cache entries!","error.txt");
+                return NULL;
+            }
+            cache->entries = entries;
+            cache->maxEntries += 32;
+        }
+        entry = &cache->entries[cache->numEntries];
+        entry->texture = SDL_CreateTexture(getRenderer(),SDL_PIXELFORMAT_ARGB8888,SDL_TEXTUREACCESS_TARGET,width,height);
+        if(entry->texture == NULL){
+            writeToLog("Error in isoRenderCacheGetEntry(...): Could not create render target texture!","error.txt");
+            return NULL;
+        }
+        //the tile set only has fully transparent or fully opaque pixels and is scaled without filtering,
+        //so blending the finished block gives the same result as blending its tiles one by one
+        SDL_SetTextureBlendMode(entry->texture,SDL_BLENDMODE_BLEND);
+        entry->width = width;
+        entry->height = height;
+        cache->memoryUsed += size;
+        cache->numEntries++;
+    }
+    entry->blockX = blockX;
+    entry->blockY = blockY;
+    entry->zoomLevel = zoomLevel;
+    entry->lastUsed = cache->frame;
+    //a revision the map never has yet, so the block gets drawn
+    entry->revision = isoMapGetChunkRevision(cache->isoMap,blockX>>(MAP_CHUNK_SHIFT-ISO_RENDER_CACHE_BLOCK_SHIFT),
+                                             blockY>>(MAP_CHUNK_SHIFT-ISO_RENDER_CACHE_BLOCK_SHIFT))-1;
+    return entry;
+}
+
+static void isoRenderCacheRemoveEntry(isoRenderCacheT *cache,int index)
+{
+    isoRenderCacheEntryT *entry = &cache->entries[index];
+
+    if(entry->texture != NULL){
+        SDL_DestroyTexture(entry->texture);
+    }
+    cache->memoryUsed -= (size_t)entry->width*entry->height*4;
+
+    //move the last entry into the free slot
+    cache->numEntries--;
+    if(index != cache->numEntries){
+        cache->entries[index] = cache->entries[cache->numEntries];
+    }
+}
+
+//Adds the ground tiles of a block to the batch.
+//baseX/baseY is the map position drawn at shiftX/shiftY, offsetX moves the tiles right after the iso conversion.
+static void isoRenderCacheBatchBlock(isoRenderCacheT *cache,isoEngineT *isoEngine,int blockX,int blockY,int baseX,int baseY,int shiftX,int shiftY,int offsetX)
+{
+    int x,y;
+    int tile;
+    int startX = blockX<<ISO_RENDER_CACHE_BLOCK_SHIFT;
+    int startY = blockY<<ISO_RENDER_CACHE_BLOCK_SHIFT;
+    int endX = SDL_min(startX+ISO_RENDER_CACHE_BLOCK_SIZE,isoEngine->isoMap->mapWidth);
+    int endY = SDL_min(startY+ISO_RENDER_CACHE_BLOCK_SIZE,isoEngine->isoMap->mapHeight);
+    isoMapChunkT *chunkData = isoMapGetChunk(isoEngine->isoMap,startX>>MAP_CHUNK_SHIFT,startY>>MAP_CHUNK_SHIFT,0);
+    int rowData[MAP_CHUNK_SIZE];
+    point2DT point;
+    SDL_Point *quadSizes = isoMapGetTileQuadSizes(isoEngine->isoMap,isoEngine->zoomLevel);
+
+    if(chunkData == NULL || quadSizes == NULL){
+        return;
+    }
+    for(y=startY;y<endY;++y){
+        isoMapChunkGetRow(chunkData,y&MAP_CHUNK_MASK,rowData);
+
+        for(x=startX;x<endX;++x){
+            tile = rowData[x&MAP_CHUNK_MASK];
+            point.x = (((x-baseX)*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + shiftX);
+            point.y = (((y-baseY)*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + shiftY);
+            isoEngineConvert2dToIso(&point);
+            textureBatchAddXYClipSize(&cache->batch,(int)point.x+offsetX,point.y,
+                                      &isoEngine->isoMap->tileSet->tileClipRects[tile],&quadSizes[tile]);
+        }
+    }
+}
+
+//A block is visible when one of its rows has visible tiles inside the block
+static int isoRenderCacheIsBlockVisible(isoVisibleRangeT *range,int blockX,int blockY)
+{
+    int y;
+    int startX = blockX<<ISO_RENDER_CACHE_BLOCK_SHIFT;
+    int endX = startX+ISO_RENDER_CACHE_BLOCK_SIZE-1;
+    int startY = SDL_max(blockY<<ISO_RENDER_CACHE_BLOCK_SHIFT,range->startY);
+    int endY = SDL_min((blockY<<ISO_RENDER_CACHE_BLOCK_SHIFT)+ISO_RENDER_CACHE_BLOCK_SIZE-1,range->endY);
+
+    for(y=startY;y<=endY;++y){
+        if(range->spanStartX[y-range->startY]<=endX && range->spanEndX[y-range->startY]>=startX &&
+           range->spanStartX[y-range->startY]<=range->spanEndX[y-range->startY]){
+            return 1;
+        }
+    }
+    return 0;
+}
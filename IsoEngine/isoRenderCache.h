@@ -0,0 +1,47 @@
+#ifndef __ISO_RENDER_CACHE_H_
+#define __ISO_RENDER_CACHE_H_
+
+#include <SDL2/SDL.h>
+#include "../texture.h"
+#include "isoMap.h"
+
+//The map is cached in blocks of ISO_RENDER_CACHE_BLOCK_SIZE x ISO_RENDER_CACHE_BLOCK_SIZE tiles.
+//A block always lies inside one map chunk, so the chunk revision tells when it has to be redrawn.
+#define ISO_RENDER_CACHE_BLOCK_SHIFT    3
+#define ISO_RENDER_CACHE_BLOCK_SIZE     (1<<ISO_RENDER_CACHE_BLOCK_SHIFT)
+#define ISO_RENDER_CACHE_DEFAULT_BUDGET (64*1024*1024)
+
+struct isoEngineT;
+struct isoVisibleRangeT;
+
+typedef struct isoRenderCacheEntryT
+{
+    int blockX;
+    int blockY;
+    float zoomLevel;
+    Uint32 revision;
+    Uint32 lastUsed;
+    int width;
+    int height;
+    SDL_Texture *texture;
+}isoRenderCacheEntryT;
+
+typedef struct isoRenderCacheT
+{
+    int numEntries;
+    int maxEntries;
+    size_t memoryUsed;
+    size_t memoryBudget;
+    Uint32 frame;
+    isoMapT *isoMap;
+    isoRenderCacheEntryT *entries;
+    textureBatchT batch;
+}isoRenderCacheT;
+
+isoRenderCacheT *isoRenderCacheNew(size_t memoryBudget);
+void isoRenderCacheFree(isoRenderCacheT *cache);
+void isoRenderCacheClear(isoRenderCacheT *cache);
+void isoRenderCacheSetBudget(isoRenderCacheT *cache,size_t memoryBudget);
+int isoRenderCacheDrawMap(isoRenderCacheT *cache,struct isoEngineT *isoEngine,struct isoVisibleRangeT *range);
+
+#endif // __ISO_RENDER_CACHE_H_
@@ -0,0 +1,340 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "isoRenderQueue.h"
+#include "../logger.h"
+
+isoRenderQueueT *isoRenderQueueNew()
+{
+    isoRenderQueueT *queue = calloc(1,sizeof(struct isoRenderQueueT));
+
+    if(queue == NULL){
+        writeToLog("Error in isoRenderQueueNew(...): Could not allocate memory for the render queue!","error.txt");
+        return NULL;
+    }
+    //calloc has set all the arrays to NULL and all the counts to 0
+    queue->allowTouchUp = 1;
+    textureBatchInit(&queue->batch);
+    return queue;
+}
+
+void isoRenderQueueFree(isoRenderQueueT *queue)
+{
+    if(queue == NULL){
+        return;
+    }
+    free(queue->keys);
+    free(queue->lastKeys);
+    free(queue->textures);
+    free(queue->srcRects);
+    free(queue->dstRects);
+    free(queue->order);
+    free(queue->scratch);
+    free(queue->changedItems);
+    free(queue->changed);
+    textureBatchFree(&queue->batch);
+    free(queue);
+}
+
+//Starts a new frame. The order and the keys of the last frame are kept for isoRenderQueueSort.
+void isoRenderQueueBegin(isoRenderQueueT *queue)
+{
+    Uint32 *keys;
+
+    if(queue == NULL){
+        return;
+    }
+    keys = queue->lastKeys;
+    queue->lastKeys = queue->keys;
+    queue->keys = keys;
+    queue->lastNumOrdered = queue->numOrdered;
+    queue->numOrdered = 0;
+    queue->numChanged = 0;
+    queue->numItems = 0;
+    queue->numTextures = 0;
+    queue->keysOr = 0;
+    queue->keysAnd = 0xffffffff;
+}
+
+static int isoRenderQueueGrowArray(void **array,size_t size,int count)
+{
+    void *grown = realloc(*array,size*count);
+
+    if(grown == NULL){
+        return 0;
+    }
+    *array = grown;
+    return 1;
+}
+
+static int isoRenderQueueGrow(isoRenderQueueT *queue)
+{
+    int maxItems = queue->maxItems == 0 ? 4096 : queue->maxItems*2;
+
+    if(isoRenderQueueGrowArray((void**)&queue->keys,sizeof(Uint32),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->lastKeys,sizeof(Uint32),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->textures,sizeof(Uint8),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->srcRects,sizeof(SDL_Rect),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->dstRects,sizeof(SDL_Rect),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->order,sizeof(Uint64),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->scratch,sizeof(Uint64),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->changedItems,sizeof(Uint32),maxItems) == 0 ||
+       isoRenderQueueGrowArray((void**)&queue->changed,sizeof(Uint64),maxItems) == 0){
+        return 0;
+    }
+    queue->maxItems = maxItems;
+    return 1;
+}
+
+//The index of the texture in the texture table. A frame uses a few textures, and mostly the one of the quad before.
+static int isoRenderQueueGetTexture(isoRenderQueueT *queue,textureT *texture)
+{
+    int i;
+
+    if(queue->numItems > 0 && queue->textureTable[queue->textures[queue->numItems-1]] == texture){
+        return queue->textures[queue->numItems-1];
+    }
+    for(i=0;i<queue->numTextures;++i){
+        if(queue->textureTable[i] == texture){
+            return i;
+        }
+    }
+    if(queue->numTextures == ISO_RENDER_QUEUE_MAX_TEXTURES){
+        return -1;
+    }
+    queue->textureTable[queue->numTextures] = texture;
+    return queue->numTextures++;
+}
+
+//Adds a quad of srcRect from the texture, drawn at x,y in size, see ISO_RENDER_QUEUE_KEY for the key
+void isoRenderQueueAdd(isoRenderQueueT *queue,Uint32 key,textureT *texture,SDL_Rect *srcRect,int x,int y,SDL_Point *size)
+{
+    int i;
+    int textureIndex;
+    char msg[200];
+
+    if(queue == NULL || texture == NULL || srcRect == NULL){
+        return;
+    }
+    if(queue->numItems == queue->maxItems && isoRenderQueueGrow(queue) == 0){
+        sprintf(msg,"Error in function isoRenderQueueAdd(...) - Could not allocate memory for %d quads!",queue->maxItems*2);
+        writeToLog(msg,"error.txt");
+        return;
+    }
+    textureIndex = isoRenderQueueGetTexture(queue,texture);
+    if(textureIndex < 0){
+        writeToLog("Error in function isoRenderQueueAdd(...) - The frame has ISO_RENDER_QUEUE_MAX_TEXTURES textures already!","error.txt");
+        return;
+    }
+    i = queue->numItems++;
+    //the keys are compared while they stream in, so the sort only has to look at the ones that changed
+    if(i < queue->lastNumOrdered && key != queue->lastKeys[i]){
+        queue->changedItems[queue->numChanged++] = i;
+    }
+    queue->keys[i] = key;
+    queue->keysOr |= key;
+    queue->keysAnd &= key;
+    queue->textures[i] = textureIndex;
+    queue->srcRects[i] = *srcRect;
+    textureGetQuadXYClipSize(x,y,size,&queue->dstRects[i]);
+}
+
+//Stable LSD radix sort of count entries (key << 32 | quad) by key. Only the bits that differ between the keys are
+//sorted by, in as few passes of at most ISO_RENDER_QUEUE_RADIX_BITS as possible. The histograms of all passes are
+//counted in one go. With keys the entries are made from keys[0] to keys[count-1] by the first pass, and entries
+//is only written to. Returns entries or scratch, whichever the sorted entries ended up in.
+static Uint64 *isoRenderQueueRadixSort(Uint64 *entries,Uint64 *scratch,int count,const Uint32 *keys,Uint32 differ)
+{
+    int i,pass;
+    int lowBit,numBits,numPasses,digitBits;
+    int shift;
+    Uint32 mask;
+    Uint32 key;
+    Uint32 sum,digitCount;
+    Uint32 histograms[ISO_RENDER_QUEUE_RADIX_PASSES][ISO_RENDER_QUEUE_RADIX_SIZE];
+    Uint32 *histogram;
+    Uint64 *source = scratch;
+    Uint64 *destination = entries;
+    Uint64 *swap;
+
+    if(differ == 0){
+        for(i=0;keys != NULL && i<count;++i){
+            entries[i] = ((Uint64)keys[i] << 32) | (Uint32)i;
+        }
+        return entries;
+    }
+    for(lowBit=0;!(differ & (1u << lowBit));++lowBit);
+    for(numBits=32-lowBit;!(differ & (1u << (lowBit+numBits-1)));--numBits);
+    numPasses = (numBits + ISO_RENDER_QUEUE_RADIX_BITS-1)/ISO_RENDER_QUEUE_RADIX_BITS;
+    digitBits = (numBits + numPasses-1)/numPasses;
+    mask = (1u << digitBits)-1;
+
+    memset(histograms,0,sizeof(histograms));
+    for(i=0;i<count;++i){
+        key = (keys != NULL ? keys[i] : (Uint32)(entries[i] >> 32)) >> lowBit;
+        for(pass=0;pass<numPasses;++pass){
+            histograms[pass][(key >> (pass*digitBits)) & mask]++;
+        }
+    }
+    //every histogram becomes the first place of every digit
+    for(pass=0;pass<numPasses;++pass){
+        sum = 0;
+        for(i=0;i<=(int)mask;++i){
+            digitCount = histograms[pass][i];
+            histograms[pass][i] = sum;
+            sum += digitCount;
+        }
+    }
+
+    if(keys != NULL){
+        histogram = histograms[0];
+        for(i=0;i<count;++i){
+            key = keys[i];
+            destination[histogram[(key >> lowBit) & mask]++] = ((Uint64)key << 32) | (Uint32)i;
+        }
+        pass = 1;
+    }
+    else{
+        destination = scratch;
+        source = entries;
+        pass = 0;
+    }
+    for(;pass<numPasses;++pass){
+        if(pass > 0){
+            swap = source;
+            source = destination;
+            destination = swap;
+        }
+        histogram = histograms[pass];
+        shift = 32 + lowBit + pass*digitBits;
+        for(i=0;i<count;++i){
+            destination[histogram[(source[i] >> shift) & mask]++] = source[i];
+        }
+    }
+    return destination;
+}
+
+//The differing bits of the keys of count entries
+static Uint32 isoRenderQueueDiffer(Uint64 *entries,int count)
+{
+    int i;
+    Uint32 keysOr = 0;
+    Uint32 keysAnd = 0xffffffff;
+
+    for(i=0;i<count;++i){
+        keysOr |= (Uint32)(entries[i] >> 32);
+        keysAnd &= (Uint32)(entries[i] >> 32);
+    }
+    return keysOr ^ keysAnd;
+}
+
+//Sorts the quads whose key changed since the last frame and merges them into the order of the last frame.
+//Gives up and returns 0 when more than 1/ISO_RENDER_QUEUE_TOUCH_UP_SHARE of the keys changed, then the radix sort
+//of all quads is about as fast. The other quads have the same key and the same place as in the last order.
+static int isoRenderQueueTouchUp(isoRenderQueueT *queue)
+{
+    int i;
+    int n = queue->numItems;
+    int maxChanged = n/ISO_RENDER_QUEUE_TOUCH_UP_SHARE;
+    int numChanged = queue->numChanged;
+    Uint32 item;
+    int removedIndex = 0;
+    int addedIndex = 0;
+    int out = 0;
+    Uint64 entry;
+    Uint64 *removed = queue->changed;                   //the entries of the last order that are wrong now
+    Uint64 *added = queue->changed + maxChanged;        //and the ones that replace them
+    Uint64 *scratch = queue->changed + 2*maxChanged;    //room for two sorts, 4*maxChanged <= n
+    Uint64 *order = queue->order;
+    Uint64 *merged = queue->scratch;
+
+    if(numChanged > maxChanged){
+        return 0;
+    }
+    for(i=0;i<numChanged;++i){
+        item = queue->changedItems[i];
+        removed[i] = ((Uint64)queue->lastKeys[item] << 32) | item;
+        added[i] = ((Uint64)queue->keys[item] << 32) | item;
+    }
+    if(numChanged == 0){
+        return 1;
+    }
+    removed = isoRenderQueueRadixSort(removed,scratch,numChanged,NULL,isoRenderQueueDiffer(removed,numChanged));
+    added = isoRenderQueueRadixSort(added,scratch + maxChanged,numChanged,NULL,isoRenderQueueDiffer(added,numChanged));
+
+    //the entries are unique, the quad is part of them
+    for(i=0;i<n;++i){
+        entry = order[i];
+        if(removedIndex < numChanged && entry == removed[removedIndex]){
+            removedIndex++;
+            continue;
+        }
+        while(addedIndex < numChanged && added[addedIndex] < entry){
+            merged[out++] = added[addedIndex++];
+        }
+        merged[out++] = entry;
+    }
+    while(addedIndex < numChanged){
+        merged[out++] = added[addedIndex++];
+    }
+    queue->order = merged;
+    queue->scratch = order;
+    return 1;
+}
+
+//Sorts the quads back to front. Quads with the same key stay in the order they were added.
+void isoRenderQueueSort(isoRenderQueueT *queue)
+{
+    int n;
+    Uint64 *sorted;
+
+    if(queue == NULL){
+        return;
+    }
+    n = queue->numItems;
+    queue->numOrdered = n;
+    if(n == 0){
+        queue->sortMode = ISO_RENDER_QUEUE_SORTED_NONE;
+        return;
+    }
+    //the order of the last frame only means something for this one if it has the same number of quads
+    if(queue->allowTouchUp && queue->lastNumOrdered == n && isoRenderQueueTouchUp(queue)){
+        queue->sortMode = ISO_RENDER_QUEUE_SORTED_TOUCH_UP;
+        return;
+    }
+    sorted = isoRenderQueueRadixSort(queue->order,queue->scratch,n,queue->keys,queue->keysOr ^ queue->keysAnd);
+    if(sorted != queue->order){
+        queue->scratch = queue->order;
+        queue->order = sorted;
+    }
+    queue->sortMode = queue->keysOr == queue->keysAnd ? ISO_RENDER_QUEUE_SORTED_NONE : ISO_RENDER_QUEUE_SORTED_RADIX;
+}
+
+//Sorts the quads and draws them, one batch for every run of quads with the same texture
+void isoRenderQueueDraw(isoRenderQueueT *queue)
+{
+    int i;
+    Uint32 item;
+    int textureIndex = -1;
+    SDL_Point size;
+
+    if(queue == NULL){
+        return;
+    }
+    isoRenderQueueSort(queue);
+    queue->numRuns = 0;
+    for(i=0;i<queue->numItems;++i){
+        item = (Uint32)queue->order[i];
+        if(queue->textures[item] != textureIndex){
+            textureBatchDraw(&queue->batch);
+            textureIndex = queue->textures[item];
+            textureBatchBegin(&queue->batch,queue->textureTable[textureIndex]);
+            queue->numRuns++;
+        }
+        size.x = queue->dstRects[item].w;
+        size.y = queue->dstRects[item].h;
+        textureBatchAddXYClipSize(&queue->batch,queue->dstRects[item].x,queue->dstRects[item].y,&queue->srcRects[item],&size);
+    }
+    textureBatchDraw(&queue->batch);
+    textureBatchBegin(&queue->batch,NULL);
+}
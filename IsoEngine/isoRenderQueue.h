@@ -0,0 +1,67 @@
+#ifndef __ISO_RENDER_QUEUE_H_
+#define __ISO_RENDER_QUEUE_H_
+
+#include <SDL2/SDL.h>
+#include "../texture.h"
+
+//Collects the quads of a frame (tiles of any layer and sprites) with a depth key and draws them back to front.
+//The key is the iso depth x+y of the tile the quad stands on, then its layer, then a sub-order within the tile:
+//a quad is drawn over every quad with a smaller key, quads with the same key in the order they were added.
+//Each frame is sorted with a stable radix sort. When the frame has as many quads as the last one, quad i is
+//taken to be the same quad as quad i of the last frame: only the quads whose key changed are sorted,
+//and merged into the order of the last frame, which is much faster when little has moved.
+//The radix sort only sorts by the bits that are not the same in every key, a screen of tiles and sprites
+//has about 22 of them: two passes of ISO_RENDER_QUEUE_RADIX_BITS.
+#define ISO_RENDER_QUEUE_LAYER_SHIFT    8
+#define ISO_RENDER_QUEUE_DEPTH_SHIFT    12
+#define ISO_RENDER_QUEUE_MAX_DEPTH      0xfffff
+#define ISO_RENDER_QUEUE_MAX_LAYER      0xf
+#define ISO_RENDER_QUEUE_MAX_SUB_ORDER  0xff
+#define ISO_RENDER_QUEUE_MAX_TEXTURES   256
+#define ISO_RENDER_QUEUE_RADIX_BITS     11
+#define ISO_RENDER_QUEUE_RADIX_SIZE     (1<<ISO_RENDER_QUEUE_RADIX_BITS)
+#define ISO_RENDER_QUEUE_RADIX_PASSES   3       //ISO_RENDER_QUEUE_RADIX_BITS*ISO_RENDER_QUEUE_RADIX_PASSES >= 32
+#define ISO_RENDER_QUEUE_TOUCH_UP_SHARE 4       //the last order is touched up when at most 1/this of the keys changed
+
+#define ISO_RENDER_QUEUE_KEY(depth,layer,subOrder) (((Uint32)(depth) << ISO_RENDER_QUEUE_DEPTH_SHIFT) | \
+                                                    ((Uint32)(layer) << ISO_RENDER_QUEUE_LAYER_SHIFT) | (Uint32)(subOrder))
+
+//How the last isoRenderQueueSort sorted
+#define ISO_RENDER_QUEUE_SORTED_NONE        0   //all the quads have the same key, they stay in the order they were added
+#define ISO_RENDER_QUEUE_SORTED_TOUCH_UP    1   //the order of the last frame, touched up
+#define ISO_RENDER_QUEUE_SORTED_RADIX       2
+
+typedef struct isoRenderQueueT
+{
+    int numItems;
+    int maxItems;
+    Uint32 *keys;
+    Uint32 *lastKeys;           //the keys of the last frame that was sorted
+    Uint32 keysOr;              //all the keys of the frame ored together, and anded together
+    Uint32 keysAnd;
+    Uint8 *textures;            //the index of the quad's texture in textureTable
+    SDL_Rect *srcRects;
+    SDL_Rect *dstRects;
+    Uint64 *order;              //key << 32 | quad, sorted. Kept from frame to frame for the touch up.
+    Uint64 *scratch;
+    Uint32 *changedItems;       //the quads isoRenderQueueAdd found with another key than in lastKeys
+    int numChanged;
+    Uint64 *changed;            //the entries of the changed quads with the old and the new key
+    int numOrdered;             //the quads sorted in this frame
+    int lastNumOrdered;         //the quads in order and lastKeys, 0 if the last frame was not sorted
+    int sortMode;
+    int allowTouchUp;
+    int numTextures;
+    textureT *textureTable[ISO_RENDER_QUEUE_MAX_TEXTURES];
+    textureBatchT batch;
+    int numRuns;                //the batches isoRenderQueueDraw drew, one per run of quads with the same texture
+}isoRenderQueueT;
+
+isoRenderQueueT *isoRenderQueueNew();
+void isoRenderQueueFree(isoRenderQueueT *queue);
+void isoRenderQueueBegin(isoRenderQueueT *queue);
+void isoRenderQueueAdd(isoRenderQueueT *queue,Uint32 key,textureT *texture,SDL_Rect *srcRect,int x,int y,SDL_Point *size);
+void isoRenderQueueSort(isoRenderQueueT *queue);
+void isoRenderQueueDraw(isoRenderQueueT *queue);
+
+#endif // __ISO_RENDER_QUEUE_H_
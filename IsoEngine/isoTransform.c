@@ -0,0 +1,176 @@
+#include <SDL2/SDL.h>
+#include <float.h>
+#include "isoTransform.h"
+
+//The vector versions compute in single precision like SSE scalar math does. With x87 math (FLT_EVAL_METHOD 2,
+//e.g. 32 bit builds without -mfpmath=sse) the single point versions keep more precision, so only the
+//scalar version is bit-identical there.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__)) && FLT_EVAL_METHOD == 0
+#define ISO_TRANSFORM_X86
+#include <immintrin.h>
+#endif
+
+static int implementation = ISO_TRANSFORM_SCALAR;
+static const char *implementationNames[ISO_TRANSFORM_NUM_IMPLEMENTATIONS] = {"scalar","sse2","avx2"};
+
+//The same expressions as isoEngineConvert2dToIso and isoEngineConvertIsoTo2D
+static void isoTransform2dToIsoScalar(float *x,float *y,int count)
+{
+    int i;
+    int tmpX,tmpY;
+
+    for(i=0;i<count;++i){
+        tmpX = x[i] - y[i];
+        tmpY = (x[i] + y[i])*0.5;
+        x[i] = tmpX;
+        y[i] = tmpY;
+    }
+}
+
+static void isoTransformIsoTo2DScalar(float *x,float *y,int count)
+{
+    int i;
+    int tmpX,tmpY;
+
+    for(i=0;i<count;++i){
+        tmpX = (2 * y[i] + x[i])*0.5;
+        tmpY = (2 * y[i] - x[i])*0.5;
+        x[i] = tmpX;
+        y[i] = tmpY;
+    }
+}
+
+#ifdef ISO_TRANSFORM_X86
+//Halving a float is exact, so (x+y)*0.5f gives the same float as the double (x+y)*0.5 of the scalar version,
+//and y+y is exactly 2*y. _mm_cvttps_epi32 truncates towards zero like the cast to int.
+__attribute__((target("sse2")))
+static void isoTransform2dToIsoSSE2(float *x,float *y,int count)
+{
+    int i;
+    __m128 vx,vy;
+    __m128 half = _mm_set1_ps(0.5f);
+
+    for(i=0;i+4<=count;i+=4){
+        vx = _mm_loadu_ps(&x[i]);
+        vy = _mm_loadu_ps(&y[i]);
+        _mm_storeu_ps(&x[i],_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_sub_ps(vx,vy))));
+        _mm_storeu_ps(&y[i],_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(vx,vy),half))));
+    }
+    isoTransform2dToIsoScalar(&x[i],&y[i],count-i);
+}
+
+__attribute__((target("sse2")))
+static void isoTransformIsoTo2DSSE2(float *x,float *y,int count)
+{
+    int i;
+    __m128 vx,vy,vy2;
+    __m128 half = _mm_set1_ps(0.5f);
+
+    for(i=0;i+4<=count;i+=4){
+        vx = _mm_loadu_ps(&x[i]);
+        vy = _mm_loadu_ps(&y[i]);
+        vy2 = _mm_add_ps(vy,vy);
+        _mm_storeu_ps(&x[i],_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(vy2,vx),half))));
+        _mm_storeu_ps(&y[i],_mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(vy2,vx),half))));
+    }
+    isoTransformIsoTo2DScalar(&x[i],&y[i],count-i);
+}
+
+__attribute__((target("avx2")))
+static void isoTransform2dToIsoAVX2(float *x,float *y,int count)
+{
+    int i;
+    __m256 vx,vy;
+    __m256 half = _mm256_set1_ps(0.5f);
+
+    for(i=0;i+8<=count;i+=8){
+        vx = _mm256_loadu_ps(&x[i]);
+        vy = _mm256_loadu_ps(&y[i]);
+        _mm256_storeu_ps(&x[i],_mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_sub_ps(vx,vy))));
+        _mm256_storeu_ps(&y[i],_mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(vx,vy),half))));
+    }
+    isoTransform2dToIsoScalar(&x[i],&y[i],count-i);
+}
+
+__attribute__((target("avx2")))
+static void isoTransformIsoTo2DAVX2(float *x,float *y,int count)
+{
+    int i;
+    __m256 vx,vy,vy2;
+    __m256 half = _mm256_set1_ps(0.5f);
+
+    for(i=0;i+8<=count;i+=8){
+        vx = _mm256_loadu_ps(&x[i]);
+        vy = _mm256_loadu_ps(&y[i]);
+        vy2 = _mm256_add_ps(vy,vy);
+        _mm256_storeu_ps(&x[i],_mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(vy2,vx),half))));
+        _mm256_storeu_ps(&y[i],_mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(vy2,vx),half))));
+    }
+    isoTransformIsoTo2DScalar(&x[i],&y[i],count-i);
+}
+#endif
+
+int isoTransformSetImplementation(int newImplementation)
+{
+    if(newImplementation == ISO_TRANSFORM_AUTO){
+        newImplementation = ISO_TRANSFORM_AVX2;
+    }
+#ifdef ISO_TRANSFORM_X86
+    if(newImplementation == ISO_TRANSFORM_AVX2 && !SDL_HasAVX2()){
+        newImplementation = ISO_TRANSFORM_SSE2;
+    }
+    if(newImplementation == ISO_TRANSFORM_SSE2 && !SDL_HasSSE2()){
+        newImplementation = ISO_TRANSFORM_SCALAR;
+    }
+    if(newImplementation < 0 || newImplementation >= ISO_TRANSFORM_NUM_IMPLEMENTATIONS){
+        newImplementation = ISO_TRANSFORM_SCALAR;
+    }
+#else
+    newImplementation = ISO_TRANSFORM_SCALAR;
+#endif
+    implementation = newImplementation;
+    return implementation;
+}
+
+int isoTransformGetImplementation()
+{
+    return implementation;
+}
+
+const char *isoTransformGetImplementationName(int which)
+{
+    if(which < 0 || which >= ISO_TRANSFORM_NUM_IMPLEMENTATIONS){
+        return "unknown";
+    }
+    return implementationNames[which];
+}
+
+void isoTransformConvert2dToIso(float *x,float *y,int count)
+{
+#ifdef ISO_TRANSFORM_X86
+    if(implementation == ISO_TRANSFORM_AVX2){
+        isoTransform2dToIsoAVX2(x,y,count);
+        return;
+    }
+    if(implementation == ISO_TRANSFORM_SSE2){
+        isoTransform2dToIsoSSE2(x,y,count);
+        return;
+    }
+#endif
+    isoTransform2dToIsoScalar(x,y,count);
+}
+
+void isoTransformConvertIsoTo2D(float *x,float *y,int count)
+{
+#ifdef ISO_TRANSFORM_X86
+    if(implementation == ISO_TRANSFORM_AVX2){
+        isoTransformIsoTo2DAVX2(x,y,count);
+        return;
+    }
+    if(implementation == ISO_TRANSFORM_SSE2){
+        isoTransformIsoTo2DSSE2(x,y,count);
+        return;
+    }
+#endif
+    isoTransformIsoTo2DScalar(x,y,count);
+}
@@ -0,0 +1,23 @@
+#ifndef __ISO_TRANSFORM_H_
+#define __ISO_TRANSFORM_H_
+
+#include <SDL2/SDL.h>
+
+//isoEngineConvert2dToIso and isoEngineConvertIsoTo2D for whole arrays of points, the x and y coordinates
+//in separate arrays. The points are converted in place and the results are bit-identical to the single point
+//versions, including the truncation to int. SSE2 or AVX2 is used when the CPU has it.
+#define ISO_TRANSFORM_AUTO      -1  //the fastest the CPU supports
+#define ISO_TRANSFORM_SCALAR    0
+#define ISO_TRANSFORM_SSE2      1
+#define ISO_TRANSFORM_AVX2      2
+#define ISO_TRANSFORM_NUM_IMPLEMENTATIONS 3
+
+//Until this is called the scalar version is used. isoEngineNewIsoEngine calls it with ISO_TRANSFORM_AUTO.
+//Returns the implementation that is used, the scalar one if the asked for one is not available.
+int isoTransformSetImplementation(int implementation);
+int isoTransformGetImplementation();
+const char *isoTransformGetImplementationName(int which);
+void isoTransformConvert2dToIso(float *x,float *y,int count);
+void isoTransformConvertIsoTo2D(float *x,float *y,int count);
+
+#endif // __ISO_TRANSFORM_H_
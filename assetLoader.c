@@ -0,0 +1,234 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assetLoader.h"
+#include "logger.h"
+
+static SDL_Thread *threads[ASSET_LOADER_MAX_THREADS];
+static int numThreads = 0;
+static SDL_mutex *lock = NULL;
+static SDL_cond *wake = NULL;       //a job was queued or the loader shuts down
+static SDL_cond *finished = NULL;   //a job was decoded
+static assetLoaderJobT *queueHead = NULL;
+static assetLoaderJobT *queueTail = NULL;
+static int quit = 0;
+
+static int assetLoaderWorker(void *data)
+{
+    assetLoaderJobT *job;
+    SDL_Surface *surface;
+
+    SDL_LockMutex(lock);
+    while(1){
+        while(queueHead == NULL && !quit){
+            SDL_CondWait(wake,lock);
+        }
+        if(quit){
+            break;
+        }
+        job = queueHead;
+        queueHead = job->next;
+        if(queueHead == NULL){
+            queueTail = NULL;
+        }
+        job->next = NULL;
+        SDL_UnlockMutex(lock);
+
+        surface = IMG_Load(job->path);
+        if(surface == NULL){
+            logError("error.txt","assetLoaderWorker(...) - Could not decode %s! SDL_image Error:%s",job->path,IMG_GetError());
+        }
+
+        SDL_LockMutex(lock);
+        job->surface = surface;
+        job->done = 1;
+        SDL_CondBroadcast(finished);
+    }
+    SDL_UnlockMutex(lock);
+    return 0;
+}
+
+//Starts the worker threads, one less than there are CPU cores, the render thread has enough to do
+static int assetLoaderStart()
+{
+    int i;
+    int wanted = SDL_max(1,SDL_min(SDL_GetCPUCount()-1,ASSET_LOADER_MAX_THREADS));
+    char name[32];
+
+    lock = SDL_CreateMutex();
+    wake = SDL_CreateCond();
+    finished = SDL_CreateCond();
+    if(lock == NULL || wake == NULL || finished == NULL){
+        writeToLog("Error in function: assetLoaderStart() - Could not create the asset loader's mutex!","error.txt");
+        assetLoaderShutdown();
+        return 0;
+    }
+    quit = 0;
+    for(i=0;i<wanted;++i){
+        sprintf(name,"assetLoader%d",i);
+        threads[i] = SDL_CreateThread(assetLoaderWorker,name,NULL);
+        if(threads[i] == NULL){
+            logWarning("error.txt","assetLoaderStart() - Could only start %d of %d decoding threads: %s",i,wanted,SDL_GetError());
+            break;
+        }
+        numThreads++;
+    }
+    if(numThreads == 0){
+        assetLoaderShutdown();
+        return 0;
+    }
+    return 1;
+}
+
+//Reads the size of a PNG file from its header, without decoding it. Returns 0 if the file is not a PNG file.
+int assetLoaderReadImageSize(const char *path,int *width,int *height)
+{
+    static const Uint8 signature[8] = {0x89,'P','N','G','\r','\n',0x1a,'\n'};
+    Uint8 header[24];
+    FILE *file = fopen(path,"rb");
+
+    if(file == NULL){
+        return 0;
+    }
+    if(fread(header,1,sizeof(header),file) != sizeof(header) || memcmp(header,signature,8) != 0 || memcmp(&header[12],"IHDR",4) != 0){
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    //the IHDR chunk is always first, its width and height are big endian
+    *width = (header[16]<<24) | (header[17]<<16) | (header[18]<<8) | header[19];
+    *height = (header[20]<<24) | (header[21]<<16) | (header[22]<<8) | header[23];
+    return *width > 0 && *height > 0;
+}
+
+//Queues the file for decoding, returns NULL if the loader could not be started.
+//Every job is handed back with assetLoaderFinish or assetLoaderCancel.
+assetLoaderJobT *assetLoaderDecode(const char *path)
+{
+    assetLoaderJobT *job;
+
+    if(path == NULL || strlen(path) >= ASSET_LOADER_MAX_PATH){
+        logError("error.txt","assetLoaderDecode(...) - The path %s is NULL or too long!",path != NULL ? path : "");
+        return NULL;
+    }
+    if(numThreads == 0 && assetLoaderStart() == 0){
+        return NULL;
+    }
+    job = malloc(sizeof(assetLoaderJobT));
+    if(job == NULL){
+        logError("error.txt","assetLoaderDecode(...) - Could not allocate memory for the job of %s!",path);
+        return NULL;
+    }
+    snprintf(job->path,ASSET_LOADER_MAX_PATH,"%s",path);
+    job->surface = NULL;
+    job->done = 0;
+    job->next = NULL;
+
+    SDL_LockMutex(lock);
+    if(queueTail != NULL){
+        queueTail->next = job;
+    }
+    else{
+        queueHead = job;
+    }
+    queueTail = job;
+    SDL_CondSignal(wake);
+    SDL_UnlockMutex(lock);
+    return job;
+}
+
+int assetLoaderIsDone(assetLoaderJobT *job)
+{
+    int done;
+
+    SDL_LockMutex(lock);
+    done = job->done;
+    SDL_UnlockMutex(lock);
+    return done;
+}
+
+//Waits until the job is decoded, frees it and returns the surface, which now belongs to the caller
+SDL_Surface *assetLoaderFinish(assetLoaderJobT *job)
+{
+    SDL_Surface *surface;
+
+    SDL_LockMutex(lock);
+    while(!job->done){
+        SDL_CondWait(finished,lock);
+    }
+    SDL_UnlockMutex(lock);
+    surface = job->surface;
+    free(job);
+    return surface;
+}
+
+//Drops a job, a job that is still queued is never decoded
+void assetLoaderCancel(assetLoaderJobT *job)
+{
+    assetLoaderJobT *prev = NULL;
+    assetLoaderJobT *queued;
+
+    if(job == NULL){
+        return;
+    }
+    SDL_LockMutex(lock);
+    for(queued=queueHead;queued!=NULL;prev=queued,queued=queued->next){
+        if(queued == job){
+            if(prev != NULL){
+                prev->next = job->next;
+            }
+            else{
+                queueHead = job->next;
+            }
+            if(queueTail == job){
+                queueTail = prev;
+            }
+            SDL_UnlockMutex(lock);
+            free(job);
+            return;
+        }
+    }
+    SDL_UnlockMutex(lock);
+    //a worker is decoding it
+    SDL_FreeSurface(assetLoaderFinish(job));
+}
+
+int assetLoaderGetNumThreads()
+{
+    return numThreads;
+}
+
+//Stops the worker threads. The jobs have to be finished or cancelled first.
+void assetLoaderShutdown()
+{
+    int i;
+
+    if(numThreads > 0){
+        SDL_LockMutex(lock);
+        quit = 1;
+        SDL_CondBroadcast(wake);
+        SDL_UnlockMutex(lock);
+
+        for(i=0;i<numThreads;++i){
+            SDL_WaitThread(threads[i],NULL);
+        }
+        numThreads = 0;
+    }
+    if(queueHead != NULL){
+        logWarning("error.txt","assetLoaderShutdown() - There were still images waiting to be decoded!");
+    }
+    if(lock != NULL){
+        SDL_DestroyMutex(lock);
+        lock = NULL;
+    }
+    if(wake != NULL){
+        SDL_DestroyCond(wake);
+        wake = NULL;
+    }
+    if(finished != NULL){
+        SDL_DestroyCond(finished);
+        finished = NULL;
+    }
+}
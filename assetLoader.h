@@ -0,0 +1,28 @@
+#ifndef __ASSET_LOADER_H_
+#define __ASSET_LOADER_H_
+
+#include <SDL2/SDL.h>
+
+//Decodes image files to surfaces on worker threads, so the game can draw its first frame while the assets load.
+//assetLoaderDecode queues a file and returns at once, the thread that owns the renderer picks up the surface
+//with assetLoaderFinish and uploads it. The worker threads are started by the first assetLoaderDecode.
+#define ASSET_LOADER_MAX_THREADS    8
+#define ASSET_LOADER_MAX_PATH       256
+
+typedef struct assetLoaderJobT
+{
+    char path[ASSET_LOADER_MAX_PATH];
+    SDL_Surface *surface;       //the decoded image, NULL if the file could not be decoded
+    int done;
+    struct assetLoaderJobT *next;
+}assetLoaderJobT;
+
+int assetLoaderReadImageSize(const char *path,int *width,int *height);
+assetLoaderJobT *assetLoaderDecode(const char *path);
+int assetLoaderIsDone(assetLoaderJobT *job);
+SDL_Surface *assetLoaderFinish(assetLoaderJobT *job);
+void assetLoaderCancel(assetLoaderJobT *job);
+int assetLoaderGetNumThreads();
+void assetLoaderShutdown();
+
+#endif // __ASSET_LOADER_H_
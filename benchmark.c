@@ -0,0 +1,3887 @@
+/*
+ *   Isometric Game Tutorial Part 2.5 - Benchmarks
+ *
+ *   Built by the "Benchmark" target instead of the game (isoTutorialPart2.5.c).
+ *   Every benchmark writes its results as JSON, to stdout or to the given file.
+ *
+ *   Render benchmark:
+ *   Runs headless through SDL's dummy video driver and the software renderer, so it works on CPU-only machines.
+ *   Draws the map, the character and the iso mouse for every combination of map size, zoom level and
+ *   scripted camera path, and reports frames per second, p50/p99 frame time and SDL draw calls per frame.
+ *   Every combination runs with the per tile, the batched and the render cache draw mode. The first frame of
+ *   the per tile and the batched mode is read back and compared, to make sure the batched output is pixel-identical.
+ *
+ *   Visibility check:
+ *   Puts the camera at many random positions and zoom levels and compares the tiles isoEngineDrawIsoMap
+ *   draws (isoEngineGetVisibleTiles) with a brute force test of every tile on the map. Reports the number
+ *   of off-screen tiles that would be drawn and on-screen tiles that would be missed, both should be 0.
+ *
+ *   Map layout benchmark:
+ *   Pans a camera across a large map and reads every visible tile the same way isoEngineDrawIsoMap does.
+ *   The chunked map storage is compared against the old flat layout, where the tiles were stored
+ *   as (y*mapWidth+x)*numLayers+layer. On Linux the cache misses are read from the performance counters,
+ *   on other systems (or without permission to read them) they are reported as -1.
+ *
+ *   Map file benchmark:
+ *   Generates a map, saves it with isoMapSaveMap and loads it back with isoMapLoadMap. Reports the time to generate,
+ *   save and load the map, and the time for the first pass over every tile of the loaded map, which is when the
+ *   operating system actually reads the pages in. The loaded tiles are compared with the generated ones.
+ *
+ *   Paging benchmark:
+ *   Saves a generated map and pans the camera across it fast, drawn from memory, from the memory mapped file
+ *   (isoMapLoadMap) and paged with a small memory budget (isoMapLoadMapPaged). Reports the average, p99 and
+ *   worst frame time, which shows the stutter when chunks are read from the disk, the frames that were drawn
+ *   with visible chunks still missing, and how many chunks the pager loaded and dropped again.
+ *
+ *   Damage tracking benchmark:
+ *   Runs the game's draw loop with and without damage tracking (isoDamageBeginFrame) while nothing happens,
+ *   while the mouse moves, while the character walks, while tiles are changed and while the camera pans.
+ *   Reports how many frames were drawn and skipped, how much of the screen was repainted on average
+ *   and the time spent per frame.
+ *
+ *   Game loop benchmark:
+ *   Runs the fixed timestep loop of the game (frameTimer) for a few seconds, uncapped and with frame caps,
+ *   while the camera pans and the character walks. Every 10th frame handles an input event. Reports frames and
+ *   ticks per second (the ticks have to stay at BENCH_LOOP_TICKS_PER_SECOND), the time spent simulating and
+ *   drawing per frame, and the average and worst input to present latency.
+ *
+ *   Tile band benchmark:
+ *   Generates the quads of the visible tiles (isoEngineBuildMapBatch) while the camera pans, zoomed out further
+ *   and further, with thread pools of 1, 2, 4 ... threads up to the number of CPU cores. Only the generation is timed.
+ *   Reports the average and p99 time per frame, the tiles per frame and the speedup over a single thread. The first
+ *   frame is drawn and read back, it has to be pixel-identical to the one generated on a single thread.
+ *
+ *   Transform benchmark:
+ *   Converts the same random points with isoEngineConvert2dToIso and isoEngineConvertIsoTo2D one by one, and with
+ *   the array versions (isoTransformConvert2dToIso, isoTransformConvertIsoTo2D) in every implementation the CPU supports.
+ *   Reports the time per pass over all points, millions of points per second and the speedup over the single point
+ *   versions. The results of the array versions have to be bit-identical to the single point ones.
+ *
+ *   Picking benchmark:
+ *   Picks the tiles under random screen points at random camera positions and zoom levels, with the old
+ *   isoEngineGetMouseTilePos (snapped to half tiles, float corrections) and with isoEnginePickTile. Both are
+ *   compared with a brute force test of the diamond of every visible tile, in the order they are drawn. Reports
+ *   the wrong picks of both and the time per point of the old, the single point and the batch (isoEnginePickTiles) version.
+ *
+ *   Texture cache benchmark:
+ *   Creates many small maps that share one tile set and loads the tile set into each of them, once with the
+ *   unused textures purged after every map (so every load decodes the file and uploads the texture again) and
+ *   once with all maps kept alive, sharing the cached texture. Reports the time per tile set load, the cache hits
+ *   and misses and the texture memory in use.
+ *
+ *   Quad table benchmark:
+ *   Adds the same random tiles to a batch at every zoom level of the game, with the sizes computed for every quad
+ *   (textureBatchAddXYClipScale) and looked up in the tile set's quad table (textureBatchAddXYClipSize). Reports the
+ *   time per million quads of both and the speedup. The quads of both have to be identical.
+ *
+ *   Asset loading benchmark:
+ *   Copies data/isotiles.png to many files and loads all of them before the first frame, once one by one on the render
+ *   thread (loadTexture) and once decoded in the background (loadTextureAsync) while frames with placeholders are drawn.
+ *   Reports the time to the first frame, the time until every image is loaded and the frames drawn in between.
+ *
+ *   Palette benchmark:
+ *   Generates a map and paints decorations on the layers above the ground through isoMapSetTile, a few values per
+ *   chunk on one layer and hundreds per chunk on the other, so chunks are widened from 4 to 8 and 16 bit indices.
+ *   Reports how many chunks have which width, the memory of the packed chunks against 32 bit tiles, and the time
+ *   and cache misses per frame for reading the visible ground tiles from the packed chunks and from int chunks.
+ *   Every painted tile is read back and checked.
+ *
+ *   Generator benchmark:
+ *   Generates a map with noise, stamps and decorations (isoMapGenRun) on thread pools of 1, 2, 4 ... threads up to the
+ *   number of CPU cores, and once more chunk by chunk in reverse order (isoMapGenChunk). Reports the time and the
+ *   speedup over a single thread. Every map has to be identical to the one generated on a single thread, the checksum
+ *   of the map is printed so it can be compared between machines.
+ *
+ *   Entity benchmark:
+ *   Moves and draws many walking entities, stored one struct per entity the way the character was stored and drawn
+ *   with a draw call each like drawCharacter, and stored in the entity store (isoEntityUpdate, isoEntityDraw).
+ *   Reports the update and draw time per entity and the draw calls per frame of both. Both have to end up with the
+ *   same positions and draw the same entities. Then every third entity is removed, and every handle has to find its
+ *   entity again while the handles of the removed ones find nothing.
+ *
+ *   Depth sort benchmark:
+ *   Fills the render queue (isoRenderQueue) with two layers of tiles and sprites walking on them, 200000 quads by
+ *   default, and sorts it every frame, always with the radix sort, with the order of the last frame touched up, and
+ *   with a quarter of the sprites jumping somewhere else every frame. Reports the time to add the quads, the average
+ *   and worst sort time, how the frames were sorted and the time qsort takes for the same keys. Every order has to be
+ *   identical to the qsort one. Then one frame is drawn and the batches and draw calls are reported. Last a frame of the
+ *   game is queued, zoomed out over a generated map with decorations and entities (isoEngineQueueIsoMap, isoEntityQueue).
+ *
+ *   Pathfinding benchmark:
+ *   Generates maps of 256, 1024 and 4096 tiles with water and decorations that can not be walked on, builds the path
+ *   finder (isoPath) and searches random paths across the map, a time budget per frame like the game (isoPathUpdate).
+ *   Reports the build time, paths per second, the worst frame and the average path length. Every path has to step from
+ *   the start to the goal over walkable tiles. On the smaller maps paths are compared with an A* over every tile: none
+ *   may be missed and the extra cost of the paths is reported. Then a wall is put across the map, the time to build
+ *   the clusters around it again is reported and paths through the wall have to go around it.
+ *
+ *   Flow field benchmark:
+ *   Steers 10000 units from all over a generated map of 1024 tiles to one goal with a flow field (isoFlow). Every tick
+ *   the units ask for the chunks they are heading into and step to the next tile the field points to. Reports the first
+ *   update, which searches the nodes and integrates most chunks, the average and worst tick, and how far the units got.
+ *   Then a wall is put across the map and the chunks integrated again and kept are reported. Every tile of the field is
+ *   checked against a Dijkstra over every tile from the goal: every step has to be allowed and go to a cheaper tile,
+ *   no tile that can reach the goal may be missed and the extra cost is reported. Asking for the goal again has to
+ *   return the cached field.
+ *
+ *   Edit journal benchmark:
+ *   Paints brush strokes on a generated map of 2048 tiles with an edit journal attached (isoMapJournal), one transaction
+ *   per stroke. Reports the time per stroke, the memory of the journal per stroke and per tile against a snapshot of
+ *   every tile before each stroke, and the time to undo and redo a stroke and one big edit. Undoing every stroke has
+ *   to give back the generated map and redoing them the painted one. Then the strokes are painted again with a small
+ *   memory budget, which has to hold while the oldest strokes are dropped.
+ *
+ *   Bulk tile operations benchmark:
+ *   Does the same random fills, stamps, copies and reads of rects, some of them sticking out of the map, on two copies
+ *   of a generated map of 1024 tiles, tile by tile with isoMapGetTile and isoMapSetTile on one and with isoMapFillRect,
+ *   isoMapStampRect, isoMapCopyRect and isoMapReadRect on the other. Copies come from another map or from the same map,
+ *   between layers or overlapping, stamps are blocks of values in an ellipse. Reports the time per tile of both for every operation. The reads and both maps at
+ *   the end have to be the same, and with an edit journal attached every operation has to be undone as one transaction.
+ *
+ *   Usage:
+ *   benchmark render [frames] [output.json]
+ *   benchmark layout [mapSize] [frames] [output.json]
+ *   benchmark visibility [cameras] [output.json]
+ *   benchmark mapfile [mapSize] [output.json]
+ *   benchmark paging [mapSize] [frames] [output.json]
+ *   benchmark damage [frames] [output.json]
+ *   benchmark loop [seconds] [output.json]
+ *   benchmark bands [frames] [output.json]
+ *   benchmark transform [points] [output.json]
+ *   benchmark picking [points] [output.json]
+ *   benchmark texcache [maps] [output.json]
+ *   benchmark quads [quads] [output.json]
+ *   benchmark assets [images] [output.json]
+ *   benchmark palette [mapSize] [frames] [output.json]
+ *   benchmark generate [mapSize] [output.json]
+ *   benchmark entities [entities] [output.json]
+ *   benchmark depth [items] [output.json]
+ *   benchmark pathfinding [requests] [output.json]
+ *   benchmark flowfield [units] [output.json]
+ *   benchmark journal [strokes] [output.json]
+ *   benchmark bulk [operations] [output.json]
+ *
+ *   Returns 1 on bad arguments and 2 when one of the correctness checks of a mode failed, 0 otherwise.
+ */
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "initclose.h"
+#include "renderer.h"
+#include "texture.h"
+#include "IsoEngine/isoEngine.h"
+#include "IsoEngine/isoMapPager.h"
+#include "IsoEngine/isoMapGen.h"
+#include "IsoEngine/isoMapJournal.h"
+#include "IsoEngine/isoEntity.h"
+#include "IsoEngine/isoPath.h"
+#include "IsoEngine/isoFlow.h"
+#include "IsoEngine/isoTransform.h"
+#include "logger.h"
+#include "frameTimer.h"
+#include "textureCache.h"
+#include "assetLoader.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#define BENCH_MAP_SIZE      4096
+#define BENCH_MAP_LAYERS    2
+#define BENCH_FRAMES        600
+#define BENCH_TILE_SIZE     64
+#define BENCH_RENDER_FRAMES 300
+#define BENCH_VISIBILITY_CAMERAS 2000
+#define BENCH_MAPFILE_SIZE  8192
+#define BENCH_MAPFILE_NAME  "benchmark.map"
+#define BENCH_PAGING_SIZE   8192
+#define BENCH_PAGING_BUDGET (2*1024*1024)
+#define BENCH_PAGING_SCROLL_SPEED 128
+#define BENCH_PAGING_FRAME_MS 16   //the game waits for vsync, the loader thread has the rest of the frame
+
+#define BENCH_LOOP_SECONDS  3
+#define BENCH_LOOP_TICKS_PER_SECOND 60
+
+#define BENCH_BANDS_FRAMES  200
+
+#define BENCH_TRANSFORM_POINTS  1000000
+#define BENCH_TRANSFORM_REPEATS 20
+
+#define BENCH_PICKING_POINTS    1000000
+#define BENCH_PICKING_CAMERAS   50
+#define BENCH_PICKING_CHECKS    100     //points per camera checked against the brute force test
+
+#define BENCH_TEXCACHE_MAPS     100
+
+#define BENCH_QUADS             1000000
+#define BENCH_QUADS_REPEATS     10
+
+#define BENCH_ASSETS_IMAGES     64
+#define BENCH_ASSETS_FILE       "benchmark_asset_%d.png"
+#define BENCH_ASSETS_UPLOAD_MS  4
+
+#define BENCH_PALETTE_LAYERS    3
+
+#define BENCH_GENERATE_SIZE     8192
+#define BENCH_GENERATE_SEED     2024
+#define BENCH_GENERATE_REPEATS  3
+
+#define BENCH_ENTITIES          100000
+#define BENCH_ENTITIES_AREA     8192    //the entities are spread over this many map pixels in x and y
+#define BENCH_ENTITIES_TICKS    200
+#define BENCH_ENTITIES_FRAMES   50
+
+#define BENCH_DEPTH_ITEMS       200000
+#define BENCH_DEPTH_LAYERS      2
+#define BENCH_DEPTH_SPRITES_PERCENT 10
+#define BENCH_DEPTH_JUMP        512     //how far the scattered sprites jump in x and y, in map pixels
+#define BENCH_DEPTH_FRAMES      100
+#define BENCH_DEPTH_MAP_SIZE    512
+#define BENCH_DEPTH_ZOOM        0.125
+#define BENCH_DEPTH_ENTITIES    100000
+
+#define BENCH_PATH_REQUESTS     2000
+#define BENCH_PATH_BUDGET_MS    2       //time per frame for searching paths
+#define BENCH_PATH_SLOW_COST    3       //the cost of the decoration that can be walked through
+#define BENCH_PATH_REFERENCE_SIZE 1024  //the paths of maps up to this size are compared with the cheapest ones
+#define BENCH_PATH_CHECKS       100     //paths per map compared with the cheapest ones
+#define BENCH_PATH_WALL_PATHS   100
+
+#define BENCH_FLOW_UNITS        10000
+#define BENCH_FLOW_MAP_SIZE     1024
+#define BENCH_FLOW_TICKS        600
+#define BENCH_FLOW_SPEED        16      //map pixels per tick
+
+#define BENCH_JOURNAL_STROKES   1000
+#define BENCH_JOURNAL_MAP_SIZE  2048
+#define BENCH_JOURNAL_DABS      20      //brush dabs per stroke
+#define BENCH_JOURNAL_BRUSH     5       //the side of the square brush
+#define BENCH_JOURNAL_FILL      256     //the side of the square of the big edit
+#define BENCH_JOURNAL_BUDGET    (64*1024*1024)
+#define BENCH_JOURNAL_SMALL_BUDGET (256*1024)
+
+#define BENCH_BULK_OPS          1000
+#define BENCH_BULK_MAP_SIZE     1024
+#define BENCH_BULK_MAX_SIDE     256     //the biggest side of a rect
+#define BENCH_BULK_TRANSPARENT  -1
+#define BENCH_BULK_FILL         0
+#define BENCH_BULK_STAMP        1
+#define BENCH_BULK_COPY         2
+#define BENCH_BULK_READ         3
+#define BENCH_BULK_NUM_OPS      4
+
+#define NUM_CHARACTER_SPRITES   8
+#define PLAYER_DIR_DOWN         5
+
+typedef enum
+{
+    BENCH_CAMERA_STATIC,
+    BENCH_CAMERA_PAN,
+    BENCH_CAMERA_FOLLOW,
+    BENCH_NUM_CAMERA_PATHS
+}benchCameraPathT;
+
+static char *benchCameraPathNames[BENCH_NUM_CAMERA_PATHS] = {"static","pan","follow"};
+static char *benchDrawModeNames[] = {"perTile","batched","cached"};
+static int benchRenderMapSizes[] = {64,512,4096};
+static float benchRenderZoomLevels[] = {1.0,1.5,2.0,2.5,3.0};
+
+static textureT benchCharacterTex;
+static SDL_Rect benchCharRects[NUM_CHARACTER_SPRITES];
+static textureQuadTableT benchCharQuads;
+
+typedef struct benchViewT
+{
+    char *name;
+    int rows;       //screen rows (x+y) visible
+    int columns;    //screen columns (x-y) visible
+}benchViewT;
+
+static benchViewT benchViews[] =
+{
+    {"1200x720 zoom 1.0",26+(WINDOW_HEIGHT/(BENCH_TILE_SIZE/2))*2,5+WINDOW_WIDTH/(BENCH_TILE_SIZE/2)},
+    {"3840x2160 zoom 1.0",26+(2160/(BENCH_TILE_SIZE/2))*2,5+3840/(BENCH_TILE_SIZE/2)},
+    {"7680x4320 zoom 1.0",26+(4320/(BENCH_TILE_SIZE/2))*2,5+7680/(BENCH_TILE_SIZE/2)},
+};
+
+static int benchCacheMissCounter = -1;
+
+//Set when a correctness check fails, main then returns 2 so a script running the benchmarks notices
+static int benchFailed = 0;
+
+//Records a correctness check and returns it for the JSON output
+static const char *benchCheck(int passed)
+{
+    if(!passed){
+        benchFailed = 1;
+    }
+    return passed ? "true" : "false";
+}
+
+static void benchStartCacheMisses()
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    if(benchCacheMissCounter == -1){
+        memset(&attr,0,sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        benchCacheMissCounter = syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+        if(benchCacheMissCounter == -1){
+            benchCacheMissCounter = -2;
+        }
+    }
+    if(benchCacheMissCounter >= 0){
+        ioctl(benchCacheMissCounter,PERF_EVENT_IOC_RESET,0);
+        ioctl(benchCacheMissCounter,PERF_EVENT_IOC_ENABLE,0);
+    }
+#endif
+}
+
+//returns -1 when the cache misses can not be measured on this system
+static long long benchStopCacheMisses()
+{
+    long long count = -1;
+#ifdef __linux__
+    if(benchCacheMissCounter >= 0){
+        ioctl(benchCacheMissCounter,PERF_EVENT_IOC_DISABLE,0);
+        if(read(benchCacheMissCounter,&count,sizeof(count))!=sizeof(count)){
+            count = -1;
+        }
+    }
+#endif
+    return count;
+}
+
+//Copy the ground layer into the old flat layout
+static int *benchCreateFlatMap(isoMapT *isoMap)
+{
+    int x,y,layer;
+    int *flat = malloc((size_t)isoMap->mapWidth * isoMap->mapHeight * isoMap->numLayers * sizeof(int));
+
+    if(flat == NULL){
+        return NULL;
+    }
+    for(y=0;y<isoMap->mapHeight;++y){
+        for(x=0;x<isoMap->mapWidth;++x){
+            for(layer=0;layer<isoMap->numLayers;++layer){
+                flat[((size_t)y * isoMap->mapWidth + x) * isoMap->numLayers + layer] = isoMapGetTile(isoMap,x,y,layer);
+            }
+        }
+    }
+    return flat;
+}
+
+//Camera position for a frame: a diagonal pan followed by a pan down the screen
+static void benchCameraPos(isoMapT *isoMap,benchViewT *view,int frame,int numFrames,int *startRow,int *startColumn)
+{
+    int travel = isoMap->mapWidth - view->rows;
+    int half = numFrames/2;
+
+    if(frame<half){
+        *startRow = (travel * frame)/half;
+        *startColumn = -view->columns/2;
+    }
+    else{
+        *startRow = travel/2;
+        *startColumn = -isoMap->mapWidth/2 + ((isoMap->mapWidth - view->columns) * (frame-half))/half;
+    }
+}
+
+//Visit the visible tiles row by row on the screen, as the old draw loop did
+static long long benchFrameFlat(isoMapT *isoMap,int *flat,int startRow,int startColumn,benchViewT *view)
+{
+    int i,j,x,y;
+    long long sum = 0;
+
+    for(i=startRow;i<startRow+view->rows;++i){
+        for(j=startColumn;j<startColumn+view->columns;++j){
+            if((j&1) != (i&1)){
+                continue;
+            }
+            x = (i+j)/2;
+            y = (i-j)/2;
+            if(x>=0 && y>=0 && x<isoMap->mapWidth && y<isoMap->mapHeight){
+                sum += flat[((size_t)y * isoMap->mapWidth + x) * isoMap->numLayers];
+            }
+        }
+    }
+    return sum;
+}
+
+//Visit the visible tiles chunk by chunk, as isoEngineDrawIsoMap does. With unpacked set the ground layer is read
+//from plain int chunks instead, the way the map stored its tiles before they were packed.
+static long long benchFrameChunked(isoMapT *isoMap,int **unpacked,int startRow,int startColumn,benchViewT *view)
+{
+    int i,j,x,y;
+    int chunkX,chunkY;
+    isoMapChunkT *chunkData;
+    int rowData[MAP_CHUNK_SIZE];
+    int *row;
+    long long sum = 0;
+    int endRow = startRow+view->rows;
+    int endColumn = startColumn+view->columns;
+    int minX = SDL_max((startRow+startColumn)/2-1,0);
+    int maxX = SDL_min((endRow+endColumn)/2,isoMap->mapWidth-1);
+    int minY = SDL_max((startRow-endColumn)/2-1,0);
+    int maxY = SDL_min((endRow-startColumn)/2,isoMap->mapHeight-1);
+
+    for(chunkY=minY>>MAP_CHUNK_SHIFT;chunkY<=maxY>>MAP_CHUNK_SHIFT;++chunkY){
+        for(chunkX=minX>>MAP_CHUNK_SHIFT;chunkX<=maxX>>MAP_CHUNK_SHIFT;++chunkX){
+            chunkData = isoMapGetChunk(isoMap,chunkX,chunkY,0);
+            for(y=SDL_max(chunkY<<MAP_CHUNK_SHIFT,minY);y<=SDL_min((chunkY<<MAP_CHUNK_SHIFT)+MAP_CHUNK_MASK,maxY);++y){
+                if(unpacked != NULL){
+                    row = unpacked[chunkY*isoMap->numChunksX+chunkX] + ((y&MAP_CHUNK_MASK)<<MAP_CHUNK_SHIFT);
+                }
+                else{
+                    isoMapChunkGetRow(chunkData,y&MAP_CHUNK_MASK,rowData);
+                    row = rowData;
+                }
+                for(x=SDL_max(chunkX<<MAP_CHUNK_SHIFT,minX);x<=SDL_min((chunkX<<MAP_CHUNK_SHIFT)+MAP_CHUNK_MASK,maxX);++x){
+                    i = x+y;
+                    j = x-y;
+                    if(i<startRow || i>=endRow || j<startColumn || j>=endColumn){
+                        continue;
+                    }
+                    sum += row[x&MAP_CHUNK_MASK];
+                }
+            }
+        }
+    }
+    return sum;
+}
+
+static void benchMapLayout(FILE *out,int mapSize,int numFrames)
+{
+    int v,frame;
+    int startRow,startColumn;
+    int *flat;
+    long long sumFlat,sumChunked;
+    long long missesFlat,missesChunked;
+    Uint64 start,timeFlat,timeChunked;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    isoMapT *isoMap;
+
+    isoMap = isoMapCreateEmptyMap("Benchmark",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    if(isoMap == NULL){
+        fprintf(stderr,"Could not create the map!\n");
+        return;
+    }
+    flat = benchCreateFlatMap(isoMap);
+    if(flat == NULL){
+        fprintf(stderr,"Could not allocate the flat map!\n");
+        isoMapFreeMap(isoMap);
+        return;
+    }
+    fprintf(out,"{\n  \"benchmark\": \"layout\",\n  \"mapSize\": %d,\n  \"layers\": %d,\n  \"frames\": %d,\n  \"results\": [\n",
+            mapSize,BENCH_MAP_LAYERS,numFrames);
+
+    for(v=0;v<(int)SDL_arraysize(benchViews);++v){
+        sumFlat = 0;
+        benchStartCacheMisses();
+        start = SDL_GetPerformanceCounter();
+        for(frame=0;frame<numFrames;++frame){
+            benchCameraPos(isoMap,&benchViews[v],frame,numFrames,&startRow,&startColumn);
+            sumFlat += benchFrameFlat(isoMap,flat,startRow,startColumn,&benchViews[v]);
+        }
+        timeFlat = SDL_GetPerformanceCounter()-start;
+        missesFlat = benchStopCacheMisses();
+
+        sumChunked = 0;
+        benchStartCacheMisses();
+        start = SDL_GetPerformanceCounter();
+        for(frame=0;frame<numFrames;++frame){
+            benchCameraPos(isoMap,&benchViews[v],frame,numFrames,&startRow,&startColumn);
+            sumChunked += benchFrameChunked(isoMap,NULL,startRow,startColumn,&benchViews[v]);
+        }
+        timeChunked = SDL_GetPerformanceCounter()-start;
+        missesChunked = benchStopCacheMisses();
+
+        fprintf(out,"    {\"view\": \"%s\", \"flatMsPerFrame\": %.4f, \"flatCacheMisses\": %lld, "
+                    "\"chunkedMsPerFrame\": %.4f, \"chunkedCacheMisses\": %lld, \"tilesMatch\": %s}%s\n",
+                benchViews[v].name,
+                timeFlat*1000.0/freq/numFrames,missesFlat,
+                timeChunked*1000.0/freq/numFrames,missesChunked,
+                benchCheck(sumFlat == sumChunked),
+                v<(int)SDL_arraysize(benchViews)-1 ? "," : "");
+    }
+    fprintf(out,"  ]\n}\n");
+    free(flat);
+    isoMapFreeMap(isoMap);
+}
+
+static long long benchSumTiles(isoMapT *isoMap)
+{
+    int x,y,layer;
+    long long sum = 0;
+
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        for(y=0;y<isoMap->mapHeight;++y){
+            for(x=0;x<isoMap->mapWidth;++x){
+                sum += isoMapGetTile(isoMap,x,y,layer)*(long long)(layer+1);
+            }
+        }
+    }
+    return sum;
+}
+
+static void benchMapFile(FILE *out,int mapSize)
+{
+    int i;
+    long long sumGenerated,sumLoaded;
+    Uint64 start,timeGenerate,timeSave,timeLoad,timeFirstPass;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    isoMapT *isoMap;
+    isoMapT *loadedMap;
+    FILE *mapFile;
+    long fileSize = -1;
+
+    srand(1);
+    start = SDL_GetPerformanceCounter();
+    isoMap = isoMapCreateEmptyMap("Benchmark",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    timeGenerate = SDL_GetPerformanceCounter()-start;
+    if(isoMap == NULL){
+        fprintf(stderr,"Could not create the map!\n");
+        return;
+    }
+    //a few things standing around on the sparse upper layer
+    for(i=0;i<mapSize*4;++i){
+        isoMapSetTile(isoMap,rand()%mapSize,rand()%mapSize,1,1+rand()%4);
+    }
+    sumGenerated = benchSumTiles(isoMap);
+
+    start = SDL_GetPerformanceCounter();
+    if(isoMapSaveMap(isoMap,BENCH_MAPFILE_NAME)==0){
+        fprintf(stderr,"Could not save %s!\n",BENCH_MAPFILE_NAME);
+        isoMapFreeMap(isoMap);
+        return;
+    }
+    timeSave = SDL_GetPerformanceCounter()-start;
+    isoMapFreeMap(isoMap);
+
+    mapFile = fopen(BENCH_MAPFILE_NAME,"rb");
+    if(mapFile != NULL){
+        fseek(mapFile,0,SEEK_END);
+        fileSize = ftell(mapFile);
+        fclose(mapFile);
+    }
+
+    start = SDL_GetPerformanceCounter();
+    loadedMap = isoMapLoadMap(BENCH_MAPFILE_NAME);
+    timeLoad = SDL_GetPerformanceCounter()-start;
+    if(loadedMap == NULL){
+        fprintf(stderr,"Could not load %s!\n",BENCH_MAPFILE_NAME);
+        return;
+    }
+    start = SDL_GetPerformanceCounter();
+    sumLoaded = benchSumTiles(loadedMap);
+    timeFirstPass = SDL_GetPerformanceCounter()-start;
+
+    fprintf(out,"{\n  \"benchmark\": \"mapfile\",\n  \"mapSize\": %d,\n  \"layers\": %d,\n  \"fileMegabytes\": %.1f,\n"
+                "  \"generateMs\": %.2f,\n  \"saveMs\": %.2f,\n  \"loadMs\": %.3f,\n  \"firstPassMs\": %.2f,\n  \"tilesMatch\": %s\n}\n",
+            mapSize,BENCH_MAP_LAYERS,fileSize/(1024.0*1024.0),
+            timeGenerate*1000.0/freq,timeSave*1000.0/freq,timeLoad*1000.0/freq,timeFirstPass*1000.0/freq,
+            benchCheck(sumGenerated == sumLoaded));
+    isoMapFreeMap(loadedMap);
+    remove(BENCH_MAPFILE_NAME);
+}
+
+static int benchCompareDouble(const void *a,const void *b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da>db) - (da<db);
+}
+
+static double benchPercentile(double *sorted,int count,double percentile)
+{
+    int index = (int)(percentile*(count-1)+0.5);
+    return sorted[index];
+}
+
+//The same as drawCharacter() in the game
+static void benchDrawCharacter(isoEngineT *isoEngine,point2DT *charPoint)
+{
+    point2DT point;
+
+    if(textureQuadTableUpdate(&benchCharQuads,benchCharRects,NUM_CHARACTER_SPRITES,isoEngine->zoomLevel)==0){
+        return;
+    }
+    point.x = (int)(charPoint->x*isoEngine->zoomLevel)+ isoEngine->scrollX;
+    point.y = (int)(charPoint->y*isoEngine->zoomLevel)+ isoEngine->scrollY;
+    isoEngineConvert2dToIso(&point);
+    textureRenderXYClipSize(&benchCharacterTex,point.x,point.y,&benchCharRects[PLAYER_DIR_DOWN],&benchCharQuads.sizes[PLAYER_DIR_DOWN]);
+}
+
+//Move the camera along a scripted path, the same way the game moves it
+static void benchUpdateCamera(isoEngineT *isoEngine,benchCameraPathT cameraPath,int frame,point2DT *charPoint)
+{
+    switch(cameraPath)
+    {
+        case BENCH_CAMERA_STATIC:
+            if(frame == 0){
+                isoEngineCenterMap(isoEngine,charPoint);
+            }
+        break;
+
+        //scroll diagonally, as when the mouse is held in a corner of the screen
+        case BENCH_CAMERA_PAN:
+            if(frame == 0){
+                isoEngineCenterMap(isoEngine,charPoint);
+            }
+            isoEngine->mapScroll2Dpos.x+=isoEngine->mapScrollSpeed;
+            isoEngine->mapScroll2Dpos.y-=isoEngine->mapScrollSpeed;
+            isoEngineConvertCartesianCameraToIsometric(isoEngine,&isoEngine->mapScroll2Dpos);
+        break;
+
+        //the character walks down the screen and the camera follows it (object focus mode)
+        case BENCH_CAMERA_FOLLOW:
+            charPoint->x+=5;
+            charPoint->y+=5;
+            isoEngineCenterMap(isoEngine,charPoint);
+        break;
+
+        default:break;
+    }
+}
+
+//Puts the mouse at a screen position, as isoEngineUpdateMousePos does
+static void benchSetMouse(isoEngineT *isoEngine,int x,int y)
+{
+    isoEngine->mouseScreenPos.x = x;
+    isoEngine->mouseScreenPos.y = y;
+    isoEngine->mouseRect.x = x/isoEngine->zoomLevel;
+    isoEngine->mouseRect.y = y/isoEngine->zoomLevel;
+}
+
+static void benchDrawFrame(isoEngineT *isoEngine,point2DT *charPoint)
+{
+    SDL_SetRenderDrawColor(getRenderer(),0x3b,0x3b,0x3b,0x00);
+    SDL_RenderClear(getRenderer());
+
+    isoEngineDrawIsoMap(isoEngine);
+    benchDrawCharacter(isoEngine,charPoint);
+    isoEngineDrawIsoMouse(isoEngine);
+}
+
+//Draw the same frame with every draw mode and compare the pixels
+static int benchDrawModesMatch(isoEngineT *isoEngine,point2DT *charPoint)
+{
+    int mode;
+    int match = -1;
+    int pitch = WINDOW_WIDTH*4;
+    int drawMode = isoEngine->drawMode;
+    Uint8 *pixels[2];
+
+    pixels[0] = malloc(pitch*WINDOW_HEIGHT);
+    pixels[1] = malloc(pitch*WINDOW_HEIGHT);
+
+    if(pixels[0] != NULL && pixels[1] != NULL){
+        match = 1;
+        for(mode=ISO_ENGINE_DRAW_PER_TILE;mode<=ISO_ENGINE_DRAW_BATCHED;++mode){
+            isoEngine->drawMode = mode;
+            benchDrawFrame(isoEngine,charPoint);
+            if(SDL_RenderReadPixels(getRenderer(),NULL,SDL_PIXELFORMAT_ARGB8888,pixels[mode],pitch)!=0){
+                match = -1;
+                break;
+            }
+            SDL_RenderPresent(getRenderer());
+        }
+        if(match == 1 && memcmp(pixels[0],pixels[1],pitch*WINDOW_HEIGHT)!=0){
+            match = 0;
+        }
+    }
+    free(pixels[0]);
+    free(pixels[1]);
+    isoEngine->drawMode = drawMode;
+    return match;
+}
+
+static void benchRenderRun(FILE *out,isoEngineT *isoEngine,int mapSize,float zoomLevel,benchCameraPathT cameraPath,int numFrames,int last)
+{
+    int frame;
+    int drawCalls = 0;
+    int pixelMatch = -1;
+    double total = 0;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double *frameTimes = malloc(numFrames*sizeof(double));
+    Uint64 start;
+    point2DT charPoint;
+
+    if(frameTimes == NULL){
+        return;
+    }
+    //start in the middle of the map
+    charPoint.x = (mapSize/2)*isoEngine->isoMap->tileSize;
+    charPoint.y = (mapSize/2)*isoEngine->isoMap->tileSize;
+    isoEngine->zoomLevel = zoomLevel;
+
+    for(frame=0;frame<numFrames;++frame){
+        benchUpdateCamera(isoEngine,cameraPath,frame,&charPoint);
+
+        //move the mouse around the screen
+        benchSetMouse(isoEngine,(frame*7)%WINDOW_WIDTH,(frame*5)%WINDOW_HEIGHT);
+
+        if(frame == 0){
+            pixelMatch = benchDrawModesMatch(isoEngine,&charPoint);
+            resetDrawCallCount();
+        }
+
+        start = SDL_GetPerformanceCounter();
+        benchDrawFrame(isoEngine,&charPoint);
+        SDL_RenderPresent(getRenderer());
+        frameTimes[frame] = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        total += frameTimes[frame];
+    }
+    drawCalls = getDrawCallCount();
+
+    qsort(frameTimes,numFrames,sizeof(double),benchCompareDouble);
+    fprintf(out,"    {\"mapSize\": %d, \"zoom\": %.2f, \"camera\": \"%s\", \"drawMode\": \"%s\", \"frames\": %d, \"fps\": %.2f, "
+                "\"frameTimeP50Ms\": %.4f, \"frameTimeP99Ms\": %.4f, \"drawCallsPerFrame\": %.1f, \"pixelIdentical\": %s}%s\n",
+            mapSize,zoomLevel,benchCameraPathNames[cameraPath],benchDrawModeNames[isoEngine->drawMode],numFrames,
+            total>0 ? numFrames*1000.0/total : 0.0,
+            benchPercentile(frameTimes,numFrames,0.50),benchPercentile(frameTimes,numFrames,0.99),
+            (double)drawCalls/numFrames,pixelMatch == 1 ? "true" : (pixelMatch == 0 ? benchCheck(0) : "null"),last ? "" : ",");
+    fflush(out);
+    free(frameTimes);
+}
+
+//headless: no window system and no GPU needed
+static void benchInitHeadless()
+{
+    SDL_setenv("SDL_VIDEODRIVER","dummy",1);
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER,"software");
+    SDL_SetHint(SDL_HINT_RENDER_VSYNC,"0");
+    initSDL("Isometric Benchmark");
+}
+
+static void benchVisibility(FILE *out,int numCameras)
+{
+    int m,camera;
+    int x,y,tile;
+    int drawn,onScreen;
+    int mapSizes[][2] = {{64,64},{200,150},{37,300}};
+    long long offScreenDrawn = 0,onScreenMissed = 0,tilesDrawn = 0;
+    isoEngineT *isoEngine;
+    isoVisibleRangeT *range;
+    point2DT point;
+    SDL_Rect quad;
+
+    benchInitHeadless();
+    fprintf(out,"{\n  \"benchmark\": \"visibility\",\n  \"cameras\": %d,\n  \"results\": [\n",numCameras);
+    srand(1);
+
+    for(m=0;m<(int)SDL_arraysize(mapSizes);++m){
+        isoEngine = isoEngineNewIsoEngine();
+        if(isoEngine == NULL){
+            break;
+        }
+        isoEngine->isoMap = isoMapCreateEmptyMap("Visibility",mapSizes[m][0],mapSizes[m][1],1,BENCH_TILE_SIZE);
+        if(isoEngine->isoMap == NULL || isoMapLoadTileSet(isoEngine->isoMap,"data/isotiles.png",64,80)!=1){
+            fprintf(stderr,"Could not create the map or load data/isotiles.png!\n");
+            isoEngineFreeIsoEngine(isoEngine);
+            break;
+        }
+        range = &isoEngine->visibleTiles;
+        offScreenDrawn = 0;
+        onScreenMissed = 0;
+        tilesDrawn = 0;
+
+        for(camera=0;camera<numCameras;++camera){
+            //a zoom level the game can use, centered on a random point on or around the map
+            isoEngine->zoomLevel = 1.0+0.25*(rand()%9);
+            point.x = (rand()%(mapSizes[m][0]+20)-10)*isoEngine->isoMap->tileSize + rand()%isoEngine->isoMap->tileSize;
+            point.y = (rand()%(mapSizes[m][1]+20)-10)*isoEngine->isoMap->tileSize + rand()%isoEngine->isoMap->tileSize;
+            isoEngineCenterMap(isoEngine,&point);
+
+            isoEngineGetVisibleTiles(isoEngine,range);
+
+            for(y=0;y<isoEngine->isoMap->mapHeight;++y){
+                for(x=0;x<isoEngine->isoMap->mapWidth;++x){
+                    drawn = y>=range->startY && y<=range->endY &&
+                            x>=range->spanStartX[y-range->startY] && x<=range->spanEndX[y-range->startY];
+
+                    //where the tile ends up on the screen when it is drawn
+                    tile = isoMapGetTile(isoEngine->isoMap,x,y,0);
+                    point.x = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
+                    point.y = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
+                    isoEngineConvert2dToIso(&point);
+                    textureGetQuadXYClipScale(isoEngine->isoMap->tileSet->tilesTex,point.x,point.y,
+                                              &isoEngine->isoMap->tileSet->tileClipRects[tile],isoEngine->zoomLevel,&quad);
+                    onScreen = quad.x < WINDOW_WIDTH && quad.y < WINDOW_HEIGHT && quad.x+quad.w > 0 && quad.y+quad.h > 0;
+
+                    tilesDrawn += drawn;
+                    offScreenDrawn += drawn && !onScreen;
+                    onScreenMissed += onScreen && !drawn;
+                }
+            }
+        }
+        fprintf(out,"    {\"mapWidth\": %d, \"mapHeight\": %d, \"tilesDrawnPerFrame\": %.1f, \"offScreenDrawn\": %lld, \"onScreenMissed\": %lld, "
+                    "\"valid\": %s}%s\n",
+                mapSizes[m][0],mapSizes[m][1],(double)tilesDrawn/numCameras,offScreenDrawn,onScreenMissed,
+                benchCheck(offScreenDrawn == 0 && onScreenMissed == 0),m<(int)SDL_arraysize(mapSizes)-1 ? "," : "");
+        isoEngineFreeIsoEngine(isoEngine);
+    }
+    fprintf(out,"  ]\n}\n");
+    closeDownSDL();
+}
+
+static void benchRender(FILE *out,int numFrames)
+{
+    int i,m,z,c,d;
+    int x=0;
+    isoEngineT *isoEngine;
+    SDL_RendererInfo info;
+
+    benchInitHeadless();
+
+    textureInit(&benchCharacterTex,0,0,0,NULL,NULL,SDL_FLIP_NONE);
+    if(loadTexture(&benchCharacterTex,"data/character.png")==0){
+        fprintf(stderr,"Could not load data/character.png!\n");
+        closeDownSDL();
+        return;
+    }
+    for(i=0;i<NUM_CHARACTER_SPRITES;++i){
+        setupRect(&benchCharRects[i],x,0,70,102);
+        x+=70;
+    }
+    SDL_GetRendererInfo(getRenderer(),&info);
+    fprintf(out,"{\n  \"benchmark\": \"render\",\n  \"renderer\": \"%s\",\n  \"windowWidth\": %d,\n  \"windowHeight\": %d,\n  \"results\": [\n",
+            info.name,WINDOW_WIDTH,WINDOW_HEIGHT);
+
+    for(m=0;m<(int)SDL_arraysize(benchRenderMapSizes);++m){
+        isoEngine = isoEngineNewIsoEngine();
+        if(isoEngine == NULL){
+            break;
+        }
+        isoEngine->isoMap = isoMapCreateEmptyMap("Benchmark",benchRenderMapSizes[m],benchRenderMapSizes[m],BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+        if(isoEngine->isoMap == NULL || isoMapLoadTileSet(isoEngine->isoMap,"data/isotiles.png",64,80)!=1){
+            fprintf(stderr,"Could not create the map or load data/isotiles.png!\n");
+            isoEngineFreeIsoEngine(isoEngine);
+            break;
+        }
+        for(z=0;z<(int)SDL_arraysize(benchRenderZoomLevels);++z){
+            for(c=0;c<BENCH_NUM_CAMERA_PATHS;++c){
+                for(d=ISO_ENGINE_DRAW_PER_TILE;d<=ISO_ENGINE_DRAW_CACHED;++d){
+                    isoEngine->drawMode = d;
+                    benchRenderRun(out,isoEngine,benchRenderMapSizes[m],benchRenderZoomLevels[z],c,numFrames,
+                                   m==(int)SDL_arraysize(benchRenderMapSizes)-1 && z==(int)SDL_arraysize(benchRenderZoomLevels)-1 &&
+                                   c==BENCH_NUM_CAMERA_PATHS-1 && d==ISO_ENGINE_DRAW_CACHED);
+                }
+            }
+        }
+        isoEngineFreeIsoEngine(isoEngine);
+    }
+    fprintf(out,"  ]\n}\n");
+    textureDelete(&benchCharacterTex);
+    textureQuadTableFree(&benchCharQuads);
+    closeDownSDL();
+}
+
+static FILE *benchOpenOutput(int argc,char *argv[],int index)
+{
+    FILE *out = stdout;
+
+    if(argc>index){
+        out = fopen(argv[index],"w");
+        if(out == NULL){
+            fprintf(stderr,"Could not open %s for writing!\n",argv[index]);
+        }
+    }
+    return out;
+}
+
+//Pans fast across the map, numFrames frames from the middle towards a corner
+static void benchPagingRun(FILE *out,isoMapT *isoMap,char *mode,int numFrames,int last)
+{
+    int frame;
+    int missingFrames = 0;
+    double total = 0;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double *frameTimes = malloc(numFrames*sizeof(double));
+    Uint64 start;
+    isoEngineT *isoEngine;
+    point2DT charPoint;
+
+    isoEngine = isoEngineNewIsoEngine();
+    if(isoEngine == NULL || frameTimes == NULL){
+        free(frameTimes);
+        isoEngineFreeIsoEngine(isoEngine);
+        isoMapFreeMap(isoMap);
+        return;
+    }
+    isoEngine->isoMap = isoMap;
+    isoEngine->mapScrollSpeed = BENCH_PAGING_SCROLL_SPEED;
+    charPoint.x = (isoMap->mapWidth/2)*isoMap->tileSize;
+    charPoint.y = (isoMap->mapHeight/2)*isoMap->tileSize;
+
+    for(frame=0;frame<numFrames;++frame){
+        benchUpdateCamera(isoEngine,BENCH_CAMERA_PAN,frame,&charPoint);
+
+        start = SDL_GetPerformanceCounter();
+        SDL_RenderClear(getRenderer());
+        isoEngineDrawIsoMap(isoEngine);
+        SDL_RenderPresent(getRenderer());
+        frameTimes[frame] = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        total += frameTimes[frame];
+        if(frameTimes[frame] < BENCH_PAGING_FRAME_MS){
+            SDL_Delay(BENCH_PAGING_FRAME_MS-(Uint32)frameTimes[frame]);
+        }
+
+        if(isoMap->pager != NULL && isoMap->pager->missingChunks > 0){
+            missingFrames++;
+        }
+    }
+    qsort(frameTimes,numFrames,sizeof(double),benchCompareDouble);
+    fprintf(out,"    {\"mode\": \"%s\", \"frames\": %d, \"frameTimeAvgMs\": %.4f, \"frameTimeP99Ms\": %.4f, \"frameTimeMaxMs\": %.4f, "
+                "\"framesMissingChunks\": %d, \"chunksLoaded\": %d, \"chunksEvicted\": %d, \"residentMegabytes\": %.1f}%s\n",
+            mode,numFrames,total/numFrames,benchPercentile(frameTimes,numFrames,0.99),frameTimes[numFrames-1],missingFrames,
+            isoMap->pager != NULL ? isoMap->pager->chunksLoaded : 0,isoMap->pager != NULL ? isoMap->pager->chunksEvicted : 0,
+            isoMap->pager != NULL ? isoMap->pager->memoryUsed/(1024.0*1024.0) : 0.0,last ? "" : ",");
+    fflush(out);
+    free(frameTimes);
+    isoEngineFreeIsoEngine(isoEngine);
+}
+
+static void benchPaging(FILE *out,int mapSize,int numFrames)
+{
+    int i;
+    isoMapT *isoMap;
+
+    benchInitHeadless();
+    srand(1);
+    isoMap = isoMapCreateEmptyMap("Benchmark",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    if(isoMap == NULL || isoMapLoadTileSet(isoMap,"data/isotiles.png",64,80)!=1){
+        fprintf(stderr,"Could not create the map or load data/isotiles.png!\n");
+        isoMapFreeMap(isoMap);
+        closeDownSDL();
+        return;
+    }
+    for(i=0;i<mapSize*4;++i){
+        isoMapSetTile(isoMap,rand()%mapSize,rand()%mapSize,1,1+rand()%4);
+    }
+    if(isoMapSaveMap(isoMap,BENCH_MAPFILE_NAME)==0){
+        fprintf(stderr,"Could not save %s!\n",BENCH_MAPFILE_NAME);
+        isoMapFreeMap(isoMap);
+        closeDownSDL();
+        return;
+    }
+    fprintf(out,"{\n  \"benchmark\": \"paging\",\n  \"mapSize\": %d,\n  \"scrollSpeed\": %d,\n  \"budgetMegabytes\": %.1f,\n  \"results\": [\n",
+            mapSize,BENCH_PAGING_SCROLL_SPEED,BENCH_PAGING_BUDGET/(1024.0*1024.0));
+
+    //the run frees the map
+    benchPagingRun(out,isoMap,"memory",numFrames,0);
+    isoMap = isoMapLoadMap(BENCH_MAPFILE_NAME);
+    if(isoMap != NULL){
+        benchPagingRun(out,isoMap,"mapped",numFrames,0);
+    }
+    isoMap = isoMapLoadMapPaged(BENCH_MAPFILE_NAME,BENCH_PAGING_BUDGET);
+    if(isoMap != NULL){
+        benchPagingRun(out,isoMap,"paged",numFrames,1);
+    }
+    fprintf(out,"  ]\n}\n");
+    remove(BENCH_MAPFILE_NAME);
+    closeDownSDL();
+}
+
+typedef enum
+{
+    BENCH_DAMAGE_IDLE,
+    BENCH_DAMAGE_MOUSE,
+    BENCH_DAMAGE_ENTITY,
+    BENCH_DAMAGE_TILE_EDIT,
+    BENCH_DAMAGE_PAN,
+    BENCH_NUM_DAMAGE_SCENARIOS
+}benchDamageScenarioT;
+
+static char *benchDamageScenarioNames[BENCH_NUM_DAMAGE_SCENARIOS] = {"idle","mouse","entity","tileEdit","pan"};
+
+static void benchCharacterQuad(isoEngineT *isoEngine,point2DT *charPoint,SDL_Rect *quad)
+{
+    point2DT point;
+
+    if(textureQuadTableUpdate(&benchCharQuads,benchCharRects,NUM_CHARACTER_SPRITES,isoEngine->zoomLevel)==0){
+        setupRect(quad,0,0,0,0);
+        return;
+    }
+    point.x = (int)(charPoint->x*isoEngine->zoomLevel)+ isoEngine->scrollX;
+    point.y = (int)(charPoint->y*isoEngine->zoomLevel)+ isoEngine->scrollY;
+    isoEngineConvert2dToIso(&point);
+    textureGetQuadXYClipSize(point.x,point.y,&benchCharQuads.sizes[PLAYER_DIR_DOWN],quad);
+}
+
+//The game's draw(), with or without damage tracking
+static void benchDamageRun(FILE *out,isoEngineT *isoEngine,benchDamageScenarioT scenario,int useDamage,int numFrames,int last)
+{
+    int frame;
+    int tileX,tileY;
+    int tile = 0;
+    int drawn = 0;
+    double damagedArea = 0;
+    double total = 0;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint64 start;
+    isoDamageT *damage = useDamage ? isoDamageNew() : NULL;
+    point2DT charPoint;
+    SDL_Rect quad,charQuad;
+
+    charPoint.x = (isoEngine->isoMap->mapWidth/2)*isoEngine->isoMap->tileSize;
+    charPoint.y = (isoEngine->isoMap->mapHeight/2)*isoEngine->isoMap->tileSize;
+    isoEngine->zoomLevel = 1.0;
+    isoEngineCenterMap(isoEngine,&charPoint);
+    benchSetMouse(isoEngine,WINDOW_WIDTH/2,WINDOW_HEIGHT/2);
+    benchCharacterQuad(isoEngine,&charPoint,&charQuad);
+
+    for(frame=0;frame<numFrames;++frame){
+        switch(scenario)
+        {
+            case BENCH_DAMAGE_MOUSE:
+                benchSetMouse(isoEngine,(WINDOW_WIDTH/4 + frame*3)%WINDOW_WIDTH,(WINDOW_HEIGHT/4 + frame*2)%WINDOW_HEIGHT);
+            break;
+
+            case BENCH_DAMAGE_ENTITY:
+                charPoint.x+=5;
+                charPoint.y+=5;
+                if(frame%100 == 99){
+                    charPoint.x-=500;
+                    charPoint.y-=500;
+                }
+            break;
+
+            //a tile near the middle of the screen changes every 10th frame
+            case BENCH_DAMAGE_TILE_EDIT:
+                if(frame%10 == 0){
+                    tileX = isoEngine->isoMap->mapWidth/2 + (frame/10)%8;
+                    tileY = isoEngine->isoMap->mapHeight/2 - 4;
+                    tile = (tile+1)%isoEngine->isoMap->tileSet->numTileClipRects;
+                    isoMapSetTile(isoEngine->isoMap,tileX,tileY,0,tile);
+                }
+            break;
+
+            case BENCH_DAMAGE_PAN:
+                benchUpdateCamera(isoEngine,BENCH_CAMERA_PAN,frame+1,&charPoint);
+            break;
+
+            default:break;
+        }
+
+        start = SDL_GetPerformanceCounter();
+        benchCharacterQuad(isoEngine,&charPoint,&quad);
+        if(SDL_RectEquals(&quad,&charQuad) == SDL_FALSE){
+            isoDamageAddRect(damage,&charQuad);
+            isoDamageAddRect(damage,&quad);
+            charQuad = quad;
+        }
+        if(damage == NULL || isoDamageBeginFrame(damage,isoEngine)){
+            if(damage == NULL || damage->full){
+                damagedArea += 1.0;
+            }
+            else{
+                damagedArea += (double)damage->rect.w*damage->rect.h/((double)damage->width*damage->height);
+            }
+            SDL_SetRenderDrawColor(getRenderer(),0x3b,0x3b,0x3b,0x00);
+            SDL_RenderFillRect(getRenderer(),NULL);
+            isoEngineDrawIsoMap(isoEngine);
+            benchDrawCharacter(isoEngine,&charPoint);
+            isoEngineDrawIsoMouse(isoEngine);
+            isoDamageEndFrame(damage,isoEngine);
+            SDL_RenderPresent(getRenderer());
+            drawn++;
+        }
+        total += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    }
+    fprintf(out,"    {\"scenario\": \"%s\", \"damageTracking\": %s, \"frames\": %d, \"framesDrawn\": %d, \"framesSkipped\": %d, "
+                "\"repaintedScreenPercent\": %.1f, \"frameTimeAvgMs\": %.4f}%s\n",
+            benchDamageScenarioNames[scenario],useDamage ? "true" : "false",numFrames,drawn,numFrames-drawn,
+            100.0*damagedArea/numFrames,total/numFrames,last ? "" : ",");
+    fflush(out);
+    isoDamageFree(damage);
+}
+
+static void benchDamage(FILE *out,int numFrames)
+{
+    int i,s,d;
+    int x=0;
+    isoEngineT *isoEngine;
+
+    benchInitHeadless();
+    textureInit(&benchCharacterTex,0,0,0,NULL,NULL,SDL_FLIP_NONE);
+    if(loadTexture(&benchCharacterTex,"data/character.png")==0){
+        fprintf(stderr,"Could not load data/character.png!\n");
+        closeDownSDL();
+        return;
+    }
+    for(i=0;i<NUM_CHARACTER_SPRITES;++i){
+        setupRect(&benchCharRects[i],x,0,70,102);
+        x+=70;
+    }
+    fprintf(out,"{\n  \"benchmark\": \"damage\",\n  \"results\": [\n");
+
+    for(s=0;s<BENCH_NUM_DAMAGE_SCENARIOS;++s){
+        for(d=0;d<2;++d){
+            //a fresh map and engine, so every run starts with the same tiles and an empty render cache
+            isoEngine = isoEngineNewIsoEngine();
+            if(isoEngine == NULL){
+                break;
+            }
+            isoEngine->isoMap = isoMapCreateEmptyMap("Damage",512,512,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+            if(isoEngine->isoMap == NULL || isoMapLoadTileSet(isoEngine->isoMap,"data/isotiles.png",64,80)!=1){
+                fprintf(stderr,"Could not create the map or load data/isotiles.png!\n");
+                isoEngineFreeIsoEngine(isoEngine);
+                break;
+            }
+            benchDamageRun(out,isoEngine,s,d,numFrames,s==BENCH_NUM_DAMAGE_SCENARIOS-1 && d==1);
+            isoEngineFreeIsoEngine(isoEngine);
+        }
+    }
+    fprintf(out,"  ]\n}\n");
+    textureDelete(&benchCharacterTex);
+    textureQuadTableFree(&benchCharQuads);
+    closeDownSDL();
+}
+
+static int benchLoopFrameCaps[] = {0,60,144};
+
+static void benchLoopRun(FILE *out,isoEngineT *isoEngine,int maxFramesPerSecond,int seconds,int last)
+{
+    int i,ticks;
+    int frame = 0;
+    int tick = 0;
+    float alpha;
+    double elapsed;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint64 start;
+    Uint32 lastPoll = SDL_GetTicks();
+    int scrollX,scrollY;
+    int prevScrollX,prevScrollY;
+    point2DT charPoint,prevCharPoint,drawCharPoint;
+    frameTimerT timer;
+
+    charPoint.x = (isoEngine->isoMap->mapWidth/2)*isoEngine->isoMap->tileSize;
+    charPoint.y = (isoEngine->isoMap->mapHeight/2)*isoEngine->isoMap->tileSize;
+    prevCharPoint = charPoint;
+    isoEngine->zoomLevel = 1.0;
+    benchUpdateCamera(isoEngine,BENCH_CAMERA_PAN,0,&charPoint);
+    prevScrollX = isoEngine->scrollX;
+    prevScrollY = isoEngine->scrollY;
+
+    frameTimerInit(&timer,BENCH_LOOP_TICKS_PER_SECOND,maxFramesPerSecond);
+    start = SDL_GetPerformanceCounter();
+    while((SDL_GetPerformanceCounter()-start)/freq < seconds){
+        //a key press or a click, that came in right after the events of the last frame were handled
+        if(frame%10 == 0){
+            frameTimerInputEvent(&timer,lastPoll);
+        }
+        lastPoll = SDL_GetTicks();
+        ticks = frameTimerBeginFrame(&timer);
+        for(i=0;i<ticks;++i){
+            prevScrollX = isoEngine->scrollX;
+            prevScrollY = isoEngine->scrollY;
+            prevCharPoint = charPoint;
+            benchUpdateCamera(isoEngine,BENCH_CAMERA_PAN,++tick,&charPoint);
+            charPoint.x+=5;
+            charPoint.y-=5;
+        }
+        frameTimerEndSimulation(&timer);
+
+        //draw between the last two ticks, the same way the game does
+        alpha = frameTimerGetAlpha(&timer);
+        scrollX = isoEngine->scrollX;
+        scrollY = isoEngine->scrollY;
+        isoEngine->scrollX = prevScrollX + (int)floorf((scrollX-prevScrollX)*alpha+0.5f);
+        isoEngine->scrollY = prevScrollY + (int)floorf((scrollY-prevScrollY)*alpha+0.5f);
+        drawCharPoint.x = prevCharPoint.x + (charPoint.x-prevCharPoint.x)*alpha;
+        drawCharPoint.y = prevCharPoint.y + (charPoint.y-prevCharPoint.y)*alpha;
+        benchDrawFrame(isoEngine,&drawCharPoint);
+        SDL_RenderPresent(getRenderer());
+        isoEngine->scrollX = scrollX;
+        isoEngine->scrollY = scrollY;
+
+        frameTimerEndFrame(&timer,1);
+        frame++;
+    }
+    elapsed = (SDL_GetPerformanceCounter()-start)/freq;
+
+    fprintf(out,"    {\"frameCap\": %d, \"seconds\": %.2f, \"fps\": %.1f, \"ticksPerSecond\": %.1f, \"ticksDropped\": %d, "
+                "\"simulationMsPerFrame\": %.4f, \"drawMsPerFrame\": %.4f, \"latencyAvgMs\": %.2f, \"latencyMaxMs\": %u}%s\n",
+            maxFramesPerSecond,elapsed,timer.numFrames/elapsed,timer.numTicks/elapsed,timer.numTicksDropped,
+            timer.simulationTime*1000.0/timer.frequency/timer.numFrames,timer.renderTime*1000.0/timer.frequency/timer.numFrames,
+            timer.numLatencies > 0 ? (double)timer.latencySum/timer.numLatencies : 0.0,timer.latencyMax,last ? "" : ",");
+    fflush(out);
+}
+
+static void benchLoop(FILE *out,int seconds)
+{
+    int i,c;
+    int x=0;
+    isoEngineT *isoEngine;
+
+    benchInitHeadless();
+    textureInit(&benchCharacterTex,0,0,0,NULL,NULL,SDL_FLIP_NONE);
+    if(loadTexture(&benchCharacterTex,"data/character.png")==0){
+        fprintf(stderr,"Could not load data/character.png!\n");
+        closeDownSDL();
+        return;
+    }
+    for(i=0;i<NUM_CHARACTER_SPRITES;++i){
+        setupRect(&benchCharRects[i],x,0,70,102);
+        x+=70;
+    }
+    isoEngine = isoEngineNewIsoEngine();
+    if(isoEngine != NULL){
+        isoEngine->isoMap = isoMapCreateEmptyMap("Loop",BENCH_MAP_SIZE,BENCH_MAP_SIZE,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    }
+    if(isoEngine == NULL || isoEngine->isoMap == NULL || isoMapLoadTileSet(isoEngine->isoMap,"data/isotiles.png",64,80)!=1){
+        fprintf(stderr,"Could not create the map or load data/isotiles.png!\n");
+        isoEngineFreeIsoEngine(isoEngine);
+        textureDelete(&benchCharacterTex);
+        textureQuadTableFree(&benchCharQuads);
+        closeDownSDL();
+        return;
+    }
+    fprintf(out,"{\n  \"benchmark\": \"loop\",\n  \"ticksPerSecond\": %d,\n  \"results\": [\n",BENCH_LOOP_TICKS_PER_SECOND);
+    for(c=0;c<(int)SDL_arraysize(benchLoopFrameCaps);++c){
+        benchLoopRun(out,isoEngine,benchLoopFrameCaps[c],seconds,c==(int)SDL_arraysize(benchLoopFrameCaps)-1);
+    }
+    fprintf(out,"  ]\n}\n");
+    isoEngineFreeIsoEngine(isoEngine);
+    textureDelete(&benchCharacterTex);
+    textureQuadTableFree(&benchCharQuads);
+    closeDownSDL();
+}
+
+//zoomed out as far as 8x, at 0.125 the 1200x720 window shows as many tiles as 9600x5760 at zoom 1.0
+static float benchBandsZoomLevels[] = {1.0,0.5,0.25,0.125};
+
+//Draws one frame of the map and reads it back, returns 0 on failure
+static int benchReadMapFrame(isoEngineT *isoEngine,Uint8 *pixels)
+{
+    SDL_SetRenderDrawColor(getRenderer(),0x3b,0x3b,0x3b,0x00);
+    SDL_RenderClear(getRenderer());
+    isoEngineDrawIsoMap(isoEngine);
+    return SDL_RenderReadPixels(getRenderer(),NULL,SDL_PIXELFORMAT_ARGB8888,pixels,WINDOW_WIDTH*4)==0;
+}
+
+static void benchBandsRun(FILE *out,isoEngineT *isoEngine,float zoomLevel,int numThreads,int numFrames,
+                          Uint8 *reference,Uint8 *pixels,double *singleThreadMs,int last)
+{
+    int frame;
+    int pixelMatch = -1;
+    long long numTiles = 0;
+    double total = 0;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double *frameTimes = malloc(numFrames*sizeof(double));
+    Uint64 start;
+    point2DT charPoint;
+
+    threadPoolFree(isoEngine->threadPool);
+    isoEngine->threadPool = threadPoolNew(numThreads-1);
+    if(frameTimes == NULL || isoEngine->threadPool == NULL){
+        free(frameTimes);
+        return;
+    }
+    charPoint.x = (BENCH_MAP_SIZE/2)*isoEngine->isoMap->tileSize;
+    charPoint.y = (BENCH_MAP_SIZE/2)*isoEngine->isoMap->tileSize;
+    isoEngine->zoomLevel = zoomLevel;
+
+    for(frame=0;frame<numFrames;++frame){
+        benchUpdateCamera(isoEngine,BENCH_CAMERA_PAN,frame,&charPoint);
+
+        //the first frame is compared with the one generated on a single thread
+        if(frame == 0 && pixels != NULL){
+            if(benchReadMapFrame(isoEngine,numThreads == 1 ? reference : pixels)){
+                pixelMatch = numThreads == 1 || memcmp(reference,pixels,WINDOW_WIDTH*4*WINDOW_HEIGHT)==0;
+            }
+        }
+        if(isoEngineGetVisibleTiles(isoEngine,&isoEngine->visibleTiles)==0){
+            frameTimes[frame] = 0;
+            continue;
+        }
+        start = SDL_GetPerformanceCounter();
+        isoEngineBuildMapBatch(isoEngine,&isoEngine->visibleTiles);
+        frameTimes[frame] = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        total += frameTimes[frame];
+        numTiles += isoEngine->mapBatch.numQuads;
+    }
+    if(numThreads == 1){
+        *singleThreadMs = total/numFrames;
+    }
+    qsort(frameTimes,numFrames,sizeof(double),benchCompareDouble);
+    fprintf(out,"    {\"zoom\": %.3f, \"threads\": %d, \"frames\": %d, \"tilesPerFrame\": %lld, \"avgMs\": %.4f, \"p99Ms\": %.4f, "
+                "\"speedup\": %.2f, \"pixelIdentical\": %s}%s\n",
+            zoomLevel,threadPoolGetNumThreads(isoEngine->threadPool),numFrames,numTiles/numFrames,total/numFrames,
+            benchPercentile(frameTimes,numFrames,0.99),total > 0 ? *singleThreadMs/(total/numFrames) : 0.0,
+            pixelMatch == 1 ? "true" : (pixelMatch == 0 ? benchCheck(0) : "null"),last ? "" : ",");
+    fflush(out);
+    free(frameTimes);
+}
+
+static void benchBands(FILE *out,int numFrames)
+{
+    int z,threads;
+    int numCores = SDL_GetCPUCount();
+    double singleThreadMs = 0;
+    Uint8 *reference,*pixels;
+    isoEngineT *isoEngine;
+
+    benchInitHeadless();
+    isoEngine = isoEngineNewIsoEngine();
+    if(isoEngine != NULL){
+        isoEngine->isoMap = isoMapCreateEmptyMap("Bands",BENCH_MAP_SIZE,BENCH_MAP_SIZE,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    }
+    if(isoEngine == NULL || isoEngine->isoMap == NULL || isoMapLoadTileSet(isoEngine->isoMap,"data/isotiles.png",64,80)!=1){
+        fprintf(stderr,"Could not create the map or load data/isotiles.png!\n");
+        isoEngineFreeIsoEngine(isoEngine);
+        closeDownSDL();
+        return;
+    }
+    isoEngine->drawMode = ISO_ENGINE_DRAW_BATCHED;
+    reference = malloc(WINDOW_WIDTH*4*WINDOW_HEIGHT);
+    pixels = malloc(WINDOW_WIDTH*4*WINDOW_HEIGHT);
+    if(reference == NULL || pixels == NULL){
+        free(reference);
+        free(pixels);
+        reference = pixels = NULL;
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"bands\",\n  \"cpuCores\": %d,\n  \"results\": [\n",numCores);
+    for(z=0;z<(int)SDL_arraysize(benchBandsZoomLevels);++z){
+        //1, 2, 4 ... threads, and all cores last
+        for(threads=1;threads<numCores*2;threads*=2){
+            threads = SDL_min(threads,numCores);
+            benchBandsRun(out,isoEngine,benchBandsZoomLevels[z],threads,numFrames,reference,pixels,&singleThreadMs,
+                          z==(int)SDL_arraysize(benchBandsZoomLevels)-1 && threads==numCores);
+            if(threads == numCores){
+                break;
+            }
+        }
+    }
+    fprintf(out,"  ]\n}\n");
+    free(reference);
+    free(pixels);
+    isoEngineFreeIsoEngine(isoEngine);
+    closeDownSDL();
+}
+
+static void benchTransformPrint(FILE *out,char *conversion,char *implementation,int numPoints,double ms,double singlePointMs,int identical,int last)
+{
+    fprintf(out,"    {\"conversion\": \"%s\", \"implementation\": \"%s\", \"points\": %d, \"ms\": %.4f, \"mpointsPerSecond\": %.1f, "
+                "\"speedup\": %.2f, \"bitIdentical\": %s}%s\n",
+            conversion,implementation,numPoints,ms,ms > 0 ? numPoints/ms/1000.0 : 0.0,ms > 0 ? singlePointMs/ms : 0.0,
+            identical == 1 ? "true" : (identical == 0 ? benchCheck(0) : "null"),last ? "" : ",");
+}
+
+static void benchTransformFree(point2DT *points,float *srcX,float *srcY,float *refX,float *refY,float *x,float *y)
+{
+    free(points);
+    free(srcX);
+    free(srcY);
+    free(refX);
+    free(refY);
+    free(x);
+    free(y);
+}
+
+static void benchTransform(FILE *out,int numPoints)
+{
+    int i,c,r,impl;
+    int best = isoTransformSetImplementation(ISO_TRANSFORM_AUTO);
+    double ms,singlePointMs;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    char *conversionNames[2] = {"2dToIso","isoTo2D"};
+    Uint64 start;
+    point2DT *points = malloc(numPoints*sizeof(point2DT));
+    float *srcX = malloc(numPoints*sizeof(float));
+    float *srcY = malloc(numPoints*sizeof(float));
+    float *refX = malloc(numPoints*sizeof(float));
+    float *refY = malloc(numPoints*sizeof(float));
+    float *x = malloc(numPoints*sizeof(float));
+    float *y = malloc(numPoints*sizeof(float));
+
+    if(points == NULL || srcX == NULL || srcY == NULL || refX == NULL || refY == NULL || x == NULL || y == NULL){
+        fprintf(stderr,"Could not allocate memory for %d points!\n",numPoints);
+        benchTransformFree(points,srcX,srcY,refX,refY,x,y);
+        return;
+    }
+    //screen and map positions, whole and fractional, with halves and negative values where the truncation matters
+    srand(1);
+    for(i=0;i<numPoints;++i){
+        srcX[i] = (rand()%400000 - 200000) + (rand()%8)*0.25f;
+        srcY[i] = (rand()%400000 - 200000) + (rand()%8)*0.25f;
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"transform\",\n  \"results\": [\n");
+    for(c=0;c<2;++c){
+        //the single point versions, as they are called today
+        singlePointMs = 0;
+        for(r=0;r<BENCH_TRANSFORM_REPEATS;++r){
+            for(i=0;i<numPoints;++i){
+                points[i].x = srcX[i];
+                points[i].y = srcY[i];
+            }
+            start = SDL_GetPerformanceCounter();
+            if(c == 0){
+                for(i=0;i<numPoints;++i){
+                    isoEngineConvert2dToIso(&points[i]);
+                }
+            }
+            else{
+                for(i=0;i<numPoints;++i){
+                    isoEngineConvertIsoTo2D(&points[i]);
+                }
+            }
+            singlePointMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        }
+        singlePointMs /= BENCH_TRANSFORM_REPEATS;
+        for(i=0;i<numPoints;++i){
+            refX[i] = points[i].x;
+            refY[i] = points[i].y;
+        }
+        benchTransformPrint(out,conversionNames[c],"singlePoint",numPoints,singlePointMs,singlePointMs,1,0);
+
+        for(impl=ISO_TRANSFORM_SCALAR;impl<ISO_TRANSFORM_NUM_IMPLEMENTATIONS;++impl){
+            if(isoTransformSetImplementation(impl) != impl){
+                continue;
+            }
+            ms = 0;
+            for(r=0;r<BENCH_TRANSFORM_REPEATS;++r){
+                memcpy(x,srcX,numPoints*sizeof(float));
+                memcpy(y,srcY,numPoints*sizeof(float));
+                start = SDL_GetPerformanceCounter();
+                if(c == 0){
+                    isoTransformConvert2dToIso(x,y,numPoints);
+                }
+                else{
+                    isoTransformConvertIsoTo2D(x,y,numPoints);
+                }
+                ms += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+            }
+            benchTransformPrint(out,conversionNames[c],(char*)isoTransformGetImplementationName(impl),numPoints,
+                                ms/BENCH_TRANSFORM_REPEATS,singlePointMs,
+                                memcmp(x,refX,numPoints*sizeof(float))==0 && memcmp(y,refY,numPoints*sizeof(float))==0,
+                                c==1 && impl==best);
+            fflush(out);
+        }
+    }
+    fprintf(out,"  ]\n}\n");
+    isoTransformSetImplementation(best);
+    benchTransformFree(points,srcX,srcY,refX,refY,x,y);
+}
+
+static float benchPickingZoomLevels[] = {0.25,0.5,1.0,1.25,1.5,2.0,2.5,3.0};
+
+//isoEngineGetMouseTilePos as it was: the mouse snapped to half tiles, then corrected by the scroll position
+static void benchLegacyPick(isoEngineT *isoEngine,int screenX,int screenY,int *tileX,int *tileY)
+{
+    int tileSize = isoEngine->isoMap->tileSize;
+    int modulusX = tileSize*isoEngine->zoomLevel;
+    int modulusY = tileSize*isoEngine->zoomLevel;
+    int correctX =(((int)isoEngine->mapScroll2Dpos.x)%modulusX)*2;
+    int correctY = ((int)isoEngine->mapScroll2Dpos.y)%modulusY;
+    int mouseX = screenX/isoEngine->zoomLevel;
+    int mouseY = screenY/isoEngine->zoomLevel;
+    point2DT mousePoint,point,tileShift;
+
+    mousePoint.x = (mouseX/tileSize) * tileSize;
+    mousePoint.y = (mouseY/tileSize) * tileSize;
+    if(((int)mousePoint.x/tileSize)%2){
+        mousePoint.y+=tileSize*0.5;
+    }
+    isoEngineConvertIsoTo2D(&mousePoint);
+    isoEngineGetTileCoordinates(isoEngine,&mousePoint,&point);
+
+    tileShift.x = correctX;
+    tileShift.y = correctY;
+    isoEngineConvert2dToIso(&tileShift);
+
+    point.y -= (((float)isoEngine->scrollY-tileShift.y)/(float)tileSize)/isoEngine->zoomLevel;
+    if(isoEngine->mapScroll2Dpos.y>0){
+        point.y+=1;
+    }
+    point.x -= (((float)isoEngine->scrollX+(float)tileShift.x)/(float)tileSize)/isoEngine->zoomLevel;
+    if(isoEngine->mapScroll2Dpos.x>0){
+        point.x+=1;
+    }
+    *tileX = (int)point.x;
+    *tileY = (int)point.y;
+}
+
+//Tests the pixel against the diamond of every visible tile in drawing order, the last one drawn over it wins.
+//Returns 0 if no diamond covers the pixel.
+static int benchBruteForcePick(isoEngineT *isoEngine,isoVisibleRangeT *range,int screenX,int screenY,int *tileX,int *tileY)
+{
+    int x,y;
+    int chunkX,chunkY;
+    int found = 0;
+    double step = isoEngine->zoomLevel*isoEngine->isoMap->tileSize;
+    double dx,dy;
+    point2DT point;
+    SDL_Rect quad;
+
+    for(chunkY=range->startY>>MAP_CHUNK_SHIFT;chunkY<=range->endY>>MAP_CHUNK_SHIFT;++chunkY){
+        for(chunkX=range->minX>>MAP_CHUNK_SHIFT;chunkX<=range->maxX>>MAP_CHUNK_SHIFT;++chunkX){
+            for(y=SDL_max(chunkY<<MAP_CHUNK_SHIFT,range->startY);y<=SDL_min((chunkY<<MAP_CHUNK_SHIFT)+MAP_CHUNK_MASK,range->endY);++y){
+                for(x=SDL_max(range->spanStartX[y-range->startY],chunkX<<MAP_CHUNK_SHIFT);
+                    x<=SDL_min(range->spanEndX[y-range->startY],(chunkX<<MAP_CHUNK_SHIFT)+MAP_CHUNK_MASK);++x){
+                    point.x = ((x*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollX);
+                    point.y = ((y*isoEngine->zoomLevel *isoEngine->isoMap->tileSize) + isoEngine->scrollY);
+                    isoEngineConvert2dToIso(&point);
+                    textureGetQuadXYClipScale(isoEngine->isoMap->tileSet->tilesTex,point.x,point.y,NULL,isoEngine->zoomLevel,&quad);
+
+                    dx = fabs(screenX+0.5 - (quad.x+step));
+                    dy = fabs(screenY+0.5 - (quad.y+step/2));
+                    if(dx/step + dy/(step/2) <= 1.0){
+                        *tileX = x;
+                        *tileY = y;
+                        found = 1;
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
+
+static void benchPicking(FILE *out,int numPoints)
+{
+    int i,z,camera;
+    int tileX,tileY,refX,refY;
+    int picked,onMap,mapSize = 256;
+    int sum = 0;
+    long long checked,newWrong,legacyWrong,seams;
+    double legacyMs,singleMs,batchMs;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint64 start;
+    point2DT center;
+    isoEngineT *isoEngine;
+    SDL_Point *points = malloc(numPoints*sizeof(SDL_Point));
+    SDL_Point *tiles = malloc(numPoints*sizeof(SDL_Point));
+
+    benchInitHeadless();
+    isoEngine = isoEngineNewIsoEngine();
+    if(isoEngine != NULL){
+        isoEngine->isoMap = isoMapCreateEmptyMap("Picking",mapSize,mapSize,1,BENCH_TILE_SIZE);
+    }
+    if(points == NULL || tiles == NULL || isoEngine == NULL || isoEngine->isoMap == NULL ||
+       isoMapLoadTileSet(isoEngine->isoMap,"data/isotiles.png",64,80)!=1){
+        fprintf(stderr,"Could not allocate the points, create the map or load data/isotiles.png!\n");
+        free(points);
+        free(tiles);
+        isoEngineFreeIsoEngine(isoEngine);
+        closeDownSDL();
+        return;
+    }
+    srand(1);
+    for(i=0;i<numPoints;++i){
+        points[i].x = rand()%WINDOW_WIDTH;
+        points[i].y = rand()%WINDOW_HEIGHT;
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"picking\",\n  \"cameras\": %d,\n  \"results\": [\n",BENCH_PICKING_CAMERAS);
+    for(z=0;z<(int)SDL_arraysize(benchPickingZoomLevels);++z){
+        isoEngine->zoomLevel = benchPickingZoomLevels[z];
+        checked = newWrong = legacyWrong = seams = 0;
+        legacyMs = singleMs = batchMs = 0;
+
+        for(camera=0;camera<BENCH_PICKING_CAMERAS;++camera){
+            //a random camera over the map, scrolled by whole and odd pixels
+            center.x = rand()%(mapSize*isoEngine->isoMap->tileSize);
+            center.y = rand()%(mapSize*isoEngine->isoMap->tileSize);
+            isoEngineCenterMap(isoEngine,&center);
+            isoEngineGetVisibleTiles(isoEngine,&isoEngine->visibleTiles);
+
+            for(i=0;i<BENCH_PICKING_CHECKS;++i){
+                onMap = isoEnginePickTile(isoEngine,points[i].x,points[i].y,&tileX,&tileY);
+                if(!benchBruteForcePick(isoEngine,&isoEngine->visibleTiles,points[i].x,points[i].y,&refX,&refY)){
+                    //between the rounded diamonds, or off the map
+                    seams += onMap;
+                    continue;
+                }
+                checked++;
+                newWrong += tileX != refX || tileY != refY;
+                benchLegacyPick(isoEngine,points[i].x,points[i].y,&tileX,&tileY);
+                legacyWrong += tileX != refX || tileY != refY;
+            }
+
+            //timing, every version picks all points
+            start = SDL_GetPerformanceCounter();
+            for(i=0;i<numPoints/BENCH_PICKING_CAMERAS;++i){
+                benchLegacyPick(isoEngine,points[i].x,points[i].y,&tileX,&tileY);
+                sum += tileX+tileY;
+            }
+            legacyMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+            start = SDL_GetPerformanceCounter();
+            for(i=0;i<numPoints/BENCH_PICKING_CAMERAS;++i){
+                isoEnginePickTile(isoEngine,points[i].x,points[i].y,&tileX,&tileY);
+                sum += tileX+tileY;
+            }
+            singleMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+            start = SDL_GetPerformanceCounter();
+            picked = isoEnginePickTiles(isoEngine,points,tiles,numPoints/BENCH_PICKING_CAMERAS);
+            batchMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+            sum += picked;
+        }
+        numPoints = numPoints/BENCH_PICKING_CAMERAS*BENCH_PICKING_CAMERAS;
+        fprintf(out,"    {\"zoom\": %.2f, \"checkedPoints\": %lld, \"wrongPicks\": %lld, \"legacyWrongPicks\": %lld, \"seamPixels\": %lld, "
+                    "\"legacyNsPerPoint\": %.1f, \"singleNsPerPoint\": %.1f, \"batchNsPerPoint\": %.1f, \"valid\": %s}%s\n",
+                benchPickingZoomLevels[z],checked,newWrong,legacyWrong,seams,
+                legacyMs*1000000.0/numPoints,singleMs*1000000.0/numPoints,batchMs*1000000.0/numPoints,benchCheck(newWrong == 0),
+                z==(int)SDL_arraysize(benchPickingZoomLevels)-1 ? "" : ",");
+        fflush(out);
+    }
+    fprintf(out,"  ],\n  \"checksum\": %d\n}\n",sum);
+    free(points);
+    free(tiles);
+    isoEngineFreeIsoEngine(isoEngine);
+    closeDownSDL();
+}
+
+static void benchTexCacheRun(FILE *out,int numMaps,int shared,int last)
+{
+    int i;
+    double ms = 0;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint64 start;
+    textureCacheStatsT stats;
+    isoMapT **maps = calloc(numMaps,sizeof(isoMapT*));
+
+    if(maps == NULL){
+        return;
+    }
+    textureCachePurge();
+    textureCacheResetStats();
+
+    for(i=0;i<numMaps;++i){
+        maps[i] = isoMapCreateEmptyMap("TexCache",64,64,1,BENCH_TILE_SIZE);
+        if(maps[i] == NULL){
+            break;
+        }
+        start = SDL_GetPerformanceCounter();
+        isoMapLoadTileSet(maps[i],"data/isotiles.png",64,80);
+        ms += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+        //without sharing every map loads the file on its own
+        if(!shared){
+            isoMapFreeMap(maps[i]);
+            maps[i] = NULL;
+            textureCachePurge();
+        }
+    }
+    textureCacheGetStats(&stats);
+    fprintf(out,"    {\"mode\": \"%s\", \"maps\": %d, \"msPerLoad\": %.4f, \"hits\": %d, \"misses\": %d, "
+                "\"texturesCached\": %d, \"textureMemoryBytes\": %u}%s\n",
+            shared ? "shared" : "purged",i,i > 0 ? ms/i : 0.0,stats.hits,stats.misses,stats.numTextures,(unsigned int)stats.memory,last ? "" : ",");
+    fflush(out);
+
+    for(i=0;i<numMaps;++i){
+        isoMapFreeMap(maps[i]);
+    }
+    free(maps);
+}
+
+static void benchTexCache(FILE *out,int numMaps)
+{
+    benchInitHeadless();
+    fprintf(out,"{\n  \"benchmark\": \"texcache\",\n  \"results\": [\n");
+    benchTexCacheRun(out,numMaps,0,0);
+    benchTexCacheRun(out,numMaps,1,1);
+    fprintf(out,"  ]\n}\n");
+    closeDownSDL();
+}
+
+static float benchQuadsZoomLevels[] = {0.25,0.5,0.75,1.0,1.25,1.5,1.75,2.0,2.25,2.5,2.75,3.0};
+
+static void benchQuads(FILE *out,int numQuads)
+{
+    int i,z,repeat;
+    int identical;
+    double scaleMs,tableMs;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    float zoomLevel;
+    Uint64 start;
+    SDL_Point *quadSizes;
+    SDL_Point *points = malloc(numQuads*sizeof(SDL_Point));
+    int *tiles = malloc(numQuads*sizeof(int));
+    textureBatchT scaled,table;
+    isoMapT *isoMap;
+
+    benchInitHeadless();
+    textureBatchInit(&scaled);
+    textureBatchInit(&table);
+    isoMap = isoMapCreateEmptyMap("Quads",64,64,1,BENCH_TILE_SIZE);
+    if(points == NULL || tiles == NULL || isoMap == NULL || isoMapLoadTileSet(isoMap,"data/isotiles.png",64,80)!=1){
+        fprintf(stderr,"Could not create the map or load data/isotiles.png!\n");
+        free(points);
+        free(tiles);
+        isoMapFreeMap(isoMap);
+        closeDownSDL();
+        return;
+    }
+    srand(16);
+    for(i=0;i<numQuads;++i){
+        points[i].x = rand()%(WINDOW_WIDTH+256)-128;
+        points[i].y = rand()%(WINDOW_HEIGHT+256)-128;
+        tiles[i] = rand()%isoMap->tileSet->numTileClipRects;
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"quads\",\n  \"quads\": %d,\n  \"results\": [\n",numQuads);
+    for(z=0;z<(int)SDL_arraysize(benchQuadsZoomLevels);++z){
+        zoomLevel = benchQuadsZoomLevels[z];
+        scaleMs = 0;
+        tableMs = 0;
+        for(repeat=0;repeat<BENCH_QUADS_REPEATS;++repeat){
+            textureBatchBegin(&scaled,isoMap->tileSet->tilesTex);
+            start = SDL_GetPerformanceCounter();
+            for(i=0;i<numQuads;++i){
+                textureBatchAddXYClipScale(&scaled,points[i].x,points[i].y,&isoMap->tileSet->tileClipRects[tiles[i]],zoomLevel);
+            }
+            scaleMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+            //a frame looks the table up once, the first repeat also builds it for the new zoom level
+            textureBatchBegin(&table,isoMap->tileSet->tilesTex);
+            start = SDL_GetPerformanceCounter();
+            quadSizes = isoMapGetTileQuadSizes(isoMap,zoomLevel);
+            for(i=0;i<numQuads;++i){
+                textureBatchAddXYClipSize(&table,points[i].x,points[i].y,&isoMap->tileSet->tileClipRects[tiles[i]],&quadSizes[tiles[i]]);
+            }
+            tableMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        }
+        identical = scaled.numQuads == table.numQuads &&
+                    memcmp(scaled.dstRects,table.dstRects,numQuads*sizeof(SDL_Rect))==0 &&
+                    memcmp(scaled.srcRects,table.srcRects,numQuads*sizeof(SDL_Rect))==0;
+        scaleMs /= BENCH_QUADS_REPEATS;
+        tableMs /= BENCH_QUADS_REPEATS;
+        fprintf(out,"    {\"zoom\": %.2f, \"scaledMsPerMillion\": %.3f, \"tableMsPerMillion\": %.3f, \"speedup\": %.2f, "
+                    "\"identical\": %s}%s\n",
+                zoomLevel,scaleMs*1000000.0/numQuads,tableMs*1000000.0/numQuads,tableMs > 0 ? scaleMs/tableMs : 0.0,
+                benchCheck(identical),z==(int)SDL_arraysize(benchQuadsZoomLevels)-1 ? "" : ",");
+        fflush(out);
+    }
+    fprintf(out,"  ]\n}\n");
+    textureBatchFree(&scaled);
+    textureBatchFree(&table);
+    free(points);
+    free(tiles);
+    isoMapFreeMap(isoMap);
+    closeDownSDL();
+}
+
+//Copies a file, returns 0 on failure
+static int benchCopyFile(const char *from,const char *to)
+{
+    char buffer[4096];
+    size_t size;
+    int ok = 1;
+    FILE *in = fopen(from,"rb");
+    FILE *out = in != NULL ? fopen(to,"wb") : NULL;
+
+    if(out == NULL){
+        if(in != NULL){
+            fclose(in);
+        }
+        return 0;
+    }
+    while((size = fread(buffer,1,sizeof(buffer),in)) > 0){
+        if(fwrite(buffer,1,size,out) != size){
+            ok = 0;
+            break;
+        }
+    }
+    fclose(in);
+    fclose(out);
+    return ok;
+}
+
+static void benchAssetsDrawFrame(textureT *textures,int numImages)
+{
+    int i;
+
+    SDL_SetRenderDrawColor(getRenderer(),0x3b,0x3b,0x3b,0x00);
+    SDL_RenderClear(getRenderer());
+    for(i=0;i<numImages;++i){
+        textureRenderXYClip(&textures[i],(i%8)*64,(i/8%8)*80,NULL);
+    }
+    SDL_RenderPresent(getRenderer());
+}
+
+static void benchAssetsRun(FILE *out,textureT *textures,int numImages,int async,int last)
+{
+    int i;
+    int numFrames = 0;
+    int numLoaded = 0;
+    char filename[64];
+    double firstFrameMs,loadedMs;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint64 start;
+
+    //every run decodes the files again
+    textureCachePurge();
+    textureCacheResetStats();
+    start = SDL_GetPerformanceCounter();
+
+    for(i=0;i<numImages;++i){
+        textureInit(&textures[i],0,0,0,NULL,NULL,SDL_FLIP_NONE);
+        textures[i].texture = NULL;
+        sprintf(filename,BENCH_ASSETS_FILE,i);
+        numLoaded += async ? loadTextureAsync(&textures[i],filename) : loadTexture(&textures[i],filename);
+    }
+    benchAssetsDrawFrame(textures,numImages);
+    firstFrameMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+    //the game loop, until the last image is uploaded
+    while(textureCacheGetProgress() < 1.0f){
+        textureCacheUpdate(BENCH_ASSETS_UPLOAD_MS);
+        benchAssetsDrawFrame(textures,numImages);
+        numFrames++;
+    }
+    loadedMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+    fprintf(out,"    {\"mode\": \"%s\", \"images\": %d, \"loaded\": %d, \"decodingThreads\": %d, \"firstFrameMs\": %.3f, "
+                "\"allLoadedMs\": %.3f, \"framesWhileLoading\": %d}%s\n",
+            async ? "async" : "sync",numImages,numLoaded,async ? assetLoaderGetNumThreads() : 0,firstFrameMs,loadedMs,numFrames,last ? "" : ",");
+    fflush(out);
+
+    for(i=0;i<numImages;++i){
+        textureDelete(&textures[i]);
+    }
+}
+
+static void benchAssets(FILE *out,int numImages)
+{
+    int i;
+    char filename[64];
+    textureT *textures = malloc(numImages*sizeof(textureT));
+
+    benchInitHeadless();
+    for(i=0;i<numImages && textures != NULL;++i){
+        sprintf(filename,BENCH_ASSETS_FILE,i);
+        if(benchCopyFile("data/isotiles.png",filename) == 0){
+            fprintf(stderr,"Could not copy data/isotiles.png to %s!\n",filename);
+            numImages = i;
+            break;
+        }
+    }
+    if(textures != NULL && numImages > 0){
+        fprintf(out,"{\n  \"benchmark\": \"assets\",\n  \"results\": [\n");
+        benchAssetsRun(out,textures,numImages,0,0);
+        benchAssetsRun(out,textures,numImages,1,1);
+        fprintf(out,"  ]\n}\n");
+    }
+    for(i=0;i<numImages;++i){
+        sprintf(filename,BENCH_ASSETS_FILE,i);
+        remove(filename);
+    }
+    free(textures);
+    closeDownSDL();
+}
+
+//The decoration the palette benchmark paints on a tile: every 8th tile of every 4th chunk on layer 1 gets one of
+//40 values, every tile of every 64th chunk on layer 2 one of 600
+static int benchPaletteTile(int x,int y,int layer)
+{
+    int chunkX = x>>MAP_CHUNK_SHIFT;
+    int chunkY = y>>MAP_CHUNK_SHIFT;
+    Uint32 hash = ((Uint32)x*73856093u) ^ ((Uint32)y*19349663u) ^ ((Uint32)layer*83492791u);
+
+    hash ^= hash >> 13;
+    hash *= 0x5bd1e995u;
+    hash ^= hash >> 15;
+    if(layer == 1 && (chunkX+chunkY)%4 == 0 && hash%8 == 0){
+        return 1 + (hash>>3)%40;
+    }
+    if(layer == 2 && (chunkX*7+chunkY)%64 == 0){
+        return 100 + (hash>>3)%600;
+    }
+    return MAP_EMPTY_TILE;
+}
+
+static void benchPalette(FILE *out,int mapSize,int numFrames)
+{
+    int v,frame;
+    int x,y,layer,chunk;
+    int startRow,startColumn;
+    int numChunks;
+    int numWidths[3] = {0,0,0};
+    int numChunksAllocated = 0;
+    int tilesMatch = 1;
+    int **unpacked;
+    long long sumInt,sumPacked;
+    long long missesInt,missesPacked;
+    size_t intBytes,packedBytes;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint64 start,timeInt,timePacked;
+    double paintMs;
+    isoMapChunkT *chunkData;
+    isoMapT *isoMap;
+
+    isoMap = isoMapCreateEmptyMap("Palette",mapSize,mapSize,BENCH_PALETTE_LAYERS,BENCH_TILE_SIZE);
+    if(isoMap == NULL){
+        fprintf(stderr,"Could not create the map!\n");
+        return;
+    }
+    numChunks = isoMap->numChunksX * isoMap->numChunksY;
+
+    start = SDL_GetPerformanceCounter();
+    for(y=0;y<mapSize;++y){
+        for(x=0;x<mapSize;++x){
+            for(layer=1;layer<BENCH_PALETTE_LAYERS;++layer){
+                if(benchPaletteTile(x,y,layer) != MAP_EMPTY_TILE){
+                    isoMapSetTile(isoMap,x,y,layer,benchPaletteTile(x,y,layer));
+                }
+            }
+        }
+    }
+    paintMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    for(y=0;y<mapSize && tilesMatch;++y){
+        for(x=0;x<mapSize;++x){
+            for(layer=1;layer<BENCH_PALETTE_LAYERS;++layer){
+                if(isoMapGetTile(isoMap,x,y,layer) != benchPaletteTile(x,y,layer)){
+                    tilesMatch = 0;
+                }
+            }
+        }
+    }
+
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        numChunksAllocated += isoMap->layers[layer].numChunksAllocated;
+        for(chunk=0;chunk<numChunks;++chunk){
+            chunkData = &isoMap->layers[layer].chunks[chunk];
+            if(chunkData->indices != NULL){
+                numWidths[chunkData->bitsPerTile == 4 ? 0 : chunkData->bitsPerTile == 8 ? 1 : 2]++;
+            }
+        }
+    }
+    intBytes = (size_t)numChunksAllocated*MAP_CHUNK_NUM_TILES*sizeof(int);
+    packedBytes = isoMapGetTileMemory(isoMap);
+
+    //the ground layer the way it was stored before
+    unpacked = calloc(numChunks,sizeof(int*));
+    for(chunk=0;unpacked != NULL && chunk<numChunks;++chunk){
+        unpacked[chunk] = malloc(MAP_CHUNK_NUM_TILES*sizeof(int));
+        if(unpacked[chunk] == NULL){
+            break;
+        }
+        isoMapChunkGetTiles(&isoMap->layers[0].chunks[chunk],unpacked[chunk]);
+    }
+    if(unpacked == NULL || chunk < numChunks){
+        fprintf(stderr,"Could not allocate the int chunks!\n");
+        for(chunk=0;unpacked != NULL && chunk<numChunks;++chunk){
+            free(unpacked[chunk]);
+        }
+        free(unpacked);
+        isoMapFreeMap(isoMap);
+        return;
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"palette\",\n  \"mapSize\": %d,\n  \"layers\": %d,\n  \"frames\": %d,\n"
+                "  \"chunks4Bit\": %d,\n  \"chunks8Bit\": %d,\n  \"chunks16Bit\": %d,\n"
+                "  \"intBytes\": %llu,\n  \"packedBytes\": %llu,\n  \"memoryRatio\": %.2f,\n"
+                "  \"paintMs\": %.1f,\n  \"tilesMatch\": %s,\n  \"results\": [\n",
+            mapSize,BENCH_PALETTE_LAYERS,numFrames,numWidths[0],numWidths[1],numWidths[2],
+            (unsigned long long)intBytes,(unsigned long long)packedBytes,packedBytes > 0 ? (double)intBytes/packedBytes : 0.0,
+            paintMs,benchCheck(tilesMatch));
+
+    for(v=0;v<(int)SDL_arraysize(benchViews);++v){
+        sumInt = 0;
+        benchStartCacheMisses();
+        start = SDL_GetPerformanceCounter();
+        for(frame=0;frame<numFrames;++frame){
+            benchCameraPos(isoMap,&benchViews[v],frame,numFrames,&startRow,&startColumn);
+            sumInt += benchFrameChunked(isoMap,unpacked,startRow,startColumn,&benchViews[v]);
+        }
+        timeInt = SDL_GetPerformanceCounter()-start;
+        missesInt = benchStopCacheMisses();
+
+        sumPacked = 0;
+        benchStartCacheMisses();
+        start = SDL_GetPerformanceCounter();
+        for(frame=0;frame<numFrames;++frame){
+            benchCameraPos(isoMap,&benchViews[v],frame,numFrames,&startRow,&startColumn);
+            sumPacked += benchFrameChunked(isoMap,NULL,startRow,startColumn,&benchViews[v]);
+        }
+        timePacked = SDL_GetPerformanceCounter()-start;
+        missesPacked = benchStopCacheMisses();
+
+        fprintf(out,"    {\"view\": \"%s\", \"intMsPerFrame\": %.4f, \"intCacheMisses\": %lld, "
+                    "\"packedMsPerFrame\": %.4f, \"packedCacheMisses\": %lld, \"tilesMatch\": %s}%s\n",
+                benchViews[v].name,
+                timeInt*1000.0/freq/numFrames,missesInt,
+                timePacked*1000.0/freq/numFrames,missesPacked,
+                benchCheck(sumInt == sumPacked),
+                v<(int)SDL_arraysize(benchViews)-1 ? "," : "");
+    }
+    fprintf(out,"  ]\n}\n");
+    for(chunk=0;chunk<numChunks;++chunk){
+        free(unpacked[chunk]);
+    }
+    free(unpacked);
+    isoMapFreeMap(isoMap);
+}
+
+//FNV-1a over every tile of every layer, and which chunks of the sparse layers are there
+static Uint32 benchMapChecksum(isoMapT *isoMap)
+{
+    int i,layer,chunk;
+    int tiles[MAP_CHUNK_NUM_TILES];
+    Uint32 hash = 2166136261u;
+    isoMapChunkT *chunkData;
+
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        for(chunk=0;chunk<isoMap->numChunksX * isoMap->numChunksY;++chunk){
+            chunkData = &isoMap->layers[layer].chunks[chunk];
+            hash = (hash ^ (chunkData->indices != NULL)) * 16777619u;
+            if(chunkData->indices == NULL){
+                continue;
+            }
+            isoMapChunkGetTiles(chunkData,tiles);
+            for(i=0;i<MAP_CHUNK_NUM_TILES;++i){
+                hash = (hash ^ (Uint32)tiles[i]) * 16777619u;
+            }
+        }
+    }
+    return hash;
+}
+
+//water where the noise is low, decorations on the layer above
+static const isoMapGenNoiseT benchGenerateWater = {64,4,1,{ISO_MAP_GEN_NOISE_MAX*3/10},{2}};
+static const isoMapGenStampsT benchGenerateDecorations = {1,0,3,{MAP_EMPTY_TILE,3,4},{18,1,1}};
+
+static void benchGenerate(FILE *out,int mapSize)
+{
+    int threads,repeat,chunk;
+    int numCores = SDL_GetCPUCount();
+    int ok = 1;
+    double ms,singleThreadMs = 0;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint32 checksum,reference = 0;
+    Uint64 start;
+    isoMapGenT gen;
+    threadPoolT *pool;
+    isoMapT *isoMap;
+
+    isoMap = isoMapCreateEmptyMap("Generate",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    if(isoMap == NULL){
+        fprintf(stderr,"Could not create the map!\n");
+        return;
+    }
+    isoMapGenInitDefault(&gen,BENCH_GENERATE_SEED);
+    isoMapGenAddPass(&gen,isoMapGenNoisePass,&benchGenerateWater,0);
+    isoMapGenAddPass(&gen,isoMapGenStamps,&benchGenerateDecorations,1);
+
+    fprintf(out,"{\n  \"benchmark\": \"generate\",\n  \"mapSize\": %d,\n  \"layers\": %d,\n  \"cpuCores\": %d,\n  \"results\": [\n",
+            mapSize,BENCH_MAP_LAYERS,numCores);
+    //1, 2, 4 ... threads, and all cores last
+    for(threads=1;threads<numCores*2;threads*=2){
+        threads = SDL_min(threads,numCores);
+        pool = threadPoolNew(threads-1);
+        ms = 0;
+        for(repeat=0;repeat<BENCH_GENERATE_REPEATS;++repeat){
+            start = SDL_GetPerformanceCounter();
+            ok &= isoMapGenRun(&gen,isoMap,pool);
+            ms += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        }
+        ms /= BENCH_GENERATE_REPEATS;
+        checksum = benchMapChecksum(isoMap);
+        if(threads == 1){
+            singleThreadMs = ms;
+            reference = checksum;
+        }
+        fprintf(out,"    {\"threads\": %d, \"ms\": %.2f, \"megaTilesPerSecond\": %.1f, \"speedup\": %.2f, \"identical\": %s},\n",
+                threadPoolGetNumThreads(pool),ms,(double)mapSize*mapSize/1000.0/ms,ms > 0 ? singleThreadMs/ms : 0.0,
+                benchCheck(checksum == reference));
+        fflush(out);
+        threadPoolFree(pool);
+        if(threads == numCores){
+            break;
+        }
+    }
+
+    //the chunks one by one, last to first
+    start = SDL_GetPerformanceCounter();
+    for(chunk=isoMap->numChunksX * isoMap->numChunksY - 1;chunk>=0;--chunk){
+        ok &= isoMapGenChunk(&gen,isoMap,chunk % isoMap->numChunksX,chunk / isoMap->numChunksX);
+    }
+    ms = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    checksum = benchMapChecksum(isoMap);
+    fprintf(out,"    {\"order\": \"reverse\", \"ms\": %.2f, \"identical\": %s}\n  ],\n",ms,benchCheck(checksum == reference));
+    fprintf(out,"  \"seed\": %u,\n  \"checksum\": \"%08x\",\n  \"succeeded\": %s\n}\n",(unsigned)BENCH_GENERATE_SEED,reference,benchCheck(ok));
+    isoMapFreeMap(isoMap);
+}
+
+//An entity stored the way the character was, one struct per entity, with the components of the entity store
+typedef struct benchEntityT
+{
+    point2DT point;
+    point2DT prevPoint;
+    point2DT velocity;
+    int direction;
+    Uint32 walkStart;
+    int sprite;
+}benchEntityT;
+
+static const int benchEntityDirections[3][3] =
+{
+    {ISO_ENTITY_DIR_UP,ISO_ENTITY_DIR_UP_LEFT,ISO_ENTITY_DIR_LEFT},
+    {ISO_ENTITY_DIR_UP_RIGHT,-1,ISO_ENTITY_DIR_DOWN_LEFT},
+    {ISO_ENTITY_DIR_RIGHT,ISO_ENTITY_DIR_DOWN_RIGHT,ISO_ENTITY_DIR_DOWN}
+};
+
+//The same as isoEntityUpdate
+static void benchEntitiesUpdate(benchEntityT *entities,int numEntities)
+{
+    int i;
+    benchEntityT *entity;
+
+    for(i=0;i<numEntities;++i){
+        entity = &entities[i];
+        entity->prevPoint = entity->point;
+        entity->point.x += entity->velocity.x;
+        entity->point.y += entity->velocity.y;
+    }
+}
+
+//drawCharacter for every entity on the screen, returns how many were drawn
+static int benchEntitiesDraw(benchEntityT *entities,int numEntities,isoEngineT *isoEngine,float alpha)
+{
+    int i;
+    int numDrawn = 0;
+    point2DT point;
+    SDL_Point *size;
+    benchEntityT *entity;
+
+    if(textureQuadTableUpdate(&benchCharQuads,benchCharRects,NUM_CHARACTER_SPRITES,isoEngine->zoomLevel)==0){
+        return 0;
+    }
+    for(i=0;i<numEntities;++i){
+        entity = &entities[i];
+        point.x = entity->prevPoint.x + (entity->point.x-entity->prevPoint.x)*alpha;
+        point.y = entity->prevPoint.y + (entity->point.y-entity->prevPoint.y)*alpha;
+        point.x = (int)(point.x*isoEngine->zoomLevel)+ isoEngine->scrollX;
+        point.y = (int)(point.y*isoEngine->zoomLevel)+ isoEngine->scrollY;
+        isoEngineConvert2dToIso(&point);
+        size = &benchCharQuads.sizes[entity->direction];
+        if(point.x >= WINDOW_WIDTH || point.y >= WINDOW_HEIGHT || point.x + size->x <= 0 || point.y + size->y <= 0){
+            continue;
+        }
+        textureRenderXYClipSize(&benchCharacterTex,point.x,point.y,&benchCharRects[entity->direction],size);
+        numDrawn++;
+    }
+    return numDrawn;
+}
+
+static void benchEntities(FILE *out,int numEntities)
+{
+    int i,tick,frame;
+    int index;
+    int sprite;
+    int x=0;
+    int numDrawn = 0;
+    int positionsMatch = 1;
+    int drawnMatch = 1;
+    int handlesValid = 1;
+    int drawCallsStruct,drawCallsStore;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    Uint64 start,timeStruct,timeStore;
+    double updateStructNs,updateStoreNs;
+    point2DT center;
+    benchEntityT *entities;
+    isoEntityHandleT *handles;
+    isoEntityStoreT *store;
+    isoEngineT *isoEngine;
+
+    benchInitHeadless();
+    textureInit(&benchCharacterTex,0,0,0,NULL,NULL,SDL_FLIP_NONE);
+    if(loadTexture(&benchCharacterTex,"data/character.png")==0){
+        fprintf(stderr,"Could not load data/character.png!\n");
+        closeDownSDL();
+        return;
+    }
+    for(i=0;i<NUM_CHARACTER_SPRITES;++i){
+        setupRect(&benchCharRects[i],x,0,70,102);
+        x+=70;
+    }
+    isoEngine = isoEngineNewIsoEngine();
+    entities = malloc(numEntities*sizeof(benchEntityT));
+    handles = malloc(numEntities*sizeof(isoEntityHandleT));
+    store = isoEntityStoreNew();
+    if(isoEngine == NULL || entities == NULL || handles == NULL || store == NULL){
+        fprintf(stderr,"Could not allocate the entities!\n");
+        free(entities);
+        free(handles);
+        isoEntityStoreFree(store);
+        isoEngineFreeIsoEngine(isoEngine);
+        textureDelete(&benchCharacterTex);
+        closeDownSDL();
+        return;
+    }
+    //the camera looks at the middle of the entities
+    isoEngine->isoMap = isoMapCreateEmptyMap("Entities",BENCH_ENTITIES_AREA/BENCH_TILE_SIZE,BENCH_ENTITIES_AREA/BENCH_TILE_SIZE,1,BENCH_TILE_SIZE);
+    center.x = BENCH_ENTITIES_AREA/2;
+    center.y = BENCH_ENTITIES_AREA/2;
+    isoEngineCenterMap(isoEngine,&center);
+
+    sprite = isoEntityAddSprite(store,&benchCharacterTex,benchCharRects,1,1);
+    srand(BENCH_GENERATE_SEED);
+    for(i=0;i<numEntities;++i){
+        entities[i].point.x = rand()%BENCH_ENTITIES_AREA;
+        entities[i].point.y = rand()%BENCH_ENTITIES_AREA;
+        entities[i].prevPoint = entities[i].point;
+        //a few of them stand still
+        entities[i].velocity.x = rand()%7 - 3;
+        entities[i].velocity.y = rand()%7 - 3;
+        entities[i].direction = benchEntityDirections[(entities[i].velocity.x > 0) - (entities[i].velocity.x < 0) + 1]
+                                                     [(entities[i].velocity.y > 0) - (entities[i].velocity.y < 0) + 1];
+        if(entities[i].direction < 0){
+            entities[i].direction = ISO_ENTITY_DIR_DOWN;
+        }
+        entities[i].walkStart = 0;
+        entities[i].sprite = sprite;
+        handles[i] = isoEntityCreate(store,entities[i].point.x,entities[i].point.y,sprite);
+        isoEntitySetVelocity(store,handles[i],entities[i].velocity.x,entities[i].velocity.y);
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for(tick=0;tick<BENCH_ENTITIES_TICKS;++tick){
+        benchEntitiesUpdate(entities,numEntities);
+    }
+    timeStruct = SDL_GetPerformanceCounter()-start;
+    start = SDL_GetPerformanceCounter();
+    for(tick=0;tick<BENCH_ENTITIES_TICKS;++tick){
+        isoEntityUpdate(store);
+    }
+    timeStore = SDL_GetPerformanceCounter()-start;
+    updateStructNs = timeStruct*1e9/freq/BENCH_ENTITIES_TICKS/numEntities;
+    updateStoreNs = timeStore*1e9/freq/BENCH_ENTITIES_TICKS/numEntities;
+    for(i=0;i<numEntities;++i){
+        index = isoEntityGetIndex(store,handles[i]);
+        if(store->x[index] != entities[i].point.x || store->y[index] != entities[i].point.y ||
+           store->prevX[index] != entities[i].prevPoint.x || store->direction[index] != entities[i].direction){
+            positionsMatch = 0;
+        }
+    }
+
+    resetDrawCallCount();
+    start = SDL_GetPerformanceCounter();
+    for(frame=0;frame<BENCH_ENTITIES_FRAMES;++frame){
+        numDrawn = benchEntitiesDraw(entities,numEntities,isoEngine,(float)frame/BENCH_ENTITIES_FRAMES);
+        SDL_RenderPresent(getRenderer());
+    }
+    timeStruct = SDL_GetPerformanceCounter()-start;
+    drawCallsStruct = getDrawCallCount();
+
+    resetDrawCallCount();
+    start = SDL_GetPerformanceCounter();
+    for(frame=0;frame<BENCH_ENTITIES_FRAMES;++frame){
+        isoEntityDraw(store,isoEngine,(float)frame/BENCH_ENTITIES_FRAMES);
+        SDL_RenderPresent(getRenderer());
+    }
+    timeStore = SDL_GetPerformanceCounter()-start;
+    drawCallsStore = getDrawCallCount();
+    if(store->numDrawn != numDrawn){
+        drawnMatch = 0;
+    }
+
+    //remove every third entity, the rest have moved in the arrays
+    for(i=0;i<numEntities;i+=3){
+        isoEntityRemove(store,handles[i]);
+    }
+    for(i=0;i<numEntities;++i){
+        index = isoEntityGetIndex(store,handles[i]);
+        if(i%3 == 0){
+            if(index != -1){
+                handlesValid = 0;
+            }
+        }
+        else if(index < 0 || store->x[index] != entities[i].point.x || store->y[index] != entities[i].point.y){
+            handlesValid = 0;
+        }
+    }
+    //the free slots are used again, the old handles still find nothing
+    for(i=0;i<numEntities;i+=3){
+        if(isoEntityGetIndex(store,isoEntityCreate(store,0,0,sprite)) < 0 || isoEntityGetIndex(store,handles[i]) != -1){
+            handlesValid = 0;
+        }
+    }
+    if(store->numEntities != numEntities){
+        handlesValid = 0;
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"entities\",\n  \"entities\": %d,\n  \"ticks\": %d,\n  \"frames\": %d,\n"
+                "  \"entitiesOnScreen\": %d,\n  \"results\": [\n",
+            numEntities,BENCH_ENTITIES_TICKS,BENCH_ENTITIES_FRAMES,numDrawn);
+    fprintf(out,"    {\"storage\": \"struct\", \"updateNsPerEntity\": %.2f, \"drawNsPerEntity\": %.2f, \"drawCallsPerFrame\": %.1f},\n",
+            updateStructNs,timeStruct*1e9/freq/BENCH_ENTITIES_FRAMES/numEntities,(double)drawCallsStruct/BENCH_ENTITIES_FRAMES);
+    fprintf(out,"    {\"storage\": \"store\", \"updateNsPerEntity\": %.2f, \"drawNsPerEntity\": %.2f, \"drawCallsPerFrame\": %.1f}\n  ],\n",
+            updateStoreNs,timeStore*1e9/freq/BENCH_ENTITIES_FRAMES/numEntities,(double)drawCallsStore/BENCH_ENTITIES_FRAMES);
+    fprintf(out,"  \"updateSpeedup\": %.2f,\n  \"positionsMatch\": %s,\n  \"drawnMatch\": %s,\n  \"handlesValid\": %s\n}\n",
+            updateStoreNs > 0 ? updateStructNs/updateStoreNs : 0.0,
+            benchCheck(positionsMatch),benchCheck(drawnMatch),benchCheck(handlesValid));
+
+    free(entities);
+    free(handles);
+    isoEntityStoreFree(store);
+    isoEngineFreeIsoEngine(isoEngine);
+    textureDelete(&benchCharacterTex);
+    textureQuadTableFree(&benchCharQuads);
+    closeDownSDL();
+}
+
+//A tile or a sprite of the depth benchmark, placed the way isoEngineQueueIsoMap and isoEntityQueue place them
+typedef struct benchDepthItemT
+{
+    float x;                //map pixels
+    float y;
+    float velocityX;
+    float velocityY;
+    int layer;
+    int sprite;
+}benchDepthItemT;
+
+static Uint32 benchDepthKey(benchDepthItemT *item)
+{
+    int tileX = floor(item->x/BENCH_TILE_SIZE);
+    int tileY = floor(item->y/BENCH_TILE_SIZE);
+    int depth = SDL_min(SDL_max(tileX+tileY,0),ISO_RENDER_QUEUE_MAX_DEPTH);
+    int subOrder = 0;
+
+    if(item->sprite){
+        subOrder = 1 + (int)((item->x - tileX*BENCH_TILE_SIZE + item->y - tileY*BENCH_TILE_SIZE)*(ISO_RENDER_QUEUE_MAX_SUB_ORDER-2)/(2*BENCH_TILE_SIZE));
+        subOrder = SDL_min(SDL_max(subOrder,1),ISO_RENDER_QUEUE_MAX_SUB_ORDER-1);
+    }
+    return ISO_RENDER_QUEUE_KEY(depth,item->layer,subOrder);
+}
+
+static int benchCompareUint64(const void *a,const void *b)
+{
+    Uint64 x = *(const Uint64*)a;
+    Uint64 y = *(const Uint64*)b;
+
+    return (x > y) - (x < y);
+}
+
+//Fills the queue with a frame: the tiles layer by layer in map order, then the sprites, which move a little every frame
+static void benchDepthFill(isoRenderQueueT *queue,benchDepthItemT *items,int numItems,int move,textureT *tilesTex,SDL_Rect *tileRect)
+{
+    int i;
+    SDL_Point size = {tileRect->w,tileRect->h};
+    benchDepthItemT *item;
+
+    isoRenderQueueBegin(queue);
+    for(i=0;i<numItems;++i){
+        item = &items[i];
+        if(move){
+            item->x += item->velocityX;
+            item->y += item->velocityY;
+        }
+        if(item->sprite){
+            isoRenderQueueAdd(queue,benchDepthKey(item),&benchCharacterTex,&benchCharRects[0],item->x - item->y,(item->x + item->y)/2,&size);
+        }
+        else{
+            isoRenderQueueAdd(queue,benchDepthKey(item),tilesTex,tileRect,item->x - item->y,(item->x + item->y)/2,&size);
+        }
+    }
+}
+
+//Runs the frames with the touch up allowed or not, or scattering the sprites every frame. Every sort is compared with qsort.
+static void benchDepthRun(FILE *out,isoRenderQueueT *queue,benchDepthItemT *items,int numItems,char *scenario,
+                          int allowTouchUp,int scatter,textureT *tilesTex,SDL_Rect *tileRect,int last)
+{
+    int i,frame;
+    int identical = 1;
+    int modes[3] = {0,0,0};
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double addMs = 0,sortMs = 0,worstMs = 0,qsortMs = 0,ms;
+    Uint64 start;
+    Uint64 *reference = malloc(numItems*sizeof(Uint64));
+
+    if(reference == NULL){
+        return;
+    }
+    queue->allowTouchUp = allowTouchUp;
+    for(frame=0;frame<BENCH_DEPTH_FRAMES;++frame){
+        if(scatter){
+            for(i=0;i<numItems;++i){
+                if(items[i].sprite && rand()%4 == 0){
+                    items[i].x += rand()%(2*BENCH_DEPTH_JUMP+1) - BENCH_DEPTH_JUMP;
+                    items[i].y += rand()%(2*BENCH_DEPTH_JUMP+1) - BENCH_DEPTH_JUMP;
+                }
+            }
+        }
+        start = SDL_GetPerformanceCounter();
+        benchDepthFill(queue,items,numItems,1,tilesTex,tileRect);
+        addMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        start = SDL_GetPerformanceCounter();
+        isoRenderQueueSort(queue);
+        ms = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        sortMs += ms;
+        if(ms > worstMs) worstMs = ms;
+        modes[queue->sortMode]++;
+
+        for(i=0;i<numItems;++i){
+            reference[i] = ((Uint64)queue->keys[i] << 32) | (Uint32)i;
+        }
+        start = SDL_GetPerformanceCounter();
+        qsort(reference,numItems,sizeof(Uint64),benchCompareUint64);
+        qsortMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        if(memcmp(reference,queue->order,numItems*sizeof(Uint64)) != 0){
+            identical = 0;
+        }
+    }
+    fprintf(out,"    {\"scenario\": \"%s\", \"addMs\": %.3f, \"sortMs\": %.3f, \"worstSortMs\": %.3f, \"qsortMs\": %.3f, \"speedupOverQsort\": %.1f, "
+                "\"radixSorts\": %d, \"touchUps\": %d, \"alreadySorted\": %d, \"identical\": %s}%s\n",
+            scenario,addMs/BENCH_DEPTH_FRAMES,sortMs/BENCH_DEPTH_FRAMES,worstMs,qsortMs/BENCH_DEPTH_FRAMES,sortMs > 0 ? qsortMs/sortMs : 0.0,
+            modes[ISO_RENDER_QUEUE_SORTED_RADIX],modes[ISO_RENDER_QUEUE_SORTED_TOUCH_UP],modes[ISO_RENDER_QUEUE_SORTED_NONE],
+            benchCheck(identical),last ? "" : ",");
+    fflush(out);
+    free(reference);
+}
+
+//A frame of the game zoomed out: the ground and the decorations of a generated map and walking entities, all queued.
+//The ground tiles in the queue have to be the ones isoEngineBuildMapBatch draws.
+static void benchDepthGameFrame(FILE *out)
+{
+    int i;
+    int sprite;
+    int groundTiles = 0;
+    int ordered = 1;
+    int drawCalls;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double queueMs,drawMs;
+    Uint64 start;
+    point2DT center;
+    isoMapGenT gen;
+    isoEngineT *isoEngine;
+    isoEntityStoreT *store;
+    isoRenderQueueT *queue;
+
+    isoEngine = isoEngineNewIsoEngine();
+    store = isoEntityStoreNew();
+    if(isoEngine != NULL){
+        isoEngine->isoMap = isoMapCreateEmptyMap("Depth",BENCH_DEPTH_MAP_SIZE,BENCH_DEPTH_MAP_SIZE,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    }
+    if(isoEngine == NULL || store == NULL || isoEngine->isoMap == NULL || isoEngine->renderQueue == NULL ||
+       isoMapLoadTileSet(isoEngine->isoMap,"data/isotiles.png",64,80)!=1){
+        fprintf(out,"  \"gameFrame\": null\n}\n");
+        isoEntityStoreFree(store);
+        isoEngineFreeIsoEngine(isoEngine);
+        return;
+    }
+    queue = isoEngine->renderQueue;
+    isoMapGenInitDefault(&gen,BENCH_GENERATE_SEED);
+    isoMapGenAddPass(&gen,isoMapGenStamps,&benchGenerateDecorations,1);
+    isoMapGenRun(&gen,isoEngine->isoMap,isoEngine->threadPool);
+    isoEngine->zoomLevel = BENCH_DEPTH_ZOOM;
+    center.x = BENCH_DEPTH_MAP_SIZE*BENCH_TILE_SIZE/2;
+    center.y = BENCH_DEPTH_MAP_SIZE*BENCH_TILE_SIZE/2;
+    isoEngineCenterMap(isoEngine,&center);
+
+    sprite = isoEntityAddSprite(store,&benchCharacterTex,benchCharRects,1,1);
+    for(i=0;i<BENCH_DEPTH_ENTITIES;++i){
+        isoEntityCreate(store,rand()%(BENCH_DEPTH_MAP_SIZE*BENCH_TILE_SIZE),rand()%(BENCH_DEPTH_MAP_SIZE*BENCH_TILE_SIZE),sprite);
+    }
+
+    start = SDL_GetPerformanceCounter();
+    isoRenderQueueBegin(queue);
+    isoEngineQueueIsoMap(isoEngine,queue,0,BENCH_MAP_LAYERS-1);
+    isoEntityQueue(store,isoEngine,1.0f,queue,1);
+    queueMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    for(i=0;i<queue->numItems;++i){
+        if((queue->keys[i] >> ISO_RENDER_QUEUE_LAYER_SHIFT & ISO_RENDER_QUEUE_MAX_LAYER) == 0){
+            groundTiles++;
+        }
+    }
+    resetDrawCallCount();
+    start = SDL_GetPerformanceCounter();
+    isoRenderQueueDraw(queue);
+    drawMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    drawCalls = getDrawCallCount();
+    for(i=1;i<queue->numItems;++i){
+        if(queue->order[i-1] > queue->order[i]){
+            ordered = 0;
+        }
+    }
+    isoEngineBuildMapBatch(isoEngine,&isoEngine->visibleTiles);
+
+    fprintf(out,"  \"gameFrame\": {\"quads\": %d, \"groundTiles\": %d, \"entities\": %d, \"queueMs\": %.3f, \"sortAndDrawMs\": %.3f, "
+                "\"drawCalls\": %d, \"groundMatches\": %s, \"ordered\": %s}\n}\n",
+            queue->numItems,groundTiles,store->numDrawn,queueMs,drawMs,drawCalls,
+            benchCheck(groundTiles == isoEngine->mapBatch.numQuads),benchCheck(ordered));
+    isoEntityStoreFree(store);
+    isoEngineFreeIsoEngine(isoEngine);
+}
+
+static void benchDepth(FILE *out,int numItems)
+{
+    int i,x,y,layer;
+    int side;
+    int numTiles = 0;
+    int drawCalls;
+    textureT tilesTex;
+    SDL_Rect tileRect;
+    benchDepthItemT *items;
+    isoRenderQueueT *queue;
+
+    benchInitHeadless();
+    textureInit(&tilesTex,0,0,0,NULL,NULL,SDL_FLIP_NONE);
+    textureInit(&benchCharacterTex,0,0,0,NULL,NULL,SDL_FLIP_NONE);
+    if(loadTexture(&tilesTex,"data/isotiles.png")==0 || loadTexture(&benchCharacterTex,"data/character.png")==0){
+        fprintf(stderr,"Could not load data/isotiles.png or data/character.png!\n");
+        textureDelete(&tilesTex);
+        textureDelete(&benchCharacterTex);
+        closeDownSDL();
+        return;
+    }
+    setupRect(&benchCharRects[0],0,0,70,102);
+    setupRect(&tileRect,0,0,BENCH_TILE_SIZE*2,BENCH_TILE_SIZE*2);
+    items = malloc(numItems*sizeof(benchDepthItemT));
+    queue = isoRenderQueueNew();
+    if(items == NULL || queue == NULL){
+        fprintf(stderr,"Could not allocate the render queue!\n");
+        free(items);
+        isoRenderQueueFree(queue);
+        textureDelete(&tilesTex);
+        textureDelete(&benchCharacterTex);
+        closeDownSDL();
+        return;
+    }
+
+    //BENCH_DEPTH_LAYERS layers of tiles fill most of the queue, the rest are sprites walking around on them
+    side = SDL_max((int)sqrt((double)numItems*(100-BENCH_DEPTH_SPRITES_PERCENT)/100/BENCH_DEPTH_LAYERS),1);
+    srand(BENCH_GENERATE_SEED);
+    for(layer=1;layer<=BENCH_DEPTH_LAYERS;++layer){
+        for(y=0;y<side && numTiles<numItems;++y){
+            for(x=0;x<side && numTiles<numItems;++x){
+                items[numTiles].x = x*BENCH_TILE_SIZE;
+                items[numTiles].y = y*BENCH_TILE_SIZE;
+                items[numTiles].velocityX = 0;
+                items[numTiles].velocityY = 0;
+                items[numTiles].layer = layer;
+                items[numTiles].sprite = 0;
+                numTiles++;
+            }
+        }
+    }
+    for(i=numTiles;i<numItems;++i){
+        items[i].x = rand()%(side*BENCH_TILE_SIZE);
+        items[i].y = rand()%(side*BENCH_TILE_SIZE);
+        //pixels per frame, like the character
+        items[i].velocityX = rand()%7 - 3;
+        items[i].velocityY = rand()%7 - 3;
+        items[i].layer = 1;
+        items[i].sprite = 1;
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"depth\",\n  \"items\": %d,\n  \"tiles\": %d,\n  \"sprites\": %d,\n  \"frames\": %d,\n  \"results\": [\n",
+            numItems,numTiles,numItems-numTiles,BENCH_DEPTH_FRAMES);
+    benchDepthRun(out,queue,items,numItems,"radix",0,0,&tilesTex,&tileRect,0);
+    benchDepthRun(out,queue,items,numItems,"touchUp",1,0,&tilesTex,&tileRect,0);
+    benchDepthRun(out,queue,items,numItems,"scattered",1,1,&tilesTex,&tileRect,1);
+
+    //one frame drawn: a batch for every run of tiles or sprites between the other texture
+    benchDepthFill(queue,items,numItems,0,&tilesTex,&tileRect);
+    resetDrawCallCount();
+    isoRenderQueueDraw(queue);
+    drawCalls = getDrawCallCount();
+    fprintf(out,"  ],\n  \"drawRuns\": %d,\n  \"drawCalls\": %d,\n",queue->numRuns,drawCalls);
+    free(items);
+    isoRenderQueueFree(queue);
+
+    benchDepthGameFrame(out);
+    textureDelete(&tilesTex);
+    textureDelete(&benchCharacterTex);
+    closeDownSDL();
+}
+
+//What the benchmark finds out about one path
+typedef struct benchPathResultT
+{
+    isoPathFinderT *finder;
+    int startX;
+    int startY;
+    int goalX;
+    int goalY;
+    int found;
+    int valid;              //every step goes to a walkable neighbour without cutting a corner, from the start to the goal
+    int length;
+    Uint32 cost;
+    SDL_Rect wall;          //no tile of the path may be inside it
+}benchPathResultT;
+
+//The reference: A* over every tile of the map
+typedef struct benchPathGridT
+{
+    int size;
+    Uint32 *cost;
+    Uint64 *open;
+    int numOpen;
+    int maxOpen;
+}benchPathGridT;
+
+static int benchPathMapSizes[] = {256,1024,4096};
+
+//The cost of a path the way isoPath counts it, ISO_PATH_NO_PATH if a step is not allowed
+static Uint32 benchPathCost(isoPathFinderT *finder,const SDL_Point *tiles,int numTiles)
+{
+    int i;
+    int dx,dy;
+    int cost;
+    Uint32 total = 0;
+
+    for(i=1;i<numTiles;++i){
+        dx = tiles[i].x - tiles[i-1].x;
+        dy = tiles[i].y - tiles[i-1].y;
+        cost = isoPathGetCost(finder,tiles[i].x,tiles[i].y);
+        if(abs(dx) > 1 || abs(dy) > 1 || (dx == 0 && dy == 0) || cost == ISO_PATH_BLOCKED){
+            return ISO_PATH_NO_PATH;
+        }
+        if(dx != 0 && dy != 0){
+            if(isoPathGetCost(finder,tiles[i-1].x+dx,tiles[i-1].y) == ISO_PATH_BLOCKED ||
+               isoPathGetCost(finder,tiles[i-1].x,tiles[i-1].y+dy) == ISO_PATH_BLOCKED){
+                return ISO_PATH_NO_PATH;
+            }
+            total += ISO_PATH_DIAGONAL*cost;
+        }
+        else{
+            total += ISO_PATH_STRAIGHT*cost;
+        }
+    }
+    return total;
+}
+
+static void benchPathFound(void *data,int found,const SDL_Point *tiles,int numTiles)
+{
+    int i;
+    benchPathResultT *result = data;
+
+    result->found = found;
+    result->length = numTiles;
+    result->cost = found ? benchPathCost(result->finder,tiles,numTiles) : 0;
+    result->valid = !found || (numTiles > 0 && result->cost != ISO_PATH_NO_PATH &&
+                               tiles[0].x == result->startX && tiles[0].y == result->startY &&
+                               tiles[numTiles-1].x == result->goalX && tiles[numTiles-1].y == result->goalY);
+    for(i=0;i<numTiles && result->valid;++i){
+        if(tiles[i].x >= result->wall.x && tiles[i].x < result->wall.x+result->wall.w &&
+           tiles[i].y >= result->wall.y && tiles[i].y < result->wall.y+result->wall.h){
+            result->valid = 0;
+        }
+    }
+}
+
+//A random walkable tile inside area
+static int benchPathRandomTile(isoPathFinderT *finder,SDL_Rect *area,int *x,int *y)
+{
+    int tries;
+
+    for(tries=0;tries<10000;++tries){
+        *x = area->x + rand()%area->w;
+        *y = area->y + rand()%area->h;
+        if(isoPathGetCost(finder,*x,*y) != ISO_PATH_BLOCKED){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static Uint32 benchPathHeuristic(int x,int y,int goalX,int goalY)
+{
+    int dx = abs(x-goalX);
+    int dy = abs(y-goalY);
+
+    return ISO_PATH_STRAIGHT*SDL_max(dx,dy) + (ISO_PATH_DIAGONAL-ISO_PATH_STRAIGHT)*SDL_min(dx,dy);
+}
+
+static void benchPathGridPush(benchPathGridT *grid,Uint64 entry)
+{
+    int i;
+    Uint64 *open;
+
+    if(grid->numOpen == grid->maxOpen){
+        open = realloc(grid->open,(grid->maxOpen+65536)*sizeof(Uint64));
+        if(open == NULL){
+            return;
+        }
+        grid->open = open;
+        grid->maxOpen += 65536;
+    }
+    for(i=grid->numOpen++;i>0 && grid->open[(i-1)/2] > entry;i=(i-1)/2){
+        grid->open[i] = grid->open[(i-1)/2];
+    }
+    grid->open[i] = entry;
+}
+
+static Uint64 benchPathGridPop(benchPathGridT *grid)
+{
+    int i,child;
+    Uint64 top = grid->open[0];
+    Uint64 last = grid->open[--grid->numOpen];
+
+    for(i=0;(child = 2*i+1) < grid->numOpen;i=child){
+        if(child+1 < grid->numOpen && grid->open[child+1] < grid->open[child]){
+            child++;
+        }
+        if(grid->open[child] >= last){
+            break;
+        }
+        grid->open[i] = grid->open[child];
+    }
+    grid->open[i] = last;
+    return top;
+}
+
+//The cost of the cheapest path, with the same steps isoPath takes, ISO_PATH_NO_PATH if there is none
+static Uint32 benchPathReference(isoPathFinderT *finder,benchPathGridT *grid,int startX,int startY,int goalX,int goalY)
+{
+    int step;
+    int x,y,nextX,nextY;
+    int tile,next;
+    int cost;
+    Uint32 newCost;
+    Uint64 entry;
+    static const int stepX[8] = {0,1,0,-1,1,1,-1,-1};
+    static const int stepY[8] = {-1,0,1,0,-1,1,1,-1};
+
+    if(isoPathGetCost(finder,startX,startY) == ISO_PATH_BLOCKED || isoPathGetCost(finder,goalX,goalY) == ISO_PATH_BLOCKED){
+        return ISO_PATH_NO_PATH;
+    }
+    memset(grid->cost,0xff,(size_t)grid->size*grid->size*sizeof(Uint32));
+    grid->numOpen = 0;
+    tile = startY*grid->size + startX;
+    grid->cost[tile] = 0;
+    benchPathGridPush(grid,((Uint64)benchPathHeuristic(startX,startY,goalX,goalY) << 32) | tile);
+    while(grid->numOpen > 0){
+        entry = benchPathGridPop(grid);
+        tile = (Uint32)entry;
+        x = tile % grid->size;
+        y = tile / grid->size;
+        if(x == goalX && y == goalY){
+            return grid->cost[tile];
+        }
+        //an entry from before a cheaper way to the tile was found
+        if((Uint32)(entry >> 32) - benchPathHeuristic(x,y,goalX,goalY) > grid->cost[tile]){
+            continue;
+        }
+        for(step=0;step<8;++step){
+            nextX = x + stepX[step];
+            nextY = y + stepY[step];
+            cost = isoPathGetCost(finder,nextX,nextY);
+            if(cost == ISO_PATH_BLOCKED ||
+               (step >= 4 && (isoPathGetCost(finder,nextX,y) == ISO_PATH_BLOCKED || isoPathGetCost(finder,x,nextY) == ISO_PATH_BLOCKED))){
+                continue;
+            }
+            next = nextY*grid->size + nextX;
+            newCost = grid->cost[tile] + (step < 4 ? ISO_PATH_STRAIGHT : ISO_PATH_DIAGONAL)*cost;
+            if(newCost < grid->cost[next]){
+                grid->cost[next] = newCost;
+                benchPathGridPush(grid,((Uint64)(newCost + benchPathHeuristic(nextX,nextY,goalX,goalY)) << 32) | next);
+            }
+        }
+    }
+    return ISO_PATH_NO_PATH;
+}
+
+static void benchPathfindingRun(FILE *out,int mapSize,int numRequests,threadPoolT *pool,int last)
+{
+    int i;
+    int numNodes = 0;
+    int numFrames = 0;
+    int numFound = 0;
+    int numValid = 0;
+    int numChecked = 0;
+    int numMissed = 0;
+    int numWallPaths = 0;
+    int numWallValid = 0;
+    int numRebuilt;
+    int found;
+    int numTiles;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double buildMs,requestsMs = 0,frameMs,worstFrameMs = 0;
+    double referenceMs = 0,hpaMs = 0,rebuildMs;
+    double ratio,ratioSum = 0,worstRatio = 1;
+    Uint64 lengthSum = 0;
+    Uint64 start;
+    Uint32 referenceCost;
+    const SDL_Point *tiles;
+    SDL_Rect area;
+    SDL_Rect wall;
+    isoMapGenT gen;
+    isoMapT *isoMap;
+    isoPathFinderT *finder = NULL;
+    benchPathResultT *results = NULL;
+    benchPathResultT result;
+    benchPathGridT grid;
+
+    memset(&grid,0,sizeof(grid));
+    isoMap = isoMapCreateEmptyMap("Pathfinding",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    if(isoMap != NULL){
+        finder = isoPathNew(isoMap,pool);
+        results = calloc(numRequests,sizeof(benchPathResultT));
+    }
+    if(isoMap == NULL || finder == NULL || results == NULL){
+        fprintf(stderr,"Could not create the map or the path finder!\n");
+        fprintf(out,"    {\"mapSize\": %d, \"valid\": %s}%s\n",mapSize,benchCheck(0),last ? "" : ",");
+        free(results);
+        isoPathFree(finder);
+        isoMapFreeMap(isoMap);
+        return;
+    }
+    //water and one of the decorations can not be walked on, the other decoration slows down
+    isoMapGenInitDefault(&gen,BENCH_GENERATE_SEED);
+    isoMapGenAddPass(&gen,isoMapGenNoisePass,&benchGenerateWater,0);
+    isoMapGenAddPass(&gen,isoMapGenStamps,&benchGenerateDecorations,1);
+    isoMapGenRun(&gen,isoMap,pool);
+    isoPathSetTileCost(finder,2,ISO_PATH_BLOCKED);
+    isoPathSetTileCost(finder,3,ISO_PATH_BLOCKED);
+    isoPathSetTileCost(finder,4,BENCH_PATH_SLOW_COST);
+
+    start = SDL_GetPerformanceCounter();
+    isoPathRebuild(finder);
+    buildMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    for(i=0;i<finder->numClustersX * finder->numClustersY;++i){
+        numNodes += finder->clusters[i].numNodes;
+    }
+
+    //random paths across the whole map, searched a budget per frame like in the game
+    srand(BENCH_GENERATE_SEED);
+    setupRect(&area,0,0,mapSize,mapSize);
+    for(i=0;i<numRequests;++i){
+        results[i].finder = finder;
+        benchPathRandomTile(finder,&area,&results[i].startX,&results[i].startY);
+        benchPathRandomTile(finder,&area,&results[i].goalX,&results[i].goalY);
+        isoPathRequest(finder,results[i].startX,results[i].startY,results[i].goalX,results[i].goalY,benchPathFound,&results[i]);
+    }
+    while(finder->numRequests > 0){
+        start = SDL_GetPerformanceCounter();
+        isoPathUpdate(finder,BENCH_PATH_BUDGET_MS);
+        frameMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        requestsMs += frameMs;
+        worstFrameMs = SDL_max(worstFrameMs,frameMs);
+        numFrames++;
+    }
+    for(i=0;i<numRequests;++i){
+        numFound += results[i].found;
+        numValid += results[i].valid;
+        lengthSum += results[i].length;
+    }
+
+    //the cost of the paths against the cheapest ones, the reference is too slow for the biggest maps
+    if(mapSize <= BENCH_PATH_REFERENCE_SIZE){
+        grid.size = mapSize;
+        grid.cost = malloc((size_t)mapSize*mapSize*sizeof(Uint32));
+    }
+    for(i=0;i<numRequests && i<BENCH_PATH_CHECKS && grid.cost != NULL;++i){
+        start = SDL_GetPerformanceCounter();
+        isoPathFind(finder,results[i].startX,results[i].startY,results[i].goalX,results[i].goalY,NULL,NULL);
+        hpaMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        start = SDL_GetPerformanceCounter();
+        referenceCost = benchPathReference(finder,&grid,results[i].startX,results[i].startY,results[i].goalX,results[i].goalY);
+        referenceMs += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        numChecked++;
+        if(referenceCost == ISO_PATH_NO_PATH){
+            //a path where there is none
+            numValid -= results[i].found;
+        }
+        else if(!results[i].found){
+            numMissed++;
+        }
+        else if(referenceCost > 0){
+            ratio = (double)results[i].cost/referenceCost;
+            ratioSum += ratio;
+            worstRatio = SDL_max(worstRatio,ratio);
+        }
+    }
+
+    //a wall across the middle of the map, only the clusters around it are built again
+    setupRect(&wall,mapSize/2,mapSize/4,1,mapSize/2);
+    for(i=wall.y;i<wall.y+wall.h;++i){
+        isoMapSetTile(isoMap,wall.x,i,0,2);
+    }
+    start = SDL_GetPerformanceCounter();
+    numRebuilt = isoPathRebuild(finder);
+    rebuildMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    for(i=0;i<BENCH_PATH_WALL_PATHS;++i){
+        memset(&result,0,sizeof(result));
+        result.finder = finder;
+        result.wall = wall;
+        setupRect(&area,0,wall.y,wall.x,wall.h);
+        benchPathRandomTile(finder,&area,&result.startX,&result.startY);
+        setupRect(&area,wall.x+1,wall.y,mapSize-wall.x-1,wall.h);
+        benchPathRandomTile(finder,&area,&result.goalX,&result.goalY);
+        found = isoPathFind(finder,result.startX,result.startY,result.goalX,result.goalY,&tiles,&numTiles);
+        benchPathFound(&result,found,tiles,numTiles);
+        numWallPaths += found;
+        numWallValid += result.valid;
+    }
+
+    fprintf(out,"    {\"mapSize\": %d, \"clusters\": %d, \"nodes\": %d, \"buildMs\": %.1f, \"frames\": %d, \"worstFrameMs\": %.2f, "
+                "\"pathsPerSecond\": %.0f, \"found\": %d, \"averageLength\": %.1f, \"checked\": %d, \"missed\": %d, "
+                "\"msPerPath\": %.3f, \"referenceMsPerPath\": %.3f, \"averageSuboptimality\": %.4f, \"worstSuboptimality\": %.4f, "
+                "\"wallClustersRebuilt\": %d, \"wallRebuildMs\": %.2f, \"wallPaths\": %d, \"valid\": %s}%s\n",
+            mapSize,finder->numClustersX * finder->numClustersY,numNodes,buildMs,numFrames,worstFrameMs,
+            requestsMs > 0 ? numRequests*1000.0/requestsMs : 0.0,numFound,numFound > 0 ? (double)lengthSum/numFound : 0.0,
+            numChecked,numMissed,numChecked > 0 ? hpaMs/numChecked : 0.0,numChecked > 0 ? referenceMs/numChecked : 0.0,
+            numChecked-numMissed > 0 ? ratioSum/(numChecked-numMissed) - 1.0 : 0.0,worstRatio - 1.0,
+            numRebuilt,rebuildMs,numWallPaths,
+            benchCheck(numValid == numRequests && numMissed == 0 && numWallValid == BENCH_PATH_WALL_PATHS),last ? "" : ",");
+    fflush(out);
+    free(grid.cost);
+    free(grid.open);
+    free(results);
+    isoPathFree(finder);
+    isoMapFreeMap(isoMap);
+}
+
+static void benchPathfinding(FILE *out,int numRequests)
+{
+    int i;
+    int numSizes = sizeof(benchPathMapSizes)/sizeof(benchPathMapSizes[0]);
+    threadPoolT *pool = threadPoolNew(-1);
+
+    fprintf(out,"{\n  \"benchmark\": \"pathfinding\",\n  \"requests\": %d,\n  \"budgetMs\": %d,\n  \"threads\": %d,\n  \"results\": [\n",
+            numRequests,BENCH_PATH_BUDGET_MS,threadPoolGetNumThreads(pool));
+    for(i=0;i<numSizes;++i){
+        benchPathfindingRun(out,benchPathMapSizes[i],numRequests,pool,i == numSizes-1);
+    }
+    fprintf(out,"  ]\n}\n");
+    threadPoolFree(pool);
+}
+
+//The reference: a Dijkstra over every tile of the map backwards from the goal, the cost to the goal of every tile
+static void benchFlowReference(isoPathFinderT *finder,benchPathGridT *grid,int goalX,int goalY)
+{
+    int step;
+    int x,y,nextX,nextY;
+    int tile,next;
+    int cost;
+    Uint32 newCost;
+    Uint64 entry;
+    static const int stepX[8] = {0,1,0,-1,1,1,-1,-1};
+    static const int stepY[8] = {-1,0,1,0,-1,1,1,-1};
+
+    memset(grid->cost,0xff,(size_t)grid->size*grid->size*sizeof(Uint32));
+    grid->numOpen = 0;
+    if(isoPathGetCost(finder,goalX,goalY) == ISO_PATH_BLOCKED){
+        return;
+    }
+    tile = goalY*grid->size + goalX;
+    grid->cost[tile] = 0;
+    benchPathGridPush(grid,tile);
+    while(grid->numOpen > 0){
+        entry = benchPathGridPop(grid);
+        tile = (Uint32)entry;
+        if((Uint32)(entry >> 32) > grid->cost[tile]){
+            continue;
+        }
+        x = tile % grid->size;
+        y = tile / grid->size;
+        //the step from the neighbour onto this tile
+        cost = isoPathGetCost(finder,x,y);
+        for(step=0;step<8;++step){
+            nextX = x + stepX[step];
+            nextY = y + stepY[step];
+            if(isoPathGetCost(finder,nextX,nextY) == ISO_PATH_BLOCKED ||
+               (step >= 4 && (isoPathGetCost(finder,nextX,y) == ISO_PATH_BLOCKED || isoPathGetCost(finder,x,nextY) == ISO_PATH_BLOCKED))){
+                continue;
+            }
+            next = nextY*grid->size + nextX;
+            newCost = grid->cost[tile] + (step < 4 ? ISO_PATH_STRAIGHT : ISO_PATH_DIAGONAL)*cost;
+            if(newCost < grid->cost[next]){
+                grid->cost[next] = newCost;
+                benchPathGridPush(grid,((Uint64)newCost << 32) | next);
+            }
+        }
+    }
+}
+
+//Checks every tile of the field against the reference: every step has to be allowed and lead to a tile that is
+//cheaper, and every tile the goal can be reached from has to have a way. Returns the number of bad tiles.
+static int benchFlowCheck(isoPathFinderT *finder,isoFlowFieldT *field,benchPathGridT *grid,int *numMissed,double *ratioSum,double *worstRatio,int *numWays)
+{
+    int x,y;
+    int dx,dy;
+    int numBad = 0;
+    Uint32 cost,referenceCost;
+    double ratio;
+
+    *numMissed = 0;
+    *ratioSum = 0;
+    *worstRatio = 1;
+    *numWays = 0;
+    for(y=0;y<grid->size;++y){
+        for(x=0;x<grid->size;++x){
+            referenceCost = grid->cost[y*grid->size + x];
+            cost = isoFlowGetCost(field,x,y);
+            if(!isoFlowGetDirection(field,x,y,&dx,&dy)){
+                *numMissed += referenceCost != ISO_PATH_NO_PATH;
+                continue;
+            }
+            if(referenceCost == ISO_PATH_NO_PATH || cost < referenceCost){
+                numBad++;
+                continue;
+            }
+            (*numWays)++;
+            if(referenceCost > 0){
+                ratio = (double)cost/referenceCost;
+                *ratioSum += ratio;
+                *worstRatio = SDL_max(*worstRatio,ratio);
+            }
+            if(dx == 0 && dy == 0){
+                numBad += x != field->goalX || y != field->goalY;
+                continue;
+            }
+            if(isoPathGetCost(finder,x+dx,y+dy) == ISO_PATH_BLOCKED || isoFlowGetCost(field,x+dx,y+dy) >= cost ||
+               (dx != 0 && dy != 0 && (isoPathGetCost(finder,x+dx,y) == ISO_PATH_BLOCKED || isoPathGetCost(finder,x,y+dy) == ISO_PATH_BLOCKED))){
+                numBad++;
+            }
+        }
+    }
+    return numBad;
+}
+
+static void benchFlowFree(isoMapT *isoMap,isoPathFinderT *finder,isoFlowT *flow,isoEntityStoreT *store,isoEntityHandleT *handles,
+                          SDL_Point *targets,Uint32 *startCosts,benchPathGridT *grid,threadPoolT *pool)
+{
+    free(grid->cost);
+    free(grid->open);
+    free(startCosts);
+    free(targets);
+    free(handles);
+    isoEntityStoreFree(store);
+    isoFlowFree(flow);
+    isoPathFree(finder);
+    isoMapFreeMap(isoMap);
+    threadPoolFree(pool);
+}
+
+static void benchFlowfield(FILE *out,int numUnits)
+{
+    int i,tick;
+    int x,y,dx,dy;
+    int index;
+    int numClusters;
+    int numIntegrated = 0;
+    int numFirstIntegrated = 0;
+    int numArrived = 0;
+    int numWithWay = 0;
+    int numBad = 0,numMissed = 0,numWays = 0;
+    int wallIntegrated = 0,wallKept = 0;
+    int cacheHit;
+    int mapSize = BENCH_FLOW_MAP_SIZE;
+    int tileSize = BENCH_TILE_SIZE;
+    float targetX,targetY,distance;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double buildMs,firstUpdateMs = 0,tickMs,tickSum = 0,worstTickMs = 0,updateSum = 0;
+    double fullFieldMs,wallMs,referenceMs;
+    double ratioSum = 0,worstRatio = 1;
+    double costStart = 0,costEnd = 0;
+    Uint64 start,updateStart;
+    Uint32 cost;
+    SDL_Rect area;
+    SDL_Rect wall;
+    isoMapGenT gen;
+    isoMapT *isoMap;
+    isoPathFinderT *finder = NULL;
+    isoFlowT *flow = NULL;
+    isoFlowFieldT *field = NULL;
+    isoEntityStoreT *store = NULL;
+    isoEntityHandleT *handles = NULL;
+    SDL_Point *targets = NULL;
+    Uint32 *startCosts = NULL;
+    benchPathGridT grid;
+    threadPoolT *pool = threadPoolNew(-1);
+
+    memset(&grid,0,sizeof(grid));
+    isoMap = isoMapCreateEmptyMap("Flow field",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    if(isoMap != NULL){
+        finder = isoPathNew(isoMap,pool);
+        flow = isoFlowNew(finder,pool);
+        store = isoEntityStoreNew();
+        handles = malloc(numUnits*sizeof(isoEntityHandleT));
+        targets = malloc(numUnits*sizeof(SDL_Point));
+        startCosts = malloc(numUnits*sizeof(Uint32));
+        grid.size = mapSize;
+        grid.cost = malloc((size_t)mapSize*mapSize*sizeof(Uint32));
+    }
+    //the units are not drawn, the sprite is never loaded
+    if(isoMap == NULL || finder == NULL || flow == NULL || store == NULL || handles == NULL || targets == NULL ||
+       startCosts == NULL || grid.cost == NULL || isoEntityAddSprite(store,&benchCharacterTex,benchCharRects,1,1) < 0){
+        fprintf(stderr,"Could not create the map or the flow fields!\n");
+        fprintf(out,"{\n  \"benchmark\": \"flowfield\",\n  \"valid\": %s\n}\n",benchCheck(0));
+        benchFlowFree(isoMap,finder,flow,store,handles,targets,startCosts,&grid,pool);
+        return;
+    }
+    numClusters = finder->numClustersX * finder->numClustersY;
+
+    //the map of the pathfinding benchmark
+    isoMapGenInitDefault(&gen,BENCH_GENERATE_SEED);
+    isoMapGenAddPass(&gen,isoMapGenNoisePass,&benchGenerateWater,0);
+    isoMapGenAddPass(&gen,isoMapGenStamps,&benchGenerateDecorations,1);
+    isoMapGenRun(&gen,isoMap,pool);
+    isoPathSetTileCost(finder,2,ISO_PATH_BLOCKED);
+    isoPathSetTileCost(finder,3,ISO_PATH_BLOCKED);
+    isoPathSetTileCost(finder,4,BENCH_PATH_SLOW_COST);
+    start = SDL_GetPerformanceCounter();
+    isoPathRebuild(finder);
+    buildMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+    //the units all over the map, the goal near the middle
+    srand(BENCH_GENERATE_SEED);
+    setupRect(&area,mapSize/2-16,mapSize/2-16,32,32);
+    benchPathRandomTile(finder,&area,&x,&y);
+    field = isoFlowGetField(flow,x,y);
+    if(field == NULL){
+        fprintf(stderr,"Could not create the flow field!\n");
+        fprintf(out,"{\n  \"benchmark\": \"flowfield\",\n  \"valid\": %s\n}\n",benchCheck(0));
+        benchFlowFree(isoMap,finder,flow,store,handles,targets,startCosts,&grid,pool);
+        return;
+    }
+    setupRect(&area,0,0,mapSize,mapSize);
+    for(i=0;i<numUnits;++i){
+        benchPathRandomTile(finder,&area,&targets[i].x,&targets[i].y);
+        handles[i] = isoEntityCreate(store,targets[i].x*tileSize,targets[i].y*tileSize,0);
+    }
+
+    //every tick the units ask for the chunks they are heading into, then steer to the next tile of the field
+    for(tick=0;tick<BENCH_FLOW_TICKS;++tick){
+        start = SDL_GetPerformanceCounter();
+        for(i=0;i<numUnits;++i){
+            isoFlowRequire(field,targets[i].x,targets[i].y);
+        }
+        updateStart = SDL_GetPerformanceCounter();
+        numIntegrated += isoFlowUpdate(flow);
+        if(tick == 0){
+            firstUpdateMs = (SDL_GetPerformanceCounter()-updateStart)*1000.0/freq;
+            numFirstIntegrated = numIntegrated;
+            for(i=0;i<numUnits;++i){
+                startCosts[i] = isoFlowGetCost(field,targets[i].x,targets[i].y);
+            }
+        }
+        else{
+            updateSum += (SDL_GetPerformanceCounter()-updateStart)*1000.0/freq;
+        }
+        for(i=0;i<numUnits;++i){
+            index = isoEntityGetIndex(store,handles[i]);
+            targetX = targets[i].x*tileSize - store->x[index];
+            targetY = targets[i].y*tileSize - store->y[index];
+            distance = sqrtf(targetX*targetX + targetY*targetY);
+            //on the tile it was heading for, on to the next one
+            if(distance <= BENCH_FLOW_SPEED && isoFlowGetDirection(field,targets[i].x,targets[i].y,&dx,&dy) && (dx != 0 || dy != 0)){
+                targets[i].x += dx;
+                targets[i].y += dy;
+                targetX = targets[i].x*tileSize - store->x[index];
+                targetY = targets[i].y*tileSize - store->y[index];
+                distance = sqrtf(targetX*targetX + targetY*targetY);
+            }
+            if(distance > BENCH_FLOW_SPEED){
+                isoEntitySetVelocity(store,handles[i],targetX*BENCH_FLOW_SPEED/distance,targetY*BENCH_FLOW_SPEED/distance);
+            }
+            else{
+                isoEntitySetVelocity(store,handles[i],targetX,targetY);
+            }
+        }
+        isoEntityUpdate(store);
+        if(tick > 0){
+            tickMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+            tickSum += tickMs;
+            worstTickMs = SDL_max(worstTickMs,tickMs);
+        }
+    }
+    for(i=0;i<numUnits;++i){
+        if(startCosts[i] == ISO_PATH_NO_PATH){
+            continue;
+        }
+        cost = isoFlowGetCost(field,targets[i].x,targets[i].y);
+        numWithWay++;
+        numArrived += cost == 0;
+        costStart += startCosts[i];
+        costEnd += cost != ISO_PATH_NO_PATH ? cost : startCosts[i];
+    }
+
+    //the whole field, then a wall across the east of the map: only the chunks whose way changed are integrated again
+    start = SDL_GetPerformanceCounter();
+    for(y=0;y<mapSize;y+=ISO_PATH_CLUSTER_SIZE){
+        for(x=0;x<mapSize;x+=ISO_PATH_CLUSTER_SIZE){
+            isoFlowRequire(field,x,y);
+        }
+    }
+    isoFlowUpdate(flow);
+    fullFieldMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    setupRect(&wall,mapSize*3/4,mapSize/4,1,mapSize/2);
+    for(i=wall.y;i<wall.y+wall.h;++i){
+        isoMapSetTile(isoMap,wall.x,i,0,2);
+    }
+    start = SDL_GetPerformanceCounter();
+    for(y=0;y<mapSize;y+=ISO_PATH_CLUSTER_SIZE){
+        for(x=0;x<mapSize;x+=ISO_PATH_CLUSTER_SIZE){
+            isoFlowRequire(field,x,y);
+        }
+    }
+    wallIntegrated = isoFlowUpdate(flow);
+    wallKept = flow->numKept;
+    wallMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+    //the field after the wall against the cheapest ways
+    start = SDL_GetPerformanceCounter();
+    benchFlowReference(finder,&grid,field->goalX,field->goalY);
+    referenceMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    numBad = benchFlowCheck(finder,field,&grid,&numMissed,&ratioSum,&worstRatio,&numWays);
+
+    //the same goal again is the same field, also after another goal was asked for
+    cacheHit = isoFlowGetField(flow,field->goalX,field->goalY) == field;
+    cacheHit &= isoFlowGetField(flow,0,0) != field && isoFlowGetField(flow,field->goalX,field->goalY) == field;
+
+    fprintf(out,"{\n  \"benchmark\": \"flowfield\",\n  \"mapSize\": %d,\n  \"units\": %d,\n  \"ticks\": %d,\n  \"threads\": %d,\n"
+                "  \"chunks\": %d,\n  \"buildMs\": %.1f,\n  \"firstUpdateMs\": %.1f,\n  \"firstChunksIntegrated\": %d,\n"
+                "  \"averageUpdateMs\": %.3f,\n  \"averageTickMs\": %.3f,\n  \"worstTickMs\": %.2f,\n  \"chunksIntegrated\": %d,\n"
+                "  \"unitsWithWay\": %d,\n  \"arrived\": %d,\n  \"progress\": %.3f,\n"
+                "  \"fullFieldMs\": %.1f,\n  \"wallMs\": %.1f,\n  \"wallChunksIntegrated\": %d,\n  \"wallChunksKept\": %d,\n"
+                "  \"referenceMs\": %.1f,\n  \"tilesWithWay\": %d,\n  \"missed\": %d,\n  \"badSteps\": %d,\n"
+                "  \"averageSuboptimality\": %.4f,\n  \"worstSuboptimality\": %.4f,\n  \"cacheHit\": %s,\n  \"valid\": %s\n}\n",
+            mapSize,numUnits,BENCH_FLOW_TICKS,threadPoolGetNumThreads(pool),numClusters,buildMs,firstUpdateMs,numFirstIntegrated,
+            BENCH_FLOW_TICKS > 1 ? updateSum/(BENCH_FLOW_TICKS-1) : 0.0,BENCH_FLOW_TICKS > 1 ? tickSum/(BENCH_FLOW_TICKS-1) : 0.0,
+            worstTickMs,numIntegrated,numWithWay,numArrived,costStart > 0 ? 1.0 - costEnd/costStart : 0.0,
+            fullFieldMs,wallMs,wallIntegrated,wallKept,referenceMs,numWays,numMissed,numBad,
+            numWays > 0 ? ratioSum/numWays - 1.0 : 0.0,worstRatio - 1.0,benchCheck(cacheHit),
+            benchCheck(numBad == 0 && numMissed == 0 && cacheHit));
+    benchFlowFree(isoMap,finder,flow,store,handles,targets,startCosts,&grid,pool);
+}
+
+//Every tile of every layer, layer after layer
+static void benchJournalReadTiles(isoMapT *isoMap,int *tiles)
+{
+    int x,y,layer;
+
+    for(layer=0;layer<isoMap->numLayers;++layer){
+        for(y=0;y<isoMap->mapHeight;++y){
+            for(x=0;x<isoMap->mapWidth;++x){
+                *tiles++ = isoMapGetTile(isoMap,x,y,layer);
+            }
+        }
+    }
+}
+
+//Brush strokes: a square brush dabbed along a random walk, one transaction per stroke
+static void benchJournalStrokes(isoMapT *isoMap,isoMapJournalT *journal,int numStrokes,double *worstMs)
+{
+    int i,dab;
+    int x,y,brushX,brushY;
+    int layer,value;
+    double ms;
+    Uint64 start;
+
+    for(i=0;i<numStrokes;++i){
+        start = SDL_GetPerformanceCounter();
+        isoMapJournalBegin(journal);
+        x = rand()%isoMap->mapWidth;
+        y = rand()%isoMap->mapHeight;
+        layer = rand()%isoMap->numLayers;
+        value = layer == 0 ? 1 + rand()%4 : 3 + rand()%2;
+        for(dab=0;dab<BENCH_JOURNAL_DABS;++dab){
+            for(brushY=0;brushY<BENCH_JOURNAL_BRUSH;++brushY){
+                for(brushX=0;brushX<BENCH_JOURNAL_BRUSH;++brushX){
+                    isoMapSetTile(isoMap,x+brushX,y+brushY,layer,value);
+                }
+            }
+            x += rand()%5 - 2;
+            y += rand()%5 - 2;
+        }
+        isoMapJournalEnd(journal);
+        ms = (SDL_GetPerformanceCounter()-start)*1000.0/SDL_GetPerformanceFrequency();
+        *worstMs = SDL_max(*worstMs,ms);
+    }
+}
+
+static void benchJournal(FILE *out,int numStrokes)
+{
+    int x,y;
+    int numTiles;
+    int numUndone = 0,numRedone = 0;
+    int undoValid,redoValid,bigValid,branchValid,budgetValid;
+    int strokeTiles = 0,bigTiles;
+    int kept;
+    int mapSize = BENCH_JOURNAL_MAP_SIZE;
+    size_t numMapTiles = (size_t)mapSize*mapSize*BENCH_MAP_LAYERS;
+    size_t journalBytes;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double strokesMs,worstStrokeMs = 0,snapshotMs;
+    double undoMs = 0,worstUndoMs = 0,redoMs = 0,bigUndoMs,ms;
+    Uint64 start;
+    isoMapGenT gen;
+    isoMapT *isoMap;
+    isoMapJournalT *journal = NULL;
+    int *before = malloc(numMapTiles*sizeof(int));
+    int *after = malloc(numMapTiles*sizeof(int));
+    int *tiles = malloc(numMapTiles*sizeof(int));
+
+    isoMap = isoMapCreateEmptyMap("Journal",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    if(isoMap != NULL){
+        isoMapGenInitDefault(&gen,BENCH_GENERATE_SEED);
+        isoMapGenAddPass(&gen,isoMapGenNoisePass,&benchGenerateWater,0);
+        isoMapGenAddPass(&gen,isoMapGenStamps,&benchGenerateDecorations,1);
+        isoMapGenRun(&gen,isoMap,NULL);
+        journal = isoMapJournalNew(isoMap,BENCH_JOURNAL_BUDGET);
+    }
+    if(isoMap == NULL || journal == NULL || before == NULL || after == NULL || tiles == NULL){
+        fprintf(stderr,"Could not create the map or the journal!\n");
+        fprintf(out,"{\n  \"benchmark\": \"journal\",\n  \"valid\": %s\n}\n",benchCheck(0));
+        free(before);
+        free(after);
+        free(tiles);
+        isoMapFreeMap(isoMap);
+        return;
+    }
+    benchJournalReadTiles(isoMap,before);
+
+    //what a snapshot of every tile before each stroke would cost
+    start = SDL_GetPerformanceCounter();
+    memcpy(tiles,before,numMapTiles*sizeof(int));
+    snapshotMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+    srand(BENCH_GENERATE_SEED);
+    start = SDL_GetPerformanceCounter();
+    benchJournalStrokes(isoMap,journal,numStrokes,&worstStrokeMs);
+    strokesMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    benchJournalReadTiles(isoMap,after);
+    kept = journal->numTransactions;
+    journalBytes = journal->memoryUsed;
+
+    //everything undone has to give the generated map back, everything redone the painted one
+    for(;;){
+        start = SDL_GetPerformanceCounter();
+        numTiles = isoMapJournalUndo(journal);
+        ms = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+        if(numTiles == 0){
+            break;
+        }
+        undoMs += ms;
+        worstUndoMs = SDL_max(worstUndoMs,ms);
+        strokeTiles += numTiles;
+        numUndone++;
+    }
+    benchJournalReadTiles(isoMap,tiles);
+    undoValid = numUndone == kept && memcmp(tiles,before,numMapTiles*sizeof(int)) == 0;
+    start = SDL_GetPerformanceCounter();
+    while(isoMapJournalRedo(journal) > 0){
+        numRedone++;
+    }
+    redoMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    benchJournalReadTiles(isoMap,tiles);
+    redoValid = numRedone == kept && memcmp(tiles,after,numMapTiles*sizeof(int)) == 0;
+
+    //one big edit, its undo takes longer by as much as it is bigger
+    isoMapJournalBegin(journal);
+    for(y=0;y<BENCH_JOURNAL_FILL;++y){
+        for(x=0;x<BENCH_JOURNAL_FILL;++x){
+            isoMapSetTile(isoMap,mapSize/4+x,mapSize/4+y,0,(x^y)&1 ? 1 : 4);
+        }
+    }
+    isoMapJournalEnd(journal);
+    start = SDL_GetPerformanceCounter();
+    bigTiles = isoMapJournalUndo(journal);
+    bigUndoMs = (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+    benchJournalReadTiles(isoMap,tiles);
+    bigValid = memcmp(tiles,after,numMapTiles*sizeof(int)) == 0;
+
+    //a new edit after an undo ends what could be redone
+    isoMapJournalUndo(journal);
+    isoMapSetTile(isoMap,0,0,1,3);
+    isoMapSetTile(isoMap,0,0,1,4);
+    branchValid = isoMapJournalRedo(journal) == 0 && isoMapJournalUndo(journal) == 1;
+
+    //with a small budget the oldest strokes are dropped
+    isoMapJournalSetBudget(journal,BENCH_JOURNAL_SMALL_BUDGET);
+    benchJournalStrokes(isoMap,journal,numStrokes,&ms);
+    budgetValid = journal->memoryUsed <= BENCH_JOURNAL_SMALL_BUDGET && journal->numTransactions > 0 &&
+                  journal->numTransactions + journal->numDropped >= numStrokes;
+
+    fprintf(out,"{\n  \"benchmark\": \"journal\",\n  \"mapSize\": %d,\n  \"layers\": %d,\n  \"strokes\": %d,\n"
+                "  \"tilesPerStroke\": %.1f,\n  \"strokeMs\": %.4f,\n  \"worstStrokeMs\": %.3f,\n"
+                "  \"journalBytes\": %u,\n  \"bytesPerStroke\": %.0f,\n  \"bytesPerTile\": %.2f,\n"
+                "  \"snapshotBytes\": %.0f,\n  \"snapshotMs\": %.2f,\n  \"snapshotsBytes\": %.0f,\n"
+                "  \"undoMs\": %.4f,\n  \"worstUndoMs\": %.3f,\n  \"redoMs\": %.4f,\n  \"undoNsPerTile\": %.1f,\n"
+                "  \"bigEditTiles\": %d,\n  \"bigUndoMs\": %.3f,\n  \"bigUndoNsPerTile\": %.1f,\n"
+                "  \"smallBudget\": %d,\n  \"smallBudgetBytes\": %u,\n  \"smallBudgetKept\": %d,\n  \"smallBudgetDropped\": %d,\n"
+                "  \"undoValid\": %s,\n  \"redoValid\": %s,\n  \"bigValid\": %s,\n  \"branchValid\": %s,\n  \"budgetValid\": %s,\n"
+                "  \"valid\": %s\n}\n",
+            mapSize,BENCH_MAP_LAYERS,numStrokes,kept > 0 ? (double)strokeTiles/kept : 0.0,strokesMs/numStrokes,worstStrokeMs,
+            (unsigned)journalBytes,kept > 0 ? (double)journalBytes/kept : 0.0,strokeTiles > 0 ? (double)journalBytes/strokeTiles : 0.0,
+            (double)numMapTiles*sizeof(int),snapshotMs,(double)numMapTiles*sizeof(int)*numStrokes,
+            numUndone > 0 ? undoMs/numUndone : 0.0,worstUndoMs,numRedone > 0 ? redoMs/numRedone : 0.0,
+            strokeTiles > 0 ? undoMs*1000000.0/strokeTiles : 0.0,
+            bigTiles,bigUndoMs,bigTiles > 0 ? bigUndoMs*1000000.0/bigTiles : 0.0,
+            BENCH_JOURNAL_SMALL_BUDGET,(unsigned)journal->memoryUsed,journal->numTransactions,journal->numDropped,
+            benchCheck(undoValid),benchCheck(redoValid),benchCheck(bigValid),
+            benchCheck(branchValid),benchCheck(budgetValid),
+            benchCheck(undoValid && redoValid && bigValid && branchValid && budgetValid));
+    free(before);
+    free(after);
+    free(tiles);
+    isoMapFreeMap(isoMap);
+}
+
+//A rect that can stick out of the map on any side
+static void benchBulkRect(int mapSize,SDL_Rect *rect)
+{
+    rect->w = 1 + rand()%BENCH_BULK_MAX_SIDE;
+    rect->h = 1 + rand()%BENCH_BULK_MAX_SIDE;
+    rect->x = rand()%(mapSize + BENCH_BULK_MAX_SIDE) - BENCH_BULK_MAX_SIDE/2;
+    rect->y = rand()%(mapSize + BENCH_BULK_MAX_SIDE) - BENCH_BULK_MAX_SIDE/2;
+}
+
+//The bulk operations done tile by tile with isoMapGetTile and isoMapSetTile, op is one of the BENCH_BULK_ kinds
+static void benchBulkPerTile(int op,isoMapT *isoMap,isoMapT *src,const SDL_Rect *rect,int layer,int srcLayer,int dstX,int dstY,
+                             int value,const int *pattern,int *tiles)
+{
+    int x,y;
+
+    for(y=0;y<rect->h;++y){
+        for(x=0;x<rect->w;++x){
+            if(op == BENCH_BULK_READ || op == BENCH_BULK_COPY){
+                tiles[y*rect->w + x] = isoMapGetTile(op == BENCH_BULK_COPY ? src : isoMap,rect->x+x,rect->y+y,op == BENCH_BULK_COPY ? srcLayer : layer);
+            }
+            else if(op == BENCH_BULK_FILL){
+                isoMapSetTile(isoMap,rect->x+x,rect->y+y,layer,value);
+            }
+            else if(pattern[y*rect->w + x] != BENCH_BULK_TRANSPARENT){
+                isoMapSetTile(isoMap,rect->x+x,rect->y+y,layer,pattern[y*rect->w + x]);
+            }
+        }
+    }
+    //the whole source is read first, the rects can overlap
+    if(op == BENCH_BULK_COPY){
+        for(y=0;y<rect->h;++y){
+            for(x=0;x<rect->w;++x){
+                if(tiles[y*rect->w + x] >= 0){
+                    isoMapSetTile(isoMap,dstX+x,dstY+y,layer,tiles[y*rect->w + x]);
+                }
+            }
+        }
+    }
+}
+
+//The same random fills, stamps, copies and reads on two copies of a generated map, tile by tile on one and with
+//the bulk operations on the other
+static void benchBulk(FILE *out,int numOps)
+{
+    int i,op;
+    int x,y;
+    double dx,dy;
+    int layer,srcLayer,value;
+    int dstX,dstY;
+    int numTiles[BENCH_BULK_NUM_OPS] = {0};
+    int numCalls[BENCH_BULK_NUM_OPS] = {0};
+    int readValid = 1,mapValid,journalValid = 0;
+    int journalTiles = 0;
+    int mapSize = BENCH_BULK_MAP_SIZE;
+    size_t numMapTiles = (size_t)mapSize*mapSize*BENCH_MAP_LAYERS;
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double perTileMs[BENCH_BULK_NUM_OPS] = {0};
+    double bulkMs[BENCH_BULK_NUM_OPS] = {0};
+    const char *names[BENCH_BULK_NUM_OPS] = {"fill","stamp","copy","read"};
+    Uint64 start;
+    SDL_Rect rect;
+    isoMapGenT gen;
+    isoMapT *perTileMap;
+    isoMapT *bulkMap;
+    isoMapT *srcMap;
+    isoMapT *copyFrom;
+    isoMapJournalT *journal;
+    int *pattern = malloc(BENCH_BULK_MAX_SIDE*BENCH_BULK_MAX_SIDE*sizeof(int));
+    int *perTileTiles = malloc(BENCH_BULK_MAX_SIDE*BENCH_BULK_MAX_SIDE*sizeof(int));
+    int *bulkTiles = malloc(BENCH_BULK_MAX_SIDE*BENCH_BULK_MAX_SIDE*sizeof(int));
+    int *tiles = malloc(numMapTiles*sizeof(int));
+    int *bulkMapTiles = malloc(numMapTiles*sizeof(int));
+
+    perTileMap = isoMapCreateEmptyMap("Per tile",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    bulkMap = isoMapCreateEmptyMap("Bulk",mapSize,mapSize,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    srcMap = isoMapCreateEmptyMap("Source",mapSize/2,mapSize/2,BENCH_MAP_LAYERS,BENCH_TILE_SIZE);
+    if(perTileMap == NULL || bulkMap == NULL || srcMap == NULL || pattern == NULL || perTileTiles == NULL ||
+       bulkTiles == NULL || tiles == NULL || bulkMapTiles == NULL){
+        fprintf(stderr,"Could not create the maps!\n");
+        fprintf(out,"{\n  \"benchmark\": \"bulk\",\n  \"valid\": %s\n}\n",benchCheck(0));
+        free(pattern);
+        free(perTileTiles);
+        free(bulkTiles);
+        free(tiles);
+        free(bulkMapTiles);
+        isoMapFreeMap(perTileMap);
+        isoMapFreeMap(bulkMap);
+        isoMapFreeMap(srcMap);
+        return;
+    }
+    isoMapGenInitDefault(&gen,BENCH_GENERATE_SEED);
+    isoMapGenAddPass(&gen,isoMapGenNoisePass,&benchGenerateWater,0);
+    isoMapGenAddPass(&gen,isoMapGenStamps,&benchGenerateDecorations,1);
+    isoMapGenRun(&gen,perTileMap,NULL);
+    isoMapGenRun(&gen,bulkMap,NULL);
+    isoMapGenInitDefault(&gen,BENCH_GENERATE_SEED+1);
+    isoMapGenAddPass(&gen,isoMapGenNoisePass,&benchGenerateWater,0);
+    isoMapGenRun(&gen,srcMap,NULL);
+
+    srand(BENCH_GENERATE_SEED);
+    for(i=0;i<numOps;++i){
+        op = rand()%BENCH_BULK_NUM_OPS;
+        benchBulkRect(mapSize,&rect);
+        layer = rand()%BENCH_MAP_LAYERS;
+        srcLayer = rand()%BENCH_MAP_LAYERS;
+        value = layer == 0 ? 1 + rand()%4 : 3 + rand()%2;
+        dstX = rect.x + rand()%BENCH_BULK_MAX_SIDE - BENCH_BULK_MAX_SIDE/2;
+        dstY = rect.y + rand()%BENCH_BULK_MAX_SIDE - BENCH_BULK_MAX_SIDE/2;
+        //half of the copies come from another map, the others from the same map, overlapping or not
+        copyFrom = rand()%2 ? srcMap : NULL;
+        //a brush or a decoration: blocks of values in an ellipse
+        if(op == BENCH_BULK_STAMP){
+            for(y=0;y<rect.h;++y){
+                for(x=0;x<rect.w;++x){
+                    dx = (2.0*x + 1.0)/rect.w - 1.0;
+                    dy = (2.0*y + 1.0)/rect.h - 1.0;
+                    pattern[y*rect.w + x] = dx*dx + dy*dy > 1.0 ? BENCH_BULK_TRANSPARENT : 1 + (value + x/8 + y/8)%4;
+                }
+            }
+        }
+
+        start = SDL_GetPerformanceCounter();
+        benchBulkPerTile(op,perTileMap,copyFrom != NULL ? copyFrom : perTileMap,&rect,layer,srcLayer,dstX,dstY,value,pattern,perTileTiles);
+        perTileMs[op] += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+        start = SDL_GetPerformanceCounter();
+        if(op == BENCH_BULK_FILL){
+            isoMapFillRect(bulkMap,&rect,layer,value);
+        }
+        else if(op == BENCH_BULK_STAMP){
+            isoMapStampRect(bulkMap,rect.x,rect.y,layer,pattern,rect.w,rect.h,BENCH_BULK_TRANSPARENT);
+        }
+        else if(op == BENCH_BULK_COPY){
+            isoMapCopyRect(bulkMap,dstX,dstY,layer,copyFrom != NULL ? copyFrom : bulkMap,&rect,srcLayer);
+        }
+        else{
+            isoMapReadRect(bulkMap,&rect,layer,bulkTiles);
+        }
+        bulkMs[op] += (SDL_GetPerformanceCounter()-start)*1000.0/freq;
+
+        if(op == BENCH_BULK_READ && memcmp(perTileTiles,bulkTiles,rect.w*rect.h*sizeof(int)) != 0){
+            readValid = 0;
+        }
+        numTiles[op] += rect.w*rect.h;
+        numCalls[op]++;
+    }
+    benchJournalReadTiles(perTileMap,tiles);
+    benchJournalReadTiles(bulkMap,bulkMapTiles);
+    mapValid = memcmp(tiles,bulkMapTiles,numMapTiles*sizeof(int)) == 0;
+
+    //with a journal every operation is one transaction
+    journal = isoMapJournalNew(bulkMap,ISO_MAP_JOURNAL_DEFAULT_BUDGET);
+    if(journal != NULL){
+        rect.x = mapSize/4;
+        rect.y = mapSize/4;
+        rect.w = mapSize/2;
+        rect.h = mapSize/2;
+        journalTiles = isoMapFillRect(bulkMap,&rect,0,2);
+        isoMapCopyRect(bulkMap,mapSize/4 + 7,mapSize/4 + 5,1,bulkMap,&rect,0);
+        journalValid = isoMapJournalUndo(journal) > 0 && isoMapJournalUndo(journal) == journalTiles &&
+                       isoMapJournalUndo(journal) == 0;
+        benchJournalReadTiles(bulkMap,tiles);
+        journalValid = journalValid && memcmp(tiles,bulkMapTiles,numMapTiles*sizeof(int)) == 0;
+        isoMapJournalFree(journal);
+    }
+
+    fprintf(out,"{\n  \"benchmark\": \"bulk\",\n  \"mapSize\": %d,\n  \"layers\": %d,\n  \"operations\": [\n",
+            mapSize,BENCH_MAP_LAYERS);
+    for(op=0;op<BENCH_BULK_NUM_OPS;++op){
+        fprintf(out,"    {\"operation\": \"%s\", \"calls\": %d, \"tilesPerCall\": %.0f, \"perTileNsPerTile\": %.2f, "
+                    "\"bulkNsPerTile\": %.2f, \"speedup\": %.1f}%s\n",
+                names[op],numCalls[op],numCalls[op] > 0 ? (double)numTiles[op]/numCalls[op] : 0.0,
+                numTiles[op] > 0 ? perTileMs[op]*1000000.0/numTiles[op] : 0.0,
+                numTiles[op] > 0 ? bulkMs[op]*1000000.0/numTiles[op] : 0.0,
+                bulkMs[op] > 0 ? perTileMs[op]/bulkMs[op] : 0.0,op < BENCH_BULK_NUM_OPS-1 ? "," : "");
+    }
+    fprintf(out,"  ],\n  \"readValid\": %s,\n  \"mapValid\": %s,\n  \"journalValid\": %s,\n  \"valid\": %s\n}\n",
+            benchCheck(readValid),benchCheck(mapValid),benchCheck(journalValid),
+            benchCheck(readValid && mapValid && journalValid));
+    free(pattern);
+    free(perTileTiles);
+    free(bulkTiles);
+    free(tiles);
+    free(bulkMapTiles);
+    isoMapFreeMap(perTileMap);
+    isoMapFreeMap(bulkMap);
+    isoMapFreeMap(srcMap);
+}
+
+static int benchUsage(char *name)
+{
+    fprintf(stderr,"Usage:\n");
+    fprintf(stderr,"  %s render [frames] [output.json]\n",name);
+    fprintf(stderr,"  %s layout [mapSize] [frames] [output.json]\n",name);
+    fprintf(stderr,"  %s visibility [cameras] [output.json]\n",name);
+    fprintf(stderr,"  %s mapfile [mapSize] [output.json]\n",name);
+    fprintf(stderr,"  %s paging [mapSize] [frames] [output.json]\n",name);
+    fprintf(stderr,"  %s damage [frames] [output.json]\n",name);
+    fprintf(stderr,"  %s loop [seconds] [output.json]\n",name);
+    fprintf(stderr,"  %s bands [frames] [output.json]\n",name);
+    fprintf(stderr,"  %s transform [points] [output.json]\n",name);
+    fprintf(stderr,"  %s picking [points] [output.json]\n",name);
+    fprintf(stderr,"  %s texcache [maps] [output.json]\n",name);
+    fprintf(stderr,"  %s quads [quads] [output.json]\n",name);
+    fprintf(stderr,"  %s assets [images] [output.json]\n",name);
+    fprintf(stderr,"  %s palette [mapSize] [frames] [output.json]\n",name);
+    fprintf(stderr,"  %s generate [mapSize] [output.json]\n",name);
+    fprintf(stderr,"  %s entities [entities] [output.json]\n",name);
+    fprintf(stderr,"  %s depth [items] [output.json]\n",name);
+    fprintf(stderr,"  %s pathfinding [requests] [output.json]\n",name);
+    fprintf(stderr,"  %s flowfield [units] [output.json]\n",name);
+    fprintf(stderr,"  %s journal [strokes] [output.json]\n",name);
+    fprintf(stderr,"  %s bulk [operations] [output.json]\n",name);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    int mapSize = BENCH_MAP_SIZE;
+    int numFrames;
+    FILE *out;
+
+    if(argc<2 || strcmp(argv[1],"render")==0){
+        numFrames = BENCH_RENDER_FRAMES;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchRender(out,numFrames);
+    }
+    else if(strcmp(argv[1],"layout")==0){
+        numFrames = BENCH_FRAMES;
+        if(argc>2){
+            mapSize = atoi(argv[2]);
+        }
+        if(argc>3){
+            numFrames = atoi(argv[3]);
+        }
+        if(mapSize<=0 || numFrames<=0 || (out = benchOpenOutput(argc,argv,4)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchMapLayout(out,mapSize,numFrames);
+    }
+    else if(strcmp(argv[1],"visibility")==0){
+        numFrames = BENCH_VISIBILITY_CAMERAS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchVisibility(out,numFrames);
+    }
+    else if(strcmp(argv[1],"mapfile")==0){
+        mapSize = BENCH_MAPFILE_SIZE;
+        if(argc>2){
+            mapSize = atoi(argv[2]);
+        }
+        if(mapSize<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchMapFile(out,mapSize);
+    }
+    else if(strcmp(argv[1],"paging")==0){
+        mapSize = BENCH_PAGING_SIZE;
+        numFrames = BENCH_FRAMES;
+        if(argc>2){
+            mapSize = atoi(argv[2]);
+        }
+        if(argc>3){
+            numFrames = atoi(argv[3]);
+        }
+        if(mapSize<=0 || numFrames<=0 || (out = benchOpenOutput(argc,argv,4)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchPaging(out,mapSize,numFrames);
+    }
+    else if(strcmp(argv[1],"damage")==0){
+        numFrames = BENCH_RENDER_FRAMES;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchDamage(out,numFrames);
+    }
+    else if(strcmp(argv[1],"loop")==0){
+        numFrames = BENCH_LOOP_SECONDS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchLoop(out,numFrames);
+    }
+    else if(strcmp(argv[1],"bands")==0){
+        numFrames = BENCH_BANDS_FRAMES;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchBands(out,numFrames);
+    }
+    else if(strcmp(argv[1],"transform")==0){
+        numFrames = BENCH_TRANSFORM_POINTS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchTransform(out,numFrames);
+    }
+    else if(strcmp(argv[1],"picking")==0){
+        numFrames = BENCH_PICKING_POINTS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<BENCH_PICKING_CAMERAS*BENCH_PICKING_CHECKS || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchPicking(out,numFrames);
+    }
+    else if(strcmp(argv[1],"texcache")==0){
+        numFrames = BENCH_TEXCACHE_MAPS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchTexCache(out,numFrames);
+    }
+    else if(strcmp(argv[1],"quads")==0){
+        numFrames = BENCH_QUADS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchQuads(out,numFrames);
+    }
+    else if(strcmp(argv[1],"assets")==0){
+        numFrames = BENCH_ASSETS_IMAGES;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchAssets(out,numFrames);
+    }
+    else if(strcmp(argv[1],"palette")==0){
+        numFrames = BENCH_FRAMES;
+        if(argc>2){
+            mapSize = atoi(argv[2]);
+        }
+        if(argc>3){
+            numFrames = atoi(argv[3]);
+        }
+        if(mapSize<=0 || numFrames<=0 || (out = benchOpenOutput(argc,argv,4)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchPalette(out,mapSize,numFrames);
+    }
+    else if(strcmp(argv[1],"generate")==0){
+        mapSize = BENCH_GENERATE_SIZE;
+        if(argc>2){
+            mapSize = atoi(argv[2]);
+        }
+        if(mapSize<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchGenerate(out,mapSize);
+    }
+    else if(strcmp(argv[1],"entities")==0){
+        numFrames = BENCH_ENTITIES;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchEntities(out,numFrames);
+    }
+    else if(strcmp(argv[1],"depth")==0){
+        numFrames = BENCH_DEPTH_ITEMS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchDepth(out,numFrames);
+    }
+    else if(strcmp(argv[1],"pathfinding")==0){
+        numFrames = BENCH_PATH_REQUESTS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchPathfinding(out,numFrames);
+    }
+    else if(strcmp(argv[1],"flowfield")==0){
+        numFrames = BENCH_FLOW_UNITS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchFlowfield(out,numFrames);
+    }
+    else if(strcmp(argv[1],"journal")==0){
+        numFrames = BENCH_JOURNAL_STROKES;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchJournal(out,numFrames);
+    }
+    else if(strcmp(argv[1],"bulk")==0){
+        numFrames = BENCH_BULK_OPS;
+        if(argc>2){
+            numFrames = atoi(argv[2]);
+        }
+        if(numFrames<=0 || (out = benchOpenOutput(argc,argv,3)) == NULL){
+            return benchUsage(argv[0]);
+        }
+        benchBulk(out,numFrames);
+    }
+    else{
+        return benchUsage(argv[0]);
+    }
+
+    if(out!=stdout){
+        fclose(out);
+    }
+    if(benchFailed){
+        fprintf(stderr,"A correctness check failed, see the results!\n");
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <SDL2/SDL.h>
+#include "frameTimer.h"
+
+void frameTimerInit(frameTimerT *timer,int ticksPerSecond,int maxFramesPerSecond)
+{
+    timer->frequency = SDL_GetPerformanceFrequency();
+    timer->tickLength = timer->frequency / (ticksPerSecond > 0 ? ticksPerSecond : 60);
+    timer->accumulator = 0;
+    timer->lastTime = SDL_GetPerformanceCounter();
+    timer->frameStart = timer->lastTime;
+    timer->simulationEnd = timer->lastTime;
+    timer->nextFrame = timer->lastTime;
+    frameTimerSetFrameCap(timer,maxFramesPerSecond);
+    frameTimerResetStats(timer);
+}
+
+//0 or less draws as many frames as the renderer allows (only vsync holds it back)
+void frameTimerSetFrameCap(frameTimerT *timer,int maxFramesPerSecond)
+{
+    timer->frameLength = maxFramesPerSecond > 0 ? timer->frequency / maxFramesPerSecond : 0;
+}
+
+void frameTimerResetStats(frameTimerT *timer)
+{
+    timer->inputTimestamp = 0;
+    timer->numFrames = 0;
+    timer->numFramesPresented = 0;
+    timer->numTicks = 0;
+    timer->numTicksDropped = 0;
+    timer->simulationTime = 0;
+    timer->renderTime = 0;
+    timer->numLatencies = 0;
+    timer->latencySum = 0;
+    timer->latencyMax = 0;
+}
+
+//Returns how many ticks to simulate before the frame is drawn
+int frameTimerBeginFrame(frameTimerT *timer)
+{
+    int ticks;
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    timer->frameStart = now;
+    timer->accumulator += now - timer->lastTime;
+    timer->lastTime = now;
+
+    ticks = (int)SDL_min(timer->accumulator / timer->tickLength,(Uint64)FRAME_TIMER_MAX_TICKS_PER_FRAME + 1);
+    if(ticks > FRAME_TIMER_MAX_TICKS_PER_FRAME){
+        //after a long stall (a dragged window, a breakpoint) the game continues from here, it does not race to catch up
+        timer->numTicksDropped += (int)(timer->accumulator / timer->tickLength) - FRAME_TIMER_MAX_TICKS_PER_FRAME;
+        ticks = FRAME_TIMER_MAX_TICKS_PER_FRAME;
+        timer->accumulator = ticks * timer->tickLength;
+    }
+    timer->accumulator -= ticks * timer->tickLength;
+    timer->numTicks += ticks;
+    return ticks;
+}
+
+//Call after the ticks have been simulated, the rest of the frame counts as drawing
+void frameTimerEndSimulation(frameTimerT *timer)
+{
+    timer->simulationEnd = SDL_GetPerformanceCounter();
+    timer->simulationTime += timer->simulationEnd - timer->frameStart;
+}
+
+//How far the time of this frame is between the last tick and the next one, 0 to 1.
+//Draw everything that moves at previous + (current - previous) * alpha.
+float frameTimerGetAlpha(frameTimerT *timer)
+{
+    return (float)((double)timer->accumulator / timer->tickLength);
+}
+
+//An input event (its SDL timestamp) has been handled. The time until the next presented frame is its latency.
+void frameTimerInputEvent(frameTimerT *timer,Uint32 timestamp)
+{
+    if(timer->inputTimestamp == 0){
+        timer->inputTimestamp = timestamp != 0 ? timestamp : SDL_GetTicks();
+    }
+}
+
+//Call after SDL_RenderPresent, or with presented 0 when the frame was not drawn.
+//Waits until the next frame is due when the frame rate is capped.
+void frameTimerEndFrame(frameTimerT *timer,int presented)
+{
+    Uint32 latency;
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 target;
+    Uint64 delay;
+
+    timer->renderTime += now - timer->simulationEnd;
+    timer->numFrames++;
+
+    if(presented){
+        timer->numFramesPresented++;
+        if(timer->inputTimestamp != 0){
+            latency = SDL_GetTicks() - timer->inputTimestamp;
+            timer->latencySum += latency;
+            timer->latencyMax = SDL_max(timer->latencyMax,latency);
+            timer->numLatencies++;
+            timer->inputTimestamp = 0;
+        }
+    }
+
+    if(timer->frameLength == 0){
+        return;
+    }
+    //frames are due at fixed intervals, so time lost oversleeping one frame is made up in the next.
+    //A frame that is late starts a new schedule instead of being followed by a burst of frames.
+    timer->nextFrame += timer->frameLength;
+    target = timer->nextFrame;
+    if(now >= target){
+        timer->nextFrame = now;
+        return;
+    }
+    //SDL_Delay may oversleep by a millisecond or more, the last millisecond is waited out
+    delay = (target - now) * 1000 / timer->frequency;
+    if(delay > 1){
+        SDL_Delay((Uint32)(delay - 1));
+    }
+    while(SDL_GetPerformanceCounter() < target){
+        SDL_Delay(0);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef __FRAME_TIMER_H_
+#define __FRAME_TIMER_H_
+
+#include <SDL2/SDL.h>
+
+//Fixed timestep: the game is simulated in ticks of the same length, however fast or slow it is drawn.
+//Every frame runs the ticks that are due, then draws the state between the last two ticks
+//(frameTimerGetAlpha) and waits until the next frame is due when the frame rate is capped.
+#define FRAME_TIMER_MAX_TICKS_PER_FRAME 8   //a slower machine falls behind instead of simulating ever more ticks
+
+typedef struct frameTimerT
+{
+    Uint64 frequency;
+    Uint64 tickLength;          //performance counter units per tick
+    Uint64 frameLength;         //performance counter units per frame, 0 = uncapped
+    Uint64 accumulator;         //time not simulated yet
+    Uint64 lastTime;
+    Uint64 frameStart;
+    Uint64 simulationEnd;
+    Uint64 nextFrame;           //when the next frame is due, with a frame cap
+    Uint32 inputTimestamp;      //SDL_GetTicks() of the oldest input that has not been presented yet, 0 if none
+
+    //statistics since frameTimerInit or frameTimerResetStats
+    int numFrames;
+    int numFramesPresented;
+    int numTicks;
+    int numTicksDropped;
+    Uint64 simulationTime;
+    Uint64 renderTime;
+    int numLatencies;
+    Uint32 latencySum;
+    Uint32 latencyMax;
+}frameTimerT;
+
+void frameTimerInit(frameTimerT *timer,int ticksPerSecond,int maxFramesPerSecond);
+void frameTimerSetFrameCap(frameTimerT *timer,int maxFramesPerSecond);
+void frameTimerResetStats(frameTimerT *timer);
+int frameTimerBeginFrame(frameTimerT *timer);
+void frameTimerEndSimulation(frameTimerT *timer);
+float frameTimerGetAlpha(frameTimerT *timer);
+void frameTimerInputEvent(frameTimerT *timer,Uint32 timestamp);
+void frameTimerEndFrame(frameTimerT *timer,int presented);
+
+#endif // __FRAME_TIMER_H_
@@ -5,10 +5,13 @@
 #include "initclose.h"
 #include "renderer.h"
 #include "logger.h"
+#include "textureCache.h"
+#include "assetLoader.h"
 
 void initSDL(char *windowName)
 {
     char msg[200];
+    loggerInit();
     if(SDL_Init(SDL_INIT_VIDEO)< 0){
         sprintf(msg,"Could not initialize SDL! SDL Error:%s\n",SDL_GetError());
         writeToLog(msg,"error.txt");
@@ -35,7 +38,11 @@ void initSDL(char *windowName)
 
 void closeDownSDL()
 {
+    //the cached textures belong to the renderer
+    textureCacheShutdown();
+    assetLoaderShutdown();
     closeRenderer();
     IMG_Quit();
     SDL_Quit();
+    loggerShutdown();
 }
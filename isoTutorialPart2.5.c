@@ -12,14 +12,20 @@
  *      * Get a tile from the map: (x,y,layer)
  *      * Set a tile on the map: (x,y,layer)
  *      * Logging errors/warnings/info to text file
+ *      * Only repainting what has changed on the screen (damage tracking)
+ *      * Fixed timestep: the game runs at GAME_TICKS_PER_SECOND, however fast it is drawn
+ *      * Images are decoded in the background, the game starts drawing before they are loaded
+ *      * The character is an entity in the entity store (isoEntity), which can move and draw thousands of them
+ *      * The map layers above the ground and the entities are drawn back to front by depth (isoRenderQueue)
+ *      * The character walks to a tile along a path found on the map (isoPath), a few paths are searched per frame
  *
- *      NOTE: The character moving/drawing code is not re-factored in this tutorial.
- *            It will be replaced later when the entity component system (ECS)
- *            is developed later in tutorial part (4? or 5?).
+ *      NOTE: The entity store only has the components the character needs so far.
+ *            The full entity component system (ECS) is developed later in tutorial part (4? or 5?).
  *
  *   Usage:
  *   Space bar -  toggle between Overview mode / Object focus mode
  *   Move the character with w,a,s,d
+ *   Right click - the character walks to the tile under the mouse (w,a,s,d stops it)
  *   Zoom in and out with the mouse wheel
  *
  *   Overview mode:
@@ -29,6 +35,10 @@
  *   Object focus mode:
  *   Left click on the map for "tile picking" (shows the selected tile up in the top left corner of the screen)
  *
+ *   Command line:
+ *   --fps N     draw at most N frames per second (default GAME_MAX_FPS, 0 = no cap)
+ *   --uncapped  no frame cap and no vsync, to measure how fast the game can go
+ *
  ******************************************************************************************************************
  *
  *   Copyright 2017 Johan Forsblom
@@ -47,26 +57,29 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include "initclose.h"
 #include "renderer.h"
 #include "texture.h"
 #include "IsoEngine/isoEngine.h"
+#include "IsoEngine/isoEntity.h"
+#include "IsoEngine/isoPath.h"
 #include "logger.h"
-
-#define PLAYER_DIR_UP_LEFT      0
-#define PLAYER_DIR_UP           1
-#define PLAYER_DIR_UP_RIGHT     2
-#define PLAYER_DIR_RIGHT        3
-#define PLAYER_DIR_DOWN_RIGHT   4
-#define PLAYER_DIR_DOWN         5
-#define PLAYER_DIR_DOWN_LEFT    6
-#define PLAYER_DIR_LEFT         7
+#include "frameTimer.h"
+#include "textureCache.h"
 
 #define NUM_ISOMETRIC_TILES 5
-#define NUM_CHARACTER_SPRITES 8
+#define NUM_CHARACTER_SPRITES 8     //one frame for every direction
 #define MAP_HEIGHT 64
 #define MAP_WIDTH 64
 
+#define GAME_TICKS_PER_SECOND       60
+#define GAME_MAX_FPS                144
+#define GAME_ASSET_UPLOAD_MS        4       //time per frame for uploading the images decoded in the background
+#define GAME_PATH_MS                1       //time per frame for searching paths
+#define GAME_WALK_SPEED             5       //how far the character walks along a path per tick
+#define GAME_WINDOW_NAME            "Isometric Game Tutorial - Part 2.5 - By Johan Forsblom"
+
 #define GAME_MODE_OVERVIEW          0
 #define GAME_MODE_OBJECT_FOCUS      1
 #define NUM_GAME_MODES              2
@@ -76,9 +89,23 @@ typedef struct gameT
     SDL_Event event;
     int loopDone;
     isoEngineT *isoEngine;
-    point2DT charPoint;
-    int charDirection;
+    isoEntityStoreT *entities;
+    isoEntityHandleT player;
+    isoPathFinderT *pathFinder;
+    SDL_Point *path;            //the tiles the character walks along, it is at pathStep
+    int pathLength;
+    int maxPathLength;
+    int pathStep;
+    int prevScrollX;
+    int prevScrollY;
     int gameMode;
+    SDL_Rect charQuad;          //where the character was drawn in the last frame
+    int charQuadDirection;
+    int lastTileDrawn;
+    frameTimerT frameTimer;
+    Uint64 startTime;           //performance counter when the game was started
+    int firstFramePresented;
+    int loadingPercent;         //shown in the window title while images are loading, -1 when everything is loaded
 }gameT;
 
 gameT game;
@@ -111,27 +138,44 @@ void init()
         closeDownSDL();
         exit(1);
     }
-    isoMapLoadTileSet(game.isoEngine->isoMap,"data/isotiles.png",64,80);
+    isoMapLoadTileSetAsync(game.isoEngine->isoMap,"data/isotiles.png",64,80);
 
     setLoggerDirectory("logs");
     initCharClip();
-    game.charPoint.x = 0;
-    game.charPoint.y = 0;
-    game.charDirection = PLAYER_DIR_DOWN;
+    game.entities = isoEntityStoreNew();
+    if(game.entities == NULL){
+        closeDownSDL();
+        exit(1);
+    }
+    game.player = isoEntityCreate(game.entities,0,0,isoEntityAddSprite(game.entities,&characterTex,charRects,1,1));
+
+    //the character can still be moved with w,a,s,d without a path finder
+    game.pathFinder = isoPathNew(game.isoEngine->isoMap,game.isoEngine->threadPool);
+    game.path = NULL;
+    game.pathLength = 0;
+    game.maxPathLength = 0;
+    game.pathStep = 0;
+    game.prevScrollX = game.isoEngine->scrollX;
+    game.prevScrollY = game.isoEngine->scrollY;
     game.gameMode = GAME_MODE_OVERVIEW;
+    setupRect(&game.charQuad,0,0,0,0);
+    game.charQuadDirection = -1;
+    game.lastTileDrawn = -1;
+
+    game.firstFramePresented = 0;
+    game.loadingPercent = 0;
 
-    if(loadTexture(&characterTex,"data/character.png")==0){
+    if(loadTextureAsync(&characterTex,"data/character.png")==0){
         writeToLog("Error, could not load texture: data/character.png","error.txt");
         exit(1);
     }
 }
-void drawCharacter(isoEngineT *isoEngine)
+//Where the character is now, the point the camera centers on in object focus mode
+void getCharacterPoint(point2DT *point)
 {
-    point2DT point;
-    point.x = (int)(game.charPoint.x*isoEngine->zoomLevel)+ isoEngine->scrollX;
-    point.y = (int)(game.charPoint.y*isoEngine->zoomLevel)+ isoEngine->scrollY;
-    isoEngineConvert2dToIso(&point);
-    textureRenderXYClipScale(&characterTex,point.x,point.y,&charRects[game.charDirection],isoEngine->zoomLevel);
+    point->x = 0;
+    point->y = 0;
+    isoEntityGetPosition(game.entities,game.player,&point->x,&point->y);
 }
 
 void drawLastTileClicked(isoEngineT *isoEngine)
@@ -141,27 +185,275 @@ void drawLastTileClicked(isoEngineT *isoEngine)
     }
 }
 
-void draw()
+//Tell the engine about the things on the screen that it does not draw itself
+void addDamage(isoEngineT *isoEngine,float alpha)
+{
+    SDL_Rect quad;
+    int player = isoEntityGetIndex(game.entities,game.player);
+    int direction = player >= 0 ? game.entities->direction[player] : -1;
+
+    isoEntityGetQuad(game.entities,game.player,isoEngine,alpha,&quad);
+    if(SDL_RectEquals(&quad,&game.charQuad)==SDL_FALSE || direction != game.charQuadDirection){
+        isoDamageAddRect(isoEngine->damage,&game.charQuad);
+        isoDamageAddRect(isoEngine->damage,&quad);
+        game.charQuad = quad;
+        game.charQuadDirection = direction;
+    }
+    if(isoEngine->lastTileClicked != game.lastTileDrawn){
+        if(game.lastTileDrawn != -1){
+            setupRect(&quad,0,0,isoEngine->isoMap->tileSet->tileClipRects[game.lastTileDrawn].w,isoEngine->isoMap->tileSet->tileClipRects[game.lastTileDrawn].h);
+            isoDamageAddRect(isoEngine->damage,&quad);
+        }
+        if(isoEngine->lastTileClicked != -1){
+            setupRect(&quad,0,0,isoEngine->isoMap->tileSet->tileClipRects[isoEngine->lastTileClicked].w,isoEngine->isoMap->tileSet->tileClipRects[isoEngine->lastTileClicked].h);
+            isoDamageAddRect(isoEngine->damage,&quad);
+        }
+        game.lastTileDrawn = isoEngine->lastTileClicked;
+    }
+}
+
+//Uploads the images that have been decoded in the background and shows the progress in the window title
+void updateAssets()
+{
+    char title[128];
+    int percent;
+
+    if(game.loadingPercent < 0){
+        return;
+    }
+    //the placeholders have to be painted over
+    if(textureCacheUpdate(GAME_ASSET_UPLOAD_MS) > 0){
+        isoDamageAddFull(game.isoEngine->damage);
+    }
+    percent = (int)(textureCacheGetProgress()*100);
+    if(percent >= 100){
+        game.loadingPercent = -1;
+        SDL_SetWindowTitle(getWindow(),GAME_WINDOW_NAME);
+        logInfo("timing.txt","All images loaded after %.1f ms",
+                (SDL_GetPerformanceCounter()-game.startTime)*1000.0/SDL_GetPerformanceFrequency());
+    }
+    else if(percent != game.loadingPercent){
+        game.loadingPercent = percent;
+        snprintf(title,sizeof(title),"%s - loading %d%%",GAME_WINDOW_NAME,percent);
+        SDL_SetWindowTitle(getWindow(),title);
+    }
+}
+
+//Jumps of the camera (zooming, centering on a click) are not animated
+void snapInterpolation()
+{
+    game.prevScrollX = game.isoEngine->scrollX;
+    game.prevScrollY = game.isoEngine->scrollY;
+    isoEntitySnap(game.entities);
+}
+
+//Draws the game between the last two ticks. Returns 1 if a frame was presented.
+int draw(float alpha)
 {
+    int scrollX = game.isoEngine->scrollX;
+    int scrollY = game.isoEngine->scrollY;
+    int presented = 0;
+
+    game.isoEngine->scrollX = game.prevScrollX + (int)floorf((scrollX-game.prevScrollX)*alpha+0.5f);
+    game.isoEngine->scrollY = game.prevScrollY + (int)floorf((scrollY-game.prevScrollY)*alpha+0.5f);
+
+    addDamage(game.isoEngine,alpha);
+
+    //nothing has changed, the last frame is still on the screen
+    if(isoDamageBeginFrame(game.isoEngine->damage,game.isoEngine)==0){
+        game.isoEngine->scrollX = scrollX;
+        game.isoEngine->scrollY = scrollY;
+        return 0;
+    }
+    //SDL_RenderClear would ignore the clip rectangle of the damaged area
     SDL_SetRenderDrawColor(getRenderer(),0x3b,0x3b,0x3b,0x00);
-    SDL_RenderClear(getRenderer());
+    SDL_RenderFillRect(getRenderer(),NULL);
 
+    //the ground, then the layers above it and the entities back to front
     isoEngineDrawIsoMap(game.isoEngine);
-    drawCharacter(game.isoEngine);
+    if(game.isoEngine->renderQueue != NULL){
+        isoRenderQueueBegin(game.isoEngine->renderQueue);
+        isoEngineQueueIsoMap(game.isoEngine,game.isoEngine->renderQueue,1,ISO_RENDER_QUEUE_MAX_LAYER);
+        isoEntityQueue(game.entities,game.isoEngine,alpha,game.isoEngine->renderQueue,1);
+        isoRenderQueueDraw(game.isoEngine->renderQueue);
+    }
+    else{
+        isoEntityDraw(game.entities,game.isoEngine,alpha);
+    }
     isoEngineDrawIsoMouse(game.isoEngine);
     drawLastTileClicked(game.isoEngine);
 
+    isoDamageEndFrame(game.isoEngine->damage,game.isoEngine);
     SDL_RenderPresent(getRenderer());
-    //Don't be a CPU HOG!! :D
-    SDL_Delay(10);
+    presented = 1;
+
+    game.isoEngine->scrollX = scrollX;
+    game.isoEngine->scrollY = scrollY;
+    return presented;
+}
+
+//isoPathUpdate found the path to the tile that was right clicked
+void pathFound(void *data,int found,const SDL_Point *tiles,int numTiles)
+{
+    SDL_Point *path;
+
+    game.pathLength = 0;
+    game.pathStep = 0;
+    if(!found){
+        return;
+    }
+    if(numTiles > game.maxPathLength){
+        path = realloc(game.path,numTiles*sizeof(SDL_Point));
+        if(path == NULL){
+            writeToLog("Error in function: pathFound(...) - Could not allocate memory for the path!","error.txt");
+            return;
+        }
+        game.path = path;
+        game.maxPathLength = numTiles;
+    }
+    memcpy(game.path,tiles,numTiles*sizeof(SDL_Point));
+    game.pathLength = numTiles;
+}
+
+//Asks for a path from the tile the character stands on to the tile under the mouse
+void walkToTileUnderMouse()
+{
+    int tileX,tileY;
+    float x,y;
+    int tileSize = game.isoEngine->isoMap->tileSize;
+
+    if(game.pathFinder == NULL ||
+       !isoEnginePickTile(game.isoEngine,game.isoEngine->mouseScreenPos.x,game.isoEngine->mouseScreenPos.y,&tileX,&tileY) ||
+       !isoEntityGetPosition(game.entities,game.player,&x,&y)){
+        return;
+    }
+    isoPathCancelRequests(game.pathFinder,&game);
+    isoPathRequest(game.pathFinder,(int)floor(x/tileSize),(int)floor(y/tileSize),tileX,tileY,pathFound,&game);
+}
+
+//The velocity that takes the character towards the next tile of its path, 0 when it is at the end
+void followPath(float *velocityX,float *velocityY)
+{
+    float x,y;
+    float dx,dy;
+    float distance;
+    int tileSize = game.isoEngine->isoMap->tileSize;
+
+    *velocityX = 0;
+    *velocityY = 0;
+    if(!isoEntityGetPosition(game.entities,game.player,&x,&y)){
+        return;
+    }
+    while(game.pathStep < game.pathLength){
+        dx = game.path[game.pathStep].x*tileSize - x;
+        dy = game.path[game.pathStep].y*tileSize - y;
+        distance = sqrtf(dx*dx + dy*dy);
+        if(distance > GAME_WALK_SPEED){
+            *velocityX = dx*GAME_WALK_SPEED/distance;
+            *velocityY = dy*GAME_WALK_SPEED/distance;
+            return;
+        }
+        //close enough to the tile, on to the next one with what is left of the step
+        if(distance > 0 && game.pathStep+1 == game.pathLength){
+            *velocityX = dx;
+            *velocityY = dy;
+        }
+        game.pathStep++;
+    }
 }
 
+//The keys held down set the velocity of the character, isoEntityUpdate moves it and turns it the way it moves.
+//Without keys held down the character follows its path.
+void updateInput()
+{
+    const Uint8 *keystate = SDL_GetKeyboardState(NULL);
+    float velocityX = 0;
+    float velocityY = 0;
+
+    if(keystate[SDL_SCANCODE_W] || keystate[SDL_SCANCODE_A] || keystate[SDL_SCANCODE_S] || keystate[SDL_SCANCODE_D]){
+        isoPathCancelRequests(game.pathFinder,&game);
+        game.pathLength = 0;
+    }
+    else if(game.pathStep < game.pathLength){
+        followPath(&velocityX,&velocityY);
+    }
+
+    if(keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
+    {
+        velocityX = 5;
+        velocityY = 5;
+    }
+    else if(!keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && keystate[SDL_SCANCODE_W])
+    {
+        velocityX = -5;
+        velocityY = -5;
+    }
+    else if(!keystate[SDL_SCANCODE_S] && keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && keystate[SDL_SCANCODE_W])
+    {
+        velocityY = -5;
+    }
+    else if(!keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && keystate[SDL_SCANCODE_A] && keystate[SDL_SCANCODE_W])
+    {
+        velocityX = -5;
+    }
+    else if(!keystate[SDL_SCANCODE_S] && keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
+    {
+        velocityX = 3;
+        velocityY = -3;
+    }
+    else if(!keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
+    {
+        velocityX = -3;
+        velocityY = 3;
+    }
+    else if(keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
+    {
+        velocityY = 5;
+    }
+    else if(keystate[SDL_SCANCODE_S] && keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
+    {
+        velocityX = 5;
+    }
+    isoEntitySetVelocity(game.entities,game.player,velocityX,velocityY);
+/*
+    if(keystate[SDL_SCANCODE_W]){
+
+        game.mapScroll2Dpos.y+=game.mapScrolllSpeed;
+        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
+    }
+    if(keystate[SDL_SCANCODE_A]){
+
+        game.mapScroll2Dpos.x-=game.mapScrolllSpeed;
+        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
+    }
+    if(keystate[SDL_SCANCODE_S]){
+
+        game.mapScroll2Dpos.y-=game.mapScrolllSpeed;
+        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
+
+    }
+    if(keystate[SDL_SCANCODE_D]){
+
+        game.mapScroll2Dpos.x+=game.mapScrolllSpeed;
+        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
+    }
+*/
+}
+
+//One tick of the game. Everything that moves, moves the same distance per tick at any frame rate.
 void update(isoEngineT *isoEngine)
 {
-    isoEngineUpdateMousePos(isoEngine);
+    point2DT charPoint;
+
+    game.prevScrollX = isoEngine->scrollX;
+    game.prevScrollY = isoEngine->scrollY;
+
+    updateInput();
+    isoEntityUpdate(game.entities);
     if(game.gameMode == GAME_MODE_OBJECT_FOCUS)
     {
-        isoEngineCenterMap(game.isoEngine,&game.charPoint);
+        getCharacterPoint(&charPoint);
+        isoEngineCenterMap(game.isoEngine,&charPoint);
     }
     else if(game.gameMode == GAME_MODE_OVERVIEW){
         isoEngineScrollMapWithMouse(game.isoEngine);
@@ -169,18 +461,48 @@ void update(isoEngineT *isoEngine)
 
 }
 
-void updateInput()
+//Handles the events once per frame, so clicks and key presses are never waiting for a tick
+void handleEvents()
 {
-    const Uint8 *keystate = SDL_GetKeyboardState(NULL);
+    point2DT charPoint;
+
+    isoEngineUpdateMousePos(game.isoEngine);
 
     while(SDL_PollEvent(&game.event) != 0)
     {
+        switch(game.event.type)
+        {
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEWHEEL:
+            case SDL_MOUSEMOTION:
+                frameTimerInputEvent(&game.frameTimer,game.event.common.timestamp);
+            break;
+
+            default:break;
+        }
+
         switch(game.event.type)
         {
             case SDL_QUIT:
                 game.loopDone=1;
             break;
 
+            //the contents of all render target textures are gone
+            case SDL_RENDER_TARGETS_RESET:
+            case SDL_RENDER_DEVICE_RESET:
+                isoRenderCacheClear(game.isoEngine->renderCache);
+                isoDamageAddFull(game.isoEngine->damage);
+            break;
+
+            //the window has to be painted again, even if nothing in the game has changed
+            case SDL_WINDOWEVENT:
+                if(game.event.window.event == SDL_WINDOWEVENT_EXPOSED || game.event.window.event == SDL_WINDOWEVENT_RESTORED){
+                    isoDamageAddFull(game.isoEngine->damage);
+                }
+            break;
+
             case SDL_KEYUP:
                 switch(game.event.key.keysym.sym){
                     case SDLK_ESCAPE:
@@ -204,12 +526,15 @@ void updateInput()
                 {
                     if(game.gameMode==GAME_MODE_OVERVIEW){
                         isoEngineCenterMapToTileUnderMouse(game.isoEngine);
-
+                        snapInterpolation();
                     }
                     if(game.gameMode == GAME_MODE_OBJECT_FOCUS){
                         isoEngineGetMouseTileClick(game.isoEngine);
                     }
                 }
+                else if(game.event.button.button == SDL_BUTTON_RIGHT){
+                    walkToTileUnderMouse();
+                }
             break;
 
             case SDL_MOUSEWHEEL:
@@ -223,8 +548,10 @@ void updateInput()
                             isoEngineCenterMap(game.isoEngine,&game.isoEngine->tilePos);
                         }
                         if(game.gameMode == GAME_MODE_OBJECT_FOCUS){
-                            isoEngineCenterMap(game.isoEngine,&game.charPoint);
+                            getCharacterPoint(&charPoint);
+                            isoEngineCenterMap(game.isoEngine,&charPoint);
                         }
+                        snapInterpolation();
                     }
                 }
                 //If the user scrolled the mouse wheel down
@@ -236,8 +563,10 @@ void updateInput()
                             isoEngineCenterMap(game.isoEngine,&game.isoEngine->tilePos);
                         }
                         if(game.gameMode == GAME_MODE_OBJECT_FOCUS){
-                            isoEngineCenterMap(game.isoEngine,&game.charPoint);
+                            getCharacterPoint(&charPoint);
+                            isoEngineCenterMap(game.isoEngine,&charPoint);
                         }
+                        snapInterpolation();
                     }
                 }
             break;
@@ -245,91 +574,71 @@ void updateInput()
             default:break;
         }
     }
-
-    if(keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.x+=5;
-        game.charPoint.y+=5;
-        game.charDirection = PLAYER_DIR_DOWN;
-    }
-    else if(!keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.x-=5;
-        game.charPoint.y-=5;
-        game.charDirection = PLAYER_DIR_UP;
-    }
-    else if(!keystate[SDL_SCANCODE_S] && keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.y-=5;
-        game.charDirection = PLAYER_DIR_UP_RIGHT;
-    }
-    else if(!keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && keystate[SDL_SCANCODE_A] && keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.x-=5;
-        game.charDirection = PLAYER_DIR_UP_LEFT;
-    }
-    else if(!keystate[SDL_SCANCODE_S] && keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.x+=3;
-        game.charPoint.y-=3;
-        game.charDirection = PLAYER_DIR_RIGHT;
-    }
-    else if(!keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.x-=3;
-        game.charPoint.y+=3;
-        game.charDirection = PLAYER_DIR_LEFT;
-    }
-    else if(keystate[SDL_SCANCODE_S] && !keystate[SDL_SCANCODE_D] && keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.y+=5;
-        game.charDirection = PLAYER_DIR_DOWN_LEFT;
-    }
-    else if(keystate[SDL_SCANCODE_S] && keystate[SDL_SCANCODE_D] && !keystate[SDL_SCANCODE_A] && !keystate[SDL_SCANCODE_W])
-    {
-        game.charPoint.x+=5;
-        game.charDirection = PLAYER_DIR_DOWN_RIGHT;
-    }
-/*
-    if(keystate[SDL_SCANCODE_W]){
-
-        game.mapScroll2Dpos.y+=game.mapScrolllSpeed;
-        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
-    }
-    if(keystate[SDL_SCANCODE_A]){
-
-        game.mapScroll2Dpos.x-=game.mapScrolllSpeed;
-        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
-    }
-    if(keystate[SDL_SCANCODE_S]){
-
-        game.mapScroll2Dpos.y-=game.mapScrolllSpeed;
-        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
-
-    }
-    if(keystate[SDL_SCANCODE_D]){
-
-        game.mapScroll2Dpos.x+=game.mapScrolllSpeed;
-        isoEngineConvertCartesianCameraToIsometric(game.isoEngine,&game.mapScroll2Dpos);
-    }
-*/
 }
 
 int main(int argc, char *argv[])
 {
-    initSDL("Isometric Game Tutorial - Part 2.5 - By Johan Forsblom");
+    int i;
+    int ticks;
+    int presented;
+    int maxFramesPerSecond = GAME_MAX_FPS;
+
+    game.startTime = SDL_GetPerformanceCounter();
+    for(i=1;i<argc;++i){
+        if(strcmp(argv[i],"--fps")==0 && i+1<argc){
+            maxFramesPerSecond = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i],"--uncapped")==0){
+            maxFramesPerSecond = 0;
+            SDL_SetHint(SDL_HINT_RENDER_VSYNC,"0");
+        }
+    }
+
+    initSDL(GAME_WINDOW_NAME);
     init();
 
     SDL_ShowCursor(0);
     SDL_SetWindowGrab(getWindow(),SDL_TRUE);
     SDL_WarpMouseInWindow(getWindow(),WINDOW_WIDTH/2,WINDOW_HEIGHT/2);
 
+    frameTimerInit(&game.frameTimer,GAME_TICKS_PER_SECOND,maxFramesPerSecond);
     while(!game.loopDone){
-        update(game.isoEngine);
-        updateInput();
-        draw();
+        handleEvents();
+
+        ticks = frameTimerBeginFrame(&game.frameTimer);
+        for(i=0;i<ticks;++i){
+            update(game.isoEngine);
+        }
+        frameTimerEndSimulation(&game.frameTimer);
+
+        isoPathUpdate(game.pathFinder,GAME_PATH_MS);
+        updateAssets();
+        presented = draw(frameTimerGetAlpha(&game.frameTimer));
+        frameTimerEndFrame(&game.frameTimer,presented);
+
+        if(presented && !game.firstFramePresented){
+            game.firstFramePresented = 1;
+            logInfo("timing.txt","First frame presented after %.1f ms",
+                    (SDL_GetPerformanceCounter()-game.startTime)*1000.0/SDL_GetPerformanceFrequency());
+        }
+    }
+
+    if(game.frameTimer.numFrames > 0){
+        logInfo("timing.txt","%d frames (%d presented), %d ticks (%d dropped), simulation %.3f ms/frame, drawing %.3f ms/frame, "
+                "input to present latency avg %.1f ms max %u ms",
+                game.frameTimer.numFrames,game.frameTimer.numFramesPresented,game.frameTimer.numTicks,game.frameTimer.numTicksDropped,
+                game.frameTimer.simulationTime*1000.0/game.frameTimer.frequency/game.frameTimer.numFrames,
+                game.frameTimer.renderTime*1000.0/game.frameTimer.frequency/game.frameTimer.numFrames,
+                game.frameTimer.numLatencies > 0 ? (double)game.frameTimer.latencySum/game.frameTimer.numLatencies : 0.0,
+                game.frameTimer.latencyMax);
     }
+    isoPathFree(game.pathFinder);
+    free(game.path);
+    isoEntityStoreFree(game.entities);
 
+    //join the engine's worker threads and give the textures back before the renderer and the texture cache go
+    textureDelete(&characterTex);
+    isoEngineFreeIsoEngine(game.isoEngine);
     closeDownSDL();
     return 0;
 }
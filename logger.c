@@ -1,49 +1,436 @@
+#include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
 #include "logger.h"
 
+#define LOGGER_SLOT_MESSAGE         0
+#define LOGGER_SLOT_ALWAYS          1   //written even when it equals the line before, e.g. separators
+#define LOGGER_SLOT_SET_DIRECTORY   2
+#define LOGGER_IDLE_WAIT_MS         50
+
+//One queued message. sequence tells who owns the slot: it equals the claim position when a producer may
+//fill it, claim position + 1 when the writer may read it and claim position + LOGGER_RING_SIZE once it is free again.
+typedef struct loggerSlotT
+{
+    SDL_atomic_t sequence;
+    int type;
+    char filename[LOGGER_MAX_FILENAME];
+    char message[LOGGER_MAX_MESSAGE];
+}loggerSlotT;
+
+//A log file the writer keeps open, together with what it needs to collapse repeated messages
+typedef struct loggerFileT
+{
+    char filename[LOGGER_MAX_FILENAME];
+    FILE *out;
+    int dirty;
+    int repeatCount;
+    Uint32 repeatTicks;
+    char lastMessage[LOGGER_MAX_MESSAGE];
+}loggerFileT;
+
+static const char *levelNames[] = {"DEBUG","INFO","WARNING","ERROR"};
+static const char *separator = "-------------------------------------------------------------------------------------------------------------------------";
+
 static char dir[255];
 static int loggerDirSet = 0;
 
+static loggerSlotT ring[LOGGER_RING_SIZE];
+static SDL_atomic_t ringHead;
+static SDL_atomic_t ringWritten;
+static unsigned int ringTail = 0;   //only touched by the writer
+static SDL_atomic_t dropped;
+static int droppedReported = 0;
+static Uint32 droppedTicks = 0;
+static SDL_atomic_t truncated;
+static int truncatedReported = 0;
+static SDL_atomic_t minLevel = {LOG_COMPILE_LEVEL};
+static SDL_atomic_t running;
+static SDL_atomic_t pushing;        //producers inside loggerPush, loggerShutdown waits for them
+static SDL_SpinLock directLock = 0; //keeps direct writes and the last drain of loggerShutdown apart
+static SDL_atomic_t quit;
+static SDL_Thread *thread = NULL;
+static SDL_sem *wake = NULL;
+static int atexitRegistered = 0;
 
-void setLoggerDirectory(char *directory)
-{
-    sprintf(dir,"%s",directory);
-    loggerDirSet = 1;
-}
+static loggerFileT files[LOGGER_MAX_OPEN_FILES];
+static int numFiles = 0;
 
-void writeToLog(char *message,char *filename)
+static void loggerGetPath(char *path,size_t size,char *filename)
 {
-    FILE *out;
-    char dirAndFilename[255];
     if(loggerDirSet){
-        sprintf(dirAndFilename,"%s/%s",dir,filename);
-        out = fopen(dirAndFilename,"a+");
+        snprintf(path,size,"%s/%s",dir,filename);
     }
     else{
-        out = fopen(filename,"a+");
+        snprintf(path,size,"%s",filename);
     }
+}
+
+//The old way, used before loggerInit, after loggerShutdown and when the writer has no file handle left
+static void loggerWriteDirect(char *filename,const char *message)
+{
+    FILE *out;
+    char dirAndFilename[512];
+
+    loggerGetPath(dirAndFilename,sizeof(dirAndFilename),filename);
+    out = fopen(dirAndFilename,"a+");
 
     if(out!=NULL){
         fprintf(out,"%s\n",message);
         fclose(out);
     }
 }
-void writeSeparatorToLog(char *filename)
+
+static void loggerFlushRepeats(loggerFileT *file)
+{
+    if(file->repeatCount > 0){
+        fprintf(file->out,"(last message repeated %d more times)\n",file->repeatCount);
+        file->repeatCount = 0;
+        file->dirty = 1;
+    }
+}
+
+static void loggerCloseFiles()
 {
+    int i;
+    for(i=0;i<numFiles;++i){
+        loggerFlushRepeats(&files[i]);
+        fclose(files[i].out);
+    }
+    numFiles = 0;
+}
+
+static loggerFileT *loggerGetFile(char *filename)
+{
+    int i;
     FILE *out;
-    char dirAndFilename[255];
-    if(loggerDirSet){
-        sprintf(dirAndFilename,"%s/%s",dir,filename);
-        out = fopen(dirAndFilename,"a+");
+    char dirAndFilename[512];
+
+    for(i=0;i<numFiles;++i){
+        if(strcmp(files[i].filename,filename)==0){
+            return &files[i];
+        }
+    }
+    if(numFiles == LOGGER_MAX_OPEN_FILES){
+        return NULL;
+    }
+    loggerGetPath(dirAndFilename,sizeof(dirAndFilename),filename);
+    out = fopen(dirAndFilename,"a+");
+    if(out == NULL){
+        return NULL;
+    }
+    snprintf(files[numFiles].filename,LOGGER_MAX_FILENAME,"%s",filename);
+    files[numFiles].out = out;
+    files[numFiles].dirty = 0;
+    files[numFiles].repeatCount = 0;
+    files[numFiles].lastMessage[0] = 0;
+    return &files[numFiles++];
+}
+
+static void loggerOutput(int type,char *filename,char *message)
+{
+    loggerFileT *file = loggerGetFile(filename);
+
+    if(file == NULL){
+        loggerWriteDirect(filename,message);
+        return;
+    }
+    //a message that keeps coming back is counted instead of written, see loggerCheckRepeats
+    if(type == LOGGER_SLOT_MESSAGE && strcmp(file->lastMessage,message)==0){
+        if(file->repeatCount == 0){
+            file->repeatTicks = SDL_GetTicks();
+        }
+        file->repeatCount++;
+        return;
+    }
+    loggerFlushRepeats(file);
+    fprintf(file->out,"%s\n",message);
+    file->dirty = 1;
+
+    if(type == LOGGER_SLOT_MESSAGE){
+        snprintf(file->lastMessage,LOGGER_MAX_MESSAGE,"%s",message);
     }
     else{
-        out = fopen(filename,"a+");
+        file->lastMessage[0] = 0;
     }
+}
 
-    if(out!=NULL){
-        fprintf(out,"%s\n","-------------------------------------------------------------------------------------------------------------------------");
-        fclose(out);
+//Reports repeated and dropped messages, at most once per LOGGER_REPEAT_INTERVAL_MS unless forced
+static void loggerCheckRepeats(int force)
+{
+    int i;
+    int numDropped;
+    int numTruncated;
+    char msg[LOGGER_MAX_MESSAGE];
+    Uint32 now = SDL_GetTicks();
+
+    numDropped = SDL_AtomicGet(&dropped);
+    numTruncated = SDL_AtomicGet(&truncated);
+    if((numDropped != droppedReported || numTruncated != truncatedReported) && (force || now - droppedTicks >= LOGGER_REPEAT_INTERVAL_MS)){
+        if(numDropped != droppedReported){
+            sprintf(msg,"Warning: the logger queue was full, %d messages were dropped!",numDropped-droppedReported);
+            loggerOutput(LOGGER_SLOT_ALWAYS,"error.txt",msg);
+        }
+        if(numTruncated != truncatedReported){
+            sprintf(msg,"Warning: %d messages were longer than %d characters and were cut off!",numTruncated-truncatedReported,LOGGER_MAX_MESSAGE-1);
+            loggerOutput(LOGGER_SLOT_ALWAYS,"error.txt",msg);
+        }
+        droppedReported = numDropped;
+        truncatedReported = numTruncated;
+        droppedTicks = now;
+    }
+    for(i=0;i<numFiles;++i){
+        if(files[i].repeatCount > 0 && (force || now - files[i].repeatTicks >= LOGGER_REPEAT_INTERVAL_MS)){
+            loggerFlushRepeats(&files[i]);
+            fflush(files[i].out);
+            files[i].dirty = 0;
+        }
+    }
+}
+
+//Writes out everything that is ready in the ring. Only one thread at a time may call this.
+static int loggerDrain()
+{
+    int i;
+    int count = 0;
+    loggerSlotT *slot;
+
+    for(;;){
+        slot = &ring[ringTail & (LOGGER_RING_SIZE-1)];
+        if((int)((unsigned int)SDL_AtomicGet(&slot->sequence) - (ringTail+1)) < 0){
+            break;
+        }
+        if(slot->type == LOGGER_SLOT_SET_DIRECTORY){
+            loggerCloseFiles();
+            snprintf(dir,sizeof(dir),"%s",slot->message);
+            loggerDirSet = 1;
+        }
+        else{
+            loggerOutput(slot->type,slot->filename,slot->message);
+        }
+        SDL_AtomicSet(&slot->sequence,(int)(ringTail+LOGGER_RING_SIZE));
+        ringTail++;
+        count++;
+    }
+
+    for(i=0;i<numFiles;++i){
+        if(files[i].dirty){
+            fflush(files[i].out);
+            files[i].dirty = 0;
+        }
+    }
+    //counted after the flush, so loggerFlush returns once the messages are really on disk
+    SDL_AtomicAdd(&ringWritten,count);
+    return count;
+}
+
+static int loggerThread(void *data)
+{
+    while(!SDL_AtomicGet(&quit)){
+        if(loggerDrain()==0){
+            SDL_SemWaitTimeout(wake,LOGGER_IDLE_WAIT_MS);
+        }
+        loggerCheckRepeats(0);
+    }
+    loggerDrain();
+    return 0;
+}
+
+//Queues a message without ever blocking: if the writer is a full ring behind, the message is dropped and counted.
+static void loggerPush(int type,char *filename,const char *message)
+{
+    loggerSlotT *slot;
+    unsigned int pos;
+    int diff;
+
+    //counted before running is read, so loggerShutdown knows when no producer can still claim a slot
+    SDL_AtomicAdd(&pushing,1);
+    if(!SDL_AtomicGet(&running)){
+        SDL_AtomicAdd(&pushing,-1);
+        SDL_AtomicLock(&directLock);
+        if(type == LOGGER_SLOT_SET_DIRECTORY){
+            snprintf(dir,sizeof(dir),"%s",message);
+            loggerDirSet = 1;
+        }
+        else{
+            loggerWriteDirect(filename,message);
+        }
+        SDL_AtomicUnlock(&directLock);
+        return;
+    }
+
+    pos = (unsigned int)SDL_AtomicGet(&ringHead);
+    for(;;){
+        slot = &ring[pos & (LOGGER_RING_SIZE-1)];
+        diff = (int)((unsigned int)SDL_AtomicGet(&slot->sequence) - pos);
+        if(diff == 0){
+            if(SDL_AtomicCAS(&ringHead,(int)pos,(int)(pos+1))){
+                break;
+            }
+        }
+        else if(diff < 0){
+            SDL_AtomicAdd(&dropped,1);
+            SDL_AtomicAdd(&pushing,-1);
+            return;
+        }
+        pos = (unsigned int)SDL_AtomicGet(&ringHead);
+    }
+
+    slot->type = type;
+    snprintf(slot->filename,LOGGER_MAX_FILENAME,"%s",filename);
+    if(snprintf(slot->message,LOGGER_MAX_MESSAGE,"%s",message) >= LOGGER_MAX_MESSAGE){
+        SDL_AtomicAdd(&truncated,1);
+    }
+    SDL_AtomicSet(&slot->sequence,(int)(pos+1));
+
+    //the writer naps while idle, a burst wakes it well before the ring is full
+    if((pos & (LOGGER_RING_SIZE/4-1)) == LOGGER_RING_SIZE/4-1){
+        SDL_SemPost(wake);
+    }
+    SDL_AtomicAdd(&pushing,-1);
+}
+
+int loggerInit()
+{
+    int i;
+
+    if(SDL_AtomicGet(&running)){
+        return 1;
+    }
+    for(i=0;i<LOGGER_RING_SIZE;++i){
+        SDL_AtomicSet(&ring[i].sequence,i);
+    }
+    SDL_AtomicSet(&ringHead,0);
+    SDL_AtomicSet(&ringWritten,0);
+    SDL_AtomicSet(&quit,0);
+    ringTail = 0;
+
+    //created once and never destroyed, a producer may still post it while the logger shuts down
+    if(wake == NULL){
+        wake = SDL_CreateSemaphore(0);
+    }
+    if(wake == NULL){
+        loggerWriteDirect("error.txt","Error in function: loggerInit() - Could not create semaphore, logging stays synchronous!");
+        return 0;
+    }
+    thread = SDL_CreateThread(loggerThread,"logger",NULL);
+    if(thread == NULL){
+        loggerWriteDirect("error.txt","Error in function: loggerInit() - Could not create writer thread, logging stays synchronous!");
+        return 0;
+    }
+    SDL_AtomicSet(&running,1);
+
+    //exit() is used on fatal errors all over, the queue must still reach the disk then
+    if(!atexitRegistered){
+        atexit(loggerShutdown);
+        atexitRegistered = 1;
+    }
+    return 1;
+}
+
+void loggerShutdown()
+{
+    if(!SDL_AtomicGet(&running)){
+        return;
+    }
+    //new messages are written directly from now on, the ones already on their way into the ring are waited for
+    SDL_AtomicSet(&running,0);
+    while(SDL_AtomicGet(&pushing) > 0){
+        SDL_Delay(0);
+    }
+    SDL_AtomicSet(&quit,1);
+    SDL_SemPost(wake);
+    SDL_WaitThread(thread,NULL);
+    thread = NULL;
+
+    //every claimed slot is published now, pick up what the writer did not get to before it stopped.
+    //Direct writes wait until the files are closed.
+    SDL_AtomicLock(&directLock);
+    loggerDrain();
+    loggerCheckRepeats(1);
+    loggerCloseFiles();
+    SDL_AtomicUnlock(&directLock);
+}
+
+void loggerFlush()
+{
+    int target;
+
+    if(!SDL_AtomicGet(&running)){
+        return;
+    }
+    target = SDL_AtomicGet(&ringHead);
+    while((int)((unsigned int)target - (unsigned int)SDL_AtomicGet(&ringWritten)) > 0 && SDL_AtomicGet(&running)){
+        SDL_SemPost(wake);
+        SDL_Delay(1);
+    }
+}
+
+void loggerSetLevel(int level)
+{
+    SDL_AtomicSet(&minLevel,level);
+}
+
+int loggerGetLevel()
+{
+    return SDL_AtomicGet(&minLevel);
+}
+
+int loggerGetDroppedCount()
+{
+    return SDL_AtomicGet(&dropped);
+}
+
+int loggerGetTruncatedCount()
+{
+    return SDL_AtomicGet(&truncated);
+}
+
+void loggerWrite(int level,char *filename,const char *format,...)
+{
+    va_list args;
+    char message[LOGGER_MAX_MESSAGE];
+    int len;
+
+    if(level < SDL_AtomicGet(&minLevel) || level < LOG_LEVEL_DEBUG || level >= LOG_LEVEL_NONE){
+        return;
+    }
+    if(filename == NULL || format == NULL){
+        return;
     }
+    len = snprintf(message,LOGGER_MAX_MESSAGE,"[%s] ",levelNames[level]);
+    va_start(args,format);
+    if(vsnprintf(message+len,LOGGER_MAX_MESSAGE-len,format,args) >= LOGGER_MAX_MESSAGE-len){
+        SDL_AtomicAdd(&truncated,1);
+    }
+    va_end(args);
+
+    loggerPush(LOGGER_SLOT_MESSAGE,filename,message);
 }
 
+void setLoggerDirectory(char *directory)
+{
+    if(directory == NULL){
+        return;
+    }
+    //queued like a message, so everything logged before the call still goes to the old directory
+    loggerPush(LOGGER_SLOT_SET_DIRECTORY,"",directory);
+}
 
+void writeToLog(char *message,char *filename)
+{
+    if(message == NULL || filename == NULL || LOG_LEVEL_ERROR < SDL_AtomicGet(&minLevel)){
+        return;
+    }
+    loggerPush(LOGGER_SLOT_MESSAGE,filename,message);
+}
+
+void writeSeparatorToLog(char *filename)
+{
+    if(filename == NULL || LOG_LEVEL_ERROR < SDL_AtomicGet(&minLevel)){
+        return;
+    }
+    loggerPush(LOGGER_SLOT_ALWAYS,filename,separator);
+}
@@ -1,6 +1,61 @@
 #ifndef __LOGGER_H_
 #define __LOGGER_H_
 
+#define LOG_LEVEL_DEBUG     0
+#define LOG_LEVEL_INFO      1
+#define LOG_LEVEL_WARNING   2
+#define LOG_LEVEL_ERROR     3
+#define LOG_LEVEL_NONE      4
+
+//Messages below LOG_COMPILE_LEVEL are removed by the preprocessor, arguments and all.
+//Define it on the compiler command line to change it, e.g. -DLOG_COMPILE_LEVEL=2
+#ifndef LOG_COMPILE_LEVEL
+    #ifdef NDEBUG
+        #define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+    #else
+        #define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+    #endif
+#endif
+
+#define LOGGER_RING_SIZE            1024    //must be a power of two
+#define LOGGER_MAX_MESSAGE          640     //the longest messages callers put together are 600 characters
+#define LOGGER_MAX_FILENAME         64
+#define LOGGER_MAX_OPEN_FILES       8
+#define LOGGER_REPEAT_INTERVAL_MS   1000    //an identical repeated message is summarized at most once per interval
+
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_DEBUG
+    #define logDebug(filename,...) loggerWrite(LOG_LEVEL_DEBUG,filename,__VA_ARGS__)
+#else
+    #define logDebug(filename,...) ((void)0)
+#endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_INFO
+    #define logInfo(filename,...) loggerWrite(LOG_LEVEL_INFO,filename,__VA_ARGS__)
+#else
+    #define logInfo(filename,...) ((void)0)
+#endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_WARNING
+    #define logWarning(filename,...) loggerWrite(LOG_LEVEL_WARNING,filename,__VA_ARGS__)
+#else
+    #define logWarning(filename,...) ((void)0)
+#endif
+#if LOG_COMPILE_LEVEL <= LOG_LEVEL_ERROR
+    #define logError(filename,...) loggerWrite(LOG_LEVEL_ERROR,filename,__VA_ARGS__)
+#else
+    #define logError(filename,...) ((void)0)
+#endif
+
+//Starts the background writer. Until it runs (and after loggerShutdown) messages are written directly.
+int loggerInit();
+void loggerShutdown();
+//Blocks until every message queued before the call has been written to disk.
+void loggerFlush();
+void loggerSetLevel(int level);
+int loggerGetLevel();
+int loggerGetDroppedCount();
+int loggerGetTruncatedCount();
+void loggerWrite(int level,char *filename,const char *format,...);
+
+//Compatibility layer, these messages are queued at LOG_LEVEL_ERROR and written without a level prefix.
 void setLoggerDirectory(char *directory);
 void writeToLog(char *message,char *filename);
 void writeSeparatorToLog(char *filename);
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "mappedFile.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+mappedFileT *mappedFileOpen(char *filename)
+{
+    mappedFileT *mappedFile;
+    char msg[300];
+
+    if(filename == NULL){
+        writeToLog("Error in function: mappedFileOpen(...) - Parameter char *filename is NULL!","error.txt");
+        return NULL;
+    }
+    mappedFile = malloc(sizeof(struct mappedFileT));
+    if(mappedFile == NULL){
+        writeToLog("Error in function: mappedFileOpen(...) - Could not allocate memory for mapped file!","error.txt");
+        return NULL;
+    }
+    mappedFile->data = NULL;
+    mappedFile->size = 0;
+
+#ifdef _WIN32
+    {
+        HANDLE file;
+        HANDLE mapping;
+        LARGE_INTEGER size;
+
+        file = CreateFileA(filename,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+        if(file == INVALID_HANDLE_VALUE){
+            sprintf(msg,"Error in function: mappedFileOpen(...) - Could not open %.200s!",filename);
+            writeToLog(msg,"error.txt");
+            free(mappedFile);
+            return NULL;
+        }
+        if(GetFileSizeEx(file,&size) == 0 || size.QuadPart == 0 || (unsigned long long)size.QuadPart > (size_t)-1){
+            sprintf(msg,"Error in function: mappedFileOpen(...) - %.200s is empty or too large to map!",filename);
+            writeToLog(msg,"error.txt");
+            CloseHandle(file);
+            free(mappedFile);
+            return NULL;
+        }
+        //PAGE_WRITECOPY + FILE_MAP_COPY is the copy-on-write mapping, the view keeps the mapping alive
+        mapping = CreateFileMappingA(file,NULL,PAGE_WRITECOPY,0,0,NULL);
+        if(mapping != NULL){
+            mappedFile->data = MapViewOfFile(mapping,FILE_MAP_COPY,0,0,0);
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        mappedFile->size = (size_t)size.QuadPart;
+    }
+#else
+    {
+        int fd;
+        struct stat info;
+        void *data;
+
+        fd = open(filename,O_RDONLY);
+        if(fd < 0){
+            sprintf(msg,"Error in function: mappedFileOpen(...) - Could not open %.200s!",filename);
+            writeToLog(msg,"error.txt");
+            free(mappedFile);
+            return NULL;
+        }
+        if(fstat(fd,&info) != 0 || info.st_size == 0 || (unsigned long long)info.st_size > (size_t)-1){
+            sprintf(msg,"Error in function: mappedFileOpen(...) - %.200s is empty or too large to map!",filename);
+            writeToLog(msg,"error.txt");
+            close(fd);
+            free(mappedFile);
+            return NULL;
+        }
+        //MAP_PRIVATE is the copy-on-write mapping, it stays valid after the file is closed
+        data = mmap(NULL,(size_t)info.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+        close(fd);
+        if(data != MAP_FAILED){
+            mappedFile->data = data;
+        }
+        mappedFile->size = (size_t)info.st_size;
+    }
+#endif
+
+    if(mappedFile->data == NULL){
+        sprintf(msg,"Error in function: mappedFileOpen(...) - Could not map %.200s into memory!",filename);
+        writeToLog(msg,"error.txt");
+        free(mappedFile);
+        return NULL;
+    }
+    return mappedFile;
+}
+
+void mappedFileClose(mappedFileT *mappedFile)
+{
+    if(mappedFile == NULL){
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(mappedFile->data);
+#else
+    munmap(mappedFile->data,mappedFile->size);
+#endif
+    free(mappedFile);
+}
+
+int mappedFileReplace(FILE *tmpFile,char *tmpFilename,char *filename)
+{
+    int ok = 1;
+
+    //the data must be on the disk before the rename makes it visible
+    if(fflush(tmpFile) != 0){
+        ok = 0;
+    }
+#ifdef _WIN32
+    if(ok && _commit(_fileno(tmpFile)) != 0){
+        ok = 0;
+    }
+#else
+    if(ok && fsync(fileno(tmpFile)) != 0){
+        ok = 0;
+    }
+#endif
+    if(fclose(tmpFile) != 0){
+        ok = 0;
+    }
+    if(ok){
+#ifdef _WIN32
+        ok = MoveFileExA(tmpFilename,filename,MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        ok = rename(tmpFilename,filename) == 0;
+#endif
+    }
+    if(!ok){
+        remove(tmpFilename);
+    }
+    return ok;
+}
@@ -0,0 +1,21 @@
+#ifndef __MAPPED_FILE_H_
+#define __MAPPED_FILE_H_
+
+#include <stdio.h>
+
+//A whole file mapped into memory copy-on-write: pages are read from the file on first use and shared
+//with every other process that maps the same file, until they are written to.
+//Writes stay private to the process, they never reach the file.
+typedef struct mappedFileT
+{
+    void *data;
+    size_t size;
+}mappedFileT;
+
+mappedFileT *mappedFileOpen(char *filename);
+void mappedFileClose(mappedFileT *mappedFile);
+//Flushes and closes tmpFile, then moves tmpFilename over filename in one step,
+//so filename is either the old or the new file, never half of one. Returns 1 on success, 0 on failure.
+int mappedFileReplace(FILE *tmpFile,char *tmpFilename,char *filename);
+
+#endif // __MAPPED_FILE_H_
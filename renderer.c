@@ -6,6 +6,7 @@
 
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
+static int drawCallCount = 0;
 
 void initRenderer(char *windowCaption)
 {
@@ -42,3 +43,20 @@ void closeRenderer()
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
 }
+
+//Every call that submits something to the renderer (SDL_RenderCopyEx etc.) is counted,
+//so the benchmarks can report the number of draw calls per frame
+void countDrawCall()
+{
+    drawCallCount++;
+}
+
+int getDrawCallCount()
+{
+    return drawCallCount;
+}
+
+void resetDrawCallCount()
+{
+    drawCallCount = 0;
+}
@@ -8,6 +8,9 @@ void initRenderer(char *windowCaption);
 SDL_Renderer *getRenderer();
 SDL_Window *getWindow();
 void closeRenderer();
+void countDrawCall();
+int getDrawCallCount();
+void resetDrawCallCount();
 
 
 #endif // __RENDERER_H
@@ -1,39 +1,59 @@
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "IsoEngine/isoEngine.h"
 #include "renderer.h"
 #include "texture.h"
+#include "textureCache.h"
 #include "logger.h"
 
+//The image comes from the texture cache, a file that is already loaded is not decoded and uploaded again
 int loadTexture(textureT *texture, char *filename)
 {
-    char msg[200];
-    SDL_Surface *tmpSurface = IMG_Load(filename);
+    SDL_Texture *cached = textureCacheAcquire(filename,&texture->width,&texture->height);
 
-    if(tmpSurface == NULL){
-        sprintf(msg,"Texture error: Could not load image:%s! SDL_image Error:%s\n",filename,IMG_GetError());
-        writeToLog(msg,"error.log");
+    if(cached == NULL){
         return 0;
     }
-    else{
-        texture->texture = SDL_CreateTextureFromSurface(getRenderer(),tmpSurface);
+    texture->texture = cached;
+    texture->loading = NULL;
+    return 1;
+}
 
-        if(texture->texture == NULL){
-            sprintf(msg,"Texture error: Could not load image:%s! SDL_image Error:%s\n",filename,IMG_GetError());
-            writeToLog(msg,"error.log");
-            SDL_FreeSurface(tmpSurface);
-            return 0;
-        }
-        else{
-            texture->width = tmpSurface->w;
-            texture->height = tmpSurface->h;
-        }
-        SDL_FreeSurface(tmpSurface);
-        return 1;
+//Like loadTexture, but the image is decoded in the background. The width and height are set at once,
+//the texture is drawn as a placeholder until textureCacheUpdate has uploaded it.
+int loadTextureAsync(textureT *texture, char *filename)
+{
+    textureCacheEntryT *entry = textureCacheAcquireAsync(filename,&texture->width,&texture->height);
+
+    if(entry == NULL){
+        return 0;
+    }
+    texture->texture = entry->texture;
+    texture->loading = entry->texture == NULL ? entry : NULL;
+    return 1;
+}
+
+//Returns 1 once the texture can be drawn, picking it up from the texture cache when it has finished loading
+int textureIsLoaded(textureT *texture)
+{
+    if(texture->texture == NULL && texture->loading != NULL && texture->loading->texture != NULL){
+        texture->texture = texture->loading->texture;
+        texture->loading = NULL;
     }
-    return 0;
+    return texture->texture != NULL;
+}
+
+static void textureDrawPlaceholder(SDL_Rect *quads,int numQuads)
+{
+    Uint8 r,g,b,a;
+
+    SDL_GetRenderDrawColor(getRenderer(),&r,&g,&b,&a);
+    SDL_SetRenderDrawColor(getRenderer(),TEXTURE_PLACEHOLDER_R,TEXTURE_PLACEHOLDER_G,TEXTURE_PLACEHOLDER_B,0xff);
+    SDL_RenderFillRects(getRenderer(),quads,numQuads);
+    SDL_SetRenderDrawColor(getRenderer(),r,g,b,a);
+    countDrawCall();
 }
 
 void textureInit(textureT *texture, int x,int y, double angle, SDL_Point *center, SDL_Rect *cliprect, SDL_RendererFlip fliptype)
@@ -44,14 +64,13 @@ void textureInit(textureT *texture, int x,int y, double angle, SDL_Point *center
     texture->center = center;
     texture->fliptype = fliptype;
     texture->cliprect = cliprect;
+    texture->loading = NULL;
 }
 
 void textureRenderXYClip(textureT *texture, int x, int y, SDL_Rect *cliprect)
 {
-    char msg[200];
     if(texture==NULL){
-        sprintf(msg,"Warning: passed texture was null!\n");
-        writeToLog(msg,"error.txt");
+        logWarning("error.txt","textureRenderXYClip(...) - passed texture was null!");
         return;
     }
     texture->x = x;
@@ -63,34 +82,75 @@ void textureRenderXYClip(textureT *texture, int x, int y, SDL_Rect *cliprect)
         quad.w = texture->cliprect->w;
         quad.h = texture->cliprect->h;
     }
+    if(!textureIsLoaded(texture)){
+        textureDrawPlaceholder(&quad,1);
+        return;
+    }
 
     SDL_RenderCopyEx(getRenderer(),texture->texture,texture->cliprect,&quad,texture->angle, texture->center,texture->fliptype);
+    countDrawCall();
 }
-void textureRenderXYClipScale(textureT *texture, int x, int y, SDL_Rect *cliprect,float scale)
+void textureGetQuadXYClipScale(textureT *texture, int x, int y, SDL_Rect *cliprect,float scale,SDL_Rect *quad)
 {
     float w,h;
     float diffx,diffy;
-    SDL_Rect quad;
     w=(float)texture->width+1*scale;
     h=(float)texture->height+1*scale;
 
     diffx = (x*scale) - x;
     diffy = (y*scale) - y;
 
-    setupRect(&quad,(x*scale)-diffx,(y*scale)-diffy,w,h);
-
-    texture->cliprect = cliprect;
+    setupRect(quad,(x*scale)-diffx,(y*scale)-diffy,w,h);
 
-    if(texture->cliprect != NULL){
-        quad.w = (int)texture->cliprect->w*scale;
-        quad.h = (int)texture->cliprect->h*scale;
+    if(cliprect != NULL){
+        quad->w = (int)cliprect->w*scale;
+        quad->h = (int)cliprect->h*scale;
 
         if(scale <1.0 || scale >1.0){
-            quad.h +=1;
-            quad.w +=1;
+            quad->h +=1;
+            quad->w +=1;
         }
     }
+}
+
+void textureRenderXYClipScale(textureT *texture, int x, int y, SDL_Rect *cliprect,float scale)
+{
+    SDL_Rect quad;
+
+    texture->cliprect = cliprect;
+    textureGetQuadXYClipScale(texture,x,y,cliprect,scale,&quad);
+    if(!textureIsLoaded(texture)){
+        textureDrawPlaceholder(&quad,1);
+        return;
+    }
+
     SDL_RenderCopyEx(getRenderer(),texture->texture,texture->cliprect,&quad,texture->angle,texture->center,texture->fliptype);
+    countDrawCall();
+}
+
+//The quad of textureGetQuadXYClipScale with the size from a textureQuadTableT. At the zoom levels of the game
+//(multiples of 0.25) the position textureGetQuadXYClipScale computes is exactly x,y, so the quads are identical.
+void textureGetQuadXYClipSize(int x, int y, SDL_Point *size,SDL_Rect *quad)
+{
+    quad->x = x;
+    quad->y = y;
+    quad->w = size->x;
+    quad->h = size->y;
+}
+
+void textureRenderXYClipSize(textureT *texture, int x, int y, SDL_Rect *cliprect,SDL_Point *size)
+{
+    SDL_Rect quad;
+
+    texture->cliprect = cliprect;
+    textureGetQuadXYClipSize(x,y,size,&quad);
+    if(!textureIsLoaded(texture)){
+        textureDrawPlaceholder(&quad,1);
+        return;
+    }
+
+    SDL_RenderCopyEx(getRenderer(),texture->texture,texture->cliprect,&quad,texture->angle,texture->center,texture->fliptype);
+    countDrawCall();
 }
 
 void textureDelete(textureT *texture)
@@ -98,7 +158,266 @@ void textureDelete(textureT *texture)
     if(texture!=NULL)
     {
         if(texture->texture != NULL){
-            SDL_DestroyTexture(texture->texture);
+            textureCacheRelease(texture->texture);
+            texture->texture = NULL;
+        }
+        if(texture->loading != NULL){
+            textureCacheReleaseEntry(texture->loading);
+            texture->loading = NULL;
         }
     }
 }
+
+void textureBatchInit(textureBatchT *batch)
+{
+    batch->texture = NULL;
+    batch->numQuads = 0;
+    batch->maxQuads = 0;
+    batch->srcRects = NULL;
+    batch->dstRects = NULL;
+#if SDL_VERSION_ATLEAST(2,0,18)
+    batch->vertices = NULL;
+#endif
+    batch->indices = NULL;
+}
+
+void textureBatchBegin(textureBatchT *batch,textureT *texture)
+{
+    batch->texture = texture;
+    batch->numQuads = 0;
+}
+
+static int textureBatchGrow(textureBatchT *batch)
+{
+    int i;
+    int maxQuads = batch->maxQuads == 0 ? 1024 : batch->maxQuads*2;
+    SDL_Rect *srcRects = realloc(batch->srcRects,maxQuads*sizeof(SDL_Rect));
+    SDL_Rect *dstRects;
+    int *indices;
+
+    if(srcRects == NULL){
+        return 0;
+    }
+    batch->srcRects = srcRects;
+
+    dstRects = realloc(batch->dstRects,maxQuads*sizeof(SDL_Rect));
+    if(dstRects == NULL){
+        return 0;
+    }
+    batch->dstRects = dstRects;
+
+#if SDL_VERSION_ATLEAST(2,0,18)
+    SDL_Vertex *vertices = realloc(batch->vertices,maxQuads*4*sizeof(SDL_Vertex));
+    if(vertices == NULL){
+        return 0;
+    }
+    batch->vertices = vertices;
+#endif
+
+    indices = realloc(batch->indices,maxQuads*6*sizeof(int));
+    if(indices == NULL){
+        return 0;
+    }
+    batch->indices = indices;
+
+    //two triangles per quad, the indices never change
+    for(i=batch->maxQuads;i<maxQuads;++i){
+        indices[i*6+0] = i*4+0;
+        indices[i*6+1] = i*4+1;
+        indices[i*6+2] = i*4+2;
+        indices[i*6+3] = i*4+0;
+        indices[i*6+4] = i*4+2;
+        indices[i*6+5] = i*4+3;
+    }
+    batch->maxQuads = maxQuads;
+    return 1;
+}
+
+void textureBatchAddXYClipScale(textureBatchT *batch,int x,int y,SDL_Rect *cliprect,float scale)
+{
+    char msg[200];
+
+    if(batch->texture == NULL || cliprect == NULL){
+        return;
+    }
+    if(batch->numQuads == batch->maxQuads && textureBatchGrow(batch) == 0){
+        sprintf(msg,"Error in function textureBatchAddXYClipScale(...) - Could not allocate memory for %d quads!",batch->maxQuads*2);
+        writeToLog(msg,"error.txt");
+        return;
+    }
+    //the same destination rectangle as textureRenderXYClipScale, so the output is identical
+    batch->srcRects[batch->numQuads] = *cliprect;
+    textureGetQuadXYClipScale(batch->texture,x,y,cliprect,scale,&batch->dstRects[batch->numQuads]);
+    batch->numQuads++;
+}
+
+void textureBatchAddXYClipSize(textureBatchT *batch,int x,int y,SDL_Rect *cliprect,SDL_Point *size)
+{
+    char msg[200];
+
+    if(batch->texture == NULL || cliprect == NULL){
+        return;
+    }
+    if(batch->numQuads == batch->maxQuads && textureBatchGrow(batch) == 0){
+        sprintf(msg,"Error in function textureBatchAddXYClipSize(...) - Could not allocate memory for %d quads!",batch->maxQuads*2);
+        writeToLog(msg,"error.txt");
+        return;
+    }
+    batch->srcRects[batch->numQuads] = *cliprect;
+    textureGetQuadXYClipSize(x,y,size,&batch->dstRects[batch->numQuads]);
+    batch->numQuads++;
+}
+
+//Appends the quads of another batch, e.g. one that was filled on another thread
+void textureBatchAppend(textureBatchT *batch,textureBatchT *quads)
+{
+    char msg[200];
+
+    if(batch->texture == NULL || quads->numQuads == 0){
+        return;
+    }
+    while(batch->numQuads + quads->numQuads > batch->maxQuads){
+        if(textureBatchGrow(batch) == 0){
+            sprintf(msg,"Error in function textureBatchAppend(...) - Could not allocate memory for %d quads!",batch->maxQuads*2);
+            writeToLog(msg,"error.txt");
+            return;
+        }
+    }
+    memcpy(&batch->srcRects[batch->numQuads],quads->srcRects,quads->numQuads*sizeof(SDL_Rect));
+    memcpy(&batch->dstRects[batch->numQuads],quads->dstRects,quads->numQuads*sizeof(SDL_Rect));
+    batch->numQuads += quads->numQuads;
+}
+
+//Draws the quads one by one, one draw call each
+void textureBatchDrawEach(textureBatchT *batch)
+{
+    int i;
+
+    if(batch->texture == NULL){
+        return;
+    }
+    if(!textureIsLoaded(batch->texture)){
+        textureDrawPlaceholder(batch->dstRects,batch->numQuads);
+        batch->numQuads = 0;
+        return;
+    }
+    for(i=0;i<batch->numQuads;++i){
+        SDL_RenderCopy(getRenderer(),batch->texture->texture,&batch->srcRects[i],&batch->dstRects[i]);
+        countDrawCall();
+    }
+    batch->numQuads = 0;
+}
+
+void textureBatchDraw(textureBatchT *batch)
+{
+    int i;
+    SDL_Rect *src,*dst;
+
+    if(batch->texture == NULL || batch->numQuads == 0){
+        return;
+    }
+    if(!textureIsLoaded(batch->texture)){
+        textureDrawPlaceholder(batch->dstRects,batch->numQuads);
+        batch->numQuads = 0;
+        return;
+    }
+#if SDL_VERSION_ATLEAST(2,0,18)
+    SDL_Vertex *vertex;
+    float texW = (float)batch->texture->width;
+    float texH = (float)batch->texture->height;
+
+    for(i=0;i<batch->numQuads;++i){
+        src = &batch->srcRects[i];
+        dst = &batch->dstRects[i];
+        vertex = &batch->vertices[i*4];
+
+        vertex[0].position.x = dst->x;
+        vertex[0].position.y = dst->y;
+        vertex[0].tex_coord.x = src->x/texW;
+        vertex[0].tex_coord.y = src->y/texH;
+
+        vertex[1].position.x = dst->x+dst->w;
+        vertex[1].position.y = dst->y;
+        vertex[1].tex_coord.x = (src->x+src->w)/texW;
+        vertex[1].tex_coord.y = src->y/texH;
+
+        vertex[2].position.x = dst->x+dst->w;
+        vertex[2].position.y = dst->y+dst->h;
+        vertex[2].tex_coord.x = (src->x+src->w)/texW;
+        vertex[2].tex_coord.y = (src->y+src->h)/texH;
+
+        vertex[3].position.x = dst->x;
+        vertex[3].position.y = dst->y+dst->h;
+        vertex[3].tex_coord.x = src->x/texW;
+        vertex[3].tex_coord.y = (src->y+src->h)/texH;
+
+        vertex[0].color.r = vertex[0].color.g = vertex[0].color.b = vertex[0].color.a = 0xff;
+        vertex[1].color = vertex[2].color = vertex[3].color = vertex[0].color;
+    }
+    if(SDL_RenderGeometry(getRenderer(),batch->texture->texture,batch->vertices,batch->numQuads*4,batch->indices,batch->numQuads*6)==0){
+        countDrawCall();
+        batch->numQuads = 0;
+        return;
+    }
+#endif
+    //the renderer can not draw geometry, draw the quads one by one
+    textureBatchDrawEach(batch);
+}
+
+void textureBatchFree(textureBatchT *batch)
+{
+    free(batch->srcRects);
+    free(batch->dstRects);
+#if SDL_VERSION_ATLEAST(2,0,18)
+    free(batch->vertices);
+#endif
+    free(batch->indices);
+    textureBatchInit(batch);
+}
+
+void textureQuadTableInit(textureQuadTableT *table)
+{
+    table->scale = 0;
+    table->numQuads = 0;
+    table->sizes = NULL;
+}
+
+//Returns 1 when the sizes are up to date for the scale, 0 when the memory for them could not be allocated
+int textureQuadTableUpdate(textureQuadTableT *table,SDL_Rect *cliprects,int numCliprects,float scale)
+{
+    int i;
+    SDL_Point *sizes;
+    SDL_Rect quad;
+
+    if(table->sizes != NULL && table->numQuads == numCliprects && table->scale == scale){
+        return 1;
+    }
+    if(table->sizes == NULL || table->numQuads != numCliprects){
+        sizes = realloc(table->sizes,sizeof(SDL_Point)*SDL_max(numCliprects,1));
+        if(sizes == NULL){
+            writeToLog("Error in function: textureQuadTableUpdate(...) - Could not allocate memory for the quad sizes!","error.txt");
+            return 0;
+        }
+        table->sizes = sizes;
+    }
+    //the same float math as textureGetQuadXYClipScale, once per clip rect instead of once per quad
+    for(i=0;i<numCliprects;++i){
+        quad.w = (int)cliprects[i].w*scale;
+        quad.h = (int)cliprects[i].h*scale;
+        if(scale <1.0 || scale >1.0){
+            quad.h +=1;
+            quad.w +=1;
+        }
+        table->sizes[i].x = quad.w;
+        table->sizes[i].y = quad.h;
+    }
+    table->numQuads = numCliprects;
+    table->scale = scale;
+    return 1;
+}
+
+void textureQuadTableFree(textureQuadTableT *table)
+{
+    free(table->sizes);
+    textureQuadTableInit(table);
+}
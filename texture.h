@@ -1,6 +1,13 @@
 #ifndef TEXTURE_H_
 #define TEXTURE_H_
 
+struct textureCacheEntryT;
+
+//A texture loaded with loadTextureAsync is drawn as a placeholder rectangle in this color until it is loaded
+#define TEXTURE_PLACEHOLDER_R   0x55
+#define TEXTURE_PLACEHOLDER_G   0x55
+#define TEXTURE_PLACEHOLDER_B   0x60
+
 typedef struct textureT
 {
     int x;
@@ -12,12 +19,53 @@ typedef struct textureT
     SDL_Rect *cliprect;
     SDL_RendererFlip fliptype;
     SDL_Texture *texture;
+    struct textureCacheEntryT *loading;     //the texture cache entry of a texture that is still loading
 }textureT;
 
+//Collects many clipped quads of one texture and draws them with a single SDL_RenderGeometry call.
+//Without SDL 2.0.18 or a renderer that supports geometry the quads are drawn one by one.
+typedef struct textureBatchT
+{
+    textureT *texture;
+    int numQuads;
+    int maxQuads;
+    SDL_Rect *srcRects;
+    SDL_Rect *dstRects;
+#if SDL_VERSION_ATLEAST(2,0,18)
+    SDL_Vertex *vertices;
+#endif
+    int *indices;
+}textureBatchT;
+
+//The destination sizes textureGetQuadXYClipScale gives every clip rect of a texture at one scale.
+//textureQuadTableUpdate only rebuilds them when the scale changes, the quads are then placed without any float math.
+typedef struct textureQuadTableT
+{
+    float scale;
+    int numQuads;
+    SDL_Point *sizes;
+}textureQuadTableT;
+
 int loadTexture(textureT *texture, char *filename);
+int loadTextureAsync(textureT *texture, char *filename);
+int textureIsLoaded(textureT *texture);
 void textureInit(textureT *texture, int x,int y, double angle, SDL_Point *center, SDL_Rect *cliprect, SDL_RendererFlip fliptype);
 void textureRenderXYClip(textureT *texture, int x, int y, SDL_Rect *cliprect);
 void textureRenderXYClipScale(textureT *texture, int x, int y, SDL_Rect *cliprect,float scale);
+void textureGetQuadXYClipScale(textureT *texture, int x, int y, SDL_Rect *cliprect,float scale,SDL_Rect *quad);
+void textureRenderXYClipSize(textureT *texture, int x, int y, SDL_Rect *cliprect,SDL_Point *size);
+void textureGetQuadXYClipSize(int x, int y, SDL_Point *size,SDL_Rect *quad);
 void textureDelete(textureT *texture);
+void textureQuadTableInit(textureQuadTableT *table);
+int textureQuadTableUpdate(textureQuadTableT *table,SDL_Rect *cliprects,int numCliprects,float scale);
+void textureQuadTableFree(textureQuadTableT *table);
+void textureBatchInit(textureBatchT *batch);
+void textureBatchBegin(textureBatchT *batch,textureT *texture);
+void textureBatchAddXYClipScale(textureBatchT *batch,int x,int y,SDL_Rect *cliprect,float scale);
+void textureBatchAddXYClipSize(textureBatchT *batch,int x,int y,SDL_Rect *cliprect,SDL_Point *size);
+void textureBatchAppend(textureBatchT *batch,textureBatchT *quads);
+void textureBatchDrawEach(textureBatchT *batch);
+void textureBatchDraw(textureBatchT *batch);
+void textureBatchFree(textureBatchT *batch);
 
 #endif // TEXTURE_H_
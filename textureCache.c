@@ -0,0 +1,372 @@
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "textureCache.h"
+#include "renderer.h"
+#include "logger.h"
+
+static textureCacheEntryT *entries = NULL;
+static int hits = 0;
+static int misses = 0;
+//the memory of the textures that were loading since everything was loaded the last time, for textureCacheGetProgress
+static size_t loadingMemory = 0;
+static size_t loadedMemory = 0;
+
+static textureCacheEntryT *textureCacheFind(const char *path)
+{
+    textureCacheEntryT *entry;
+
+    for(entry=entries;entry!=NULL;entry=entry->next){
+        if(strcmp(entry->path,path)==0){
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static size_t textureCacheGetMemory(SDL_Texture *texture,int width,int height)
+{
+    Uint32 format;
+
+    if(SDL_QueryTexture(texture,&format,NULL,NULL,NULL)!=0 || SDL_BYTESPERPIXEL(format) == 0){
+        return (size_t)width*height*4;
+    }
+    return (size_t)width*height*SDL_BYTESPERPIXEL(format);
+}
+
+static textureCacheEntryT *textureCacheNewEntry(const char *path)
+{
+    textureCacheEntryT *entry = malloc(sizeof(textureCacheEntryT));
+
+    if(entry == NULL){
+        logError("error.txt","textureCacheNewEntry(...) - Could not allocate memory for the cache entry of %s!",path);
+        return NULL;
+    }
+    snprintf(entry->path,TEXTURE_CACHE_MAX_PATH,"%s",path);
+    entry->texture = NULL;
+    entry->width = 0;
+    entry->height = 0;
+    entry->memory = 0;
+    entry->refCount = 0;
+    entry->job = NULL;
+    entry->failed = 0;
+    entry->next = entries;
+    entries = entry;
+    return entry;
+}
+
+static void textureCacheFreeEntry(textureCacheEntryT *entry)
+{
+    if(entry->job != NULL){
+        assetLoaderCancel(entry->job);
+        loadedMemory += entry->memory;
+    }
+    if(entry->texture != NULL){
+        SDL_DestroyTexture(entry->texture);
+    }
+    free(entry);
+}
+
+static void textureCacheRemoveEntry(textureCacheEntryT *entry)
+{
+    textureCacheEntryT **link;
+
+    for(link=&entries;*link!=NULL;link=&(*link)->next){
+        if(*link == entry){
+            *link = entry->next;
+            textureCacheFreeEntry(entry);
+            return;
+        }
+    }
+}
+
+//Creates the texture of the entry from the decoded image and frees the image, returns 0 on failure
+static int textureCacheUpload(textureCacheEntryT *entry,SDL_Surface *surface)
+{
+    if(surface == NULL){
+        logError("error.log","Texture error: Could not load image:%s! SDL_image Error:%s",entry->path,IMG_GetError());
+        entry->failed = 1;
+        return 0;
+    }
+    entry->texture = SDL_CreateTextureFromSurface(getRenderer(),surface);
+    if(entry->texture == NULL){
+        logError("error.log","Texture error: Could not create a texture from image:%s! SDL Error:%s",entry->path,SDL_GetError());
+        SDL_FreeSurface(surface);
+        entry->failed = 1;
+        return 0;
+    }
+    entry->width = surface->w;
+    entry->height = surface->h;
+    entry->memory = textureCacheGetMemory(entry->texture,entry->width,entry->height);
+    SDL_FreeSurface(surface);
+    return 1;
+}
+
+//Waits for the decoding of a loading entry and uploads it
+static void textureCacheFinishLoading(textureCacheEntryT *entry)
+{
+    SDL_Surface *surface = assetLoaderFinish(entry->job);
+
+    entry->job = NULL;
+    loadedMemory += entry->memory;
+    //the decoding thread has logged why
+    if(surface == NULL){
+        entry->failed = 1;
+        return;
+    }
+    textureCacheUpload(entry,surface);
+}
+
+//Returns the texture of the image file at path, loading it if it is not cached yet, or NULL if it can not be loaded
+SDL_Texture *textureCacheAcquire(const char *path,int *width,int *height)
+{
+    textureCacheEntryT *entry;
+
+    if(path == NULL){
+        logError("error.txt","textureCacheAcquire(...) - path is NULL!");
+        return NULL;
+    }
+    entry = textureCacheFind(path);
+    if(entry != NULL){
+        hits++;
+        //somebody else is loading it in the background, but we need it now
+        if(entry->job != NULL){
+            textureCacheFinishLoading(entry);
+        }
+        if(entry->failed){
+            logError("error.txt","textureCacheAcquire(...) - %s could not be loaded before!",path);
+            return NULL;
+        }
+    }
+    else{
+        if(strlen(path) >= TEXTURE_CACHE_MAX_PATH){
+            logError("error.txt","textureCacheAcquire(...) - The path %s is too long!",path);
+            return NULL;
+        }
+        misses++;
+        entry = textureCacheNewEntry(path);
+        if(entry == NULL){
+            return NULL;
+        }
+        if(textureCacheUpload(entry,IMG_Load(path)) == 0){
+            //the next try loads the file again
+            textureCacheRemoveEntry(entry);
+            return NULL;
+        }
+    }
+    entry->refCount++;
+    if(width != NULL){
+        *width = entry->width;
+    }
+    if(height != NULL){
+        *height = entry->height;
+    }
+    return entry->texture;
+}
+
+//Like textureCacheAcquire, but a file that is not cached yet is decoded in the background and the entry's
+//texture stays NULL until a textureCacheUpdate uploads it. The size is read from the file's header right away.
+//Files whose size can not be read that way are loaded at once. Returns NULL if the file can not be loaded.
+textureCacheEntryT *textureCacheAcquireAsync(const char *path,int *width,int *height)
+{
+    textureCacheEntryT *entry;
+    int w,h;
+
+    if(path == NULL){
+        logError("error.txt","textureCacheAcquireAsync(...) - path is NULL!");
+        return NULL;
+    }
+    entry = textureCacheFind(path);
+    if(entry != NULL && entry->failed){
+        logError("error.txt","textureCacheAcquireAsync(...) - %s could not be loaded before!",path);
+        return NULL;
+    }
+    if(entry != NULL){
+        hits++;
+    }
+    else if(strlen(path) < TEXTURE_CACHE_MAX_PATH && assetLoaderReadImageSize(path,&w,&h)){
+        entry = textureCacheNewEntry(path);
+        if(entry == NULL){
+            return NULL;
+        }
+        entry->job = assetLoaderDecode(path);
+        entry->width = w;
+        entry->height = h;
+        entry->memory = (size_t)w*h*4;
+        misses++;
+        loadingMemory += entry->memory;
+        //without decoding threads it is loaded now
+        if(entry->job == NULL){
+            loadedMemory += entry->memory;
+            if(textureCacheUpload(entry,IMG_Load(path)) == 0){
+                textureCacheRemoveEntry(entry);
+                return NULL;
+            }
+        }
+    }
+    else{
+        if(textureCacheAcquire(path,width,height) == NULL){
+            return NULL;
+        }
+        return textureCacheFind(path);
+    }
+    entry->refCount++;
+    if(width != NULL){
+        *width = entry->width;
+    }
+    if(height != NULL){
+        *height = entry->height;
+    }
+    return entry;
+}
+
+//Uploads the textures that have been decoded in the background, until maxMs milliseconds have passed
+//(at least one, 0 for all of them). Returns how many textures became ready.
+int textureCacheUpdate(Uint32 maxMs)
+{
+    int numReady = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 budget = maxMs*SDL_GetPerformanceFrequency()/1000;
+    textureCacheEntryT *entry;
+
+    for(entry=entries;entry!=NULL;entry=entry->next){
+        if(entry->job == NULL || !assetLoaderIsDone(entry->job)){
+            continue;
+        }
+        textureCacheFinishLoading(entry);
+        if(entry->texture != NULL){
+            numReady++;
+        }
+        if(maxMs > 0 && SDL_GetPerformanceCounter()-start >= budget){
+            break;
+        }
+    }
+    return numReady;
+}
+
+//How much of the textures that were loading in the background is loaded, from 0 to 1, weighted by their size
+float textureCacheGetProgress()
+{
+    textureCacheEntryT *entry;
+
+    //nothing is queued, and 0/0 would give the loading bar a NaN
+    if(loadingMemory == 0){
+        loadedMemory = 0;
+        return 1.0f;
+    }
+    for(entry=entries;entry!=NULL;entry=entry->next){
+        if(entry->job != NULL){
+            return (float)loadedMemory/loadingMemory;
+        }
+    }
+    loadingMemory = 0;
+    loadedMemory = 0;
+    return 1.0f;
+}
+
+void textureCacheReleaseEntry(textureCacheEntryT *entry)
+{
+    if(entry == NULL){
+        return;
+    }
+    if(entry->refCount > 0){
+        entry->refCount--;
+    }
+    else{
+        logWarning("error.txt","textureCacheRelease(...) - %s was released more often than it was acquired!",entry->path);
+    }
+}
+
+//Gives back a texture from textureCacheAcquire. A texture that is not from the cache is destroyed.
+void textureCacheRelease(SDL_Texture *texture)
+{
+    textureCacheEntryT *entry;
+
+    if(texture == NULL){
+        return;
+    }
+    for(entry=entries;entry!=NULL;entry=entry->next){
+        if(entry->texture == texture){
+            textureCacheReleaseEntry(entry);
+            return;
+        }
+    }
+    SDL_DestroyTexture(texture);
+}
+
+//Destroys the textures nobody uses, returns how many
+int textureCachePurge()
+{
+    int numPurged = 0;
+    textureCacheEntryT **link = &entries;
+    textureCacheEntryT *entry;
+
+    while(*link != NULL){
+        entry = *link;
+        if(entry->refCount == 0){
+            *link = entry->next;
+            textureCacheFreeEntry(entry);
+            numPurged++;
+        }
+        else{
+            link = &entry->next;
+        }
+    }
+    return numPurged;
+}
+
+void textureCacheGetStats(textureCacheStatsT *stats)
+{
+    textureCacheEntryT *entry;
+
+    stats->hits = hits;
+    stats->misses = misses;
+    stats->numTextures = 0;
+    stats->numUnused = 0;
+    stats->memory = 0;
+    stats->unusedMemory = 0;
+    stats->numLoading = 0;
+
+    for(entry=entries;entry!=NULL;entry=entry->next){
+        stats->numTextures++;
+        stats->memory += entry->memory;
+        if(entry->refCount == 0){
+            stats->numUnused++;
+            stats->unusedMemory += entry->memory;
+        }
+        if(entry->job != NULL){
+            stats->numLoading++;
+        }
+    }
+}
+
+void textureCacheResetStats()
+{
+    hits = 0;
+    misses = 0;
+}
+
+//Destroys every texture, call it before the renderer is destroyed
+void textureCacheShutdown()
+{
+    textureCacheEntryT *entry;
+    int numUsed = 0;
+
+    while(entries != NULL){
+        entry = entries;
+        entries = entry->next;
+        if(entry->refCount > 0){
+            numUsed++;
+        }
+        textureCacheFreeEntry(entry);
+    }
+    if(numUsed > 0){
+        logWarning("error.txt","textureCacheShutdown() - %d textures were still in use!",numUsed);
+    }
+    hits = 0;
+    misses = 0;
+    loadingMemory = 0;
+    loadedMemory = 0;
+}
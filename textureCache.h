@@ -0,0 +1,49 @@
+#ifndef __TEXTURE_CACHE_H_
+#define __TEXTURE_CACHE_H_
+
+#include <SDL2/SDL.h>
+#include "assetLoader.h"
+
+//Image files are loaded into a texture once and shared by everyone who loads the same path.
+//Every textureCacheAcquire is matched by a textureCacheRelease. A texture nobody uses any more stays
+//in the cache, so loading it again is free, until textureCachePurge or textureCacheShutdown destroys it.
+//Like all rendering, the cache is only used by the thread that owns the renderer.
+//textureCacheAcquireAsync returns before the file is decoded, the texture is created by a later textureCacheUpdate.
+#define TEXTURE_CACHE_MAX_PATH  256
+
+typedef struct textureCacheEntryT
+{
+    char path[TEXTURE_CACHE_MAX_PATH];
+    SDL_Texture *texture;
+    int width;
+    int height;
+    size_t memory;          //bytes of texture memory, estimated from the size and the pixel format
+    int refCount;
+    assetLoaderJobT *job;   //the decoding of a texture that is still loading, texture is NULL until it is done
+    int failed;             //the file could not be decoded or uploaded
+    struct textureCacheEntryT *next;
+}textureCacheEntryT;
+
+typedef struct textureCacheStatsT
+{
+    int hits;
+    int misses;             //every miss decoded a file and uploaded a texture
+    int numTextures;
+    int numUnused;          //textures with a reference count of 0, textureCachePurge would destroy them
+    size_t memory;
+    size_t unusedMemory;
+    int numLoading;         //textures that are decoded or wait for textureCacheUpdate
+}textureCacheStatsT;
+
+SDL_Texture *textureCacheAcquire(const char *path,int *width,int *height);
+textureCacheEntryT *textureCacheAcquireAsync(const char *path,int *width,int *height);
+int textureCacheUpdate(Uint32 maxMs);
+float textureCacheGetProgress();
+void textureCacheRelease(SDL_Texture *texture);
+void textureCacheReleaseEntry(textureCacheEntryT *entry);
+int textureCachePurge();
+void textureCacheGetStats(textureCacheStatsT *stats);
+void textureCacheResetStats();
+void textureCacheShutdown();
+
+#endif // __TEXTURE_CACHE_H_
@@ -0,0 +1,162 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "threadPool.h"
+#include "logger.h"
+
+//Takes jobs until there are none left, on the workers and on the thread that called threadPoolRun
+static void threadPoolWork(threadPoolT *pool,threadPoolJobT job,void *data,int numJobs)
+{
+    int next;
+
+    while((next = SDL_AtomicAdd(&pool->nextJob,1)) < numJobs){
+        job(data,next);
+    }
+}
+
+static int threadPoolWorker(void *data)
+{
+    threadPoolT *pool = data;
+    threadPoolJobT job;
+    void *jobData;
+    int numJobs;
+    int run = 0;
+
+    SDL_LockMutex(pool->lock);
+    while(1){
+        while(pool->run == run && !pool->quit){
+            SDL_CondWait(pool->wake,pool->lock);
+        }
+        if(pool->quit){
+            break;
+        }
+        run = pool->run;
+        job = pool->job;
+        jobData = pool->data;
+        numJobs = pool->numJobs;
+        SDL_UnlockMutex(pool->lock);
+
+        threadPoolWork(pool,job,jobData,numJobs);
+
+        SDL_LockMutex(pool->lock);
+        pool->numBusy--;
+        if(pool->numBusy == 0){
+            SDL_CondSignal(pool->done);
+        }
+    }
+    SDL_UnlockMutex(pool->lock);
+    return 0;
+}
+
+threadPoolT *threadPoolNew(int numWorkers)
+{
+    int i;
+    char name[32];
+    threadPoolT *pool = malloc(sizeof(threadPoolT));
+
+    if(pool == NULL){
+        writeToLog("Error in function: threadPoolNew(...) - Could not allocate memory for the thread pool!","error.txt");
+        return NULL;
+    }
+    if(numWorkers < 0){
+        numWorkers = SDL_GetCPUCount()-1;
+    }
+    numWorkers = SDL_min(numWorkers,THREAD_POOL_MAX_WORKERS);
+
+    pool->numWorkers = 0;
+    pool->job = NULL;
+    pool->data = NULL;
+    pool->numJobs = 0;
+    pool->run = 0;
+    pool->numBusy = 0;
+    pool->quit = 0;
+    SDL_AtomicSet(&pool->nextJob,0);
+    pool->lock = SDL_CreateMutex();
+    pool->wake = SDL_CreateCond();
+    pool->done = SDL_CreateCond();
+
+    if(pool->lock == NULL || pool->wake == NULL || pool->done == NULL){
+        writeToLog("Error in function: threadPoolNew(...) - Could not create the thread pool's mutex!","error.txt");
+        threadPoolFree(pool);
+        return NULL;
+    }
+    //with fewer workers than asked for the pool still works, only slower
+    for(i=0;i<numWorkers;++i){
+        sprintf(name,"threadPool%d",i);
+        pool->workers[i] = SDL_CreateThread(threadPoolWorker,name,pool);
+        if(pool->workers[i] == NULL){
+            logWarning("error.txt","threadPoolNew(...) - Could only start %d of %d worker threads: %s",i,numWorkers,SDL_GetError());
+            break;
+        }
+        pool->numWorkers++;
+    }
+    return pool;
+}
+
+void threadPoolFree(threadPoolT *pool)
+{
+    int i;
+
+    if(pool == NULL){
+        return;
+    }
+    if(pool->numWorkers > 0){
+        SDL_LockMutex(pool->lock);
+        pool->quit = 1;
+        SDL_CondBroadcast(pool->wake);
+        SDL_UnlockMutex(pool->lock);
+
+        for(i=0;i<pool->numWorkers;++i){
+            SDL_WaitThread(pool->workers[i],NULL);
+        }
+    }
+    if(pool->lock != NULL){
+        SDL_DestroyMutex(pool->lock);
+    }
+    if(pool->wake != NULL){
+        SDL_DestroyCond(pool->wake);
+    }
+    if(pool->done != NULL){
+        SDL_DestroyCond(pool->done);
+    }
+    free(pool);
+}
+
+int threadPoolGetNumThreads(threadPoolT *pool)
+{
+    return pool != NULL ? pool->numWorkers+1 : 1;
+}
+
+void threadPoolRun(threadPoolT *pool,threadPoolJobT job,void *data,int numJobs)
+{
+    int i;
+
+    if(job == NULL || numJobs <= 0){
+        return;
+    }
+    //nothing to gain from waking the workers for a single job
+    if(pool == NULL || pool->numWorkers == 0 || numJobs == 1){
+        for(i=0;i<numJobs;++i){
+            job(data,i);
+        }
+        return;
+    }
+    SDL_LockMutex(pool->lock);
+    pool->job = job;
+    pool->data = data;
+    pool->numJobs = numJobs;
+    pool->numBusy = pool->numWorkers;
+    SDL_AtomicSet(&pool->nextJob,0);
+    pool->run++;
+    SDL_CondBroadcast(pool->wake);
+    SDL_UnlockMutex(pool->lock);
+
+    threadPoolWork(pool,job,data,numJobs);
+
+    //the jobs are all taken, wait for the ones still running on the workers
+    SDL_LockMutex(pool->lock);
+    while(pool->numBusy > 0){
+        SDL_CondWait(pool->done,pool->lock);
+    }
+    SDL_UnlockMutex(pool->lock);
+}
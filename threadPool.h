@@ -0,0 +1,39 @@
+#ifndef __THREAD_POOL_H_
+#define __THREAD_POOL_H_
+
+#include <SDL2/SDL.h>
+
+//Runs numbered jobs on a fixed set of worker threads. threadPoolRun hands out the jobs 0 to numJobs-1,
+//works on them itself as well and returns when all of them are done, so the jobs may use the
+//caller's data without any locking as long as every job only writes to its own part of it.
+//Only one thread may call threadPoolRun at a time, and a job must not call it.
+#define THREAD_POOL_MAX_WORKERS     63
+
+typedef void (*threadPoolJobT)(void *data,int job);
+
+typedef struct threadPoolT
+{
+    int numWorkers;
+    SDL_Thread *workers[THREAD_POOL_MAX_WORKERS];
+    SDL_mutex *lock;
+    SDL_cond *wake;             //a new run has started, or the pool is freed
+    SDL_cond *done;             //the last worker has finished its part of the run
+
+    //the current run, written under the lock
+    threadPoolJobT job;
+    void *data;
+    int numJobs;
+    int run;                    //counts the runs, a worker waits until it changes
+    int numBusy;                //workers that have not finished the current run
+    int quit;
+    SDL_atomic_t nextJob;
+}threadPoolT;
+
+//numWorkers < 0 starts one worker per CPU core besides the calling thread, 0 runs every job on the calling thread
+threadPoolT *threadPoolNew(int numWorkers);
+void threadPoolFree(threadPoolT *pool);
+//the number of threads that work on a run, the calling thread included (1 for a NULL pool)
+int threadPoolGetNumThreads(threadPoolT *pool);
+void threadPoolRun(threadPoolT *pool,threadPoolJobT job,void *data,int numJobs);
+
+#endif // __THREAD_POOL_H_